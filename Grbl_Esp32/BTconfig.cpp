@@ -62,8 +62,12 @@ static void my_spp_cb(esp_spp_cb_event_t event, esp_spp_cb_param_t* param) {
     break;
     case ESP_SPP_CLOSE_EVT://Client connection closed
         grbl_send(CLIENT_ALL, "[MSG:BT Disconnected]\r\n");
+        status_push_stop(CLIENT_BT);
         BTConfig::_btclient = "";
         break;
+    case ESP_SPP_DATA_IND_EVT: // Data is in the SerialBT buffer
+        serial_notify();
+        break;
     default:
         break;
     }
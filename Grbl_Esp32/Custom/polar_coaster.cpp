@@ -168,7 +168,7 @@ void forward_kinematics(float *position) {
     float original_position[N_AXIS];  // temporary storage of original
     float print_position[N_AXIS];
     int32_t current_position[N_AXIS];  // Copy current state of the system position variable
-    memcpy(current_position, sys_position, sizeof(sys_position));
+    st_get_position(current_position);
     system_convert_array_steps_to_mpos(print_position, current_position);
     original_position[X_AXIS] = print_position[X_AXIS] - gc_state.coord_system[X_AXIS] + gc_state.coord_offset[X_AXIS];
     original_position[Y_AXIS] = print_position[Y_AXIS] - gc_state.coord_system[Y_AXIS] + gc_state.coord_offset[Y_AXIS];
@@ -42,6 +42,8 @@ void setup() {
     WiFi.enableSTA(false);
     WiFi.enableAP(false);
     WiFi.mode(WIFI_OFF);
+    report_init();   // Send buffers, before any message
+    output_queue_init(); // Start the task of each client that is sent to
     serial_init();   // Setup serial baud rate and interrupts
     grbl_msg_sendf(CLIENT_SERIAL, MSG_LEVEL_INFO, "Grbl_ESP32 Ver %s Date %s", GRBL_VERSION, GRBL_VERSION_BUILD); // print grbl_esp32 verion info
     grbl_msg_sendf(CLIENT_SERIAL, MSG_LEVEL_INFO, "Compiled with ESP32 SDK:%s", ESP.getSdkVersion()); // print the SDK version
@@ -56,6 +58,8 @@ void setup() {
 #endif
     settings_init(); // Load Grbl settings from EEPROM
     stepper_init();  // Configure stepper pins and interrupt timers
+    plan_init();     // Allocate the planner buffer
+    planner_task_init(); // Start planning on core 0, if USE_PLANNER_TASK
     system_ini();   // Configure pinout pins and pin-change interrupt (Renamed due to conflict with esp32 files)
     memset(sys_position, 0, sizeof(sys_position)); // Clear machine position.
 #ifdef USE_PEN_SERVO
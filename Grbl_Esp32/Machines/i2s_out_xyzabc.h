@@ -0,0 +1,64 @@
+/*
+    i2s_out_xyzabc.h
+    Part of Grbl_ESP32
+
+    Pin assignments for a 6-axis board with the step and direction
+    signals on two 74HC595 shift registers, driven by the I2S peripheral.
+
+    Grbl_ESP32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Grbl is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Grbl_ESP32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define MACHINE_NAME "I2S_OUT_XYZABC"
+
+#ifdef N_AXIS
+    #undef N_AXIS
+#endif
+#define N_AXIS 6
+
+#define SPINDLE_TYPE SPINDLE_TYPE_NONE
+
+// The shift registers replace the RMT step pulses
+#ifdef USE_RMT_STEPS
+    #undef USE_RMT_STEPS
+#endif
+#define USE_I2S_STEPS
+
+#define I2S_OUT_BCK             GPIO_NUM_22  // SHCP of both registers
+#define I2S_OUT_WS              GPIO_NUM_17  // STCP of both registers
+#define I2S_OUT_DATA            GPIO_NUM_21  // DS of the first register
+
+// Outputs of the shift registers, Q0 of the first one is 0
+#define X_DIRECTION_I2SO        0
+#define X_STEP_I2SO             1
+#define Y_DIRECTION_I2SO        2
+#define Y_STEP_I2SO             3
+#define Z_DIRECTION_I2SO        4
+#define Z_STEP_I2SO             5
+#define A_DIRECTION_I2SO        6
+#define A_STEP_I2SO             7
+#define B_DIRECTION_I2SO        8
+#define B_STEP_I2SO             9
+#define C_DIRECTION_I2SO        10
+#define C_STEP_I2SO             11
+
+#define STEPPERS_DISABLE_PIN    GPIO_NUM_13
+
+#define X_LIMIT_PIN             GPIO_NUM_36
+#define Y_LIMIT_PIN             GPIO_NUM_35
+#define Z_LIMIT_PIN             GPIO_NUM_34
+#define LIMIT_MASK              B111
+
+#define PROBE_PIN               GPIO_NUM_39
+
+#define DEFAULT_STEP_PULSE_MICROSECONDS 4 // One sample of the shift registers
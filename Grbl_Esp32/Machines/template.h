@@ -201,6 +201,21 @@
 // do not use ordinary stepper motors.  To turn it off, do this:
 // #undef USE_RMT_STEPS
 
+// === Shift register outputs
+// Boards with many axes can put the step and direction signals
+// on a chain of 74HC595 shift registers, driven by the I2S
+// peripheral from three pins.  The outputs are numbered 0..31
+// from Q0 of the register next to the ESP32.  Instead of
+// X_STEP_PIN etc., define:
+// #undef USE_RMT_STEPS
+// #define USE_I2S_STEPS
+// #define I2S_OUT_BCK             GPIO_NUM_22  // to SHCP, the shift clock
+// #define I2S_OUT_WS              GPIO_NUM_17  // to STCP, the latch
+// #define I2S_OUT_DATA            GPIO_NUM_21  // to DS, the serial data
+// #define X_STEP_I2SO             2
+// #define X_DIRECTION_I2SO        1
+// Ganged motors use X2_STEP_I2SO and X2_DIRECTION_I2SO.
+
 // === Special Features
 // Grbl_ESP32 can support non-Cartesian machines and some other
 // scenarios that cannot be handled by choosing from a set of
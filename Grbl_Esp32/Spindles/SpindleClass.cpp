@@ -46,6 +46,9 @@ DacSpindle dac_spindle;
 HuanyangSpindle huanyang_spindle;
 BESCSpindle besc_spindle;
 
+// The currently selected spindle. Set by spindle_select()
+Spindle* spindle;
+
 
 void spindle_select(uint8_t spindle_type) {
     
@@ -84,8 +87,11 @@ bool Spindle::isRateAdjusted() {
 }
 
 void Spindle :: spindle_sync(uint8_t state, uint32_t rpm) {
-    if (sys.state == STATE_CHECK_MODE)
+    if (sys.state == STATE_CHECK_MODE) {
+        if (job_compiling)
+            job_compile_spindle(state, rpm);
         return;
+    }
     protocol_buffer_synchronize(); // Empty planner buffer to ensure spindle is set when programmed.
     set_state(state, rpm);
 }
@@ -51,12 +51,12 @@
 // This is the base class. Do not use this as your spindle
 class Spindle {
   public:
-    virtual void init(); // not in constructor because this also gets called when $$ settings change
-    virtual uint32_t set_rpm(uint32_t rpm);
-    virtual void set_state(uint8_t state, uint32_t rpm);
-    virtual uint8_t get_state();
-    virtual void stop();
-    virtual void config_message();
+    virtual void init() = 0; // not in constructor because this also gets called when $$ settings change
+    virtual uint32_t set_rpm(uint32_t rpm) = 0;
+    virtual void set_state(uint8_t state, uint32_t rpm) = 0;
+    virtual uint8_t get_state() = 0;
+    virtual void stop() = 0;
+    virtual void config_message() = 0;
     virtual bool isRateAdjusted();
     virtual void spindle_sync(uint8_t state, uint32_t rpm);
 
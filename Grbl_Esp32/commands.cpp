@@ -107,6 +107,7 @@ bool COMMANDS::execute_internal_command(int cmd, String cmd_params, level_authen
             espresponse->println("[ESP210] - display SD Card content");
             espresponse->println("[ESP215](file/dir name) - delete SD Card file / directory");
             espresponse->println("[ESP220](file name) - run file from SD");
+            espresponse->println("[ESP230](file name) - compile file on SD into a job");
             espresponse->println("[ESP400] - display ESP3D settings in JSON");
             espresponse->println("[ESP401]P=(position) T=(type) V=(value) - Set specific setting");
             espresponse->println("[ESP410] - display available AP list (limited to 30) in JSON");
@@ -960,9 +961,11 @@ bool COMMANDS::execute_internal_command(int cmd, String cmd_params, level_authen
             espresponse->println("");
             return false;
         }
-        char fileLine[255];
+        char fileLine[SD_LINE_BUFFER_SIZE];
         SD_client = (espresponse) ? espresponse->client() : CLIENT_ALL;
-        if (!readFileLine(fileLine)) {
+        if (sd_job_is_compiled()) {
+            SD_ready_next = true; // compiled jobs are played from the protocol loop, record by record
+        } else if (!readFileLine(fileLine)) {
             //No need notification here it is just a macro
             closeFile();
             espresponse->println("");
@@ -974,6 +977,48 @@ bool COMMANDS::execute_internal_command(int cmd, String cmd_params, level_authen
         espresponse->println("");
     }
     break;
+    //compile SD file into a job that plays without parsing, see gcode_job.h
+    //[ESP230]<filename>
+    case 230: {
+#ifdef ENABLE_AUTHENTICATION
+        if (auth_type == LEVEL_GUEST) {
+            if (espresponse)espresponse->println("Error: Wrong authentication!");
+            return false;
+        }
+#endif
+        if (!espresponse) return false;
+        parameter = get_param(cmd_params, "", true);
+        if (parameter.length() == 0) {
+            espresponse->println("Error: Missing file name!");
+            return false;
+        }
+        parameter.trim();
+        if (parameter[0] != '/')
+            parameter = "/" + parameter;
+        int8_t state = get_sd_state(true);
+        if (state  !=  SDCARD_IDLE) {
+            espresponse->println((state == SDCARD_NOT_PRESENT) ? "No SD card" : "Busy");
+            return false;
+        }
+        if (sys.state != STATE_IDLE) {
+            espresponse->println("Busy");
+            return false;
+        }
+        // the job gets the name of the file, with the job extension
+        String jobname = parameter;
+        int dot = jobname.lastIndexOf('.');
+        if (dot > jobname.lastIndexOf('/'))
+            jobname = jobname.substring(0, dot);
+        jobname += JOB_FILE_EXTENSION;
+        // the main loop compiles it, as the compiler uses the parser
+        if (!requestCompileFile(parameter.c_str(), jobname.c_str(), espresponse->client())) {
+            espresponse->println("Busy");
+            return false;
+        }
+        espresponse->print("Compiling: ");
+        espresponse->println(jobname.c_str());
+    }
+    break;
 #endif
     //Get full ESP32  settings content
     //[ESP400]
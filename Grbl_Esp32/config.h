@@ -195,6 +195,7 @@ Some features should not be changed. See notes below.
 #define CMD_SAFETY_DOOR 0x84
 #define CMD_JOG_CANCEL  0x85
 #define CMD_DEBUG_REPORT 0x86 // Only when DEBUG enabled, sends debug report in '{}' braces.
+#define CMD_STATUS_FRAME 0x87 // Binary status report, see status_frame.h.
 #define CMD_FEED_OVR_RESET 0x90         // Restores feed override value to 100%.
 #define CMD_FEED_OVR_COARSE_PLUS 0x91
 #define CMD_FEED_OVR_COARSE_MINUS 0x92
@@ -401,6 +402,12 @@ Some features should not be changed. See notes below.
 // certain the step segment buffer is increased/decreased to account for these changes.
 #define ACCELERATION_TICKS_PER_SECOND 100
 
+// Segments of motion at a constant speed only need to be short where the speed changes, so cruising
+// segments last up to 1/CRUISE_TICKS_PER_SECOND instead. Fewer, longer segments hold the same motion
+// in less of the step segment buffer and take less time to prepare. Must not be greater than
+// ACCELERATION_TICKS_PER_SECOND.
+#define CRUISE_TICKS_PER_SECOND 25 // Comment to cut all segments at ACCELERATION_TICKS_PER_SECOND.
+
 // Adaptive Multi-Axis Step Smoothing (AMASS) is an advanced feature that does what its name implies,
 // smoothing the stepping of multi-axis motions. This feature smooths motion particularly at low step
 // frequencies below 10kHz, where the aliasing between axes of multi-axis motions can cause audible
@@ -408,6 +415,13 @@ Some features should not be changed. See notes below.
 // step smoothing. See stepper.c for more details on the AMASS system works.
 #define ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING  // Default enabled. Comment to disable.
 
+// Input shaping cancels the ringing of belts and frames, which otherwise limits the acceleration. The
+// motion of each axis is split into a few impulses, timed and weighted by its ringing frequency ($190
+// and on) and damping ($200 and on) for the shaper type set with $38, so that the ringing they excite
+// cancels out. Axes with a frequency of 0 are only delayed along with the others, and with none set
+// the segments bypass the shaper. See input_shaper.cpp. Takes about 4KB of RAM.
+#define INPUT_SHAPING // Comment to disable.
+
 // Sets the maximum step rate allowed to be written as a Grbl setting. This option enables an error
 // check in the settings module to prevent settings values that will exceed this limitation. The maximum
 // step rate is strictly limited by the CPU speed and will change if something other than an AVR running
@@ -505,16 +519,33 @@ Some features should not be changed. See notes below.
 // While this is experimental, it is intended to be the future default method after testing
 //#define USE_RMT_STEPS
 
+// Goes further than USE_RMT_STEPS: the RMT channel of each axis plays whole trains of step pulses,
+// refilled from the segment buffer every 32 steps, instead of one pulse started by the step ISR
+// for each step. This takes the CPU out of the step timing and allows step rates of 200kHz and
+// more. Every axis needs its own RMT channel. The position is counted as the steps are filled in,
+// up to 64 steps ahead of the pulses. Homing and probing still use the step ISR.
+// NOTE: Requires USE_RMT_STEPS. Uncomment to enable, here or in the machine file.
+//#define USE_RMT_STEP_TRAINS
+
+// Step and direction outputs on 74HC595 style shift registers, loaded by the I2S peripheral from
+// DMA buffers that are filled from the segment buffer 1ms at a time. Takes only three pins for up
+// to 32 outputs and no CPU time per step, for machines with many axes. The outputs change every
+// 4us, which limits the step rate to about 60kHz with a 4us pulse. The machine file maps the
+// outputs with I2S_OUT_BCK, I2S_OUT_WS, I2S_OUT_DATA and X_STEP_I2SO, X_DIRECTION_I2SO, etc.,
+// see Machines/i2s_out_xyzabc.h.
+// NOTE: Replaces USE_RMT_STEPS, which must be #undef'd. Define in the machine file to enable.
+//#define USE_I2S_STEPS
+
 // Creates a delay between the direction pin setting and corresponding step pulse by creating
-// another interrupt (Timer2 compare) to manage it. The main Grbl interrupt (Timer1 compare)
+// another interrupt (the step pulse timer) to manage it. The main Grbl interrupt (step timer)
 // sets the direction pins, and does not immediately set the stepper pins, as it would in
-// normal operation. The Timer2 compare fires next to set the stepper pins after the step
-// pulse delay time, and Timer2 overflow will complete the step pulse, except now delayed
+// normal operation. The step pulse timer fires next to set the stepper pins after the step
+// pulse delay time, and fires again to complete the step pulse, except now delayed
 // by the step pulse time plus the step pulse delay. (Thanks langwadt for the idea!)
+// With USE_RMT_STEPS the delay is part of the RMT pulse instead.
 // NOTE: Uncomment to enable. The recommended delay must be > 3us, and, when added with the
-// user-supplied step pulse time, the total time must not exceed 127us. Reported successful
-// values for certain setups have ranged from 5 to 20us.
-// must use #define USE_RMT_STEPS for this to work
+// user-supplied step pulse time, the total time must be shorter than the step period at the
+// highest step rate. Reported successful values for certain setups have ranged from 5 to 20us.
 //#define STEP_PULSE_DELAY 10 // Step pulse delay in microseconds. Default disabled.
 
 // The number of linear motions in the planner buffer to be planned at any give time. The vast
@@ -524,13 +555,34 @@ Some features should not be changed. See notes below.
 // new incoming motions as they are executed.
 // #define BLOCK_BUFFER_SIZE 16 // Uncomment to override default in planner.h.
 
+// On boards with PSRAM (WROVER modules) the planner buffer is allocated there at startup and holds
+// this many blocks instead of BLOCK_BUFFER_SIZE. The deeper look-ahead lets jobs made of very short
+// segments, like laser rasters and 3D finishing passes, reach their programmed feed rate. Without
+// PSRAM the BLOCK_BUFFER_SIZE buffer in internal RAM is used. Must not exceed 65535.
+#define PSRAM_BLOCK_BUFFER_SIZE 1024 // Comment to always use BLOCK_BUFFER_SIZE.
+
+// The maximum number of the newest planner blocks that are re-planned when a block is added. This
+// bounds the planning time per block with a deep planner buffer. Blocks further back keep the plan
+// they had, which is always safe but can be slower than optimal if the distance needed to decelerate
+// from the feed rate spans more blocks than this.
+#define PLANNER_RECALCULATE_LIMIT 256 // Comment to always re-plan the whole buffer.
+
+// Plans line motions in a separate task on core 0 instead of in the main loop. The g-code parser
+// queues the parsed motions for the planner task, so a long re-plan no longer holds up reading the
+// clients or refilling the step segment buffer, which stay on core 1.
+#define USE_PLANNER_TASK // Comment to plan in the main loop, as Grbl does.
+// #define PLANNER_QUEUE_SIZE 32 // Uncomment to override default in planner_task.h. Power of two.
+
 // Governs the size of the intermediary step segment buffer between the step execution algorithm
 // and the planner blocks. Each segment is set of steps executed at a constant velocity over a
-// fixed time defined by ACCELERATION_TICKS_PER_SECOND. They are computed such that the planner
-// block velocity profile is traced exactly. The size of this buffer governs how much step
-// execution lead time there is for other Grbl processes have to compute and do their thing
-// before having to come back and refill this buffer, currently at ~50msec of step moves.
-// #define SEGMENT_BUFFER_SIZE 6 // Uncomment to override default in stepper.h.
+// time defined by ACCELERATION_TICKS_PER_SECOND, or CRUISE_TICKS_PER_SECOND when cruising. They
+// are computed such that the planner block velocity profile is traced exactly. How much step
+// execution lead time there is for other Grbl processes to compute and do their thing before
+// having to come back and refill this buffer is set at runtime with $37, in msec of step moves,
+// up to what fits in this many segments. More lead time rides out longer WiFi or SD card stalls,
+// but feed holds and overrides take effect only after the buffered motion. Must be a power of
+// two, at most 256, or 128 with INPUT_SHAPING.
+// #define SEGMENT_BUFFER_SIZE 64 // Uncomment to override default in stepper.h.
 
 // Line buffer size from the serial input stream to be executed. Also, governs the size of
 // each of the startup blocks, as they are each stored as a string of this size. Make sure
@@ -555,6 +607,12 @@ Some features should not be changed. See notes below.
 // #define RX_BUFFER_SIZE 128 // (1-254) Uncomment to override defaults in serial.h
 // #define TX_BUFFER_SIZE 100 // (1-254)
 
+// SD card jobs are read ahead of the parser by a task on core 0, so the parser seldom waits for the
+// card. The read-ahead buffer holds several blocks; one is read while the others are parsed.
+// #define SD_READAHEAD_SIZE 8192 // Uncomment to override default in grbl_sd.h. Power of two.
+// #define SD_READ_BLOCK_SIZE 2048 // Uncomment to override default in grbl_sd.h. Multiple of 512.
+// #define SD_BATCH_LINES 8 // Uncomment to override default in grbl_sd.h. SD lines per pass of the main loop.
+
 // A simple software debouncing feature for hard limit switches. When enabled, the limit
 // switch interrupt unblock a waiting task which will recheck the limit switch pins after
 // a short delay. Default disabled
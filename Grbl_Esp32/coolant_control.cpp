@@ -115,7 +115,11 @@ void coolant_set_state(uint8_t mode) {
 // G-code parser entry-point for setting coolant state. Forces a planner buffer sync and bails
 // if an abort or check-mode is active.
 void coolant_sync(uint8_t mode) {
-    if (sys.state == STATE_CHECK_MODE)  return;
+    if (sys.state == STATE_CHECK_MODE) {
+        if (job_compiling)
+            job_compile_coolant(mode);
+        return;
+    }
     protocol_buffer_synchronize(); // Ensure coolant turns on when specified in program.
     coolant_set_state(mode);
 }
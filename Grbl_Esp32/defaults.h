@@ -132,6 +132,14 @@
         #define DEFAULT_SPINDLE_MAX_VALUE 100.0 // $36 Percent of full period (extended set)
     #endif
 
+    #ifndef DEFAULT_SEGMENT_BUFFER_TIME
+        #define DEFAULT_SEGMENT_BUFFER_TIME 100 // $37 msec (extended set)
+    #endif
+
+    #ifndef DEFAULT_INPUT_SHAPER
+        #define DEFAULT_INPUT_SHAPER 2 // $38 0 ZV, 1 ZVD, 2 MZV (extended set)
+    #endif
+
     #ifndef  DEFAULT_SPINDLE_RPM_MAX
         #define DEFAULT_SPINDLE_RPM_MAX 1000.0 // rpm
     #endif
@@ -354,6 +362,66 @@
         #define DEFAULT_C_STALLGUARD 16 // $175 stallguard (extended set)
     #endif
 
+    // ========== Jerk (S-curve acceleration) ================
+
+    #ifndef  DEFAULT_X_JERK
+        #define DEFAULT_X_JERK 0.0 // $180 mm/min^3, (5000.0*60*60*60) for 5000 mm/sec^3, 0 for trapezoidal acceleration (extended set)
+    #endif
+    #ifndef  DEFAULT_Y_JERK
+        #define DEFAULT_Y_JERK 0.0 // $181 mm/min^3, 0 for trapezoidal acceleration (extended set)
+    #endif
+    #ifndef  DEFAULT_Z_JERK
+        #define DEFAULT_Z_JERK 0.0 // $182 mm/min^3, 0 for trapezoidal acceleration (extended set)
+    #endif
+    #ifndef  DEFAULT_A_JERK
+        #define DEFAULT_A_JERK 0.0 // $183 mm/min^3, 0 for trapezoidal acceleration (extended set)
+    #endif
+    #ifndef  DEFAULT_B_JERK
+        #define DEFAULT_B_JERK 0.0 // $184 mm/min^3, 0 for trapezoidal acceleration (extended set)
+    #endif
+    #ifndef  DEFAULT_C_JERK
+        #define DEFAULT_C_JERK 0.0 // $185 mm/min^3, 0 for trapezoidal acceleration (extended set)
+    #endif
+
+    // ========== Input shaping ================
+
+    #ifndef  DEFAULT_X_SHAPER_FREQUENCY
+        #define DEFAULT_X_SHAPER_FREQUENCY 0.0 // $190 Hz, 0 for no input shaping (extended set)
+    #endif
+    #ifndef  DEFAULT_Y_SHAPER_FREQUENCY
+        #define DEFAULT_Y_SHAPER_FREQUENCY 0.0 // $191 Hz, 0 for no input shaping (extended set)
+    #endif
+    #ifndef  DEFAULT_Z_SHAPER_FREQUENCY
+        #define DEFAULT_Z_SHAPER_FREQUENCY 0.0 // $192 Hz, 0 for no input shaping (extended set)
+    #endif
+    #ifndef  DEFAULT_A_SHAPER_FREQUENCY
+        #define DEFAULT_A_SHAPER_FREQUENCY 0.0 // $193 Hz, 0 for no input shaping (extended set)
+    #endif
+    #ifndef  DEFAULT_B_SHAPER_FREQUENCY
+        #define DEFAULT_B_SHAPER_FREQUENCY 0.0 // $194 Hz, 0 for no input shaping (extended set)
+    #endif
+    #ifndef  DEFAULT_C_SHAPER_FREQUENCY
+        #define DEFAULT_C_SHAPER_FREQUENCY 0.0 // $195 Hz, 0 for no input shaping (extended set)
+    #endif
+    #ifndef  DEFAULT_X_SHAPER_DAMPING
+        #define DEFAULT_X_SHAPER_DAMPING 0.1 // $200 damping ratio (extended set)
+    #endif
+    #ifndef  DEFAULT_Y_SHAPER_DAMPING
+        #define DEFAULT_Y_SHAPER_DAMPING 0.1 // $201 damping ratio (extended set)
+    #endif
+    #ifndef  DEFAULT_Z_SHAPER_DAMPING
+        #define DEFAULT_Z_SHAPER_DAMPING 0.1 // $202 damping ratio (extended set)
+    #endif
+    #ifndef  DEFAULT_A_SHAPER_DAMPING
+        #define DEFAULT_A_SHAPER_DAMPING 0.1 // $203 damping ratio (extended set)
+    #endif
+    #ifndef  DEFAULT_B_SHAPER_DAMPING
+        #define DEFAULT_B_SHAPER_DAMPING 0.1 // $204 damping ratio (extended set)
+    #endif
+    #ifndef  DEFAULT_C_SHAPER_DAMPING
+        #define DEFAULT_C_SHAPER_DAMPING 0.1 // $205 damping ratio (extended set)
+    #endif
+
 
 
 
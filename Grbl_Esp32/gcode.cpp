@@ -44,6 +44,7 @@ parser_block_t gc_block;
 
 void gc_init() {
     memset(&gc_state, 0, sizeof(parser_state_t));
+    mc_blend_reset(); // A line held back by G64 went with the planner buffer.
     // Load default G54 coordinate system.
     if (!(settings_read_coord_data(gc_state.modal.coord_select, gc_state.coord_system)))
         report_status_message(STATUS_SETTING_READ_FAIL, CLIENT_SERIAL);
@@ -74,6 +75,7 @@ uint8_t gc_execute_line(char* line, uint8_t client) {
     uint8_t axis_command = AXIS_COMMAND_NONE;
     uint8_t axis_0, axis_1, axis_linear;
     uint8_t coord_select = 0; // Tracks G10 P coordinate selection for execution
+    float path_tolerance = 0.0; // Tracks G64 P tolerance for execution
     // Initialize bitflag tracking variables for axis indices compatible operations.
     uint8_t axis_words = 0; // XYZ tracking
     uint8_t ijk_words = 0; // IJK tracking
@@ -257,7 +259,11 @@ uint8_t gc_execute_line(char* line, uint8_t client) {
                 if (mantissa != 0) {
                     FAIL(STATUS_GCODE_UNSUPPORTED_COMMAND);    // [G61.1 not supported]
                 }
-                // gc_block.modal.control = CONTROL_MODE_EXACT_PATH; // G61
+                gc_block.modal.control = CONTROL_MODE_EXACT_PATH; // G61
+                break;
+            case 64:
+                word_bit = MODAL_GROUP_G13;
+                gc_block.modal.control = CONTROL_MODE_CONTINUOUS; // G64
                 break;
             default:
                 FAIL(STATUS_GCODE_UNSUPPORTED_COMMAND); // [Unsupported G command]
@@ -655,7 +661,16 @@ uint8_t gc_execute_line(char* line, uint8_t client) {
                 FAIL(STATUS_SETTING_READ_FAIL);
         }
     }
-    // [16. Set path control mode ]: N/A. Only G61. G61.1 and G64 NOT SUPPORTED.
+    // [16. Set path control mode ]: G61.1 NOT SUPPORTED. G64 P is the tolerance, the junction deviation without it.
+    if (bit_istrue(command_words, bit(MODAL_GROUP_G13)) && (gc_block.modal.control == CONTROL_MODE_CONTINUOUS)) {
+        if (bit_istrue(value_words, bit(WORD_P))) {
+            path_tolerance = gc_block.values.p;
+            if (gc_block.modal.units == UNITS_MODE_INCHES)
+                path_tolerance *= MM_PER_INCH;
+            bit_false(value_words, bit(WORD_P));
+        } else
+            path_tolerance = settings.junction_deviation;
+    }
     // [17. Set distance mode ]: N/A. Only G91.1. G90.1 NOT SUPPORTED.
     // [18. Set retract mode ]: NOT SUPPORTED.
     // [19. Remaining non-modal actions ]: Check go to predefined position, set G10, or set axis offsets.
@@ -1012,6 +1027,39 @@ uint8_t gc_execute_line(char* line, uint8_t client) {
        Assumes that all error-checking has been completed and no failure modes exist. We just
        need to update the state and execute the block according to the order-of-execution.
     */
+    // Blocks that change settings or offsets, probe, change tools or switch outputs can not be
+    // compiled into a job. Its motions are planned from the offsets it was compiled with.
+    if (job_compiling) {
+        switch (gc_block.non_modal_command) {
+        case NON_MODAL_SET_COORDINATE_DATA:
+        case NON_MODAL_SET_HOME_0:
+        case NON_MODAL_SET_HOME_1:
+        case NON_MODAL_SET_COORDINATE_OFFSET:
+        case NON_MODAL_RESET_COORDINATE_OFFSET:
+            FAIL(STATUS_JOB_UNSUPPORTED);
+        }
+        if ((axis_command == AXIS_COMMAND_TOOL_LENGTH_OFFSET) || (gc_state.modal.coord_select != gc_block.modal.coord_select))
+            FAIL(STATUS_JOB_UNSUPPORTED);
+        if ((axis_command == AXIS_COMMAND_MOTION_MODE) && (gc_block.modal.motion >= MOTION_MODE_PROBE_TOWARD))
+            FAIL(STATUS_JOB_UNSUPPORTED);
+        if ((gc_block.modal.io_control == NON_MODAL_IO_ENABLE) || (gc_block.modal.io_control == NON_MODAL_IO_DISABLE))
+            FAIL(STATUS_JOB_UNSUPPORTED);
+#ifdef USE_TOOL_CHANGE
+        if (gc_block.modal.tool_change == TOOL_CHANGE)
+            FAIL(STATUS_JOB_UNSUPPORTED);
+#endif
+    }
+    // In continuous path mode the end of the last line is held back, until the next line tells how to
+    // round the corner between them. Anything else has to wait for the held line to be sent on, also
+    // when it is compiled into a job instead of synchronizing with the planner.
+    bool path_blending = (gc_block.modal.control == CONTROL_MODE_CONTINUOUS) && (axis_command == AXIS_COMMAND_MOTION_MODE);
+    path_blending = path_blending && ((gc_block.modal.motion == MOTION_MODE_SEEK) || (gc_block.modal.motion == MOTION_MODE_LINEAR));
+    path_blending = path_blending && ((gc_block.non_modal_command == NON_MODAL_NO_ACTION) || (gc_block.non_modal_command == NON_MODAL_ABSOLUTE_OVERRIDE));
+    path_blending = path_blending && (gc_block.modal.spindle == gc_state.modal.spindle) && (gc_block.values.s == gc_state.spindle_speed);
+    path_blending = path_blending && (gc_block.modal.coolant == gc_state.modal.coolant) && (gc_block.modal.tool_change != TOOL_CHANGE);
+    path_blending = path_blending && (gc_block.modal.program_flow == PROGRAM_FLOW_RUNNING) && !(gc_parser_flags & GC_PARSER_JOG_MOTION);
+    if (!path_blending)
+        mc_blend_flush();
     // Initialize planner data struct for motion blocks.
     plan_line_data_t plan_data;
     plan_line_data_t* pl_data = &plan_data;
@@ -1165,8 +1213,10 @@ uint8_t gc_execute_line(char* line, uint8_t client) {
         memcpy(gc_state.coord_system, block_coord_system, N_AXIS * sizeof(float));
         system_flag_wco_change();
     }
-    // [16. Set path control mode ]: G61.1/G64 NOT SUPPORTED
-    // gc_state.modal.control = gc_block.modal.control; // NOTE: Always default.
+    // [16. Set path control mode ]: G61.1 NOT SUPPORTED
+    gc_state.modal.control = gc_block.modal.control;
+    if (bit_istrue(command_words, bit(MODAL_GROUP_G13)))
+        gc_state.path_tolerance = path_tolerance;
     // [17. Set distance mode ]:
     gc_state.modal.distance = gc_block.modal.distance;
     // [18. Set retract mode ]: NOT SUPPORTED
@@ -1186,8 +1236,12 @@ uint8_t gc_execute_line(char* line, uint8_t client) {
         // and absolute and incremental modes.
         pl_data->condition |= PL_COND_FLAG_RAPID_MOTION; // Set rapid motion condition flag.
         if (axis_command) {
+            if (job_compiling && (gc_state.modal.distance == DISTANCE_MODE_ABSOLUTE))
+                job_compile_axes(axis_words, JOB_ORIGIN_WORK);
             mc_line(gc_block.values.xyz, pl_data);  // kinematics kinematics not used for homing righ now
         }
+        if (job_compiling)
+            job_compile_axes(axis_words ? axis_words : bit(N_AXIS) - 1, JOB_ORIGIN_MACHINE);
         mc_line(gc_block.values.ijk, pl_data);
         memcpy(gc_state.position, gc_block.values.ijk, N_AXIS * sizeof(float));
         break;
@@ -1213,13 +1267,36 @@ uint8_t gc_execute_line(char* line, uint8_t client) {
     if (gc_state.modal.motion != MOTION_MODE_NONE) {
         if (axis_command == AXIS_COMMAND_MOTION_MODE) {
             uint8_t gc_update_pos = GC_UPDATE_POS_TARGET;
+            if (job_compiling) {
+                // Track which origin the axes were positioned from, so the job can be moved to the
+                // offsets it is played with. Incremental moves keep the origin of the axis.
+                uint8_t origin = (gc_block.non_modal_command == NON_MODAL_ABSOLUTE_OVERRIDE) ? JOB_ORIGIN_MACHINE : JOB_ORIGIN_WORK;
+                uint8_t origin_changed = 0;
+                if ((origin == JOB_ORIGIN_MACHINE) || (gc_state.modal.distance == DISTANCE_MODE_ABSOLUTE)) {
+                    // A line held back by G64 is compiled with the origins of its own block.
+                    if (job_origin_changes(axis_words, origin))
+                        mc_blend_flush();
+                    origin_changed = job_compile_axes(axis_words, origin);
+                }
+                // An arc is segmented from where it starts, so all of it must be moved alike.
+                if ((gc_state.modal.motion == MOTION_MODE_CW_ARC) || (gc_state.modal.motion == MOTION_MODE_CCW_ARC)) {
+                    if (origin_changed & (bit(axis_0) | bit(axis_1) | bit(axis_linear)))
+                        FAIL(STATUS_JOB_UNSUPPORTED);
+                }
+            }
             if (gc_state.modal.motion == MOTION_MODE_LINEAR) {
                 //mc_line(gc_block.values.xyz, pl_data);
-                mc_line_kins(gc_block.values.xyz, pl_data, gc_state.position);
+                if (gc_state.modal.control == CONTROL_MODE_CONTINUOUS)
+                    mc_line_blend(gc_block.values.xyz, pl_data, gc_state.position, gc_state.path_tolerance);
+                else
+                    mc_line_kins(gc_block.values.xyz, pl_data, gc_state.position);
             } else if (gc_state.modal.motion == MOTION_MODE_SEEK) {
                 pl_data->condition |= PL_COND_FLAG_RAPID_MOTION; // Set rapid motion condition flag.
                 //mc_line(gc_block.values.xyz, pl_data);
-                mc_line_kins(gc_block.values.xyz, pl_data, gc_state.position);
+                if (gc_state.modal.control == CONTROL_MODE_CONTINUOUS)
+                    mc_line_blend(gc_block.values.xyz, pl_data, gc_state.position, gc_state.path_tolerance);
+                else
+                    mc_line_kins(gc_block.values.xyz, pl_data, gc_state.position);
             } else if ((gc_state.modal.motion == MOTION_MODE_CW_ARC) || (gc_state.modal.motion == MOTION_MODE_CCW_ARC)) {
                 mc_arc(gc_block.values.xyz, pl_data, gc_state.position, gc_block.values.ijk, gc_block.values.r,
                        axis_0, axis_1, axis_linear, bit_istrue(gc_parser_flags, GC_PARSER_ARC_IS_CLOCKWISE));
@@ -1246,6 +1323,8 @@ uint8_t gc_execute_line(char* line, uint8_t client) {
     // refill and can only be resumed by the cycle start run-time command.
     gc_state.modal.program_flow = gc_block.modal.program_flow;
     if (gc_state.modal.program_flow) {
+        if (job_compiling)
+            job_compile_program_flow(gc_state.modal.program_flow);
         protocol_buffer_synchronize(); // Sync and finish all remaining buffered motions before moving on.
         if (gc_state.modal.program_flow == PROGRAM_FLOW_PAUSED) {
             if (sys.state != STATE_CHECK_MODE) {
@@ -1320,5 +1399,5 @@ uint8_t gc_execute_line(char* line, uint8_t client) {
    group 8 = {M7*} enable mist coolant (* Compile-option)
    group 9 = {M48, M49} enable/disable feed and speed override switches
    group 10 = {G98, G99} return mode canned cycles
-   group 13 = {G61.1, G64} path control mode (G61 is supported)
+   group 13 = {G61.1} path control mode (G61 and G64 are supported)
 */
@@ -41,7 +41,7 @@
 #define MODAL_GROUP_G7 7 // [G40] Cutter radius compensation mode. G41/42 NOT SUPPORTED.
 #define MODAL_GROUP_G8 8 // [G43.1,G49] Tool length offset
 #define MODAL_GROUP_G12 9 // [G54,G55,G56,G57,G58,G59] Coordinate system selection
-#define MODAL_GROUP_G13 10 // [G61] Control mode
+#define MODAL_GROUP_G13 10 // [G61,G64] Control mode
 
 #define MODAL_GROUP_M4 11  // [M0,M1,M2,M30] Stopping
 #define MODAL_GROUP_M6 14  // [M6] Tool change
@@ -116,6 +116,7 @@
 
 // Modal Group G13: Control mode
 #define CONTROL_MODE_EXACT_PATH 0 // G61 (Default: Must be zero)
+#define CONTROL_MODE_CONTINUOUS 1 // G64
 
 // Modal Group M7: Spindle control
 #define SPINDLE_DISABLE 0 // M5 (Default: Must be zero)
@@ -207,7 +208,7 @@ typedef struct {
     // uint8_t cutter_comp;  // {G40} NOTE: Don't track. Only default supported.
     uint8_t tool_length;     // {G43.1,G49}
     uint8_t coord_select;    // {G54,G55,G56,G57,G58,G59}
-    // uint8_t control;      // {G61} NOTE: Don't track. Only default supported.
+    uint8_t control;         // {G61,G64}
     uint8_t program_flow;    // {M0,M1,M2,M30}
     uint8_t coolant;         // {M7,M8,M9}
     uint8_t spindle;         // {M3,M4,M5}
@@ -245,6 +246,7 @@ typedef struct {
     float coord_offset[N_AXIS];    // Retains the G92 coordinate offset (work coordinates) relative to
     // machine zero in mm. Non-persistent. Cleared upon reset and boot.
     float tool_length_offset;      // Tracks tool length offset value when enabled.
+    float path_tolerance;          // How far G64 may round a corner off, in mm. From P or the junction deviation.
 } parser_state_t;
 extern parser_state_t gc_state;
 
@@ -0,0 +1,250 @@
+/*
+  gcode_job.cpp - compiles g-code into jobs that play without parsing
+  Part of Grbl_ESP32
+
+  A job is compiled by running the g-code through the parser in check mode.
+  Everything the parser would have motion control, the spindle and the
+  coolant do is written to the job file as a fixed size record instead: the
+  line motions with their planner data, arcs as their line segments, spindle
+  and coolant changes, dwells and program flow. Playing the job hands these
+  straight to motion control, without reading, filtering or parsing text.
+
+  Blocks that change settings or offsets (G10, G28.1, G30.1, G92, G43.1, G49,
+  coordinate system changes), probe, change tools or switch outputs are not
+  compiled. The targets are planned machine positions. They are moved to the
+  work offset and position the job is played from, see job_record_t.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "grbl.h"
+
+bool job_compiling = false;
+
+static struct {
+    job_write_t write;
+    bool write_failed;
+    uint8_t client;
+    uint32_t source_line;
+    uint8_t work_axes;        // Axes last positioned in work coordinates
+    uint8_t machine_axes;     // Axes last positioned in machine coordinates
+    parser_state_t saved_state;
+} compiler;
+
+static struct {
+    float start_delta[N_AXIS];
+    float wco_delta[N_AXIS];
+} player;
+
+// Work coordinate offset of the parser, as reported with WCO:
+static void job_get_wco(float* wco) {
+    for (uint8_t idx = 0; idx < N_AXIS; idx++) {
+        wco[idx] = gc_state.coord_system[idx] + gc_state.coord_offset[idx];
+        if (idx == TOOL_LENGTH_OFFSET_AXIS)
+            wco[idx] += gc_state.tool_length_offset;
+    }
+}
+
+static void job_write_record(job_record_t* record) {
+    record->source_line = compiler.source_line;
+    if (!compiler.write(record, sizeof(job_record_t)))
+        compiler.write_failed = true;
+}
+
+uint8_t job_compile_begin(job_write_t write, uint8_t client) {
+#ifdef USE_KINEMATICS
+    return STATUS_JOB_UNSUPPORTED; // Motion control gets motor positions, which can not be moved at play time
+#else
+    mc_blend_flush(); // A line held back by G64 is not part of the job
+    if (sys.state != STATE_IDLE)
+        return STATUS_IDLE_ERROR;
+    memset(&compiler, 0, sizeof(compiler));
+    compiler.write = write;
+    compiler.client = client;
+    memcpy(&compiler.saved_state, &gc_state, sizeof(parser_state_t));
+    job_header_t header;
+    memset(&header, 0, sizeof(job_header_t));
+    memcpy(header.magic, JOB_MAGIC, sizeof(header.magic));
+    header.version = JOB_VERSION;
+    header.n_axis = N_AXIS;
+    header.record_size = sizeof(job_record_t);
+    memcpy(header.start, gc_state.position, sizeof(header.start));
+    job_get_wco(header.wco);
+    if (!write(&header, sizeof(job_header_t)))
+        return STATUS_JOB_WRITE_FAILED;
+    sys.state = STATE_CHECK_MODE;
+    job_compiling = true;
+    return STATUS_OK;
+#endif
+}
+
+uint8_t job_compile_line(char* line, uint32_t source_line) {
+    compiler.source_line = source_line;
+    if (line[0] == 0)
+        return STATUS_OK;
+    if (line[0] == '$' || line[0] == '[')
+        return STATUS_JOB_UNSUPPORTED; // System and [ESP] commands are not part of a job
+    uint8_t status = gc_execute_line(line, compiler.client);
+    if (status == STATUS_OK && compiler.write_failed)
+        status = STATUS_JOB_WRITE_FAILED;
+    return status;
+}
+
+uint8_t job_compile_end(bool write_end) {
+    uint8_t status = STATUS_OK;
+    if (write_end) {
+        mc_blend_flush(); // The last line held back by G64
+        job_record_t record;
+        memset(&record, 0, sizeof(job_record_t));
+        record.type = JOB_RECORD_END;
+        job_write_record(&record);
+        if (compiler.write_failed)
+            status = STATUS_JOB_WRITE_FAILED;
+    }
+    mc_blend_reset();
+    job_compiling = false;
+    memcpy(&gc_state, &compiler.saved_state, sizeof(parser_state_t));
+    sys.state = STATE_IDLE;
+    return status;
+}
+
+uint8_t job_compile_axes(uint8_t axes, uint8_t origin) {
+    uint8_t changed = job_origin_changes(axes, origin);
+    if (origin == JOB_ORIGIN_WORK) {
+        compiler.work_axes |= axes;
+        compiler.machine_axes &= ~axes;
+    } else {
+        compiler.machine_axes |= axes;
+        compiler.work_axes &= ~axes;
+    }
+    return changed;
+}
+
+uint8_t job_origin_changes(uint8_t axes, uint8_t origin) {
+    if (origin == JOB_ORIGIN_WORK)
+        return axes & ~compiler.work_axes;
+    return axes & ~compiler.machine_axes;
+}
+
+void job_compile_motion(float* target, plan_line_data_t* pl_data) {
+    job_record_t record;
+    memset(&record, 0, sizeof(job_record_t));
+    record.type = JOB_RECORD_LINE;
+    record.condition = pl_data->condition;
+    record.work_axes = compiler.work_axes;
+    record.machine_axes = compiler.machine_axes;
+#ifdef USE_LINE_NUMBERS
+    record.line_number = pl_data->line_number;
+#endif
+    record.value = pl_data->feed_rate;
+    record.spindle_speed = pl_data->spindle_speed;
+    memcpy(record.target, target, sizeof(record.target));
+    job_write_record(&record);
+}
+
+void job_compile_spindle(uint8_t state, uint32_t rpm) {
+    job_record_t record;
+    memset(&record, 0, sizeof(job_record_t));
+    record.type = JOB_RECORD_SPINDLE;
+    record.condition = state;
+    record.value = rpm;
+    job_write_record(&record);
+}
+
+void job_compile_coolant(uint8_t mode) {
+    job_record_t record;
+    memset(&record, 0, sizeof(job_record_t));
+    record.type = JOB_RECORD_COOLANT;
+    record.condition = mode;
+    job_write_record(&record);
+}
+
+void job_compile_dwell(float seconds) {
+    job_record_t record;
+    memset(&record, 0, sizeof(job_record_t));
+    record.type = JOB_RECORD_DWELL;
+    record.value = seconds;
+    job_write_record(&record);
+}
+
+void job_compile_program_flow(uint8_t program_flow) {
+    job_record_t record;
+    memset(&record, 0, sizeof(job_record_t));
+    record.type = JOB_RECORD_PROGRAM_FLOW;
+    record.condition = program_flow;
+    job_write_record(&record);
+}
+
+uint8_t job_play_begin(const job_header_t* header) {
+    if (memcmp(header->magic, JOB_MAGIC, sizeof(header->magic)) != 0 || header->version != JOB_VERSION ||
+            header->n_axis != N_AXIS || header->record_size != sizeof(job_record_t))
+        return STATUS_JOB_INVALID;
+    float wco[N_AXIS];
+    job_get_wco(wco);
+    for (uint8_t idx = 0; idx < N_AXIS; idx++) {
+        player.start_delta[idx] = gc_state.position[idx] - header->start[idx];
+        player.wco_delta[idx] = wco[idx] - header->wco[idx];
+    }
+    return STATUS_OK;
+}
+
+uint8_t job_play_record(job_record_t* record, uint8_t client) {
+    switch (record->type) {
+    case JOB_RECORD_LINE: {
+        plan_line_data_t plan_data;
+        memset(&plan_data, 0, sizeof(plan_line_data_t));
+        plan_data.feed_rate = record->value;
+        plan_data.spindle_speed = record->spindle_speed;
+        plan_data.condition = record->condition;
+#ifdef USE_LINE_NUMBERS
+        plan_data.line_number = record->line_number;
+#endif
+        for (uint8_t idx = 0; idx < N_AXIS; idx++) {
+            if (bit_istrue(record->work_axes, bit(idx)))
+                record->target[idx] += player.wco_delta[idx];
+            else if (bit_isfalse(record->machine_axes, bit(idx)))
+                record->target[idx] += player.start_delta[idx];
+        }
+        mc_line(record->target, &plan_data);
+        // Keep the parser position where the job is, for the g-code that follows it.
+        memcpy(gc_state.position, record->target, sizeof(record->target));
+        return STATUS_OK;
+    }
+    case JOB_RECORD_SPINDLE:
+        spindle->spindle_sync(record->condition, (uint32_t)record->value);
+        gc_state.modal.spindle = record->condition;
+        return STATUS_OK;
+    case JOB_RECORD_COOLANT:
+        coolant_sync(record->condition);
+        if (record->condition == COOLANT_DISABLE)
+            gc_state.modal.coolant = COOLANT_DISABLE;
+        else
+            gc_state.modal.coolant |= record->condition;
+        return STATUS_OK;
+    case JOB_RECORD_DWELL:
+        mc_dwell(record->value);
+        return STATUS_OK;
+    case JOB_RECORD_PROGRAM_FLOW: {
+        // Rare enough to go through the parser, which also does the program end resets.
+        char line[4];
+        if (record->condition == PROGRAM_FLOW_PAUSED)
+            strcpy(line, "M0");
+        else if (record->condition == PROGRAM_FLOW_COMPLETED_M30)
+            strcpy(line, "M30");
+        else
+            strcpy(line, "M2");
+        return gc_execute_line(line, client);
+    }
+    default:
+        return STATUS_JOB_INVALID;
+    }
+}
@@ -0,0 +1,99 @@
+/*
+  gcode_job.h - Header for compiled g-code jobs
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef gcode_job_h
+#define gcode_job_h
+
+// File name extension of compiled jobs
+#define JOB_FILE_EXTENSION ".gjb"
+
+#define JOB_MAGIC "GJB1"
+#define JOB_VERSION 1
+
+// Define job record types.
+#define JOB_RECORD_END 0          // End of the job file
+#define JOB_RECORD_LINE 1         // Line motion, arcs are compiled into their line segments
+#define JOB_RECORD_SPINDLE 2      // Spindle state change, synced
+#define JOB_RECORD_COOLANT 3      // Coolant state change, synced
+#define JOB_RECORD_DWELL 4        // G4
+#define JOB_RECORD_PROGRAM_FLOW 5 // M0, M2 and M30
+
+// Start of a compiled job file. All values are little endian, as on the ESP32.
+typedef struct {
+    char magic[4];            // JOB_MAGIC
+    uint8_t version;          // JOB_VERSION
+    uint8_t n_axis;           // N_AXIS of the machine it was compiled for
+    uint16_t record_size;     // sizeof(job_record_t)
+    float start[N_AXIS];      // Machine position the job was compiled from
+    float wco[N_AXIS];        // Work coordinate offset it was compiled with
+} job_header_t;
+
+// One executable step of a compiled job. The targets are machine positions as planned at compile
+// time. They are moved when the job is played: axes last positioned in work coordinates by the
+// offset between the work coordinates then and now, axes not positioned by the job yet by the
+// distance between the start positions. Axes positioned with G53 or G28/G30 stay as they are.
+typedef struct {
+    uint8_t type;             // JOB_RECORD_xxx
+    uint8_t condition;        // Line: PL_COND_FLAG_xxx. Spindle and coolant: new state. Program flow: PROGRAM_FLOW_xxx
+    uint8_t work_axes;        // Line: axes positioned in work coordinates
+    uint8_t machine_axes;     // Line: axes positioned in machine coordinates
+    uint32_t source_line;     // Line of the g-code file the record was compiled from
+    int32_t line_number;      // Line: N word
+    float value;              // Line: feed rate. Spindle: rpm. Dwell: seconds.
+    uint32_t spindle_speed;   // Line: spindle speed through the motion
+    float target[N_AXIS];     // Line: end point, in mm
+} job_record_t;
+
+// Receives the compiled records. Returns false if they could not be written.
+typedef bool (*job_write_t)(const void* data, size_t size);
+
+// True while a job is being compiled. The machine is in check mode then, and motion control
+// hands its commands to the compiler instead of executing them.
+extern bool job_compiling;
+
+// Starts compiling a job from the current parser state. Grbl must be idle. Parser messages go
+// to client.
+uint8_t job_compile_begin(job_write_t write, uint8_t client);
+
+// Compiles one line, as filtered by the line tokenizer. Returns the status of the line.
+uint8_t job_compile_line(char* line, uint32_t source_line);
+
+// Finishes the job and restores the parser state. Returns STATUS_OK if the job was complete.
+uint8_t job_compile_end(bool write_end);
+
+// Called by the parser for a block that positions axes. origin is JOB_ORIGIN_WORK or
+// JOB_ORIGIN_MACHINE. Returns the axes whose origin changed.
+#define JOB_ORIGIN_WORK 0
+#define JOB_ORIGIN_MACHINE 1
+uint8_t job_compile_axes(uint8_t axes, uint8_t origin);
+
+// Returns the axes whose origin job_compile_axes() would change, without changing it.
+uint8_t job_origin_changes(uint8_t axes, uint8_t origin);
+
+// Called by motion control, the spindle and coolant control in place of executing the command.
+void job_compile_motion(float* target, plan_line_data_t* pl_data);
+void job_compile_spindle(uint8_t state, uint32_t rpm);
+void job_compile_coolant(uint8_t mode);
+void job_compile_dwell(float seconds);
+void job_compile_program_flow(uint8_t program_flow);
+
+// Checks the header of a compiled job and prepares to play it from the current position.
+uint8_t job_play_begin(const job_header_t* header);
+
+// Executes one record of the job being played.
+uint8_t job_play_record(job_record_t* record, uint8_t client);
+
+#endif
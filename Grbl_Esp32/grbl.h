@@ -28,6 +28,7 @@
 #include <driver/rmt.h>
 #include <esp_task_wdt.h>
 #include <freertos/task.h>
+#include <soc/gpio_struct.h>
 
 #include "driver/timer.h"
 
@@ -40,7 +41,9 @@
 #include "settings.h"
 #include "system.h"
 
+#include "ringbuffer.h"
 #include "planner.h"
+#include "planner_task.h"
 #include "coolant_control.h"
 #include "grbl_eeprom.h"
 #include "gcode.h"
@@ -49,10 +52,19 @@
 #include "print.h"
 #include "probe.h"
 #include "protocol.h"
+#include "line_tokenizer.h"
+#include "gcode_job.h"
+#include "status_frame.h"
 #include "report.h"
+#include "status_push.h"
+#include "output_queue.h"
 #include "serial.h"
 #include "spindle_control.h"
+#include "Spindles/SpindleClass.h"
 #include "stepper.h"
+#ifdef INPUT_SHAPING
+    #include "input_shaper.h"
+#endif
 #include "jog.h"
 #include "inputbuffer.h"
 
@@ -91,6 +103,10 @@
     #include "grbl_unipolar.h"
 #endif
 
+#ifdef USE_I2S_STEPS
+    #include "grbl_i2s_out.h"
+#endif
+
 // Called if USE_MACHINE_INIT is defined
 void machine_init();
 
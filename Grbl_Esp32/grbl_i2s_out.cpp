@@ -0,0 +1,150 @@
+/*
+  grbl_i2s_out.cpp - I2S shift register output
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "grbl.h"
+
+#ifdef USE_I2S_STEPS
+
+#include <driver/periph_ctrl.h>
+#include <esp_intr_alloc.h>
+#include <rom/gpio.h>
+#include <rom/lldesc.h>
+#include <soc/gpio_sig_map.h>
+#include <soc/i2s_struct.h>
+
+// Each sample is sent on both channels, 32 bits each, so a frame is 64 BCK cycles. WS rises
+// between the channels, when the first copy has been shifted in, and latches it. The I2S clock
+// is PLL_D2 (160MHz) divided by I2S_OUT_CLKM_DIV and I2S_OUT_BCK_DIV, 16MHz for 4us samples.
+#define I2S_OUT_PLL_D2_HZ 160000000
+#define I2S_OUT_CLKM_DIV 5
+#define I2S_OUT_BCK_DIV (I2S_OUT_PLL_D2_HZ / I2S_OUT_CLKM_DIV / 64 / (1000000 / I2S_OUT_SAMPLE_USEC))
+
+#define I2S_OUT_CHAN_STREAM 1   // Both channels send the sample popped from the FIFO
+#define I2S_OUT_CHAN_CONSTANT 4 // Both channels send conf_single_data (with tx_msb_right set)
+
+static lldesc_t i2s_out_desc[I2S_OUT_DMABUF_COUNT];
+static uint32_t i2s_out_buf[I2S_OUT_DMABUF_COUNT][I2S_OUT_DMABUF_LEN];
+static i2s_out_fill_t i2s_out_fill;
+
+// Refills the buffer that has just been sent. It goes out again after the others.
+static void IRAM_ATTR i2s_out_isr(void* arg) {
+    bool eof = I2S0.int_st.out_eof;
+    I2S0.int_clr.val = I2S0.int_st.val;
+    if (eof && i2s_out_fill != NULL) {
+        lldesc_t* desc = (lldesc_t*)I2S0.out_eof_des_addr;
+        desc->length = i2s_out_fill((uint32_t*)desc->buf, I2S_OUT_DMABUF_LEN) * sizeof(uint32_t);
+        desc->owner = 1;
+    }
+}
+
+static void i2s_out_reset() {
+    I2S0.conf.tx_reset = 1;
+    I2S0.conf.tx_reset = 0;
+    I2S0.conf.tx_fifo_reset = 1;
+    I2S0.conf.tx_fifo_reset = 0;
+    I2S0.lc_conf.out_rst = 1;
+    I2S0.lc_conf.out_rst = 0;
+    I2S0.lc_conf.ahbm_fifo_rst = 1;
+    I2S0.lc_conf.ahbm_fifo_rst = 0;
+}
+
+void i2s_out_init(uint32_t sample) {
+    pinMode(I2S_OUT_BCK, OUTPUT);
+    pinMode(I2S_OUT_WS, OUTPUT);
+    pinMode(I2S_OUT_DATA, OUTPUT);
+    gpio_matrix_out(I2S_OUT_BCK, I2S0O_BCK_OUT_IDX, false, false);
+    gpio_matrix_out(I2S_OUT_WS, I2S0O_WS_OUT_IDX, false, false);
+    gpio_matrix_out(I2S_OUT_DATA, I2S0O_DATA_OUT23_IDX, false, false);
+    periph_module_enable(PERIPH_I2S0_MODULE);
+    i2s_out_reset();
+    // Serial (not LCD) master transmitter, MSB first, without the one bit WS delay of I2S
+    I2S0.conf2.val = 0;
+    I2S0.conf.tx_slave_mod = 0;
+    I2S0.conf.tx_msb_shift = 0;
+    I2S0.conf.tx_short_sync = 0;
+    I2S0.conf.tx_mono = 0;
+    I2S0.conf.tx_right_first = 0;
+    I2S0.conf.tx_msb_right = 1;
+    I2S0.sample_rate_conf.tx_bits_mod = 32;
+    I2S0.fifo_conf.tx_fifo_mod = 3; // One 32 bit sample per frame
+    I2S0.fifo_conf.tx_fifo_mod_force_en = 1;
+    I2S0.lc_conf.out_eof_mode = 1;  // EOF when the last word of a buffer has been popped
+    I2S0.lc_conf.outdscr_burst_en = 1;
+    I2S0.lc_conf.out_data_burst_en = 1;
+    I2S0.lc_conf.out_auto_wrback = 0;
+    I2S0.lc_conf.check_owner = 0;
+    I2S0.clkm_conf.clka_en = 0;     // PLL_D2
+    I2S0.clkm_conf.clkm_div_a = 1;
+    I2S0.clkm_conf.clkm_div_b = 0;
+    I2S0.clkm_conf.clkm_div_num = I2S_OUT_CLKM_DIV;
+    I2S0.sample_rate_conf.tx_bck_div_num = I2S_OUT_BCK_DIV;
+    I2S0.clkm_conf.clk_en = 1;
+    for (uint8_t i = 0; i < I2S_OUT_DMABUF_COUNT; i++) {
+        lldesc_t* desc = &i2s_out_desc[i];
+        desc->size = sizeof(i2s_out_buf[i]);
+        desc->length = sizeof(i2s_out_buf[i]);
+        desc->offset = 0;
+        desc->sosf = 0;
+        desc->eof = 1; // An interrupt for each buffer
+        desc->owner = 1;
+        desc->buf = (uint8_t*)i2s_out_buf[i];
+        desc->qe.stqe_next = &i2s_out_desc[(i + 1) % I2S_OUT_DMABUF_COUNT];
+    }
+    I2S0.int_ena.val = 0;
+    I2S0.int_clr.val = 0xffffffff;
+    // Not ESP_INTR_FLAG_IRAM: filling a buffer can reach the spindle and st_go_idle(), which run
+    // from flash
+    esp_intr_alloc(ETS_I2S0_INTR_SOURCE, 0, i2s_out_isr, NULL, NULL);
+    I2S0.fifo_conf.dscr_en = 0;
+    I2S0.conf_single_data = sample;
+    I2S0.conf_chan.tx_chan_mod = I2S_OUT_CHAN_CONSTANT;
+    I2S0.conf.tx_start = 1;
+}
+
+void i2s_out_write(uint32_t sample) {
+    I2S0.conf_single_data = sample;
+}
+
+void i2s_out_start(i2s_out_fill_t fill) {
+    for (uint8_t i = 0; i < I2S_OUT_DMABUF_COUNT; i++)
+        i2s_out_desc[i].length = fill(i2s_out_buf[i], I2S_OUT_DMABUF_LEN) * sizeof(uint32_t);
+    i2s_out_fill = fill;
+    I2S0.conf.tx_start = 0;
+    i2s_out_reset();
+    I2S0.fifo_conf.dscr_en = 1;
+    I2S0.conf_chan.tx_chan_mod = I2S_OUT_CHAN_STREAM;
+    I2S0.out_link.addr = (uintptr_t)&i2s_out_desc[0];
+    I2S0.out_link.start = 1;
+    I2S0.int_clr.val = 0xffffffff;
+    I2S0.int_ena.out_eof = 1;
+    I2S0.conf.tx_start = 1;
+}
+
+void i2s_out_stop(uint32_t sample) {
+    I2S0.int_ena.out_eof = 0;
+    I2S0.out_link.stop = 1;
+    I2S0.conf.tx_start = 0;
+    i2s_out_fill = NULL;
+    i2s_out_reset();
+    I2S0.fifo_conf.dscr_en = 0;
+    I2S0.conf_single_data = sample;
+    I2S0.conf_chan.tx_chan_mod = I2S_OUT_CHAN_CONSTANT;
+    I2S0.conf.tx_start = 1;
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+  grbl_i2s_out.h - Header for the I2S shift register output
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+
+  The I2S peripheral shifts 32 bit samples into a chain of up to four 74HC595 (or compatible)
+  shift registers. Bit n of a sample drives output n of the chain, counting from Q0 of the
+  register next to the ESP32. BCK is the shift clock, WS the storage register clock (latch) and
+  DATA the serial data in. All outputs change together when a sample is latched, once every
+  I2S_OUT_SAMPLE_USEC.
+
+  When idle the same sample is sent over and over, and i2s_out_write() changes it. While
+  streaming, the samples come out of a ring of DMA buffers that are handed back to be refilled
+  each time one has been sent, so what is filled comes out two to three buffers later.
+*/
+
+#ifndef grbl_i2s_out_h
+#define grbl_i2s_out_h
+
+#define I2S_OUT_SAMPLE_USEC 4                                              // Time each sample is latched
+#define I2S_OUT_SAMPLE_TICKS (I2S_OUT_SAMPLE_USEC * TICKS_PER_MICROSECOND) // The same in step timer ticks
+#define I2S_OUT_DMABUF_COUNT 3                                             // Buffers in the ring
+#define I2S_OUT_DMABUF_LEN 250                                             // Samples per buffer, 1ms
+
+// Fills up to count samples, at least one, and returns how many were filled. Called from the I2S
+// interrupt each time a buffer has been sent. Filling fewer samples shortens the delay of the
+// outputs.
+typedef uint32_t (*i2s_out_fill_t)(uint32_t* samples, uint32_t count);
+
+// Sets up the I2S peripheral and its pins and starts sending sample.
+void i2s_out_init(uint32_t sample);
+
+// Changes the sample sent when not streaming.
+void i2s_out_write(uint32_t sample);
+
+// Fills the DMA buffers and starts streaming them. fill refills them from then on.
+void i2s_out_start(i2s_out_fill_t fill);
+
+// Stops streaming, dropping what has not been sent yet, and goes back to sending sample.
+void i2s_out_stop(uint32_t sample);
+
+#endif
@@ -20,16 +20,98 @@
 
 #include "grbl_sd.h"
 
-// Define line flags. Includes comment type tracking and line overflow detection.
-#define LINE_FLAG_OVERFLOW bit(0)
-#define LINE_FLAG_COMMENT_PARENTHESES bit(1)
-#define LINE_FLAG_COMMENT_SEMICOLON bit(2)
-
 File myFile;
 bool SD_ready_next = false; // Grbl has processed a line and is waiting for another
 uint8_t SD_client = CLIENT_SERIAL;
 uint32_t sd_current_line_number; // stores the most recent line number read from the SD
-static char comment[LINE_BUFFER_SIZE]; // Line to be executed. Zero-terminated.
+static line_tokenizer_t tokenizer;
+static bool sd_job_compiled = false; // the open file is a compiled job, see gcode_job.h
+static char sd_current_filename[50];
+
+/*
+ While a file is printed or compiled, the sdReadTask on core 0 owns myFile. It reads the
+ file ahead of the parser into readahead, in blocks of up to
+ SD_READ_BLOCK_SIZE bytes at sector aligned file offsets, and sleeps while
+ there is no room for another block. The main loop takes lines and records
+ out of readahead, so the card and the parser work at the same time and a
+ line never waits for the card unless the whole read-ahead has been used up.
+ The main loop wakes the task whenever it has freed a block.
+
+ closeFile() waits for the task to close the file. From interrupts (mc_reset)
+ it can only ask for it, and openFile() waits for the file to be closed.
+*/
+static RingBuffer<uint8_t, SD_READAHEAD_SIZE> readahead; // written by sdReadTask, read by the main loop
+static TaskHandle_t sdReadTaskHandle = 0;
+static volatile bool sd_reading = false;       // myFile is open and belongs to sdReadTask
+static volatile bool sd_close_request = false; // sdReadTask is to close myFile
+static volatile bool sd_read_done = false;     // nothing more will be put into readahead
+static uint32_t sd_read_pos;  // file offset of the next block, sdReadTask only
+static uint32_t sd_file_pos;  // file offset of the next byte the main loop takes
+static uint32_t sd_file_size;
+static bool sd_skip_lf = false; // the last line ended with '\r', so a '\n' right after it ends nothing
+static bool sd_compiling = false; // myFile is the source of compileFile(), not a printed file
+
+// read the next block of the file into readahead
+static void sd_read_block() {
+    // read up to a sector boundary, so after the first block the card only reads whole sectors
+    uint32_t size = SD_READ_BLOCK_SIZE - (sd_read_pos % SD_SECTOR_SIZE);
+    uint32_t span;
+    uint8_t* dest = readahead.writeSpan(&span);
+    if (size > span)
+        size = span; // the rest goes to the start of readahead with the next read
+    int count = myFile.read(dest, size);
+    if (count <= 0) {
+        sd_read_done = true;
+        return;
+    }
+    readahead.commitWrite(count);
+    sd_read_pos += count;
+}
+
+static void sdReadTask(void* pvParameters) {
+    while (true) {
+        // The timeout picks up close requests made from interrupts, which can not notify.
+        ulTaskNotifyTake(pdTRUE, 10 / portTICK_RATE_MS);
+        while (sd_reading) {
+            if (sd_close_request) {
+                myFile.close();
+                sd_read_done = true;
+                sd_reading = false;
+                break;
+            }
+            if (sd_read_done || readahead.availableForWrite() < SD_READ_BLOCK_SIZE)
+                break; // sleep until the main loop has taken a block
+            sd_read_block();
+        }
+    }
+}
+
+// wake the read-ahead task if there is room for another block
+static void sd_read_notify() {
+    if (readahead.availableForWrite() >= SD_READ_BLOCK_SIZE)
+        xTaskNotifyGive(sdReadTaskHandle);
+}
+
+// return the bytes read ahead that follow each other in memory, waiting for the card if there
+// are none yet, or NULL at the end of the file
+static const uint8_t* sd_read_span(uint32_t* len) {
+    while (readahead.empty()) {
+        if (sd_read_done) {
+            if (readahead.empty()) // the last block may have come in just before
+                return NULL;
+            break;
+        }
+        sd_read_notify();
+        vTaskDelay(1);
+    }
+    return readahead.readSpan(len);
+}
+
+static void sd_consume(uint32_t len) {
+    readahead.consume(len);
+    sd_file_pos += len;
+    sd_read_notify();
+}
 
 // attempt to mount the SD card
 /*bool sd_mount()
@@ -63,95 +145,249 @@ void listDir(fs::FS& fs, const char* dirname, uint8_t levels, uint8_t client) {
     }
 }
 
+// start the read-ahead task the first time a file is read
+static void sd_read_task_start() {
+    if (sdReadTaskHandle != 0)
+        return;
+    xTaskCreatePinnedToCore(sdReadTask,    // task
+                            "sdReadTask", // name for task
+                            4096,   // size of task stack
+                            NULL,   // parameters
+                            1, // priority
+                            &sdReadTaskHandle,
+                            0 // core
+                           );
+}
+
+// hand myFile, from the file offset pos on, to the read-ahead task
+static void sd_read_begin(uint32_t pos) {
+    strncpy(sd_current_filename, myFile.name(), sizeof(sd_current_filename) - 1);
+    sd_current_filename[sizeof(sd_current_filename) - 1] = 0;
+    sd_read_pos = pos;
+    sd_file_pos = pos;
+    sd_file_size = myFile.size();
+    sd_skip_lf = false;
+    readahead.clear();
+    sd_read_done = false;
+    sd_close_request = false;
+    sd_reading = true;
+    xTaskNotifyGive(sdReadTaskHandle);
+}
+
+// have the read-ahead task close myFile, and wait for it unless called from an interrupt
+static void sd_read_end() {
+    sd_close_request = true;
+    if (!xPortInIsrContext()) {
+        xTaskNotifyGive(sdReadTaskHandle);
+        while (sd_reading)
+            vTaskDelay(1);
+    }
+}
+
 boolean openFile(fs::FS& fs, const char* path) {
+    sd_read_task_start();
+    while (sd_reading)
+        vTaskDelay(1); // the task has not closed the last file yet
     myFile = fs.open(path);
     if (!myFile) {
         //report_status_message(STATUS_SD_FAILED_READ, CLIENT_SERIAL);
         return false;
     }
+    // compiled jobs start with a header, g-code files are played from the start
+    job_header_t header;
+    sd_job_compiled = (myFile.read((uint8_t*)&header, sizeof(job_header_t)) == sizeof(job_header_t)) &&
+                      (memcmp(header.magic, JOB_MAGIC, sizeof(header.magic)) == 0);
+    if (sd_job_compiled) {
+        if (job_play_begin(&header) != STATUS_OK) {
+            myFile.close();
+            return false;
+        }
+        sd_read_begin(sizeof(job_header_t));
+    } else {
+        myFile.seek(0);
+        sd_read_begin(0);
+    }
     set_sd_state(SDCARD_BUSY_PRINTING);
     SD_ready_next = false; // this will get set to true when Grbl issues "ok" message
     sd_current_line_number = 0;
     return true;
 }
 
+bool sd_job_is_compiled() {
+    return sd_job_compiled;
+}
+
 boolean closeFile() {
-    if (!myFile)
+    if (!sd_reading || sd_close_request || sd_compiling)
         return false;
     set_sd_state(SDCARD_IDLE);
     SD_ready_next = false;
     sd_current_line_number = 0;
-    myFile.close();
+    sd_job_compiled = false;
+    sd_read_end();
     return true;
 }
 
+// tokenize the next line out of readahead, return false at the end of the file
+static bool sd_read_line(char* line) {
+    line_tokenizer_init(&tokenizer, line, SD_LINE_BUFFER_SIZE);
+    bool complete = false;
+    const uint8_t* data;
+    uint32_t len;
+    while (!complete && (data = sd_read_span(&len)) != NULL) {
+        if (sd_skip_lf) {
+            sd_skip_lf = false;
+            if (data[0] == '\n') {
+                sd_consume(1); // "\r\n" is one end of line
+                continue;
+            }
+        }
+        sd_consume(line_tokenizer_feed(&tokenizer, data, len, &complete));
+    }
+    sd_skip_lf = complete && (tokenizer.eol == '\r');
+    if (complete)
+        return true;
+    // some files end without a newline, an empty line after new line is the end
+    return line_tokenizer_finish(&tokenizer);
+}
+
 /*
- read a line from the SD card
+ read a line from the SD card into a buffer of SD_LINE_BUFFER_SIZE bytes
  strip whitespace
  strip comments per http://linuxcnc.org/docs/ja/html/gcode/overview.html#gcode:comments
  make uppercase
  return true if a line is
 */
 boolean readFileLine(char* line) {
-    char c;
-    uint8_t index = 0;
-    uint8_t line_flags = 0;
-    uint8_t comment_char_counter = 0;
-    if (!myFile) {
+    if (!sd_reading) {
         report_status_message(STATUS_SD_FAILED_READ, SD_client);
         return false;
     }
     sd_current_line_number += 1;
-    while (myFile.available()) {
-        c = myFile.read();
-        if (line_flags & LINE_FLAG_COMMENT_PARENTHESES)    // capture all characters into a comment buffer
-            comment[comment_char_counter++] = c;
-        if (c == '\r' || c == ' ') {
-            // ignore these whitespace items
-        } else if (c == '(')
-            line_flags |= LINE_FLAG_COMMENT_PARENTHESES;
-        else if (c == ')') {
-            // End of '()' comment. Resume line allowed.
-            if (line_flags & LINE_FLAG_COMMENT_PARENTHESES) {
-                line_flags &= ~(LINE_FLAG_COMMENT_PARENTHESES);
-                comment[comment_char_counter] = 0; // null terminate
-                report_gcode_comment(comment);
-            }
-        } else if (c == ';') {
-            // NOTE: ';' comment to EOL is a LinuxCNC definition. Not NIST.
-            if (!(line_flags & LINE_FLAG_COMMENT_PARENTHESES))   // semi colon inside parentheses do not mean anything
-                line_flags |= LINE_FLAG_COMMENT_SEMICOLON;
-        } else if (c == '%') {
-            // discard this character
-        } else if (c == '\n') { // found the newline, so mark the end and return true
-            line[index] = '\0';
-            return true;
-        } else { // add characters to the line
-            if (!line_flags) {
-                c = toupper(c); // make upper case
-                line[index] = c;
-                index++;
-            }
-        }
-        if (index == 255) { // name is too long so return false
-            line[index] = '\0';
-            report_status_message(STATUS_OVERFLOW, SD_client);
+    bool ok = sd_read_line(line);
+    if (tokenizer.flags & LINE_FLAG_OVERFLOW) { // line is too long so return false
+        report_status_message(STATUS_OVERFLOW, SD_client);
+        return false;
+    }
+    return ok;
+}
+
+// read the next record of a compiled job, return false at the end of the job
+boolean readJobRecord(job_record_t* record) {
+    if (!sd_reading) {
+        report_status_message(STATUS_SD_FAILED_READ, SD_client);
+        return false;
+    }
+    uint8_t* dest = (uint8_t*)record;
+    uint32_t done = 0;
+    while (done < sizeof(job_record_t)) {
+        uint32_t len;
+        const uint8_t* data = sd_read_span(&len);
+        if (data == NULL)
             return false;
+        if (len > sizeof(job_record_t) - done)
+            len = sizeof(job_record_t) - done;
+        memcpy(dest + done, data, len);
+        sd_consume(len);
+        done += len;
+    }
+    sd_current_line_number = record->source_line;
+    return record->type != JOB_RECORD_END;
+}
+
+static File jobFile;
+
+static bool write_job(const void* data, size_t size) {
+    return jobFile.write((const uint8_t*)data, size) == size;
+}
+
+// compile the g-code file at path into a job at job_path, see gcode_job.h. The source is read
+// through readahead, as a printed file is. Uses the parser, so only the main loop may call it.
+// A line that does not compile is returned in error_line, 0 for other errors.
+static uint8_t compileFile(fs::FS& fs, const char* path, const char* job_path, uint8_t client, uint32_t* error_line) {
+    *error_line = 0;
+    sd_read_task_start();
+    while (sd_reading)
+        vTaskDelay(1); // the task has not closed the last file yet
+    myFile = fs.open(path);
+    if (!myFile)
+        return STATUS_SD_FAILED_READ;
+    jobFile = fs.open(job_path, FILE_WRITE);
+    if (!jobFile) {
+        myFile.close();
+        return STATUS_JOB_WRITE_FAILED;
+    }
+    sd_compiling = true;
+    sd_read_begin(0);
+    set_sd_state(SDCARD_BUSY_PARSING);
+    char line[SD_LINE_BUFFER_SIZE];
+    uint32_t line_number = 0;
+    uint8_t status = job_compile_begin(write_job, client);
+    if (status == STATUS_OK) {
+        while (status == STATUS_OK && sd_read_line(line)) {
+            line_number++;
+            if (tokenizer.flags & LINE_FLAG_OVERFLOW)
+                status = STATUS_OVERFLOW;
+            else
+                status = job_compile_line(line, line_number);
+        }
+        if (status == STATUS_OK)
+            status = job_compile_end(true);
+        else {
+            job_compile_end(false);
+            *error_line = line_number;
         }
     }
-    // some files end without a newline
-    if (index != 0) {
-        line[index] = '\0';
-        return true;
-    } else   // empty line after new line
+    sd_read_end();
+    sd_compiling = false;
+    jobFile.close();
+    if (status != STATUS_OK)
+        fs.remove(job_path);
+    set_sd_state(SDCARD_IDLE);
+    return status;
+}
+
+// a compile asked for by requestCompileFile(), run by sd_compile_poll()
+static char sd_compile_path[128];
+static char sd_compile_job_path[128];
+static uint8_t sd_compile_client;
+static volatile bool sd_compile_requested = false;
+
+boolean requestCompileFile(const char* path, const char* job_path, uint8_t client) {
+    if (sd_compile_requested)
+        return false; // the last one has not run yet
+    if (strlen(path) >= sizeof(sd_compile_path) || strlen(job_path) >= sizeof(sd_compile_job_path))
         return false;
+    strcpy(sd_compile_path, path);
+    strcpy(sd_compile_job_path, job_path);
+    sd_compile_client = client;
+    sd_compile_requested = true;
+    return true;
+}
+
+void sd_compile_poll() {
+    if (!sd_compile_requested)
+        return;
+    uint8_t status;
+    uint32_t error_line = 0;
+    if (get_sd_state(false) != SDCARD_IDLE)
+        status = STATUS_SD_FAILED_READ; // a file was opened for printing since the request
+    else
+        status = compileFile(SD, sd_compile_path, sd_compile_job_path, sd_compile_client, &error_line);
+    if (status == STATUS_OK)
+        grbl_msg_sendf(sd_compile_client, MSG_LEVEL_INFO, "Job compiled: %s", sd_compile_job_path);
+    else if (error_line != 0)
+        grbl_sendf(sd_compile_client, "error:%d in SD file at line %d\r\n", status, error_line);
+    else
+        report_status_message(status, sd_compile_client);
+    sd_compile_requested = false;
 }
 
 // return a percentage complete 50.5 = 50.5%
 float sd_report_perc_complete() {
-    if (!myFile)
+    if (!sd_reading || sd_file_size == 0)
         return 0.0;
-    return ((float)myFile.position() / (float)myFile.size() * 100.0);
+    return ((float)sd_file_pos / (float)sd_file_size * 100.0);
 }
 
 uint32_t sd_get_current_line_number() {
@@ -192,8 +428,8 @@ uint8_t set_sd_state(uint8_t flag) {
 }
 
 void sd_get_current_filename(char* name) {
-    if (myFile)
-        strcpy(name, myFile.name());
+    if (sd_reading)
+        strcpy(name, sd_current_filename);
     else
         name[0] = 0;
 }
@@ -22,6 +22,25 @@
 #include "SD.h"
 #include "SPI.h"
 
+#define SD_LINE_BUFFER_SIZE 255 // size of the line buffer passed to readFileLine()
+
+// Bytes of the file read ahead of the parser while printing. Power of two.
+#ifndef SD_READAHEAD_SIZE
+    #define SD_READAHEAD_SIZE 8192
+#endif
+
+// Largest single read from the card. Multiple of the sector size.
+#ifndef SD_READ_BLOCK_SIZE
+    #define SD_READ_BLOCK_SIZE 2048
+#endif
+
+#define SD_SECTOR_SIZE 512
+
+// Most SD lines the main loop runs in one pass, before it checks for realtime commands again
+#ifndef SD_BATCH_LINES
+    #define SD_BATCH_LINES 8
+#endif
+
 #define FILE_TYPE_COUNT 5   // number of acceptable gcode file types in array
 
 #define SDCARD_DET_PIN -1
@@ -45,6 +64,10 @@ void listDir(fs::FS& fs, const char* dirname, uint8_t levels, uint8_t client);
 boolean openFile(fs::FS& fs, const char* path);
 boolean closeFile();
 boolean readFileLine(char* line);
+bool sd_job_is_compiled();
+boolean readJobRecord(job_record_t* record);
+boolean requestCompileFile(const char* path, const char* job_path, uint8_t client);
+void sd_compile_poll();
 void readFile(fs::FS& fs, const char* path);
 float sd_report_perc_complete();
 uint32_t sd_get_current_line_number();
@@ -0,0 +1,301 @@
+/*
+  input_shaper.cpp - shapes the step motion to cancel the ringing of the machine
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "grbl.h"
+
+#ifdef INPUT_SHAPING
+
+/* The input shaper sits between the segment generator and the step segment buffer. A belt or
+   frame excited by a change of speed rings at its resonance frequency. Splitting each change into
+   a few impulses, timed and weighted such that the ringing the later ones excite cancels that of
+   the earlier ones, leaves hardly any ringing. So the shaped position of an axis is the sum of its
+   unshaped position at each impulse delay, times the weight of the impulse:
+
+     shaped(t) = sum of amplitude[i] * unshaped(t - delay[i])
+
+   The unshaped motion comes in segments at a constant rate, so the shaped rate is constant between
+   the start and end times of the segments, delayed by each of the delays. The shaped motion is
+   handed out in pieces cut at those times, as few of them fall within SHAPER_PIECE_MIN, each to be
+   stepped as a segment of its own. Times are counted in step timer ticks, as the segments are
+   stepped, and positions in steps. The steps of a piece are the shaped position at its end
+   rounded, less that at its start, so no step gets lost and the shaped motion ends exactly where
+   the unshaped one does, once the last delay has passed.
+     Every axis is delayed by the same mean delay, that of the axis whose impulses are spread the
+   most, so the axes stay in step with each other and multi-axis paths keep their shape, but for
+   the smoothing of the corners by the shaping itself. Axes without a frequency only get delayed.
+*/
+
+// A segment of unshaped motion at a constant rate
+typedef struct {
+    uint32_t start;            // Step timer ticks, wraps around
+    uint32_t ticks;
+    int32_t position[N_AXIS];  // At the start (steps)
+    int32_t steps[N_AXIS];
+} shaper_motion_t;
+
+static struct {
+    uint8_t impulses[N_AXIS];
+    float amplitude[N_AXIS][SHAPER_IMPULSES_MAX];  // Fraction of the motion of each impulse, sum to 1
+    uint8_t delay_index[N_AXIS][SHAPER_IMPULSES_MAX];
+    uint8_t delays;
+    uint32_t delay[N_AXIS * SHAPER_IMPULSES_MAX];  // The distinct delays of the impulses, ascending (ticks)
+
+    shaper_motion_t history[SHAPER_HISTORY_SIZE];  // Ring of the motion still to be shaped
+    uint8_t oldest;
+    uint8_t count;
+
+    int32_t position[N_AXIS];      // Unshaped position at in_time
+    uint32_t in_time;              // End of the unshaped motion
+    int32_t out_position[N_AXIS];  // Shaped position at out_time
+    uint32_t out_time;             // End of the shaped motion handed out
+} shaper;
+
+static bool shaper_changed = true; // The settings changed since the impulses were set up
+static bool shaper_shaped;         // Some axis has impulses, as set up
+
+static shaper_motion_t* shaper_history(uint8_t index) {
+    index += shaper.oldest;
+    if (index >= SHAPER_HISTORY_SIZE)
+        index -= SHAPER_HISTORY_SIZE;
+    return &shaper.history[index];
+}
+
+void shaper_reset() {
+    memset(&shaper, 0, sizeof(shaper));
+    shaper_changed = true;
+}
+
+void shaper_settings_changed() {
+    shaper_changed = true;
+}
+
+// Sets up the impulses of each axis from the settings. Returns false when no axis is shaped.
+static bool shaper_impulses() {
+    float time[N_AXIS][SHAPER_IMPULSES_MAX]; // Delays of the impulses (sec)
+    float center[N_AXIS];                    // Mean delay of the motion of the axis (sec)
+    float latest = 0.0;
+    bool shaped = false;
+    uint8_t axis, impulse;
+    for (axis = 0; axis < N_AXIS; axis++) {
+        float* amplitude = shaper.amplitude[axis];
+        float frequency = settings.shaper_frequency[axis];
+        if (frequency <= 0.0) {
+            shaper.impulses[axis] = 1;
+            amplitude[0] = 1.0;
+            time[axis][0] = 0.0;
+            center[axis] = 0.0;
+            continue;
+        }
+        shaped = true;
+        float damping = MIN(settings.shaper_damping[axis], 0.9);
+        float damped = sqrt(1.0 - damping * damping);
+        float period = 1.0 / (frequency * damped); // Of the damped ringing
+        float k;
+        switch (settings.input_shaper) {
+        case SHAPER_ZV:
+            k = exp(-damping * M_PI / damped);
+            shaper.impulses[axis] = 2;
+            amplitude[0] = 1.0;
+            amplitude[1] = k;
+            time[axis][0] = 0.0;
+            time[axis][1] = 0.5 * period;
+            break;
+        case SHAPER_ZVD:
+            k = exp(-damping * M_PI / damped);
+            shaper.impulses[axis] = 3;
+            amplitude[0] = 1.0;
+            amplitude[1] = 2.0 * k;
+            amplitude[2] = k * k;
+            time[axis][0] = 0.0;
+            time[axis][1] = 0.5 * period;
+            time[axis][2] = period;
+            break;
+        default: // SHAPER_MZV
+            k = exp(-0.75 * damping * M_PI / damped);
+            shaper.impulses[axis] = 3;
+            amplitude[0] = 1.0 - M_SQRT1_2;
+            amplitude[1] = (M_SQRT2 - 1.0) * k;
+            amplitude[2] = (1.0 - M_SQRT1_2) * k * k;
+            time[axis][0] = 0.0;
+            time[axis][1] = 0.375 * period;
+            time[axis][2] = 0.75 * period;
+        }
+        float sum = 0.0;
+        for (impulse = 0; impulse < shaper.impulses[axis]; impulse++)
+            sum += amplitude[impulse];
+        center[axis] = 0.0;
+        for (impulse = 0; impulse < shaper.impulses[axis]; impulse++) {
+            amplitude[impulse] /= sum;
+            center[axis] += amplitude[impulse] * time[axis][impulse];
+        }
+        latest = MAX(latest, center[axis]);
+    }
+    if (!shaped)
+        return false;
+    // Delay all axes by the latest mean delay and collect the distinct delays, in ascending order.
+    shaper.delays = 0;
+    for (axis = 0; axis < N_AXIS; axis++) {
+        for (impulse = 0; impulse < shaper.impulses[axis]; impulse++) {
+            uint32_t delay = lroundf((time[axis][impulse] + latest - center[axis]) * F_STEPPER_TIMER);
+            uint8_t index = 0;
+            while (index < shaper.delays && shaper.delay[index] < delay)
+                index++;
+            if (index == shaper.delays || shaper.delay[index] != delay) {
+                memmove(&shaper.delay[index + 1], &shaper.delay[index], (shaper.delays - index) * sizeof(uint32_t));
+                shaper.delay[index] = delay;
+                shaper.delays++;
+            }
+        }
+    }
+    for (axis = 0; axis < N_AXIS; axis++) {
+        for (impulse = 0; impulse < shaper.impulses[axis]; impulse++) {
+            uint32_t delay = lroundf((time[axis][impulse] + latest - center[axis]) * F_STEPPER_TIMER);
+            uint8_t index = 0;
+            while (shaper.delay[index] != delay)
+                index++;
+            shaper.delay_index[axis][impulse] = index;
+        }
+    }
+    return true;
+}
+
+bool shaper_setup() {
+    if (shaper_changed) {
+        shaper_shaped = shaper_impulses();
+        shaper_changed = false;
+    }
+    return shaper_shaped;
+}
+
+bool shaper_idle() {
+    return shaper.count == 0;
+}
+
+void shaper_add_motion(uint32_t ticks, const int32_t* steps) {
+    if (ticks == 0)
+        return;
+    if ((int32_t)(shaper.out_time - shaper.in_time) > 0)
+        shaper.in_time = shaper.out_time; // The motion had stopped and its shaped motion been handed out up to here.
+    if (shaper.count == SHAPER_HISTORY_SIZE) {
+        // Merge the two oldest segments.
+        shaper_motion_t* oldest = shaper_history(0);
+        shaper_motion_t* next = shaper_history(1);
+        next->ticks += next->start - oldest->start;
+        next->start = oldest->start;
+        for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+            next->steps[axis] += next->position[axis] - oldest->position[axis];
+            next->position[axis] = oldest->position[axis];
+        }
+        shaper.oldest = (shaper.oldest + 1) % SHAPER_HISTORY_SIZE;
+        shaper.count--;
+    }
+    shaper_motion_t* motion = shaper_history(shaper.count);
+    shaper.count++;
+    motion->start = shaper.in_time;
+    motion->ticks = ticks;
+    for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+        motion->position[axis] = shaper.position[axis];
+        motion->steps[axis] = steps[axis];
+        shaper.position[axis] += steps[axis];
+    }
+    shaper.in_time += ticks;
+}
+
+// Adds amplitude times the unshaped position of each axis at time, less the shaped position handed
+// out, to offset. Only the axes with an impulse at delay_index are added.
+static void shaper_add_impulses(uint32_t time, uint8_t delay_index, float* offset) {
+    // Searched from the newest segment, the times are recent.
+    uint8_t index = shaper.count;
+    shaper_motion_t* motion = NULL;
+    while (index > 0) {
+        motion = shaper_history(--index);
+        if ((int32_t)(time - motion->start) >= 0)
+            break;
+    }
+    float fraction = 0.0; // Of the segment, before its start when none is that old
+    if (motion != NULL && (int32_t)(time - motion->start) >= 0) {
+        uint32_t into = time - motion->start;
+        fraction = (into >= motion->ticks) ? 1.0 : (float)into / motion->ticks;
+    }
+    for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+        for (uint8_t impulse = 0; impulse < shaper.impulses[axis]; impulse++) {
+            if (shaper.delay_index[axis][impulse] != delay_index)
+                continue;
+            float position = (motion == NULL) ? (shaper.position[axis] - shaper.out_position[axis]) :
+                             (motion->position[axis] - shaper.out_position[axis]) + fraction * motion->steps[axis];
+            offset[axis] += shaper.amplitude[axis][impulse] * position;
+        }
+    }
+}
+
+bool shaper_next_piece(bool end_of_motion, uint32_t* ticks, int32_t* steps) {
+    if (shaper.count == 0)
+        return false;
+    uint32_t last_delay = shaper.delay[shaper.delays - 1];
+    // The shaped motion is known as far as the unshaped motion, less the shortest delay.
+    uint32_t end = shaper.in_time + (end_of_motion ? last_delay : shaper.delay[0]);
+    int32_t left = (int32_t)(end - shaper.out_time);
+    if (left <= 0 || (left < SHAPER_PIECE_MIN && !end_of_motion))
+        return false; // Wait for more motion rather than hand out a sliver.
+    if (left > SHAPER_PIECE_MIN) {
+        // Cut the piece where the shaped rate changes first.
+        uint32_t earliest = shaper.out_time + SHAPER_PIECE_MIN;
+        for (uint8_t delay_index = 0; delay_index < shaper.delays; delay_index++) {
+            uint32_t delay = shaper.delay[delay_index];
+            uint8_t index = shaper.count;
+            while (index > 0) {
+                shaper_motion_t* motion = shaper_history(--index);
+                uint32_t change = motion->start + motion->ticks + delay;
+                if ((int32_t)(change - earliest) <= 0)
+                    break; // Older segments change the rate even earlier.
+                if ((int32_t)(change - end) < 0)
+                    end = change;
+                change = motion->start + delay;
+                if ((int32_t)(change - earliest) > 0 && (int32_t)(change - end) < 0)
+                    end = change;
+            }
+        }
+    }
+    uint8_t axis;
+    if ((int32_t)(end - shaper.in_time - last_delay) >= 0) {
+        // All of the motion has passed the last delay.
+        for (axis = 0; axis < N_AXIS; axis++)
+            steps[axis] = shaper.position[axis] - shaper.out_position[axis];
+    } else {
+        float offset[N_AXIS] = { 0.0 };
+        for (uint8_t delay_index = 0; delay_index < shaper.delays; delay_index++)
+            shaper_add_impulses(end - shaper.delay[delay_index], delay_index, offset);
+        for (axis = 0; axis < N_AXIS; axis++)
+            steps[axis] = lroundf(offset[axis]);
+    }
+    for (axis = 0; axis < N_AXIS; axis++)
+        shaper.out_position[axis] += steps[axis];
+    *ticks = end - shaper.out_time;
+    shaper.out_time = end;
+    // Drop the segments that have passed the last delay.
+    while (shaper.count > 0) {
+        shaper_motion_t* motion = shaper_history(0);
+        if ((int32_t)(motion->start + motion->ticks + last_delay - end) > 0)
+            break;
+        shaper.oldest = (shaper.oldest + 1) % SHAPER_HISTORY_SIZE;
+        shaper.count--;
+    }
+    return true;
+}
+
+#endif
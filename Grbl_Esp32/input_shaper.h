@@ -0,0 +1,62 @@
+/*
+  input_shaper.h - shapes the step motion to cancel the ringing of the machine
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef input_shaper_h
+#define input_shaper_h
+
+#include "grbl.h"
+
+// Input shaper types, settings.input_shaper ($38)
+#define SHAPER_ZV  0 // Zero vibration, two impulses half a ringing period apart. Shortest.
+#define SHAPER_ZVD 1 // Zero vibration and derivative, three impulses. Least sensitive to the frequency.
+#define SHAPER_MZV 2 // Modified ZV, three impulses over 3/4 of a period. In between.
+
+#define SHAPER_IMPULSES_MAX 3
+
+// Segments of unshaped motion kept to be shaped. The oldest ones are merged when they do not fit,
+// which only blurs the shape of very short segments at low frequencies.
+#ifndef SHAPER_HISTORY_SIZE
+    #define SHAPER_HISTORY_SIZE 48
+#endif
+
+// Shortest piece of shaped motion handed out, in step timer ticks, unless it is the last one.
+#define SHAPER_PIECE_MIN (TICKS_PER_MICROSECOND * 1000)
+
+// Forgets all motion. Called by st_reset().
+void shaper_reset();
+
+// Has the next shaper_setup() take the settings again. Called when $38 or $190-$205 change.
+void shaper_settings_changed();
+
+// Sets up the impulses of each axis from the settings, if they changed. Only called when
+// shaper_idle(). Returns false when no axis is shaped, so the motion can bypass the shaper.
+bool shaper_setup();
+
+// Returns true when all motion given to the shaper has been handed out.
+bool shaper_idle();
+
+// Gives the shaper the next segment of unshaped motion, with steps signed by direction, that
+// takes ticks of the step timer.
+void shaper_add_motion(uint32_t ticks, const int32_t* steps);
+
+// Hands out the next piece of shaped motion, to be stepped at a constant rate. Returns false when
+// there is none yet. With end_of_motion, the motion given so far stops there and the rest of its
+// shaped motion is handed out.
+bool shaper_next_piece(bool end_of_motion, uint32_t* ticks, int32_t* steps);
+
+#endif
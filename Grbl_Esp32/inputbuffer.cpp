@@ -28,21 +28,15 @@ InputBuffer inputBuffer;
 
 
 InputBuffer::InputBuffer() {
-    _RXbufferSize = 0;
-    _RXbufferpos = 0;
 }
 InputBuffer::~InputBuffer() {
-    _RXbufferSize = 0;
-    _RXbufferpos = 0;
 }
 void InputBuffer::begin() {
-    _RXbufferSize = 0;
-    _RXbufferpos = 0;
+    _RXbuffer.clear();
 }
 
 void InputBuffer::end() {
-    _RXbufferSize = 0;
-    _RXbufferpos = 0;
+    _RXbuffer.clear();
 }
 
 InputBuffer::operator bool() const {
@@ -50,63 +44,57 @@ InputBuffer::operator bool() const {
 }
 
 int InputBuffer::available() {
-    return _RXbufferSize;
+    return _RXbuffer.available();
 }
 
 int InputBuffer::availableforwrite() {
-    return (RXBUFFERSIZE - _RXbufferSize);
+    return _RXbuffer.availableForWrite();
 }
 
 size_t InputBuffer::write(uint8_t c) {
-    if ((1 + _RXbufferSize) <= RXBUFFERSIZE) {
-        int current = _RXbufferpos + _RXbufferSize;
-        if (current > RXBUFFERSIZE)
-            current = current - RXBUFFERSIZE;
-        if (current > (RXBUFFERSIZE - 1))
-            current = 0;
-        _RXbuffer[current] = c;
-        current ++;
-        _RXbufferSize += 1;
-        return 1;
-    }
-    return 0;
+    return _RXbuffer.push(c) ? 1 : 0;
 }
 
 size_t InputBuffer::write(const uint8_t* buffer, size_t size) {
-    //No need currently
-    //keep for compatibility
-    return size;
+    return _RXbuffer.write(buffer, size);
 }
 
 int InputBuffer::peek(void) {
-    if (_RXbufferSize > 0)return _RXbuffer[_RXbufferpos];
+    uint8_t* c = _RXbuffer.front();
+    if (c != NULL)return *c;
     else return -1;
 }
 
+// Queues a whole line or nothing.
 bool InputBuffer::push(const char* data) {
-    int data_size = strlen(data);
-    if ((data_size + _RXbufferSize) <= RXBUFFERSIZE) {
-        int current = _RXbufferpos + _RXbufferSize;
-        if (current > RXBUFFERSIZE) current = current - RXBUFFERSIZE;
-        for (int i = 0; i < data_size; i++) {
-            if (current > (RXBUFFERSIZE - 1)) current = 0;
-            _RXbuffer[current] = data[i];
-            current ++;
-        }
-        _RXbufferSize += strlen(data);
+    size_t data_size = strlen(data);
+    if (data_size <= (size_t)_RXbuffer.availableForWrite()) {
+        _RXbuffer.write((const uint8_t*)data, data_size);
         return true;
     }
     return false;
 }
 
 int InputBuffer::read(void) {
-    if (_RXbufferSize > 0) {
-        int v = _RXbuffer[_RXbufferpos];
-        _RXbufferpos++;
-        if (_RXbufferpos > (RXBUFFERSIZE - 1))_RXbufferpos = 0;
-        _RXbufferSize--;
-        return v;
-    } else return -1;
+    uint8_t c;
+    if (_RXbuffer.pop(&c))return c;
+    else return -1;
+}
+
+// Copies out as much as is there, up to size bytes.
+size_t InputBuffer::read(uint8_t* buffer, size_t size) {
+    return _RXbuffer.read(buffer, size);
+}
+
+// Returns the next contiguous run of received bytes, or NULL if there are none. They stay in
+// the buffer until they are released with consume().
+const uint8_t* InputBuffer::readSpan(uint32_t* count) {
+    const uint8_t* data = _RXbuffer.readSpan(count);
+    return (*count > 0) ? data : NULL;
+}
+
+void InputBuffer::consume(uint32_t count) {
+    _RXbuffer.consume(count);
 }
 
 void InputBuffer::flush(void) {
@@ -23,6 +23,7 @@
 #define _INPUT_BUFFER_H_
 
 #include "Print.h"
+#include "ringbuffer.h"
 #define RXBUFFERSIZE 128
 class InputBuffer: public Print {
   public:
@@ -52,13 +53,15 @@ class InputBuffer: public Print {
     int availableforwrite();
     int peek(void);
     int read(void);
+    size_t read(uint8_t* buffer, size_t size);
+    const uint8_t* readSpan(uint32_t* count);
+    void consume(uint32_t count);
     bool push(const char* data);
     void flush(void);
     operator bool() const;
   private:
-    uint8_t _RXbuffer[RXBUFFERSIZE];
-    uint16_t _RXbufferSize;
-    uint16_t _RXbufferpos;
+    // Written by one task and read by another, without locks.
+    RingBuffer<uint8_t, RXBUFFERSIZE> _RXbuffer;
 };
 
 
@@ -39,6 +39,7 @@ uint8_t jog_execute(plan_line_data_t* pl_data, parser_block_t* gc_block) {
     // Valid jog command. Plan, set state, and execute.
     mc_line(gc_block->values.xyz, pl_data);
     if (sys.state == STATE_IDLE) {
+        plan_queue_synchronize();
         if (plan_get_current_block() != NULL) { // Check if there is a block to execute.
             sys.state = STATE_JOG;
             st_prep_buffer();
@@ -0,0 +1,131 @@
+/*
+  line_tokenizer.cpp - assembles g-code lines from an input stream
+  Part of Grbl_ESP32
+
+  Used by the protocol loop for the client input and by the SD card reader,
+  so that both filter lines the same way. The protocol loop feeds it the
+  input ring buffers a contiguous span at a time, and each byte is only
+  touched once on its way into the line.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "grbl.h"
+
+void line_tokenizer_init(line_tokenizer_t* tokenizer, char* line, uint16_t size) {
+    tokenizer->line = line;
+    tokenizer->size = size;
+    line_tokenizer_reset(tokenizer);
+}
+
+void line_tokenizer_reset(line_tokenizer_t* tokenizer) {
+    tokenizer->char_counter = 0;
+    tokenizer->flags = 0;
+    tokenizer->eol = 0;
+    tokenizer->comment_char_counter = 0;
+    tokenizer->line[0] = 0;
+}
+
+// Handles a character while in a comment, a bracket command or after an overflow.
+static void line_tokenizer_flagged(line_tokenizer_t* tokenizer, uint8_t c) {
+    if (tokenizer->flags & LINE_FLAG_BRACKET) {   // in bracket mode all characters are accepted
+        if (tokenizer->char_counter < tokenizer->size - 1)
+            tokenizer->line[tokenizer->char_counter++] = c;
+        else
+            tokenizer->flags |= LINE_FLAG_OVERFLOW;
+    }
+    // Throw away all (except EOL) comment characters and overflow characters.
+    if (c == ')') {
+        // End of '()' comment. Resume line allowed.
+        if (tokenizer->flags & LINE_FLAG_COMMENT_PARENTHESES) {
+            tokenizer->flags &= ~(LINE_FLAG_COMMENT_PARENTHESES);
+            tokenizer->comment[tokenizer->comment_char_counter] = 0; // null terminate
+            report_gcode_comment(tokenizer->comment);
+        }
+    }
+    if (tokenizer->flags & LINE_FLAG_COMMENT_PARENTHESES) {  // capture all characters into a comment buffer
+        if (tokenizer->comment_char_counter < LINE_BUFFER_SIZE - 1)
+            tokenizer->comment[tokenizer->comment_char_counter++] = c;
+    }
+}
+
+uint32_t line_tokenizer_feed(line_tokenizer_t* tokenizer, const uint8_t* data, uint32_t len, bool* complete) {
+    char* line = tokenizer->line;
+    uint16_t char_counter = tokenizer->char_counter;
+    uint16_t char_max = tokenizer->size - 1;
+    const uint8_t* end = data + len;
+    const uint8_t* p = data;
+    *complete = false;
+    while (p < end) {
+        uint8_t c = *p++;
+        if ((c == '\n') || (c == '\r')) { // End of line reached
+            line[char_counter] = 0; // Set string termination character.
+            tokenizer->char_counter = char_counter;
+            tokenizer->eol = c;
+            *complete = true;
+            break;
+        }
+        if (tokenizer->flags) {
+            tokenizer->char_counter = char_counter;
+            line_tokenizer_flagged(tokenizer, c);
+            char_counter = tokenizer->char_counter;
+        } else if (c <= ' ') {
+            // Throw away whitepace and control characters
+        }
+        /*
+        else if (c == '/') {
+            // Block delete NOT SUPPORTED. Ignore character.
+            // NOTE: If supported, would simply need to check the system if block delete is enabled.
+        }
+        */
+        else if (c == '(') {
+            // Enable comments flag and ignore all characters until ')' or EOL.
+            // NOTE: This doesn't follow the NIST definition exactly, but is good enough for now.
+            // In the future, we could simply remove the items within the comments, but retain the
+            // comment control characters, so that the g-code parser can error-check it.
+            tokenizer->flags |= LINE_FLAG_COMMENT_PARENTHESES;
+            tokenizer->comment_char_counter = 0;
+        } else if (c == ';') {
+            // NOTE: ';' comment to EOL is a LinuxCNC definition. Not NIST.
+            tokenizer->flags |= LINE_FLAG_COMMENT_SEMICOLON;
+        } else if (c == '[') {
+            // For ESP3D bracket commands like [ESP100]<SSID>pwd=<admin password>
+            // prevents spaces being striped and converting to uppercase
+            tokenizer->flags |= LINE_FLAG_BRACKET;
+            if (char_counter < char_max)
+                line[char_counter++] = c; // capture this character
+            else
+                tokenizer->flags |= LINE_FLAG_OVERFLOW;
+            // TODO: Install '%' feature
+        } else if (c == '%') {
+            // Program start-end percent sign NOT SUPPORTED.
+            // NOTE: This maybe installed to tell Grbl when a program is running vs manual input,
+            // where, during a program, the system auto-cycle start will continue to execute
+            // everything until the next '%' sign. This will help fix resuming issues with certain
+            // functions that empty the planner buffer to execute its task on-time.
+        } else if (char_counter >= char_max) {
+            // Detect line buffer overflow and set flag.
+            tokenizer->flags |= LINE_FLAG_OVERFLOW;
+        } else if (c >= 'a' && c <= 'z')   // Upcase lowercase
+            line[char_counter++] = c - 'a' + 'A';
+        else
+            line[char_counter++] = c;
+    }
+    tokenizer->char_counter = char_counter;
+    return p - data;
+}
+
+bool line_tokenizer_finish(line_tokenizer_t* tokenizer) {
+    tokenizer->line[tokenizer->char_counter] = 0;
+    tokenizer->eol = 0;
+    return tokenizer->char_counter != 0;
+}
@@ -0,0 +1,55 @@
+/*
+  line_tokenizer.h - Header for assembling g-code lines from an input stream
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef line_tokenizer_h
+#define line_tokenizer_h
+
+#include "grbl.h"
+
+// Define line flags. Includes comment type tracking and line overflow detection.
+#define LINE_FLAG_OVERFLOW bit(0)
+#define LINE_FLAG_COMMENT_PARENTHESES bit(1)
+#define LINE_FLAG_COMMENT_SEMICOLON bit(2)
+#define LINE_FLAG_BRACKET bit(3) // square bracket for WebUI commands
+
+// Builds one line at a time out of the raw input. Spaces, control characters and comments are
+// removed and letters are capitalized as the bytes come in, so the finished line can be handed
+// to the parsers as it is.
+typedef struct {
+    char* line;                       // Line being assembled. Zero-terminated once complete.
+    uint16_t size;                    // Size of line, including the terminating zero
+    uint16_t char_counter;
+    uint8_t flags;                    // LINE_FLAG_xxx
+    uint8_t eol;                      // The character that completed the line, '\n' or '\r'
+    uint8_t comment_char_counter;
+    char comment[LINE_BUFFER_SIZE];   // Text of the current '()' comment. Zero-terminated.
+} line_tokenizer_t;
+
+// Starts assembling lines into a buffer of size bytes.
+void line_tokenizer_init(line_tokenizer_t* tokenizer, char* line, uint16_t size);
+
+// Throws away the line assembled so far.
+void line_tokenizer_reset(line_tokenizer_t* tokenizer);
+
+// Takes bytes from data until the end of a line. Returns the number of bytes used and sets
+// *complete when a line is ready in tokenizer->line. Call line_tokenizer_reset() before
+// feeding the next line.
+uint32_t line_tokenizer_feed(line_tokenizer_t* tokenizer, const uint8_t* data, uint32_t len, bool* complete);
+
+// Completes a line that ended without an end of line character. Returns false if it is empty.
+bool line_tokenizer_finish(line_tokenizer_t* tokenizer);
+
+#endif
@@ -27,6 +27,8 @@
 #define STEPPER_OFF_TIMER_PRESCALE 8 // gives a frequency of 10MHz
 #define STEPPER_OFF_PERIOD_uSEC  3   // each tick is
 
+#define UNDEFINED_PIN 255 // Can be used to show a pin has no i/O assigned
+
 #define STEP_PULSE_MIN 2   // uSeconds
 #define STEP_PULSE_MAX 10  // uSeconds
 
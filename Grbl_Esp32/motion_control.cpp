@@ -44,6 +44,11 @@ void mc_line_kins(float* target, plan_line_data_t* pl_data, float* position) {
 // mc_line and plan_buffer_line is done primarily to place non-planner-type functions from being
 // in the planner and to let backlash compensation or canned cycle integration simple and direct.
 void mc_line(float* target, plan_line_data_t* pl_data) {
+    // When compiling a job, the motion is recorded instead. Soft limits are checked when it is played.
+    if (job_compiling) {
+        job_compile_motion(target, pl_data);
+        return;
+    }
     // If enabled, check for soft limit violations. Placed here all line motions are picked up
     // from everywhere in Grbl.
     if (bit_istrue(settings.flags, BITFLAG_SOFT_LIMIT_ENABLE)) {
@@ -70,14 +75,151 @@ void mc_line(float* target, plan_line_data_t* pl_data) {
     do {
         protocol_execute_realtime(); // Check for any run-time commands
         if (sys.abort)  return;   // Bail, if system abort.
-        if (plan_check_full_buffer())  protocol_auto_cycle_start();     // Auto-cycle start when buffer is full.
+        if (plan_check_full_queue())  protocol_auto_cycle_start();     // Auto-cycle start when buffer is full.
         else  break;
     } while (1);
-    // Plan and queue motion into planner buffer
+    // Plan and queue motion into planner buffer. With USE_PLANNER_TASK the planner task plans it.
     // uint8_t plan_status; // Not used in normal operation.
-    plan_buffer_line(target, pl_data);
+    plan_queue_line(target, pl_data);
+}
+
+
+// Continuous path mode (G64) holds back the end of the last line, until the next line tells how to
+// round the corner between them.
+static struct {
+    bool pending;              // A line is held back
+    float position[N_AXIS];    // Where the motion sent on ends, the start of the held line
+    float target[N_AXIS];      // End of the held line, the corner to the next one
+    plan_line_data_t pl_data;  // Of the held line
+} blend;
+
+// Sends a line of blended motion on from where the last one ended.
+static void mc_blend_line(float* target, plan_line_data_t* pl_data) {
+    float position[N_AXIS];
+    memcpy(position, blend.position, sizeof(position));
+    memcpy(blend.position, target, sizeof(blend.position));
+    mc_line_kins(target, pl_data, position);
+}
+
+// Executes linear motion in continuous path mode (G64). The corner to the line before is rounded
+// off by a circular arc tangent to both lines, no farther than tolerance from the corner, and cut
+// into no more than half of the lines. The arc is segmented like G2/G3 arcs, so the planner takes
+// it at the speed of its radius instead of slowing down to the junction speed of the corner.
+// The line is held back, to be rounded off into the next line or sent on by mc_blend_flush().
+void mc_line_blend(float* target, plan_line_data_t* pl_data, float* position, float tolerance) {
+    // Only lines with the same conditions are blended, as the arc between them takes the conditions
+    // of the line before. Inverse time feed rates are for the whole of the line.
+    if (blend.pending) {
+        if ((memcmp(position, blend.target, sizeof(blend.target)) != 0) || (pl_data->condition != blend.pl_data.condition) ||
+                (pl_data->spindle_speed != blend.pl_data.spindle_speed) || (pl_data->condition & PL_COND_FLAG_INVERSE_TIME))
+            mc_blend_flush();
+    }
+    if (!blend.pending) {
+        memcpy(blend.position, position, sizeof(blend.position));
+        memcpy(blend.target, target, sizeof(blend.target));
+        memcpy(&blend.pl_data, pl_data, sizeof(plan_line_data_t));
+        blend.pending = true;
+        mc_blend_poll();
+        return;
+    }
+    float unit_in[N_AXIS], unit_out[N_AXIS];
+    float length_in = 0.0, length_out = 0.0, cos_turn = 0.0;
+    uint8_t idx;
+    for (idx = 0; idx < N_AXIS; idx++) {
+        unit_in[idx] = blend.target[idx] - blend.position[idx];
+        unit_out[idx] = target[idx] - blend.target[idx];
+        length_in += unit_in[idx] * unit_in[idx];
+        length_out += unit_out[idx] * unit_out[idx];
+    }
+    if (length_out == 0.0)
+        return; // Zero-length line. Nothing to round off.
+    length_in = sqrt(length_in);
+    length_out = sqrt(length_out);
+    for (idx = 0; idx < N_AXIS; idx++) {
+        if (length_in > 0.0)
+            unit_in[idx] /= length_in;
+        unit_out[idx] /= length_out;
+        cos_turn += unit_in[idx] * unit_out[idx];
+    }
+    // An arc tangent to both lines, that passes the corner at tolerance, starts and ends a cut of
+    // tolerance * sin(turn/2) / (1 - cos(turn/2)) away from it. Nearly straight and nearly reversing
+    // corners are not rounded off. The planner runs them at full speed or stops at them anyway.
+    if ((tolerance > 0.0) && (length_in > 0.0) && (cos_turn > -0.999) && (cos_turn < 0.999999)) {
+        float sin_half = sqrt(0.5 * (1.0 - cos_turn));
+        float cos_half = sqrt(0.5 * (1.0 + cos_turn));
+        float cut = tolerance * sin_half / (1.0 - cos_half);
+        if (cut > length_in)
+            cut = length_in;
+        if (cut > 0.5 * length_out)
+            cut = 0.5 * length_out;
+        float radius = cut * cos_half / sin_half;
+        float turn = 2.0 * atan2(sin_half, cos_half);
+        // Unit vector from the start of the arc towards its center.
+        float normal[N_AXIS];
+        float sin_turn = 2.0 * sin_half * cos_half;
+        for (idx = 0; idx < N_AXIS; idx++)
+            normal[idx] = (unit_out[idx] - cos_turn * unit_in[idx]) / sin_turn;
+        // The straight part of the held line, up to the arc.
+        float start[N_AXIS];
+        for (idx = 0; idx < N_AXIS; idx++)
+            start[idx] = blend.target[idx] - cut * unit_in[idx];
+        if (cut < length_in)
+            mc_blend_line(start, &blend.pl_data);
+        if (sys.abort)  return;
+        // Segments of the arc, with the same chordal tolerance as G2/G3 arcs.
+        plan_line_data_t arc_data;
+        memcpy(&arc_data, &blend.pl_data, sizeof(plan_line_data_t));
+        if (pl_data->feed_rate < arc_data.feed_rate)
+            arc_data.feed_rate = pl_data->feed_rate;
+        uint16_t segments = 1;
+        if (radius > settings.arc_tolerance)
+            segments += floor(0.5 * turn * radius / sqrt(settings.arc_tolerance * (2 * radius - settings.arc_tolerance)));
+        float point[N_AXIS];
+        for (uint16_t i = 1; i <= segments; i++) {
+            float angle = turn * i / segments;
+            float along = radius * sin(angle);
+            float across = radius * (1.0 - cos(angle));
+            for (idx = 0; idx < N_AXIS; idx++)
+                point[idx] = start[idx] + along * unit_in[idx] + across * normal[idx];
+            if (i == segments) {
+                // Ensure the arc ends on the next line.
+                for (idx = 0; idx < N_AXIS; idx++)
+                    point[idx] = blend.target[idx] + cut * unit_out[idx];
+            }
+            mc_blend_line(point, &arc_data);
+            if (sys.abort)  return;
+        }
+    } else {
+        mc_blend_line(blend.target, &blend.pl_data);
+        if (sys.abort)  return;
+    }
+    memcpy(blend.target, target, sizeof(blend.target));
+    memcpy(&blend.pl_data, pl_data, sizeof(plan_line_data_t));
+    mc_blend_poll();
+}
+
+// Sends the line held back by continuous path mode on, to end at its corner. Called before
+// anything that is not blended and upon a buffer sync.
+void mc_blend_flush() {
+    if (!blend.pending)
+        return;
+    blend.pending = false;
+    mc_blend_line(blend.target, &blend.pl_data);
 }
 
+// Sends the held line on when the planner is about to run out of motion, rather than wait for the
+// next line to arrive. Called from the main loop and after a line is held back.
+void mc_blend_poll() {
+    if (job_compiling)
+        return; // Nothing runs while compiling a job
+    if (blend.pending && (plan_get_block_buffer_count() + plan_get_queue_count() <= 1))
+        mc_blend_flush();
+}
+
+// Forgets the held line. Called by gc_init() upon a reset.
+void mc_blend_reset() {
+    blend.pending = false;
+}
 
 // Execute an arc in offset mode format. position == current xyz, target == target xyz,
 // offset == offset from current xyz, axis_X defines circle plane in tool space, axis_linear is
@@ -200,7 +342,11 @@ void mc_arc(float* target, plan_line_data_t* pl_data, float* position, float* of
 
 // Execute dwell in seconds.
 void mc_dwell(float seconds) {
-    if (sys.state == STATE_CHECK_MODE)  return;
+    if (sys.state == STATE_CHECK_MODE) {
+        if (job_compiling)
+            job_compile_dwell(seconds);
+        return;
+    }
     protocol_buffer_synchronize();
     delay_sec(seconds, DELAY_MODE_DWELL);
 }
@@ -361,7 +507,7 @@ uint8_t mc_probe_cycle(float* target, plan_line_data_t* pl_data, uint8_t parser_
     // Probing cycle complete!
     // Set state variables and error out, if the probe failed and cycle with error is enabled.
     if (sys_probe_state == PROBE_ACTIVE) {
-        if (is_no_error)  memcpy(sys_probe_position, sys_position, sizeof(sys_position));
+        if (is_no_error)  st_get_position(sys_probe_position);
         else  system_set_exec_alarm(EXEC_ALARM_PROBE_FAIL_CONTACT);
     } else {
         sys.probe_succeeded = true; // Indicate to system the probing cycle completed successfully.
@@ -382,6 +528,7 @@ uint8_t mc_probe_cycle(float* target, plan_line_data_t* pl_data, uint8_t parser_
 }
 
 
+#ifdef PARKING_ENABLE
 // Plans and executes the single special motion case for parking. Independent of main planner buffer.
 // NOTE: Uses the always free planner ring buffer head to store motion parameters for execution.
 void mc_parking_motion(float* parking_target, plan_line_data_t* pl_data) {
@@ -403,6 +550,7 @@ void mc_parking_motion(float* parking_target, plan_line_data_t* pl_data) {
         protocol_exec_rt_system();
     }
 }
+#endif
 
 #ifdef ENABLE_PARKING_OVERRIDE_CONTROL
 void mc_override_ctrl_update(uint8_t override_state) {
@@ -49,6 +49,19 @@
 void mc_line_kins(float* target, plan_line_data_t* pl_data, float* position);
 void mc_line(float* target, plan_line_data_t* pl_data);
 
+// Execute linear motion in continuous path mode (G64), rounding off the corner to the line before
+// within tolerance in mm. The line is held back until the next one or mc_blend_flush().
+void mc_line_blend(float* target, plan_line_data_t* pl_data, float* position, float tolerance);
+
+// Sends the line held back by mc_line_blend() on.
+void mc_blend_flush();
+
+// Sends the held line on when the planner is about to run out of motion.
+void mc_blend_poll();
+
+// Forgets the held line upon a reset.
+void mc_blend_reset();
+
 // Execute an arc in offset mode format. position == current xyz, target == target xyz,
 // offset == offset from current xyz, axis_XXX defines circle plane in tool space, axis_linear is
 // the direction of helical travel, radius == circle radius, is_clockwise_arc boolean. Used
@@ -0,0 +1,226 @@
+/*
+  output_queue.cpp - per client output queues, sent by a task of each client
+  Part of Grbl_ESP32
+
+  grbl_send() used to write to each transport in turn, so a Bluetooth or
+  telnet peer that reads slowly held up whoever was sending, often the
+  main loop. Now each client has a queue that a task of its own sends,
+  and a sender only copies its message into the queues.
+
+  Text is queued whole and never reordered, and a sender never waits. It
+  holds the ok/error responses that senders count characters by, so a
+  queue is kept from filling up by back-pressure instead: the main loop
+  reads no new line of a client while its queue lacks OUTPUT_LINE_ROOM.
+  The last OUTPUT_RESPONSE_ROOM bytes are only for the ok or error: of a
+  line, so that always fits. Text that still does not fit, e.g. a long
+  listing to a slow client, is dropped whole and the client is told so,
+  where it was dropped. Status reports do not go into the queue: each client has one slot
+  per kind, and a new report replaces one that was not sent yet, so a slow
+  client gets fewer but current reports and a status report never waits.
+  They are sent after the text that is queued at that time.
+
+  Only the senders write to a queue, one at a time with the mutex of the
+  client held; only the task of the client reads it.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "grbl.h"
+
+typedef struct {
+    uint16_t len; // 0 when no report waits
+    uint8_t data[OUTPUT_STATUS_SIZE];
+} output_status_slot_t;
+
+typedef struct {
+    RingBuffer<uint8_t, OUTPUT_QUEUE_SIZE> text;
+    output_status_slot_t status[OUTPUT_STATUS_KINDS]; // Changed with the mutex held
+    SemaphoreHandle_t mutex;
+    TaskHandle_t task;         // NULL until output_queue_init(), senders then write themselves
+    bool dropped;              // Text was dropped, which the next text that fits tells of
+} output_queue_t;
+
+static const char output_dropped_msg[] = "[MSG:Output dropped]\r\n";
+
+static output_queue_t output_queue[OUTPUT_QUEUE_CLIENTS];
+
+// Clients that are compiled in
+static bool output_queue_used(uint8_t client) {
+    switch (client) {
+    case CLIENT_SERIAL: return true;
+#ifdef ENABLE_BLUETOOTH
+    case CLIENT_BT: return true;
+#endif
+#if defined (ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_OUT)
+    case CLIENT_WEBUI: return true;
+#endif
+#if defined (ENABLE_WIFI) && defined(ENABLE_TELNET)
+    case CLIENT_TELNET: return true;
+#endif
+    default: return false;
+    }
+}
+
+// Writes to the transport of a client. May block for as long as the client is slow, but returns
+// when the client is not connected, so a queue always drains.
+static void output_queue_send(uint8_t client, const uint8_t* data, size_t len) {
+    switch (client) {
+#ifdef ENABLE_BLUETOOTH
+    case CLIENT_BT:
+        if (SerialBT.hasClient())
+            SerialBT.write(data, len);
+        break;
+#endif
+#if defined (ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_OUT)
+    case CLIENT_WEBUI: Serial2Socket.write(data, len); break;
+#endif
+#if defined (ENABLE_WIFI) && defined(ENABLE_TELNET)
+    case CLIENT_TELNET: telnet_server.write(data, len); break;
+#endif
+    case CLIENT_SERIAL: Serial.write(data, len); break;
+    }
+}
+
+static void output_queue_lock(output_queue_t* queue) {
+    if (queue->mutex != NULL)
+        xSemaphoreTake(queue->mutex, portMAX_DELAY);
+}
+
+static void output_queue_unlock(output_queue_t* queue) {
+    if (queue->mutex != NULL)
+        xSemaphoreGive(queue->mutex);
+}
+
+// Has the task of the client send what was queued, or sends it right away before there is one
+static void output_queue_flush(uint8_t client) {
+    if (output_queue[client].task != NULL)
+        xTaskNotifyGive(output_queue[client].task);
+    else
+        output_queue_drain(client);
+}
+
+// Queues data whole, leaving reserve bytes free, or drops it
+static void output_queue_write_client(uint8_t client, const uint8_t* data, size_t len, uint32_t reserve) {
+    output_queue_t* queue = &output_queue[client];
+    if (queue->task == NULL) { // Before output_queue_init(), the sender sends itself
+        output_queue_drain(client);
+        output_queue_send(client, data, len);
+        return;
+    }
+    output_queue_lock(queue);
+    uint32_t room = queue->text.availableForWrite();
+    room = (room > reserve) ? room - reserve : 0;
+    if (queue->dropped && room >= sizeof(output_dropped_msg) - 1 + len) {
+        queue->text.write((const uint8_t*)output_dropped_msg, sizeof(output_dropped_msg) - 1);
+        queue->dropped = false;
+        room -= sizeof(output_dropped_msg) - 1;
+    }
+    if (room >= len)
+        queue->text.write(data, len);
+    else
+        queue->dropped = true;
+    output_queue_unlock(queue);
+    output_queue_flush(client);
+}
+
+static void output_queue_write_clients(uint8_t client, const uint8_t* data, size_t len, uint32_t reserve) {
+    if (client == CLIENT_ALL) {
+        for (client = 0; client < OUTPUT_QUEUE_CLIENTS; client++) {
+            if (output_queue_used(client))
+                output_queue_write_client(client, data, len, reserve);
+        }
+    } else if (client < OUTPUT_QUEUE_CLIENTS && output_queue_used(client))
+        output_queue_write_client(client, data, len, reserve);
+}
+
+void output_queue_write(uint8_t client, const uint8_t* data, size_t len) {
+    output_queue_write_clients(client, data, len, OUTPUT_RESPONSE_ROOM);
+}
+
+void output_queue_response(uint8_t client, const uint8_t* data, size_t len) {
+    output_queue_write_clients(client, data, len, 0);
+}
+
+bool output_queue_ready(uint8_t client) {
+    if (client >= OUTPUT_QUEUE_CLIENTS || output_queue[client].task == NULL)
+        return true; // Nothing is queued for it, or its sender sends
+    return output_queue[client].text.availableForWrite() >= OUTPUT_LINE_ROOM;
+}
+
+static void output_queue_status_client(uint8_t client, uint8_t kind, const uint8_t* data, size_t len) {
+    output_queue_t* queue = &output_queue[client];
+    output_queue_lock(queue);
+    memcpy(queue->status[kind].data, data, len);
+    queue->status[kind].len = len;
+    output_queue_unlock(queue);
+    output_queue_flush(client);
+}
+
+void output_queue_status(uint8_t client, uint8_t kind, const uint8_t* data, size_t len) {
+    if (kind >= OUTPUT_STATUS_KINDS || len > OUTPUT_STATUS_SIZE)
+        return;
+    if (client == CLIENT_ALL) {
+        for (client = 0; client < OUTPUT_QUEUE_CLIENTS; client++) {
+            if (output_queue_used(client))
+                output_queue_status_client(client, kind, data, len);
+        }
+    } else if (client < OUTPUT_QUEUE_CLIENTS && output_queue_used(client))
+        output_queue_status_client(client, kind, data, len);
+}
+
+void output_queue_drain(uint8_t client) {
+    output_queue_t* queue = &output_queue[client];
+    uint32_t span;
+    uint8_t* data;
+    while (data = queue->text.readSpan(&span), span > 0) {
+        output_queue_send(client, data, span);
+        queue->text.consume(span);
+    }
+    for (uint8_t kind = 0; kind < OUTPUT_STATUS_KINDS; kind++) {
+        uint8_t report[OUTPUT_STATUS_SIZE];
+        output_queue_lock(queue);
+        uint16_t len = queue->status[kind].len;
+        memcpy(report, queue->status[kind].data, len);
+        queue->status[kind].len = 0;
+        output_queue_unlock(queue);
+        if (len != 0)
+            output_queue_send(client, report, len);
+    }
+}
+
+static void outputQueueTask(void* pvParameters) {
+    uint8_t client = (uintptr_t)pvParameters;
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // Sleep until something is queued
+        output_queue_drain(client);
+    }
+}
+
+void output_queue_init() {
+    static const char* const task_names[OUTPUT_QUEUE_CLIENTS] = { "serialOutTask", "btOutTask", "webuiOutTask", "telnetOutTask" };
+    for (uint8_t client = 0; client < OUTPUT_QUEUE_CLIENTS; client++) {
+        output_queue_t* queue = &output_queue[client];
+        if (!output_queue_used(client) || queue->task != NULL)
+            continue;
+        queue->mutex = xSemaphoreCreateMutex();
+        xTaskCreatePinnedToCore(outputQueueTask,    // task
+                                task_names[client], // name for task
+                                4096,   // size of task stack
+                                (void*)(uintptr_t)client,   // parameters
+                                1, // priority
+                                &queue->task,
+                                0 // core
+                               );
+    }
+}
@@ -0,0 +1,67 @@
+/*
+  output_queue.h - per client output queues, sent by a task of each client
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef output_queue_h
+#define output_queue_h
+
+#include "grbl.h"
+
+// Bytes of text that can wait for each client. Must be a power of two.
+#ifndef OUTPUT_QUEUE_SIZE
+    #define OUTPUT_QUEUE_SIZE 1024
+#endif
+
+// A client's input is only read while its queue has this much room (output_queue_ready()), so
+// the response to a line and the messages the line sends on the way fit without waiting.
+#define OUTPUT_LINE_ROOM 256
+// Of that room, what only the ok or error: ending a response may take (output_queue_response())
+#define OUTPUT_RESPONSE_ROOM 16
+
+// Status reports, of which only the latest one waits for each client
+#define OUTPUT_STATUS_TEXT 0  // '<...>' text report
+#define OUTPUT_STATUS_FRAME 1 // Binary status frame (status_frame.h)
+#define OUTPUT_STATUS_KINDS 2
+#define OUTPUT_STATUS_SIZE 256
+
+// Clients that are sent to, those before CLIENT_INPUT
+#define OUTPUT_QUEUE_CLIENTS CLIENT_INPUT
+
+// Starts the task of each client that is compiled in. Until then, senders write to the client
+// themselves. Called from setup().
+void output_queue_init();
+
+// Queues data for a client, or for every client with CLIENT_ALL. Never waits: data that does not
+// fit, leaving OUTPUT_RESPONSE_ROOM free, is dropped whole, and the client gets
+// "[MSG:Output dropped]" in its place ahead of the next data that fits.
+void output_queue_write(uint8_t client, const uint8_t* data, size_t len);
+
+// Queues the ok or error: that ends the response to a line, which may take the room kept for it.
+void output_queue_response(uint8_t client, const uint8_t* data, size_t len);
+
+// Returns false while the queue of a client lacks OUTPUT_LINE_ROOM, when its input should not be
+// read, so that a slow client holds up only itself.
+bool output_queue_ready(uint8_t client);
+
+// Queues a status report, which replaces the one of the same kind that is still waiting. Never
+// waits.
+void output_queue_status(uint8_t client, uint8_t kind, const uint8_t* data, size_t len);
+
+// Sends what waits for a client. Run by the task of the client.
+void output_queue_drain(uint8_t client);
+
+#endif
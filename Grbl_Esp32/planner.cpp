@@ -25,13 +25,19 @@
 
 #include "grbl.h"
 #include <stdlib.h> // PSoc Required for labs
-
-
-static plan_block_t block_buffer[BLOCK_BUFFER_SIZE];  // A ring buffer for motion instructions
-static uint8_t block_buffer_tail;     // Index of the block to process now
-static uint8_t block_buffer_head;     // Index of the next block to be pushed
-static uint8_t next_buffer_head;      // Index of the next buffer head
-static uint8_t block_buffer_planned;  // Index of the optimally planned block
+#include <esp_heap_caps.h>
+
+
+static plan_block_t block_buffer_internal[BLOCK_BUFFER_SIZE]; // Used when there is no PSRAM buffer
+static plan_block_t* block_buffer = block_buffer_internal;  // A ring buffer for motion instructions
+static uint16_t block_buffer_size = BLOCK_BUFFER_SIZE; // Number of blocks in the ring buffer
+static uint16_t block_buffer_tail;     // Index of the block to process now
+static uint16_t block_buffer_head;     // Index of the next block to be pushed
+static uint16_t next_buffer_head;      // Index of the next buffer head
+static uint16_t block_buffer_planned;  // Index of the optimally planned block
+#ifdef USE_PLANNER_TASK
+static SemaphoreHandle_t plan_mutex;   // Held while the planner buffer is changed. See plan_lock().
+#endif
 
 // Define planner variables
 typedef struct {
@@ -45,16 +51,16 @@ static planner_t pl;
 
 
 // Returns the index of the next block in the ring buffer. Also called by stepper segment buffer.
-uint8_t plan_next_block_index(uint8_t block_index) {
+uint16_t plan_next_block_index(uint16_t block_index) {
     block_index++;
-    if (block_index == BLOCK_BUFFER_SIZE)  block_index = 0;
+    if (block_index == block_buffer_size)  block_index = 0;
     return (block_index);
 }
 
 
 // Returns the index of the previous block in the ring buffer
-static uint8_t plan_prev_block_index(uint8_t block_index) {
-    if (block_index == 0)  block_index = BLOCK_BUFFER_SIZE;
+static uint16_t plan_prev_block_index(uint16_t block_index) {
+    if (block_index == 0)  block_index = block_buffer_size;
     block_index--;
     return (block_index);
 }
@@ -124,10 +130,23 @@ static uint8_t plan_prev_block_index(uint8_t block_index) {
   to compute an optimal plan, so select carefully. The Arduino 328p memory is already maxed out, but future
   ARM versions should have enough memory and speed for look-ahead blocks numbering up to a hundred or more.
 
+  With a jerk setting ($180...) the speed changes of a block are S-curves instead of linear ramps: the
+  acceleration rises from zero at the jerk limit, holds at the block acceleration if there is time,
+  and falls back to zero. Every ramp ends with zero acceleration, at the latest at the end of its block,
+  so the acceleration never jumps and the machine is not kicked into ringing. The guidelines above
+  hold with the ramp distances of plan_ramp_distance() in place of v^2/(2a). As each block ramps on
+  its own, blocks much shorter than the distance of a ramp change speed slowly.
+
+  On the ESP32 the buffer can be put in PSRAM and hold a thousand blocks or more (PSRAM_BLOCK_BUFFER_SIZE).
+  The work per new block stays bounded regardless: it is proportional to the number of blocks behind the
+  planned pointer, which in normal streaming is the distance needed to decelerate from the nominal speed,
+  and plan_buffer_line() never lets it exceed PLANNER_RECALCULATE_LIMIT blocks. Feed holds and overrides
+  still recompute the whole buffer.
+
 */
 static void planner_recalculate() {
     // Initialize block index to the last block in the planner buffer.
-    uint8_t block_index = plan_prev_block_index(block_buffer_head);
+    uint16_t block_index = plan_prev_block_index(block_buffer_head);
     // Bail. Can't do anything with one only one plan-able block.
     if (block_index == block_buffer_planned)  return;
     // Reverse Pass: Coarsely maximize all possible deceleration curves back-planning from the last
@@ -137,7 +156,7 @@ static void planner_recalculate() {
     plan_block_t* next;
     plan_block_t* current = &block_buffer[block_index];
     // Calculate maximum entry speed for last block in buffer, where the exit speed is always zero.
-    current->entry_speed_sqr = MIN(current->max_entry_speed_sqr, 2 * current->acceleration * current->millimeters);
+    current->entry_speed_sqr = MIN(current->max_entry_speed_sqr, plan_reachable_speed_sqr(current, 0.0, current->millimeters));
     block_index = plan_prev_block_index(block_index);
     if (block_index == block_buffer_planned) { // Only two plannable blocks in buffer. Reverse pass complete.
         // Check if the first block is the tail. If so, notify stepper to update its current parameters.
@@ -151,7 +170,7 @@ static void planner_recalculate() {
             if (block_index == block_buffer_tail)  st_update_plan_block_parameters();
             // Compute maximum entry speed decelerating over the current block from its exit speed.
             if (current->entry_speed_sqr != current->max_entry_speed_sqr) {
-                entry_speed_sqr = next->entry_speed_sqr + 2 * current->acceleration * current->millimeters;
+                entry_speed_sqr = plan_reachable_speed_sqr(current, next->entry_speed_sqr, current->millimeters);
                 if (entry_speed_sqr < current->max_entry_speed_sqr)
                     current->entry_speed_sqr = entry_speed_sqr;
                 else
@@ -170,7 +189,7 @@ static void planner_recalculate() {
         // pointer forward, since everything before this is all optimal. In other words, nothing
         // can improve the plan from the buffer tail to the planned pointer by logic.
         if (current->entry_speed_sqr < next->entry_speed_sqr) {
-            entry_speed_sqr = current->entry_speed_sqr + 2 * current->acceleration * current->millimeters;
+            entry_speed_sqr = plan_reachable_speed_sqr(current, current->entry_speed_sqr, current->millimeters);
             // If true, current block is full-acceleration and we can move the planned pointer forward.
             if (entry_speed_sqr < next->entry_speed_sqr) {
                 next->entry_speed_sqr = entry_speed_sqr; // Always <= max_entry_speed_sqr. Backward pass sets this.
@@ -187,9 +206,49 @@ static void planner_recalculate() {
 }
 
 
+// Locks the planner buffer against changes from the other core. With the planner task, lines are
+// planned on core 0 while the main loop prepares segments, handles feed holds and resets on core 1.
+// The lock is recursive, so locked functions may call each other.
+void plan_lock() {
+#ifdef USE_PLANNER_TASK
+    xSemaphoreTakeRecursive(plan_mutex, portMAX_DELAY);
+#endif
+}
+
+
+void plan_unlock() {
+#ifdef USE_PLANNER_TASK
+    xSemaphoreGiveRecursive(plan_mutex);
+#endif
+}
+
+
+// Allocates the planner buffer. Called once at startup. On boards with PSRAM the buffer holds
+// PSRAM_BLOCK_BUFFER_SIZE blocks, otherwise the BLOCK_BUFFER_SIZE blocks in internal RAM are used.
+void plan_init() {
+#ifdef USE_PLANNER_TASK
+    if (plan_mutex == NULL)  plan_mutex = xSemaphoreCreateRecursiveMutex();
+#endif
+#ifdef PSRAM_BLOCK_BUFFER_SIZE
+    if (block_buffer == block_buffer_internal) {
+        plan_block_t* psram_buffer = (plan_block_t*)heap_caps_malloc(PSRAM_BLOCK_BUFFER_SIZE * sizeof(plan_block_t), MALLOC_CAP_SPIRAM);
+        if (psram_buffer != NULL) {
+            block_buffer = psram_buffer;
+            block_buffer_size = PSRAM_BLOCK_BUFFER_SIZE;
+        }
+    }
+#endif
+    grbl_msg_sendf(CLIENT_SERIAL, MSG_LEVEL_INFO, "Planner buffer %d blocks", block_buffer_size);
+    plan_reset();
+}
+
+
 void plan_reset() {
+    plan_lock();
     memset(&pl, 0, sizeof(planner_t)); // Clear planner struct
     plan_reset_buffer();
+    plan_queue_reset(); // Lines queued for the planner task are discarded as well.
+    plan_unlock();
 }
 
 
@@ -203,10 +262,11 @@ void plan_reset_buffer() {
 
 void plan_discard_current_block() {
     if (block_buffer_head != block_buffer_tail) { // Discard non-empty buffer.
-        uint8_t block_index = plan_next_block_index(block_buffer_tail);
+        uint16_t block_index = plan_next_block_index(block_buffer_tail);
         // Push block_buffer_planned pointer, if encountered.
         if (block_buffer_tail == block_buffer_planned)  block_buffer_planned = block_index;
         block_buffer_tail = block_index;
+        planner_task_notify(); // There is room for another queued line.
     }
 }
 
@@ -225,7 +285,7 @@ plan_block_t* plan_get_current_block() {
 
 
 float plan_get_exec_block_exit_speed_sqr() {
-    uint8_t block_index = plan_next_block_index(block_buffer_tail);
+    uint16_t block_index = plan_next_block_index(block_buffer_tail);
     if (block_index == block_buffer_head)  return (0.0);
     return (block_buffer[block_index].entry_speed_sqr);
 }
@@ -252,6 +312,48 @@ float plan_compute_profile_nominal_speed(plan_block_t* block) {
 }
 
 
+// A jerk limited ramp raises the acceleration at the block jerk for tj = acceleration / jerk, holds it
+// and lowers it again for tj, which takes delta_speed / acceleration + tj. Speed changes below
+// acceleration * tj never reach the full acceleration and take 2 * sqrt(delta_speed / jerk).
+float plan_ramp_time(plan_block_t* block, float delta_speed) {
+    if (block->jerk == 0.0)  return (delta_speed / block->acceleration);
+    float full_accel_time = block->acceleration / block->jerk;
+    if (delta_speed < block->acceleration * full_accel_time)  return (2.0 * sqrt(delta_speed / block->jerk));
+    return (delta_speed / block->acceleration + full_accel_time);
+}
+
+
+// Ramps are symmetric, so they cover their time at the mean of the two speeds.
+float plan_ramp_distance(plan_block_t* block, float speed, float other_speed) {
+    return (0.5 * (speed + other_speed) * plan_ramp_time(block, fabs(other_speed - speed)));
+}
+
+
+float plan_reachable_speed_sqr(plan_block_t* block, float speed_sqr, float distance) {
+    if (block->jerk == 0.0)  return (speed_sqr + 2 * block->acceleration * distance);
+    float speed = sqrt(speed_sqr);
+    // Without reaching the full acceleration, distance = jerk * u^3 + 2 * speed * u, where
+    // u = sqrt(delta_speed / jerk). Solved by Newton's method from above, where it converges steadily
+    // as the function is convex and increasing.
+    float u = cbrt(distance / block->jerk);
+    if (speed > 0.0 && distance / (2.0 * speed) < u)  u = distance / (2.0 * speed);
+    for (uint8_t iteration = 0; iteration < 8 && u > 0.0; iteration++) {
+        float excess = (block->jerk * u * u + 2.0 * speed) * u - distance;
+        if (excess <= 0.0)  break;
+        u -= excess / (3.0 * block->jerk * u * u + 2.0 * speed);
+    }
+    float delta_speed = block->jerk * u * u;
+    float full_accel_delta = block->acceleration * block->acceleration / block->jerk;
+    if (delta_speed > full_accel_delta) {
+        // Reaching the full acceleration, (2 * speed + dv) * (dv + full_accel_delta) = 2 * acceleration * distance.
+        float b = 2.0 * speed - full_accel_delta;
+        delta_speed = 0.5 * (sqrt(b * b + 8.0 * block->acceleration * distance) - (2.0 * speed + full_accel_delta));
+    }
+    speed += delta_speed;
+    return (speed * speed);
+}
+
+
 // Computes and updates the max entry speed (sqr) of the block, based on the minimum of the junction's
 // previous and current nominal speeds and max junction speed.
 static void plan_compute_profile_parameters(plan_block_t* block, float nominal_speed, float prev_nominal_speed) {
@@ -264,10 +366,11 @@ static void plan_compute_profile_parameters(plan_block_t* block, float nominal_s
 
 // Re-calculates buffered motions profile parameters upon a motion-based override change.
 void plan_update_velocity_profile_parameters() {
-    uint8_t block_index = block_buffer_tail;
+    uint16_t block_index = block_buffer_tail;
     plan_block_t* block;
     float nominal_speed;
     float prev_nominal_speed = SOME_LARGE_VALUE; // Set high for first block nominal speed calculation.
+    plan_lock();
     while (block_index != block_buffer_head) {
         block = &block_buffer[block_index];
         nominal_speed = plan_compute_profile_nominal_speed(block);
@@ -276,10 +379,12 @@ void plan_update_velocity_profile_parameters() {
         block_index = plan_next_block_index(block_index);
     }
     pl.previous_nominal_speed = prev_nominal_speed; // Update prev nominal speed for next incoming block.
+    plan_unlock();
 }
 
 
 uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
+    plan_lock();
     // Prepare and initialize new block. Copy relevant pl_data for block execution.
     plan_block_t* block = &block_buffer[block_buffer_head];
     memset(block, 0, sizeof(plan_block_t)); // Zero all block values.
@@ -337,13 +442,24 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
         if (delta_mm < 0.0)  block->direction_bits |= get_direction_pin_mask(idx);
     }
     // Bail if this is a zero-length block. Highly unlikely to occur.
-    if (block->step_event_count == 0)  return (PLAN_EMPTY_BLOCK);
+    if (block->step_event_count == 0) {
+        plan_unlock();
+        return (PLAN_EMPTY_BLOCK);
+    }
     // Calculate the unit vector of the line move and the block maximum feed rate and acceleration scaled
     // down such that no individual axes maximum values are exceeded with respect to the line direction.
     // NOTE: This calculation assumes all axes are orthogonal (Cartesian) and works with ABC-axes,
     // if they are also orthogonal/independent. Operates on the absolute value of the unit vector.
     block->millimeters = convert_delta_vector_to_unit_vector(unit_vec);
     block->acceleration = limit_value_by_axis_maximum(settings.acceleration, unit_vec);
+    // Jerk is limited the same way, by the axes that have a jerk setting.
+    block->jerk = 0.0;
+    for (idx = 0; idx < N_AXIS; idx++) {
+        if (unit_vec[idx] != 0.0 && settings.jerk[idx] > 0.0) {
+            float jerk = fabs(settings.jerk[idx] / unit_vec[idx]);
+            if (block->jerk == 0.0 || jerk < block->jerk)  block->jerk = jerk;
+        }
+    }
     block->rapid_rate = limit_value_by_axis_maximum(settings.max_rate, unit_vec);
     // Store programmed rate.
     if (block->condition & PL_COND_FLAG_RAPID_MOTION)  block->programmed_rate = block->rapid_rate;
@@ -370,10 +486,9 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
         //
         // NOTE: If the junction deviation value is finite, Grbl executes the motions in an exact path
         // mode (G61). If the junction deviation value is zero, Grbl will execute the motion in an exact
-        // stop mode (G61.1) manner. In the future, if continuous mode (G64) is desired, the math here
-        // is exactly the same. Instead of motioning all the way to junction point, the machine will
-        // just follow the arc circle defined here. The Arduino doesn't have the CPU cycles to perform
-        // a continuous mode path, but ARM-based microcontrollers most certainly do.
+        // stop mode (G61.1) manner. In continuous mode (G64), mc_line_blend() rounds the corners off
+        // with arcs before the lines get here, so the junctions left are those between the segments
+        // of the arcs, which this limits to the speed of the radius of the arc.
         //
         // NOTE: The max junction speed is a fixed value, since machine acceleration limits cannot be
         // changed dynamically during operation nor can the line move geometry. This must be kept in
@@ -413,9 +528,21 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
         // New block is all set. Update buffer head and next buffer head indices.
         block_buffer_head = next_buffer_head;
         next_buffer_head = plan_next_block_index(block_buffer_head);
+#ifdef PLANNER_RECALCULATE_LIMIT
+        // Keep the blocks older than the newest PLANNER_RECALCULATE_LIMIT blocks at their current plan,
+        // so the time spent planning each new block does not grow with the size of the buffer. Their
+        // entry speeds can only be raised by new blocks, so the plan stays safe, just not optimal.
+        uint16_t unplanned = block_buffer_head - block_buffer_planned;
+        if (block_buffer_head < block_buffer_planned)  unplanned += block_buffer_size;
+        if (unplanned > PLANNER_RECALCULATE_LIMIT) {
+            block_buffer_planned += unplanned - PLANNER_RECALCULATE_LIMIT;
+            if (block_buffer_planned >= block_buffer_size)  block_buffer_planned -= block_buffer_size;
+        }
+#endif
         // Finish up by recalculating the plan with the new block.
         planner_recalculate();
     }
+    plan_unlock();
     return (PLAN_OK);
 }
 
@@ -424,6 +551,7 @@ void plan_sync_position() {
     // TODO: For motor configurations not in the same coordinate frame as the machine position,
     // this function needs to be updated to accomodate the difference.
     uint8_t idx;
+    plan_lock();
     for (idx = 0; idx < N_AXIS; idx++) {
 #ifdef COREXY
         if (idx == X_AXIS)
@@ -436,21 +564,22 @@ void plan_sync_position() {
         pl.position[idx] = sys_position[idx];
 #endif
     }
+    plan_unlock();
 }
 
 
 // Returns the number of available blocks are in the planner buffer.
-uint8_t plan_get_block_buffer_available() {
-    if (block_buffer_head >= block_buffer_tail)  return ((BLOCK_BUFFER_SIZE - 1) - (block_buffer_head - block_buffer_tail));
+uint16_t plan_get_block_buffer_available() {
+    if (block_buffer_head >= block_buffer_tail)  return ((block_buffer_size - 1) - (block_buffer_head - block_buffer_tail));
     return ((block_buffer_tail - block_buffer_head - 1));
 }
 
 
 // Returns the number of active blocks are in the planner buffer.
 // NOTE: Deprecated. Not used unless classic status reports are enabled in config.h
-uint8_t plan_get_block_buffer_count() {
+uint16_t plan_get_block_buffer_count() {
     if (block_buffer_head >= block_buffer_tail)  return (block_buffer_head - block_buffer_tail);
-    return (BLOCK_BUFFER_SIZE - (block_buffer_tail - block_buffer_head));
+    return (block_buffer_size - (block_buffer_tail - block_buffer_head));
 }
 
 
@@ -458,7 +587,9 @@ uint8_t plan_get_block_buffer_count() {
 // Called after a steppers have come to a complete stop for a feed hold and the cycle is stopped.
 void plan_cycle_reinitialize() {
     // Re-plan from a complete stop. Reset planner entry speeds and buffer planned pointer.
+    plan_lock();
     st_update_plan_block_parameters();
     block_buffer_planned = block_buffer_tail;
     planner_recalculate();
+    plan_unlock();
 }
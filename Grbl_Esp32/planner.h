@@ -73,6 +73,7 @@ typedef struct {
     float max_entry_speed_sqr; // Maximum allowable entry speed based on the minimum of junction limit and
     //   neighboring nominal speeds with overrides in (mm/min)^2
     float acceleration;        // Axis-limit adjusted line acceleration in (mm/min^2). Does not change.
+    float jerk;                // Axis-limit adjusted jerk in (mm/min^3), 0 for trapezoidal ramps. Does not change.
     float millimeters;         // The remaining distance for this block to be executed in (mm).
     // NOTE: This value may be altered by stepper algorithm during execution.
 
@@ -99,6 +100,13 @@ typedef struct {
 
 
 
+// Allocate the planner buffer and reset the planner. Called once at startup.
+void plan_init();
+
+// Lock and unlock the planner buffer against the planner task. Only needed with USE_PLANNER_TASK.
+void plan_lock();
+void plan_unlock();
+
 // Initialize and reset the motion plan subsystem
 void plan_reset(); // Reset all
 void plan_reset_buffer(); // Reset buffer only.
@@ -119,7 +127,7 @@ plan_block_t* plan_get_system_motion_block();
 plan_block_t* plan_get_current_block();
 
 // Called periodically by step segment buffer. Mostly used internally by planner.
-uint8_t plan_next_block_index(uint8_t block_index);
+uint16_t plan_next_block_index(uint16_t block_index);
 
 // Called by step segment buffer when computing executing block velocity profile.
 float plan_get_exec_block_exit_speed_sqr();
@@ -127,6 +135,14 @@ float plan_get_exec_block_exit_speed_sqr();
 // Called by main program during planner calculations and step segment buffer during initialization.
 float plan_compute_profile_nominal_speed(plan_block_t* block);
 
+// Time and distance of a ramp of the block between two speeds. With jerk, the acceleration rises from
+// zero and falls back to zero by the end of the ramp. Used by the planner and the step segment buffer.
+float plan_ramp_time(plan_block_t* block, float delta_speed);
+float plan_ramp_distance(plan_block_t* block, float speed, float other_speed);
+
+// Returns the square of the highest speed a ramp of the block reaches from speed_sqr within distance.
+float plan_reachable_speed_sqr(plan_block_t* block, float speed_sqr, float distance);
+
 // Re-calculates buffered motions profile parameters upon a motion-based override change.
 void plan_update_velocity_profile_parameters();
 
@@ -137,11 +153,11 @@ void plan_sync_position();
 void plan_cycle_reinitialize();
 
 // Returns the number of available blocks are in the planner buffer.
-uint8_t plan_get_block_buffer_available();
+uint16_t plan_get_block_buffer_available();
 
 // Returns the number of active blocks are in the planner buffer.
 // NOTE: Deprecated. Not used unless classic status reports are enabled in config.h
-uint8_t plan_get_block_buffer_count();
+uint16_t plan_get_block_buffer_count();
 
 // Returns the status of the block ring buffer. True, if buffer is full.
 uint8_t plan_check_full_buffer();
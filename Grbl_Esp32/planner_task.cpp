@@ -0,0 +1,147 @@
+/*
+  planner_task.cpp - runs the planner in its own task on the other core
+  Part of Grbl_ESP32
+
+  The g-code parser and mc_line() run in the main loop on core 1. Instead of
+  planning every line motion right away, mc_line() puts it into a queue and
+  the planner task on core 0 moves it into the planner buffer. Parsing,
+  planning and segment preparation then overlap on the two cores.
+
+  The queue has a single producer (the main loop) and a single consumer (the
+  planner task), so it is a lock-free RingBuffer. The planner buffer itself is shared
+  between the planner task and st_prep_buffer() and is protected by
+  plan_lock().
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "grbl.h"
+
+#ifdef USE_PLANNER_TASK
+
+typedef struct {
+    float target[N_AXIS];
+    plan_line_data_t pl_data;
+} plan_queued_line_t;
+
+// Written by mc_line() and read by the planner task, or emptied by plan_queue_reset() with the planner locked.
+static RingBuffer<plan_queued_line_t, PLANNER_QUEUE_SIZE> line_queue;
+
+static TaskHandle_t plannerTaskHandle = 0;
+static TaskHandle_t volatile syncTaskHandle = 0; // Waiting in plan_queue_synchronize(), woken by the planner task
+
+// The planner task leaves the queue alone during feed holds, system motions (homing and parking)
+// and resets, the same as the main loop did when it planned every line itself.
+static bool plan_queue_paused() {
+    return (sys.abort || sys.suspend || (sys.state == STATE_HOMING) ||
+            (sys.step_control & (STEP_CONTROL_EXECUTE_HOLD | STEP_CONTROL_EXECUTE_SYS_MOTION)));
+}
+
+static void plannerTask(void* pvParameters) {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY); // Sleep until there is something to plan
+        plan_execute_queue();
+        TaskHandle_t waiting = syncTaskHandle;
+        if (waiting != 0)
+            xTaskNotifyGive(waiting); // Planned as far as it can for now
+    }
+}
+
+#endif
+
+void planner_task_init() {
+#ifdef USE_PLANNER_TASK
+    line_queue.clear();
+    xTaskCreatePinnedToCore(plannerTask,    // task
+                            "plannerTask", // name for task
+                            4096,   // size of task stack
+                            NULL,   // parameters
+                            1, // priority
+                            &plannerTaskHandle,
+                            0 // core
+                           );
+#endif
+}
+
+void planner_task_notify() {
+#ifdef USE_PLANNER_TASK
+    if (plannerTaskHandle != 0 && !line_queue.empty())
+        xTaskNotifyGive(plannerTaskHandle);
+#endif
+}
+
+void plan_queue_line(float* target, plan_line_data_t* pl_data) {
+#ifdef USE_PLANNER_TASK
+    plan_queued_line_t* line = line_queue.reserve(); // mc_line() checked that there is room.
+    memcpy(line->target, target, sizeof(line->target));
+    line->pl_data = *pl_data;
+    line_queue.commit();
+    planner_task_notify();
+#else
+    plan_buffer_line(target, pl_data);
+#endif
+}
+
+uint8_t plan_check_full_queue() {
+#ifdef USE_PLANNER_TASK
+    return (line_queue.full());
+#else
+    return (plan_check_full_buffer());
+#endif
+}
+
+uint16_t plan_get_queue_count() {
+#ifdef USE_PLANNER_TASK
+    return (line_queue.available());
+#else
+    return (0);
+#endif
+}
+
+// Only called where the next step depends on what has been planned, e.g. before a cycle start.
+// Sleeps until the planner task has planned as far as it can, instead of spinning on the other core.
+void plan_queue_synchronize() {
+#ifdef USE_PLANNER_TASK
+    while (!line_queue.empty() && !plan_check_full_buffer() && !plan_queue_paused()) {
+        syncTaskHandle = xTaskGetCurrentTaskHandle();
+        planner_task_notify();
+        ulTaskNotifyTake(pdTRUE, 1); // The tick bounds the wait, should the task have finished just before
+        syncTaskHandle = 0;
+    }
+#endif
+}
+
+void plan_execute_queue() {
+#ifdef USE_PLANNER_TASK
+    while (!line_queue.empty()) {
+        // Take the lock for each line, so that st_prep_buffer() is never held up for long.
+        plan_lock();
+        plan_queued_line_t* line = line_queue.front();
+        if (plan_check_full_buffer() || plan_queue_paused() || line == NULL) {
+            plan_unlock();
+            break;
+        }
+        plan_buffer_line(line->target, &line->pl_data);
+        line_queue.pop();
+        plan_unlock();
+    }
+#endif
+}
+
+// Called with the planner locked, so the planner task is not in the middle of a line.
+void plan_queue_reset() {
+#ifdef USE_PLANNER_TASK
+    line_queue.clear();
+#endif
+}
@@ -0,0 +1,54 @@
+/*
+  planner_task.h - runs the planner in its own task on the other core
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef planner_task_h
+#define planner_task_h
+
+#include "grbl.h"
+
+// The number of parsed line motions that can wait for the planner task. Must be a power of two.
+#ifndef PLANNER_QUEUE_SIZE
+    #define PLANNER_QUEUE_SIZE 32
+#endif
+
+// Starts the planner task. Called once at startup, after plan_init().
+void planner_task_init();
+
+// Wakes the planner task, e.g. when a planner block has been freed.
+void planner_task_notify();
+
+// Queues a line motion for the planner. Called by mc_line().
+void plan_queue_line(float* target, plan_line_data_t* pl_data);
+
+// Returns true if no more line motions can be queued.
+uint8_t plan_check_full_queue();
+
+// Returns the number of queued line motions that are not in the planner buffer yet.
+uint16_t plan_get_queue_count();
+
+// Waits until the queued line motions are in the planner buffer, as far as there is room. Called by
+// the main loop where it must see the planned blocks: cycle start, buffer synchronize and jogging.
+void plan_queue_synchronize();
+
+// Moves queued line motions into the planner buffer while there is room. Run by the planner task.
+void plan_execute_queue();
+
+// Discards all queued line motions. Called by plan_reset().
+void plan_queue_reset();
+
+#endif
@@ -126,6 +126,119 @@ void printFloat_CoordValue(float n) {
         printFloat(n, N_DECIMAL_COORDVALUE_MM);
 }
 
+// Writes the digits of n and returns their number. Divides in 32 bits where it can, which is
+// much cheaper than 64 bit division on the ESP32.
+static uint8_t format_uint64(char* s, uint64_t n) {
+    char buf[20];
+    uint8_t i = 0;
+    while (n > UINT32_MAX) {
+        buf[i++] = '0' + n % 10;
+        n /= 10;
+    }
+    uint32_t low = n;
+    do {
+        buf[i++] = '0' + low % 10;
+        low /= 10;
+    } while (low > 0);
+    for (uint8_t j = 0; j < i; j++)
+        s[j] = buf[i - 1 - j];
+    return i;
+}
+
+static uint8_t bit_length(uint64_t n) {
+    return n ? 64 - __builtin_clzll(n) : 0;
+}
+
+uint8_t format_integer(char* s, int32_t n) {
+    char* p = s;
+    uint32_t magnitude = n;
+    if (n < 0) {
+        *p++ = '-';
+        magnitude = -magnitude;
+    }
+    p += format_uint64(p, magnitude);
+    *p = '\0';
+    return p - s;
+}
+
+// What does not fit into 64 bits is left to snprintf(), cut to FORMAT_DECIMAL_SIZE. Its length
+// is of what it wrote into s, not of what it would have written.
+static uint8_t format_decimal_printf(char* s, double n, uint8_t decimal_places) {
+    int len = snprintf(s, FORMAT_DECIMAL_SIZE, "%.*f", decimal_places, n);
+    if (len < 0) {
+        s[0] = '\0';
+        return 0;
+    }
+    return (len < FORMAT_DECIMAL_SIZE) ? len : FORMAT_DECIMAL_SIZE - 1;
+}
+
+// n is mantissa * 2^exponent exactly, so n * 10^decimal_places is an integer shifted right by
+// -exponent bits, and the bits shifted out tell how to round it. Like printf, a tie is rounded
+// to even; printf always rounds the exact binary value, never a shorter decimal form of it.
+uint8_t format_decimal(char* s, double n, uint8_t decimal_places) {
+    static const uint32_t pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+    uint64_t bits;
+    memcpy(&bits, &n, sizeof(bits));
+    bool negative = bits >> 63;
+    int16_t exponent = (bits >> 52) & 0x7FF;
+    uint64_t mantissa = bits & 0xFFFFFFFFFFFFFULL;
+    if (exponent == 0x7FF || decimal_places > 9)
+        return format_decimal_printf(s, n, decimal_places);
+    if (exponent == 0)
+        exponent = 1; // Subnormal
+    else
+        mantissa |= 1ULL << 52;
+    exponent -= 1075;
+    uint32_t scale = pow10[decimal_places];
+    uint64_t scaled = 0; // n * 10^decimal_places, rounded
+    if (mantissa != 0) {
+        uint8_t zeros = __builtin_ctzll(mantissa);
+        mantissa >>= zeros;
+        exponent += zeros;
+        if (exponent >= 0) {
+            if (bit_length(mantissa) + exponent + bit_length(scale) > 64)
+                return format_decimal_printf(s, n, decimal_places);
+            scaled = (mantissa << exponent) * scale;
+        } else {
+            if (bit_length(mantissa) + bit_length(scale) > 64)
+                return format_decimal_printf(s, n, decimal_places);
+            uint64_t product = mantissa * scale;
+            uint16_t shift = -exponent;
+            if (shift < 64) {
+                scaled = product >> shift;
+                uint64_t rest = product & ((1ULL << shift) - 1);
+                uint64_t half = 1ULL << (shift - 1);
+                if (rest > half || (rest == half && (scaled & 1)))
+                    scaled++;
+            } else if (shift == 64 && product > (1ULL << 63))
+                scaled = 1;
+        }
+    }
+    char* p = s;
+    if (negative)
+        *p++ = '-'; // Also of a value that rounds to 0, as printf does
+    uint64_t integer;
+    uint32_t fraction;
+    if (scaled <= UINT32_MAX) { // Any position or rate, without 64 bit division
+        integer = (uint32_t)scaled / scale;
+        fraction = (uint32_t)scaled % scale;
+    } else {
+        integer = scaled / scale;
+        fraction = scaled % scale;
+    }
+    p += format_uint64(p, integer);
+    if (decimal_places > 0) {
+        *p = '.';
+        for (uint8_t i = decimal_places; i > 0; i--) {
+            p[i] = '0' + fraction % 10;
+            fraction /= 10;
+        }
+        p += decimal_places + 1;
+    }
+    *p = '\0';
+    return p - s;
+}
+
 // Debug tool to print free memory in bytes at the called point.
 // NOTE: Keep commented unless using. Part of this function always gets compiled in.
 // void printFreeMemory()
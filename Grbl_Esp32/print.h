@@ -48,6 +48,19 @@ void printFloat(float n, uint8_t decimal_places);
 void printFloat_CoordValue(float n);
 void printFloat_RateValue(float n);
 
+// Longest string format_decimal() writes, with the terminating NUL
+#define FORMAT_DECIMAL_SIZE 32
+
+// Writes n with decimal_places (at most 9) digits after the point into s, the same characters
+// sprintf(s, "%.*f", decimal_places, n) writes, and returns their number. The value is rounded
+// with integer math on the bits of the double, which is several times faster than printf. Values
+// that do not fit into 64 bits, inf and nan are left to snprintf(). s must hold FORMAT_DECIMAL_SIZE;
+// longer results are cut to FORMAT_DECIMAL_SIZE - 1 characters, which is then what is returned.
+uint8_t format_decimal(char* s, double n, uint8_t decimal_places);
+
+// Writes n like sprintf(s, "%d", n) and returns the number of characters, at most 11
+uint8_t format_integer(char* s, int32_t n);
+
 // Debug tool to print free memory in bytes at the called point. Not used otherwise.
 void printFreeMemory();
 
@@ -27,15 +27,8 @@
 #include "commands.h"
 #include "espresponse.h"
 
-// Define line flags. Includes comment type tracking and line overflow detection.
-#define LINE_FLAG_OVERFLOW bit(0)
-#define LINE_FLAG_COMMENT_PARENTHESES bit(1)
-#define LINE_FLAG_COMMENT_SEMICOLON bit(2)
-#define LINE_FLAG_BRACKET bit(3) // square bracket for WebUI commands
-
-
 static char line[LINE_BUFFER_SIZE]; // Line to be executed. Zero-terminated.
-static char comment[LINE_BUFFER_SIZE]; // Line to be executed. Zero-terminated.
+static line_tokenizer_t tokenizer;
 
 static void protocol_exec_rt_suspend();
 
@@ -74,17 +67,26 @@ void protocol_main_loop() {
     // Primary loop! Upon a system abort, this exits back to main() to reset the system.
     // This is also where Grbl idles while waiting for something to do.
     // ---------------------------------------------------------------------------------
-    uint8_t line_flags = 0;
-    uint8_t char_counter = 0;
-    uint8_t comment_char_counter = 0;
-    uint8_t c;
+    line_tokenizer_init(&tokenizer, line, LINE_BUFFER_SIZE);
     for (;;) {
 #ifdef ENABLE_SD_CARD
-        if (SD_ready_next) {
-            char fileLine[255];
-            if (readFileLine(fileLine)) {
+        // Run SD lines for as long as the planner takes them, up to as many as it had free blocks,
+        // so that an SD job streams at the speed of the planner rather than one line per pass
+        // through this loop. No more than SD_BATCH_LINES run between the realtime checks below, as
+        // a deep planner buffer has room for hundreds of lines.
+        uint16_t sd_lines = plan_get_block_buffer_available();
+        if (sd_lines > SD_BATCH_LINES)
+            sd_lines = SD_BATCH_LINES;
+        while (SD_ready_next && (sd_lines > 0) && !plan_check_full_queue()) {
+            char fileLine[SD_LINE_BUFFER_SIZE];
+            job_record_t record;
+            sd_lines--;
+            if (sd_job_is_compiled() ? readJobRecord(&record) : readFileLine(fileLine)) {
                 SD_ready_next = false;
-                report_status_message(gc_execute_line(fileLine, SD_client), SD_client);
+                if (sd_job_is_compiled())
+                    report_status_message(job_play_record(&record, SD_client), SD_client);
+                else
+                    report_status_message(gc_execute_line(fileLine, SD_client), SD_client);
             } else {
                 char temp[50];
                 sd_get_current_filename(temp);
@@ -92,109 +94,66 @@ void protocol_main_loop() {
                 closeFile(); // close file and clear SD ready/running flags
             }
         }
+        sd_compile_poll(); // [ESP230]
 #endif
         // Process one line of incoming serial data, as the data becomes available. Performs an
-        // initial filtering by removing spaces and comments and capitalizing all letters.
+        // initial filtering by removing spaces and comments and capitalizing all letters. The
+        // data is taken straight out of the client buffer, a contiguous span at a time.
         uint8_t client = CLIENT_SERIAL;
         for (client = 0; client < CLIENT_COUNT; client++) {
-            while ((c = serial_read(client)) != SERIAL_NO_DATA) {
-                if ((c == '\n') || (c == '\r')) { // End of line reached
-                    protocol_execute_realtime(); // Runtime command check point.
-                    if (sys.abort)  return;   // Bail to calling function upon system abort
-                    line[char_counter] = 0; // Set string termination character.
+            const uint8_t* data;
+            uint32_t len;
+            // A new line is only read while its response fits into the output queue of the client,
+            // so a client that reads its output slowly is held back, not the others.
+            if (!output_queue_ready(client))
+                continue;
+            while ((data = serial_read_span(client, &len)) != NULL) {
+                bool complete;
+                serial_consume(client, line_tokenizer_feed(&tokenizer, data, len, &complete));
+                if (!complete)
+                    continue;
+                // End of line reached
+                protocol_execute_realtime(); // Runtime command check point.
+                if (sys.abort)  return;   // Bail to calling function upon system abort
 #ifdef REPORT_ECHO_LINE_RECEIVED
-                    report_echo_line_received(line, client);
+                report_echo_line_received(line, client);
 #endif
-                    // Direct and execute one line of formatted input, and report status of execution.
-                    if (line_flags & LINE_FLAG_OVERFLOW) {
-                        // Report line overflow error.
-                        report_status_message(STATUS_OVERFLOW, client);
-                    } else if (line[0] == 0) {
-                        // Empty or comment line. For syncing purposes.
-                        report_status_message(STATUS_OK, client);
-                    } else if (line[0] == '$') {
-                        // Grbl '$' system command
-                        report_status_message(system_execute_line(line, client), client);
-                    } else if (line[0] == '[') {
-                        int cmd = 0;
-                        String cmd_params;
-                        if (COMMANDS::check_command(line, &cmd, cmd_params)) {
-                            ESPResponseStream espresponse(client, true);
-                            if (!COMMANDS::execute_internal_command(cmd, cmd_params, LEVEL_GUEST, &espresponse))
-                                report_status_message(STATUS_GCODE_UNSUPPORTED_COMMAND, CLIENT_ALL);
-                        } else grbl_msg_sendf(CLIENT_SERIAL, MSG_LEVEL_INFO, "Unknow Command...%s", line);
-                    } else if (sys.state & (STATE_ALARM | STATE_JOG)) {
-                        // Everything else is gcode. Block if in alarm or jog mode.
-                        report_status_message(STATUS_SYSTEM_GC_LOCK, client);
-                    } else {
-                        // Parse and execute g-code block
-                        report_status_message(gc_execute_line(line, client), client);
-                    }
-                    // Reset tracking data for next line.
-                    line_flags = 0;
-                    char_counter = 0;
-                    comment_char_counter = 0;
+                // Direct and execute one line of formatted input, and report status of execution.
+                if (tokenizer.flags & LINE_FLAG_OVERFLOW) {
+                    // Report line overflow error.
+                    report_status_message(STATUS_OVERFLOW, client);
+                } else if (line[0] == 0) {
+                    // Empty or comment line. For syncing purposes.
+                    report_status_message(STATUS_OK, client);
+                } else if (line[0] == '$') {
+                    // Grbl '$' system command
+                    report_status_message(system_execute_line(line, client), client);
+                } else if (line[0] == '[') {
+                    int cmd = 0;
+                    String cmd_params;
+                    if (COMMANDS::check_command(line, &cmd, cmd_params)) {
+                        ESPResponseStream espresponse(client, true);
+                        if (!COMMANDS::execute_internal_command(cmd, cmd_params, LEVEL_GUEST, &espresponse))
+                            report_status_message(STATUS_GCODE_UNSUPPORTED_COMMAND, CLIENT_ALL);
+                    } else grbl_msg_sendf(CLIENT_SERIAL, MSG_LEVEL_INFO, "Unknow Command...%s", line);
+                } else if (sys.state & (STATE_ALARM | STATE_JOG)) {
+                    // Everything else is gcode. Block if in alarm or jog mode.
+                    report_status_message(STATUS_SYSTEM_GC_LOCK, client);
                 } else {
-                    if (line_flags) {
-                        if (line_flags & LINE_FLAG_BRACKET)    // in bracket mode all characters are accepted
-                            line[char_counter++] = c;
-                        // Throw away all (except EOL) comment characters and overflow characters.
-                        if (c == ')') {
-                            // End of '()' comment. Resume line allowed.
-                            if (line_flags & LINE_FLAG_COMMENT_PARENTHESES) {
-                                line_flags &= ~(LINE_FLAG_COMMENT_PARENTHESES);
-                                comment[comment_char_counter] = 0; // null terminate
-                                report_gcode_comment(comment);
-                            }
-                        }
-                        if (line_flags & LINE_FLAG_COMMENT_PARENTHESES)    // capture all characters into a comment buffer
-                            comment[comment_char_counter++] = c;
-                    } else {
-                        if (c <= ' ') {
-                            // Throw away whitepace and control characters
-                        }
-                        /*
-                        else if (c == '/') {
-                        	// Block delete NOT SUPPORTED. Ignore character.
-                        	// NOTE: If supported, would simply need to check the system if block delete is enabled.
-                        }
-                        */
-                        else if (c == '(') {
-                            // Enable comments flag and ignore all characters until ')' or EOL.
-                            // NOTE: This doesn't follow the NIST definition exactly, but is good enough for now.
-                            // In the future, we could simply remove the items within the comments, but retain the
-                            // comment control characters, so that the g-code parser can error-check it.
-                            line_flags |= LINE_FLAG_COMMENT_PARENTHESES;
-                            comment_char_counter = 0;
-                        } else if (c == ';') {
-                            // NOTE: ';' comment to EOL is a LinuxCNC definition. Not NIST.
-                            line_flags |= LINE_FLAG_COMMENT_SEMICOLON;
-                        } else if (c == '[') {
-                            // For ESP3D bracket commands like [ESP100]<SSID>pwd=<admin password>
-                            // prevents spaces being striped and converting to uppercase
-                            line_flags |= LINE_FLAG_BRACKET;
-                            line[char_counter++] = c; // capture this character
-                            // TODO: Install '%' feature
-                        } else if (c == '%') {
-                            // Program start-end percent sign NOT SUPPORTED.
-                            // NOTE: This maybe installed to tell Grbl when a program is running vs manual input,
-                            // where, during a program, the system auto-cycle start will continue to execute
-                            // everything until the next '%' sign. This will help fix resuming issues with certain
-                            // functions that empty the planner buffer to execute its task on-time.
-                        } else if (char_counter >= (LINE_BUFFER_SIZE - 1)) {
-                            // Detect line buffer overflow and set flag.
-                            line_flags |= LINE_FLAG_OVERFLOW;
-                        } else if (c >= 'a' && c <= 'z')   // Upcase lowercase
-                            line[char_counter++] = c - 'a' + 'A';
-                        else
-                            line[char_counter++] = c;
-                    }
+                    // Parse and execute g-code block
+                    report_status_message(gc_execute_line(line, client), client);
                 }
+                // Reset tracking data for next line.
+                line_tokenizer_reset(&tokenizer);
+                if (!output_queue_ready(client))
+                    break;
             } // while serial read
         } // for clients
         // If there are no more characters in the serial read buffer to be processed and executed,
         // this indicates that g-code streaming has either filled the planner buffer or has
-        // completed. In either case, auto-cycle start, if enabled, any queued moves.
+        // completed. In either case, auto-cycle start, if enabled, any queued moves. A line held
+        // back by G64 is sent on, if the planner runs out of motion before the next one arrives.
+        mc_blend_poll();
         protocol_auto_cycle_start();
         protocol_execute_realtime();  // Runtime command check point.
         if (sys.abort)  return;   // Bail to main() program loop to reset system.
@@ -211,12 +170,19 @@ void protocol_main_loop() {
 // Block until all buffered steps are executed or in a cycle state. Works with feed hold
 // during a synchronize call, if it should happen. Also, waits for clean cycle end.
 void protocol_buffer_synchronize() {
+    mc_blend_flush(); // The line held back by G64 is part of the buffered motion.
+    plan_queue_synchronize(); // So are the lines the planner task has not planned yet.
     // If system is queued, ensure cycle resumes if the auto start flag is present.
     protocol_auto_cycle_start();
     do {
         protocol_execute_realtime();   // Check and execute run-time commands
         if (sys.abort)  return;   // Check for system abort
-    } while (plan_get_current_block() || (sys.state == STATE_CYCLE));
+        // Restart, if the steppers ran out of blocks before the planner task caught up.
+        if (plan_get_queue_count()) {
+            plan_queue_synchronize();
+            protocol_auto_cycle_start();
+        }
+    } while (plan_get_queue_count() || plan_get_current_block() || (sys.state == STATE_CYCLE));
 }
 
 
@@ -379,6 +345,7 @@ void protocol_exec_rt_system() {
                     } else {
                         // Start cycle only if queued motions exist in planner buffer and the motion is not canceled.
                         sys.step_control = STEP_CONTROL_NORMAL_OP; // Restore step control to normal operation
+                        plan_queue_synchronize();
                         if (plan_get_current_block() && bit_isfalse(sys.suspend, SUSPEND_MOTION_CANCEL)) {
                             sys.suspend = SUSPEND_DISABLE; // Break suspend state.
                             sys.state = STATE_CYCLE;
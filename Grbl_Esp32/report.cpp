@@ -49,72 +49,108 @@
 #include "grbl.h"
 
 #define DEFAULTBUFFERSIZE 64
+#define REPORT_NOTIFY_SIZE 128
+#define REPORT_STATUS_SIZE 200
 
 // this is a generic send function that everything should use, so interfaces could be added (Bluetooth, etc)
 void grbl_send(uint8_t client, const char* text) {
+    grbl_send_bytes(client, (const uint8_t*)text, strlen(text));
+}
+
+// Sends data that is not a C string. It is queued for the client (see output_queue.h), so a slow
+// client does not hold up the sender.
+void grbl_send_bytes(uint8_t client, const uint8_t* data, size_t len) {
     if (client == CLIENT_INPUT) return;
-#ifdef ENABLE_BLUETOOTH
-    if (SerialBT.hasClient() && (client == CLIENT_BT || client == CLIENT_ALL)) {
-        SerialBT.print(text);
-        //delay(10); // possible fix for dropped characters
+    output_queue_write(client, data, len);
+}
+
+// Sends the ok or error: that ends the response to a line. It may take the room the output queue
+// of the client keeps for it, so it is never dropped.
+static void report_response(uint8_t client, uint8_t status_code) {
+    char response[16];
+    if (status_code == STATUS_OK)
+        strcpy(response, "ok\r\n");
+    else
+        sprintf(response, "error:%d\r\n", status_code);
+    output_queue_response(client, (const uint8_t*)response, strlen(response));
+}
+
+// Messages are formatted in one pass into a buffer of the client they go to, with CLIENT_ALL in
+// the one of CLIENT_INPUT, which is never sent to. Nothing is allocated, so long listings and
+// bursts of messages during a job do not fragment the heap. A message that does not fit is cut
+// off, keeping its line end. Each buffer is locked while it is in use, as any task may send.
+static char tx_arena[CLIENT_COUNT][REPORT_TX_ARENA_SIZE];
+static SemaphoreHandle_t tx_arena_mutex[CLIENT_COUNT];
+
+void report_init() {
+    for (uint8_t idx = 0; idx < CLIENT_COUNT; idx++) {
+        if (tx_arena_mutex[idx] == NULL)
+            tx_arena_mutex[idx] = xSemaphoreCreateMutex();
     }
-#endif
-#if defined (ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_OUT)
-    if (client == CLIENT_WEBUI || client == CLIENT_ALL)
-        Serial2Socket.write((const uint8_t*)text, strlen(text));
-#endif
-#if defined (ENABLE_WIFI) && defined(ENABLE_TELNET)
-    if (client == CLIENT_TELNET || client == CLIENT_ALL)
-        telnet_server.write((const uint8_t*)text, strlen(text));
-#endif
-    if (client == CLIENT_SERIAL || client == CLIENT_ALL)
-        Serial.print(text);
+}
+
+// Returns the buffer for a client, locked, or NULL when nothing is sent to it
+static char* report_tx_arena_take(uint8_t client) {
+    if (client == CLIENT_ALL)
+        client = CLIENT_INPUT;
+    else if (client >= CLIENT_COUNT || client == CLIENT_INPUT)
+        return NULL;
+    if (tx_arena_mutex[client] != NULL) // Not before report_init(), while setup() is alone
+        xSemaphoreTake(tx_arena_mutex[client], portMAX_DELAY);
+    return tx_arena[client];
+}
+
+static void report_tx_arena_give(uint8_t client) {
+    if (client == CLIENT_ALL)
+        client = CLIENT_INPUT;
+    if (tx_arena_mutex[client] != NULL)
+        xSemaphoreGive(tx_arena_mutex[client]);
+}
+
+// Formats into the space of the buffer from at and returns the length of the message up to there.
+// A message that was cut off ends with the line end of the format, if it has one.
+static size_t report_tx_arena_vformat(char* arena, size_t at, size_t space, const char* format, va_list arg) {
+    int len = vsnprintf(arena + at, space, format, arg);
+    if (len < 0)
+        return at;
+    if ((size_t)len < space)
+        return at + len;
+    len = space - 1;
+    size_t format_len = strlen(format);
+    if (format_len >= 2 && format[format_len - 1] == '\n' && format[format_len - 2] == '\r' && len >= 2)
+        memcpy(arena + at + len - 2, "\r\n", 2);
+    return at + len;
 }
 
 // This is a formating version of the grbl_send(CLIENT_ALL,...) function that work like printf
 void grbl_sendf(uint8_t client, const char* format, ...) {
-    if (client == CLIENT_INPUT) return;
-    char loc_buf[64];
-    char* temp = loc_buf;
+    char* arena = report_tx_arena_take(client);
+    if (arena == NULL)
+        return;
     va_list arg;
-    va_list copy;
     va_start(arg, format);
-    va_copy(copy, arg);
-    size_t len = vsnprintf(NULL, 0, format, arg);
-    va_end(copy);
-    if (len >= sizeof(loc_buf)) {
-        temp = new char[len + 1];
-        if (temp == NULL)
-            return;
-    }
-    len = vsnprintf(temp, len + 1, format, arg);
-    grbl_send(client, temp);
+    size_t len = report_tx_arena_vformat(arena, 0, REPORT_TX_ARENA_SIZE, format, arg);
     va_end(arg);
-    if (len > 64)
-        delete[] temp;
+    grbl_send_bytes(client, (const uint8_t*)arena, len);
+    report_tx_arena_give(client);
 }
 // Use to send [MSG:xxxx] Type messages. The level allows messages to be easily suppressed
 void grbl_msg_sendf(uint8_t client, uint8_t level, const char* format, ...) {
-    if (client == CLIENT_INPUT) return;
     if (level > GRBL_MSG_LEVEL) return;
-    char loc_buf[100];
-    char* temp = loc_buf;
+    char* arena = report_tx_arena_take(client);
+    if (arena == NULL)
+        return;
+    static const char prefix[] = "[MSG:";
+    static const char suffix[] = "]\r\n";
+    memcpy(arena, prefix, sizeof(prefix) - 1);
     va_list arg;
-    va_list copy;
     va_start(arg, format);
-    va_copy(copy, arg);
-    size_t len = vsnprintf(NULL, 0, format, arg);
-    va_end(copy);
-    if (len >= sizeof(loc_buf)) {
-        temp = new char[len + 1];
-        if (temp == NULL)
-            return;
-    }
-    len = vsnprintf(temp, len + 1, format, arg);
-    grbl_sendf(client, "[MSG:%s]\r\n", temp);
+    size_t len = report_tx_arena_vformat(arena, sizeof(prefix) - 1,
+                                         REPORT_TX_ARENA_SIZE - (sizeof(prefix) - 1) - (sizeof(suffix) - 1), format, arg);
     va_end(arg);
-    if (len > 100)
-        delete[] temp;
+    memcpy(arena + len, suffix, sizeof(suffix) - 1);
+    grbl_send_bytes(client, (const uint8_t*)arena, len + sizeof(suffix) - 1);
+    report_tx_arena_give(client);
 }
 
 //function to notify
@@ -125,43 +161,49 @@ void grbl_notify(const char* title, const char* msg) {
 }
 
 void grbl_notifyf(const char* title, const char* format, ...) {
-    char loc_buf[64];
-    char* temp = loc_buf;
+    char msg[REPORT_NOTIFY_SIZE];
     va_list arg;
-    va_list copy;
     va_start(arg, format);
-    va_copy(copy, arg);
-    size_t len = vsnprintf(NULL, 0, format, arg);
-    va_end(copy);
-    if (len >= sizeof(loc_buf)) {
-        temp = new char[len + 1];
-        if (temp == NULL)
-            return;
-    }
-    len = vsnprintf(temp, len + 1, format, arg);
-    grbl_notify(title, temp);
+    vsnprintf(msg, sizeof(msg), format, arg);
     va_end(arg);
-    if (len > 64)
-        delete[] temp;
+    grbl_notify(title, msg);
 }
 
 // formats axis values into a string and returns that string in rpt
 static void report_util_axis_values(float* axis_value, char* rpt) {
     uint8_t idx;
-    char axisVal[10];
     float unit_conv = 1.0; // unit conversion multiplier..default is mm
-    rpt[0] = '\0';
-    if (bit_istrue(settings.flags, BITFLAG_REPORT_INCHES))
+    uint8_t decimal_places = 3; // Report mm to 3 decimals
+    if (bit_istrue(settings.flags, BITFLAG_REPORT_INCHES)) {
         unit_conv = 1.0 / MM_PER_INCH;
+        decimal_places = 4; // Report inches to 4 decimals
+    }
     for (idx = 0; idx < N_AXIS; idx++) {
-        if (bit_istrue(settings.flags, BITFLAG_REPORT_INCHES))
-            sprintf(axisVal, "%4.4f", axis_value[idx] * unit_conv);  // Report inches to 4 decimals
-        else
-            sprintf(axisVal, "%4.3f", axis_value[idx] * unit_conv);  // Report mm to 3 decimals
-        strcat(rpt, axisVal);
+        rpt += format_decimal(rpt, axis_value[idx] * unit_conv, decimal_places);
         if (idx < (N_AXIS - 1))
-            strcat(rpt, ",");
+            *rpt++ = ',';
     }
+    *rpt = '\0';
+}
+
+// Appends "$<number>=<value>\r\n" of a setting to a report and returns the new end of it
+static char* report_util_setting_int(char* rpt, uint16_t number, int32_t value) {
+    *rpt++ = '$';
+    rpt += format_integer(rpt, number);
+    *rpt++ = '=';
+    rpt += format_integer(rpt, value);
+    strcpy(rpt, "\r\n");
+    return rpt + 2;
+}
+
+// Appends a float setting, with 3 decimals
+static char* report_util_setting_float(char* rpt, uint16_t number, float value) {
+    *rpt++ = '$';
+    rpt += format_integer(rpt, number);
+    *rpt++ = '=';
+    rpt += format_decimal(rpt, value, 3);
+    strcpy(rpt, "\r\n");
+    return rpt + 2;
 }
 
 void get_state(char* foo) {
@@ -193,9 +235,9 @@ void report_status_message(uint8_t status_code, uint8_t client) {
         if (get_sd_state(false) == SDCARD_BUSY_PRINTING)
             SD_ready_next = true; // flag so system_execute_line() will send the next line
         else
-            grbl_send(client, "ok\r\n");
+            report_response(client, STATUS_OK);
 #else
-        grbl_send(client, "ok\r\n");
+        report_response(client, STATUS_OK);
 #endif
         break;
     default:
@@ -203,7 +245,7 @@ void report_status_message(uint8_t status_code, uint8_t client) {
         // do we need to stop a running SD job?
         if (get_sd_state(false) == SDCARD_BUSY_PRINTING) {
             if (status_code == STATUS_GCODE_UNSUPPORTED_COMMAND) {
-                grbl_sendf(client, "error:%d\r\n", status_code); // most senders seem to tolerate this error and keep on going
+                report_response(client, status_code); // most senders seem to tolerate this error and keep on going
                 grbl_sendf(CLIENT_ALL, "error:%d in SD file at line %d\r\n", status_code, sd_get_current_line_number());
                 // don't close file
             } else {
@@ -214,7 +256,7 @@ void report_status_message(uint8_t status_code, uint8_t client) {
             return;
         }
 #endif
-        grbl_sendf(client, "error:%d\r\n", status_code);
+        report_response(client, status_code);
     }
 }
 
@@ -272,7 +314,7 @@ void report_init_message(uint8_t client) {
 
 // Grbl help message
 void report_grbl_help(uint8_t client) {
-    grbl_send(client, "[HLP:$$ $+ $# $G $I $N $x=val $Nx=line $J=line $SLP $C $X $H $F ~ ! ? ctrl-x]\r\n");
+    grbl_send(client, "[HLP:$$ $+ $# $G $I $N $x=val $Nx=line $J=line $SLP $C $X $H $F $RI=ms $RB=ms ~ ! ? ctrl-x]\r\n");
 }
 
 
@@ -281,46 +323,45 @@ void report_grbl_help(uint8_t client) {
 // Extended setting will be displayed if force_extended is true or #ifdef SHOW_EXTENDED_SETTINGS
 void report_grbl_settings(uint8_t client, uint8_t show_extended) {
     // Print Grbl settings.
-    char setting[20];
     char rpt[1000];
+    char* p = rpt;
 #ifdef SHOW_EXTENDED_SETTINGS
     show_extended = true;
 #endif
-    rpt[0] = '\0';
-    sprintf(setting, "$0=%d\r\n", settings.pulse_microseconds); strcat(rpt, setting);
-    sprintf(setting, "$1=%d\r\n", settings.stepper_idle_lock_time);  strcat(rpt, setting);
-    sprintf(setting, "$2=%d\r\n", settings.step_invert_mask);  strcat(rpt, setting);
-    sprintf(setting, "$3=%d\r\n", settings.dir_invert_mask);  strcat(rpt, setting);
-    sprintf(setting, "$4=%d\r\n", bit_istrue(settings.flags, BITFLAG_INVERT_ST_ENABLE));  strcat(rpt, setting);
-    sprintf(setting, "$5=%d\r\n", bit_istrue(settings.flags, BITFLAG_INVERT_LIMIT_PINS));  strcat(rpt, setting);
-    sprintf(setting, "$6=%d\r\n", bit_istrue(settings.flags, BITFLAG_INVERT_PROBE_PIN));  strcat(rpt, setting);
-    sprintf(setting, "$10=%d\r\n", settings.status_report_mask);  strcat(rpt, setting);
-    sprintf(setting, "$11=%4.3f\r\n", settings.junction_deviation);   strcat(rpt, setting);
-    sprintf(setting, "$12=%4.3f\r\n", settings.arc_tolerance);   strcat(rpt, setting);
-    sprintf(setting, "$13=%d\r\n", bit_istrue(settings.flags, BITFLAG_REPORT_INCHES));   strcat(rpt, setting);
-    sprintf(setting, "$20=%d\r\n", bit_istrue(settings.flags, BITFLAG_SOFT_LIMIT_ENABLE));   strcat(rpt, setting);
-    sprintf(setting, "$21=%d\r\n", bit_istrue(settings.flags, BITFLAG_HARD_LIMIT_ENABLE));   strcat(rpt, setting);
-    sprintf(setting, "$22=%d\r\n", bit_istrue(settings.flags, BITFLAG_HOMING_ENABLE));   strcat(rpt, setting);
-    sprintf(setting, "$23=%d\r\n", settings.homing_dir_mask);   strcat(rpt, setting);
-    sprintf(setting, "$24=%4.3f\r\n", settings.homing_feed_rate);   strcat(rpt, setting);
-    sprintf(setting, "$25=%4.3f\r\n", settings.homing_seek_rate);   strcat(rpt, setting);
-    sprintf(setting, "$26=%d\r\n", settings.homing_debounce_delay);   strcat(rpt, setting);
-    sprintf(setting, "$27=%4.3f\r\n", settings.homing_pulloff);   strcat(rpt, setting);
-    sprintf(setting, "$30=%4.3f\r\n", settings.rpm_max);   strcat(rpt, setting);
-    sprintf(setting, "$31=%4.3f\r\n", settings.rpm_min);   strcat(rpt, setting);
-    sprintf(setting, "$32=%d\r\n", bit_istrue(settings.flags, BITFLAG_LASER_MODE));  strcat(rpt, setting);
+    p = report_util_setting_int(p, 0, settings.pulse_microseconds);
+    p = report_util_setting_int(p, 1, settings.stepper_idle_lock_time);
+    p = report_util_setting_int(p, 2, settings.step_invert_mask);
+    p = report_util_setting_int(p, 3, settings.dir_invert_mask);
+    p = report_util_setting_int(p, 4, bit_istrue(settings.flags, BITFLAG_INVERT_ST_ENABLE));
+    p = report_util_setting_int(p, 5, bit_istrue(settings.flags, BITFLAG_INVERT_LIMIT_PINS));
+    p = report_util_setting_int(p, 6, bit_istrue(settings.flags, BITFLAG_INVERT_PROBE_PIN));
+    p = report_util_setting_int(p, 10, settings.status_report_mask);
+    p = report_util_setting_float(p, 11, settings.junction_deviation);
+    p = report_util_setting_float(p, 12, settings.arc_tolerance);
+    p = report_util_setting_int(p, 13, bit_istrue(settings.flags, BITFLAG_REPORT_INCHES));
+    p = report_util_setting_int(p, 20, bit_istrue(settings.flags, BITFLAG_SOFT_LIMIT_ENABLE));
+    p = report_util_setting_int(p, 21, bit_istrue(settings.flags, BITFLAG_HARD_LIMIT_ENABLE));
+    p = report_util_setting_int(p, 22, bit_istrue(settings.flags, BITFLAG_HOMING_ENABLE));
+    p = report_util_setting_int(p, 23, settings.homing_dir_mask);
+    p = report_util_setting_float(p, 24, settings.homing_feed_rate);
+    p = report_util_setting_float(p, 25, settings.homing_seek_rate);
+    p = report_util_setting_int(p, 26, settings.homing_debounce_delay);
+    p = report_util_setting_float(p, 27, settings.homing_pulloff);
+    p = report_util_setting_float(p, 30, settings.rpm_max);
+    p = report_util_setting_float(p, 31, settings.rpm_min);
+    p = report_util_setting_int(p, 32, bit_istrue(settings.flags, BITFLAG_LASER_MODE));
 
     if (show_extended) {
-        sprintf(setting, "$33=%5.3f\r\n", settings.spindle_pwm_freq);   strcat(rpt, setting);
-        sprintf(setting, "$34=%3.3f\r\n", settings.spindle_pwm_off_value);   strcat(rpt, setting);
-        sprintf(setting, "$35=%3.3f\r\n", settings.spindle_pwm_min_value);   strcat(rpt, setting);
-        sprintf(setting, "$36=%3.3f\r\n", settings.spindle_pwm_max_value);   strcat(rpt, setting);
-        for (uint8_t index = 0; index < USER_SETTING_COUNT; index++) {
-            sprintf(setting, "$%d=%d\r\n", 80 + index, settings.machine_int16[index]);   strcat(rpt, setting);
-        }
-        for (uint8_t index = 0; index < USER_SETTING_COUNT; index++) {
-            sprintf(setting, "$%d=%5.3f\r\n", 90 + index, settings.machine_float[index]);   strcat(rpt, setting);
-        }
+        p = report_util_setting_float(p, 33, settings.spindle_pwm_freq);
+        p = report_util_setting_float(p, 34, settings.spindle_pwm_off_value);
+        p = report_util_setting_float(p, 35, settings.spindle_pwm_min_value);
+        p = report_util_setting_float(p, 36, settings.spindle_pwm_max_value);
+        p = report_util_setting_int(p, 37, settings.segment_buffer_time);
+        p = report_util_setting_int(p, 38, settings.input_shaper);
+        for (uint8_t index = 0; index < USER_SETTING_COUNT; index++)
+            p = report_util_setting_int(p, 80 + index, settings.machine_int16[index]);
+        for (uint8_t index = 0; index < USER_SETTING_COUNT; index++)
+            p = report_util_setting_float(p, 90 + index, settings.machine_float[index]);
     }
     // Print axis settings
     uint8_t idx, set_idx;
@@ -328,19 +369,25 @@ void report_grbl_settings(uint8_t client, uint8_t show_extended) {
     for (set_idx = 0; set_idx < AXIS_N_SETTINGS; set_idx++) {
         for (idx = 0; idx < N_AXIS; idx++) {
             switch (set_idx) {
-            case 0: sprintf(setting, "$%d=%4.3f\r\n", val + idx, settings.steps_per_mm[idx]);   strcat(rpt, setting);	 break;
-            case 1: sprintf(setting, "$%d=%4.3f\r\n", val + idx, settings.max_rate[idx]);   strcat(rpt, setting);	 break;
-            case 2: sprintf(setting, "$%d=%4.3f\r\n", val + idx, settings.acceleration[idx] / (60 * 60));   strcat(rpt, setting);	 break;
-            case 3: sprintf(setting, "$%d=%4.3f\r\n", val + idx, -settings.max_travel[idx]);   strcat(rpt, setting);	 break;
-            case 4: if (show_extended) {sprintf(setting, "$%d=%4.3f\r\n", val + idx, settings.current[idx]);   strcat(rpt, setting);}	 break;
-            case 5: if (show_extended) {sprintf(setting, "$%d=%4.3f\r\n", val + idx, settings.hold_current[idx]);   strcat(rpt, setting);}	 break;
-            case 6: if (show_extended) {sprintf(setting, "$%d=%d\r\n", val + idx, settings.microsteps[idx]);   strcat(rpt, setting);}	 break;
-            case 7: if (show_extended) {sprintf(setting, "$%d=%d\r\n", val + idx, settings.stallguard[idx]);   strcat(rpt, setting);}	 break;
+            case 0: p = report_util_setting_float(p, val + idx, settings.steps_per_mm[idx]); break;
+            case 1: p = report_util_setting_float(p, val + idx, settings.max_rate[idx]); break;
+            case 2: p = report_util_setting_float(p, val + idx, settings.acceleration[idx] / (60 * 60)); break;
+            case 3: p = report_util_setting_float(p, val + idx, -settings.max_travel[idx]); break;
+            case 4: if (show_extended)  p = report_util_setting_float(p, val + idx, settings.current[idx]); break;
+            case 5: if (show_extended)  p = report_util_setting_float(p, val + idx, settings.hold_current[idx]); break;
+            case 6: if (show_extended)  p = report_util_setting_int(p, val + idx, settings.microsteps[idx]); break;
+            case 7: if (show_extended)  p = report_util_setting_int(p, val + idx, settings.stallguard[idx]); break;
+            case 8: if (show_extended)  p = report_util_setting_float(p, val + idx, settings.jerk[idx] / (60 * 60 * 60)); break;
+            case 9: if (show_extended)  p = report_util_setting_float(p, val + idx, settings.shaper_frequency[idx]); break;
+            case 10: if (show_extended)  p = report_util_setting_float(p, val + idx, settings.shaper_damping[idx]); break;
             }
         }
         val += AXIS_SETTINGS_INCREMENT;
+        // Sent per axis setting, so the extended set fits into rpt with all axes.
+        if (p != rpt)
+            grbl_send(client, rpt);
+        p = rpt;
     }
-    grbl_send(client, rpt);
 }
 
 
@@ -402,10 +449,11 @@ void report_ngc_parameters(uint8_t client) {
     strcat(ngc_rpt, "]\r\n");
     strcat(ngc_rpt, "[TLO:"); // Print tool length offset value
     if (bit_istrue(settings.flags, BITFLAG_REPORT_INCHES))
-        sprintf(temp, "%4.3f]\r\n", gc_state.tool_length_offset * INCH_PER_MM);
+        format_decimal(temp, gc_state.tool_length_offset * INCH_PER_MM, 3);
     else
-        sprintf(temp, "%4.3f]\r\n", gc_state.tool_length_offset);
+        format_decimal(temp, gc_state.tool_length_offset, 3);
     strcat(ngc_rpt, temp);
+    strcat(ngc_rpt, "]\r\n");
     grbl_send(client, ngc_rpt);
     report_probe_parameters(client);
 }
@@ -432,10 +480,12 @@ void report_gcode_modes(uint8_t client) {
     strcat(modes_rpt, temp);
     sprintf(temp, " G%d", 94 - gc_state.modal.feed_rate);
     strcat(modes_rpt, temp);
+    if (gc_state.modal.control == CONTROL_MODE_CONTINUOUS)
+        strcat(modes_rpt, " G64");
     if (gc_state.modal.program_flow) {
         //report_util_gcode_modes_M();
         switch (gc_state.modal.program_flow) {
-        case PROGRAM_FLOW_PAUSED : strcat(modes_rpt, " M0"); //serial_write('0'); break;
+        case PROGRAM_FLOW_PAUSED : strcat(modes_rpt, " M0"); break;
         // case PROGRAM_FLOW_OPTIONAL_STOP : serial_write('1'); break; // M1 is ignored and not supported.
         case PROGRAM_FLOW_COMPLETED_M2 :
         case PROGRAM_FLOW_COMPLETED_M30 :
@@ -567,18 +617,40 @@ void report_echo_line_received(char* line, uint8_t client) {
     grbl_sendf(client, "[echo: %s]\r\n", line);
 }
 
+// Free space in the receive buffer of a client, for the Bf: field
+static int report_rx_buffer_available(uint8_t client) {
+    int bufsize = DEFAULTBUFFERSIZE;
+#if defined (ENABLE_WIFI) && defined(ENABLE_TELNET)
+    if (client == CLIENT_TELNET)
+        bufsize = telnet_server.get_rx_buffer_available();
+#endif //ENABLE_WIFI && ENABLE_TELNET
+#if defined(ENABLE_BLUETOOTH)
+    if (client == CLIENT_BT) {
+        //TODO FIXME
+        bufsize = 512 - SerialBT.available();
+    }
+#endif //ENABLE_BLUETOOTH
+    if (client == CLIENT_SERIAL)
+        bufsize = serial_get_rx_buffer_available(CLIENT_SERIAL);
+    return bufsize;
+}
+
 // Prints real-time data. This function grabs a real-time snapshot of the stepper subprogram
 // and the actual location of the CNC machine. Users may change the following function to their
 // specific needs, but the desired real-time data report must be as short as possible. This is
 // requires as it minimizes the computational overhead and allows grbl to keep running smoothly,
 // especially during g-code programs with fast, short line segments and high frequency reports (5-20Hz).
-void report_realtime_status(uint8_t client) {
+//
+// The free space in the receive buffer, the second value of Bf:, is the only part that depends
+// on the client. It is left out, so the report can be sent to several clients, and *rx_at is
+// where it goes, or 0 without a Bf: field.
+static void report_status_format(char* status, size_t* rx_at) {
     uint8_t idx;
     int32_t current_position[N_AXIS]; // Copy current state of the system position variable
-    memcpy(current_position, sys_position, sizeof(sys_position));
+    st_get_position(current_position);
     float print_position[N_AXIS];
-    char status[200];
     char temp[80];
+    *rx_at = 0;
     system_convert_array_steps_to_mpos(print_position, current_position);
     // Report current machine state and sub-states
     strcpy(status, "<");
@@ -591,7 +663,7 @@ void report_realtime_status(uint8_t client) {
             if (sys.suspend & SUSPEND_HOLD_COMPLETE)  strcat(status, "0");   // Ready to resume
             else  strcat(status, "1");   // Actively holding
             break;
-        } // Continues to print jog state during jog cancel.
+        } // Falls through - prints the jog state during a jog cancel.
     case STATE_JOG: strcat(status, "Jog"); break;
     case STATE_HOMING: strcat(status, "Home"); break;
     case STATE_ALARM: strcat(status, "Alarm"); break;
@@ -639,21 +711,11 @@ void report_realtime_status(uint8_t client) {
     // Returns planner and serial read buffer states.
 #ifdef REPORT_FIELD_BUFFER_STATE
     if (bit_istrue(settings.status_report_mask, BITFLAG_RT_STATUS_BUFFER_STATE)) {
-        int bufsize = DEFAULTBUFFERSIZE;
-#if defined (ENABLE_WIFI) && defined(ENABLE_TELNET)
-        if (client == CLIENT_TELNET)
-            bufsize = telnet_server.get_rx_buffer_available();
-#endif //ENABLE_WIFI && ENABLE_TELNET
-#if defined(ENABLE_BLUETOOTH)
-        if (client == CLIENT_BT) {
-            //TODO FIXME
-            bufsize = 512 - SerialBT.available();
-        }
-#endif //ENABLE_BLUETOOTH
-        if (client == CLIENT_SERIAL)
-            bufsize = serial_get_rx_buffer_available(CLIENT_SERIAL);
-        sprintf(temp, "|Bf:%d,%d", plan_get_block_buffer_available(), bufsize);
+        strcat(status, "|Bf:");
+        format_integer(temp, plan_get_block_buffer_available());
         strcat(status, temp);
+        strcat(status, ",");
+        *rx_at = strlen(status);
     }
 #endif
 #ifdef USE_LINE_NUMBERS
@@ -663,7 +725,8 @@ void report_realtime_status(uint8_t client) {
     if (cur_block != NULL) {
         uint32_t ln = cur_block->line_number;
         if (ln > 0) {
-            sprintf(temp, "|Ln:%d", ln);
+            strcat(status, "|Ln:");
+            format_integer(temp, ln);
             strcat(status, temp);
         }
     }
@@ -671,10 +734,14 @@ void report_realtime_status(uint8_t client) {
 #endif
     // Report realtime feed speed
 #ifdef REPORT_FIELD_CURRENT_FEED_SPEED
+    strcat(status, "|FS:");
     if (bit_istrue(settings.flags, BITFLAG_REPORT_INCHES))
-        sprintf(temp, "|FS:%.1f,%d", st_get_realtime_rate()/ MM_PER_INCH, sys.spindle_speed);
+        format_decimal(temp, st_get_realtime_rate() / MM_PER_INCH, 1);
     else
-        sprintf(temp, "|FS:%.0f,%d", st_get_realtime_rate(), sys.spindle_speed);
+        format_decimal(temp, st_get_realtime_rate(), 0);
+    strcat(status, temp);
+    strcat(status, ",");
+    format_integer(temp, sys.spindle_speed);
     strcat(status, temp);
 #endif
 #ifdef REPORT_FIELD_PIN_STATE
@@ -726,7 +793,14 @@ void report_realtime_status(uint8_t client) {
         if (sys.state & (STATE_HOMING | STATE_CYCLE | STATE_HOLD | STATE_JOG | STATE_SAFETY_DOOR)) {
             sys.report_ovr_counter = (REPORT_OVR_REFRESH_BUSY_COUNT - 1); // Reset counter for slow refresh
         } else  sys.report_ovr_counter = (REPORT_OVR_REFRESH_IDLE_COUNT - 1);
-        sprintf(temp, "|Ov:%d,%d,%d", sys.f_override, sys.r_override, sys.spindle_speed_ovr);
+        char* ov = temp;
+        strcpy(ov, "|Ov:");
+        ov += 4;
+        ov += format_integer(ov, sys.f_override);
+        *ov++ = ',';
+        ov += format_integer(ov, sys.r_override);
+        *ov++ = ',';
+        format_integer(ov, sys.spindle_speed_ovr);
         strcat(status, temp);
         uint8_t sp_state =  spindle->get_state();
         uint8_t cl_state = coolant_get_state();
@@ -752,13 +826,147 @@ void report_realtime_status(uint8_t client) {
     }
 #endif
     strcat(status, ">\r\n");
-    grbl_send(client, status);
+}
+
+// Sends a report of report_status_format() to a client, with its receive buffer space filled in.
+// An unsent report that is still queued for the client is replaced.
+static void report_status_send(uint8_t client, const char* status, size_t rx_at) {
+    if (rx_at == 0) {
+        output_queue_status(client, OUTPUT_STATUS_TEXT, (const uint8_t*)status, strlen(status));
+        return;
+    }
+    char temp[REPORT_STATUS_SIZE + 8];
+    memcpy(temp, status, rx_at);
+    size_t len = rx_at + format_integer(temp + rx_at, report_rx_buffer_available(client));
+    strcpy(temp + len, status + rx_at);
+    output_queue_status(client, OUTPUT_STATUS_TEXT, (const uint8_t*)temp, strlen(temp));
+}
+
+void report_realtime_status(uint8_t client) {
+    char status[REPORT_STATUS_SIZE];
+    size_t rx_at;
+    report_status_format(status, &rx_at);
+    report_status_send(client, status, rx_at);
+}
+
+// Formats one report for all the clients in a mask of bit(client), e.g. for the pushed reports
+void report_realtime_status_clients(uint8_t clients) {
+    char status[REPORT_STATUS_SIZE];
+    size_t rx_at;
+    report_status_format(status, &rx_at);
+    for (uint8_t client = 0; client < CLIENT_COUNT; client++) {
+        if (bit_istrue(clients, bit(client)))
+            report_status_send(client, status, rx_at);
+    }
+}
+
+// Fills in a binary frame (see status_frame.h) with the data of report_realtime_status(), except
+// for the receive buffer space of the client and the CRC. The frame is filled in from integers as
+// far as possible, without any text formatting, and always holds every field, so senders that
+// poll often do not need to track which ones were sent last.
+static void report_status_frame_fill(status_frame_t* frame) {
+    memset(frame, 0, sizeof(status_frame_t));
+    frame->start = STATUS_FRAME_START;
+    frame->length = sizeof(status_frame_t);
+    frame->version = STATUS_FRAME_VERSION;
+    frame->n_axis = N_AXIS;
+    switch (sys.state) {
+    case STATE_IDLE: frame->state = STATUS_FRAME_IDLE; break;
+    case STATE_CYCLE: frame->state = STATUS_FRAME_RUN; break;
+    case STATE_HOLD:
+        if (!(sys.suspend & SUSPEND_JOG_CANCEL)) {
+            frame->state = STATUS_FRAME_HOLD;
+            frame->substate = (sys.suspend & SUSPEND_HOLD_COMPLETE) ? 0 : 1;
+            break;
+        } // Falls through - reports the jog state during a jog cancel.
+    case STATE_JOG: frame->state = STATUS_FRAME_JOG; break;
+    case STATE_HOMING: frame->state = STATUS_FRAME_HOME; break;
+    case STATE_ALARM: frame->state = STATUS_FRAME_ALARM; break;
+    case STATE_CHECK_MODE: frame->state = STATUS_FRAME_CHECK; break;
+    case STATE_SAFETY_DOOR:
+        frame->state = STATUS_FRAME_DOOR;
+        if (sys.suspend & SUSPEND_INITIATE_RESTORE)
+            frame->substate = 3; // Restoring
+        else if (sys.suspend & SUSPEND_RETRACT_COMPLETE)
+            frame->substate = (sys.suspend & SUSPEND_SAFETY_DOOR_AJAR) ? 1 : 0;
+        else
+            frame->substate = 2; // Retracting
+        break;
+    case STATE_SLEEP: frame->state = STATUS_FRAME_SLEEP; break;
+    }
+    if (bit_istrue(settings.status_report_mask, BITFLAG_RT_STATUS_POSITION_TYPE))
+        frame->flags |= STATUS_FRAME_FLAG_MPOS;
+    if (bit_istrue(settings.flags, BITFLAG_REPORT_INCHES))
+        frame->flags |= STATUS_FRAME_FLAG_INCHES;
+    int32_t position[N_AXIS]; // The frame is packed, so its fields may not be aligned
+    st_get_position(position);
+    for (uint8_t idx = 0; idx < N_AXIS; idx++) {
+        frame->position[idx] = position[idx];
+        float wco = gc_state.coord_system[idx] + gc_state.coord_offset[idx];
+        if (idx == TOOL_LENGTH_OFFSET_AXIS)  wco += gc_state.tool_length_offset;
+        frame->wco[idx] = lroundf(wco * 1000.0);
+    }
+    frame->planner_available = plan_get_block_buffer_available();
+#ifdef USE_LINE_NUMBERS
+    plan_block_t* cur_block = plan_get_current_block();
+    if (cur_block != NULL)
+        frame->line_number = cur_block->line_number;
+#endif
+    frame->feed_rate = lroundf(st_get_realtime_rate() * 1000.0);
+    frame->spindle_speed = sys.spindle_speed;
+    frame->feed_override = sys.f_override;
+    frame->rapid_override = sys.r_override;
+    frame->spindle_override = sys.spindle_speed_ovr;
+    uint8_t sp_state = spindle->get_state();
+    if (sp_state == SPINDLE_STATE_CW)  frame->accessories |= STATUS_FRAME_SPINDLE_CW;
+    else if (sp_state)  frame->accessories |= STATUS_FRAME_SPINDLE_CCW;
+    uint8_t cl_state = coolant_get_state();
+    if (cl_state & COOLANT_STATE_FLOOD)  frame->accessories |= STATUS_FRAME_FLOOD;
+    if (cl_state & COOLANT_STATE_MIST)  frame->accessories |= STATUS_FRAME_MIST;
+    frame->pins = limits_get_state();
+    if (probe_get_state())  frame->pins |= STATUS_FRAME_PIN_PROBE;
+    uint8_t ctrl_pin_state = system_control_get_state();
+#ifdef ENABLE_SAFETY_DOOR_INPUT_PIN
+    if (bit_istrue(ctrl_pin_state, CONTROL_PIN_INDEX_SAFETY_DOOR))  frame->pins |= STATUS_FRAME_PIN_DOOR;
+#endif
+    if (bit_istrue(ctrl_pin_state, CONTROL_PIN_INDEX_RESET))  frame->pins |= STATUS_FRAME_PIN_RESET;
+    if (bit_istrue(ctrl_pin_state, CONTROL_PIN_INDEX_FEED_HOLD))  frame->pins |= STATUS_FRAME_PIN_HOLD;
+    if (bit_istrue(ctrl_pin_state, CONTROL_PIN_INDEX_CYCLE_START))  frame->pins |= STATUS_FRAME_PIN_START;
+    frame->sd_progress = STATUS_FRAME_NO_SD;
+#ifdef ENABLE_SD_CARD
+    if (get_sd_state(false) == SDCARD_BUSY_PRINTING)
+        frame->sd_progress = lroundf(sd_report_perc_complete() * 100.0);
+#endif
+    frame->time_ms = millis();
+}
+
+static void report_status_frame_send(uint8_t client, status_frame_t* frame) {
+    frame->rx_available = report_rx_buffer_available(client);
+    frame->crc = status_frame_crc((const uint8_t*)frame, sizeof(status_frame_t) - sizeof(frame->crc));
+    output_queue_status(client, OUTPUT_STATUS_FRAME, (const uint8_t*)frame, sizeof(status_frame_t));
+}
+
+void report_status_frame(uint8_t client) {
+    status_frame_t frame;
+    report_status_frame_fill(&frame);
+    report_status_frame_send(client, &frame);
+}
+
+void report_status_frame_clients(uint8_t clients) {
+    status_frame_t frame;
+    report_status_frame_fill(&frame);
+    for (uint8_t client = 0; client < CLIENT_COUNT; client++) {
+        if (bit_istrue(clients, bit(client)))
+            report_status_frame_send(client, &frame);
+    }
 }
 
 void report_realtime_steps() {
     uint8_t idx;
+    int32_t current_position[N_AXIS];
+    st_get_position(current_position);
     for (idx = 0; idx < N_AXIS; idx++) {
-        grbl_sendf(CLIENT_ALL, "%ld\n", sys_position[idx]);  // OK to send to all ... debug stuff
+        grbl_sendf(CLIENT_ALL, "%ld\n", current_position[idx]);  // OK to send to all ... debug stuff
     }
 }
 
@@ -72,6 +72,10 @@
 
 #define STATUS_BT_FAIL_BEGIN 70  // Bluetooth failed to start
 
+#define STATUS_JOB_UNSUPPORTED 80 // Block can not be compiled into a job
+#define STATUS_JOB_INVALID 81 // Compiled job is damaged or for another machine
+#define STATUS_JOB_WRITE_FAILED 82 // Compiled job could not be written
+
 
 
 // Define Grbl alarm codes. Valid values (1-255). 0 is reserved.
@@ -114,8 +118,18 @@
 #define MSG_LEVEL_DEBUG		4
 #define MSG_LEVEL_VERBOSE	5
 
+// Longest message of grbl_sendf() and grbl_msg_sendf(), with the terminating NUL. Longer ones are
+// cut off. There is one buffer of this size per client.
+#ifndef REPORT_TX_ARENA_SIZE
+    #define REPORT_TX_ARENA_SIZE 256
+#endif
+
+// Sets up the send buffers. Called first thing in setup().
+void report_init();
+
 // functions to send data to the user.
 void grbl_send(uint8_t client, const char* text);
+void grbl_send_bytes(uint8_t client, const uint8_t* data, size_t len);
 void grbl_sendf(uint8_t client, const char* format, ...);
 void grbl_msg_sendf(uint8_t client, uint8_t level, const char* format, ...);
 
@@ -148,6 +162,13 @@ void report_echo_line_received(char* line, uint8_t client);
 // Prints realtime status report
 void report_realtime_status(uint8_t client);
 
+// Prints the same data as a binary status frame (CMD_STATUS_FRAME)
+void report_status_frame(uint8_t client);
+
+// Send one status report or frame to each client in a mask of bit(client), formatted only once
+void report_realtime_status_clients(uint8_t clients);
+void report_status_frame_clients(uint8_t clients);
+
 // Prints recorded probe position
 void report_probe_parameters(uint8_t client);
 
@@ -0,0 +1,178 @@
+/*
+  ringbuffer.h - lock-free single producer, single consumer ring buffer
+  Part of Grbl_ESP32
+
+  One side writes, the other side reads, possibly from the other core or
+  from an interrupt. Only the writer moves the head and only the reader
+  moves the tail, so neither side needs a lock or a critical section.
+
+  The head and tail count all items ever written and read and wrap around
+  at 2^32. The capacity must be a power of two so that they can be turned
+  into an index with a mask, and the whole capacity is usable.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ringbuffer_h
+#define ringbuffer_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+// Also used by the stepper ISR, so nothing may end up as a call into flash.
+#define RING_INLINE inline __attribute__((always_inline))
+
+template <typename T, uint32_t CAPACITY>
+class RingBuffer {
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "RingBuffer capacity must be a power of two");
+
+  public:
+    RingBuffer() : _head(0), _tail(0) {}
+
+    static RING_INLINE uint32_t capacity() { return CAPACITY; }
+
+    // ---- Writer side ----
+
+    RING_INLINE uint32_t availableForWrite() const {
+        return CAPACITY - (_head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_acquire));
+    }
+
+    RING_INLINE bool full() const { return availableForWrite() == 0; }
+
+    // Returns the slot the next commit() publishes, or NULL if the buffer is full. The slot can be
+    // filled in place, which saves a copy of large items.
+    RING_INLINE T* reserve() {
+        if (full())
+            return NULL;
+        return &_buffer[_head.load(std::memory_order_relaxed) & (CAPACITY - 1)];
+    }
+
+    RING_INLINE void commit() { commitWrite(1); }
+
+    RING_INLINE bool push(const T& item) {
+        T* slot = reserve();
+        if (slot == NULL)
+            return false;
+        *slot = item;
+        commit();
+        return true;
+    }
+
+    // Returns the longest run of free slots that does not wrap, with its length in *count. Fill
+    // them and then publish them with commitWrite().
+    RING_INLINE T* writeSpan(uint32_t* count) {
+        uint32_t head  = _head.load(std::memory_order_relaxed);
+        uint32_t index = head & (CAPACITY - 1);
+        uint32_t free  = availableForWrite();
+        *count         = (free < CAPACITY - index) ? free : CAPACITY - index;
+        return &_buffer[index];
+    }
+
+    RING_INLINE void commitWrite(uint32_t count) {
+        _head.store(_head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    // Copies as many items as fit and returns how many that were.
+    uint32_t write(const T* items, uint32_t count) {
+        uint32_t written = 0;
+        while (written < count) {
+            uint32_t span;
+            T* dest = writeSpan(&span);
+            if (span == 0)
+                break;
+            if (span > count - written)
+                span = count - written;
+            memcpy(dest, items + written, span * sizeof(T));
+            commitWrite(span);
+            written += span;
+        }
+        return written;
+    }
+
+    // ---- Reader side ----
+
+    RING_INLINE uint32_t available() const {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_relaxed);
+    }
+
+    RING_INLINE bool empty() const { return available() == 0; }
+
+    // Returns the oldest item, or NULL if the buffer is empty. It stays valid until it is popped.
+    RING_INLINE T* front() {
+        if (empty())
+            return NULL;
+        return &_buffer[_tail.load(std::memory_order_relaxed) & (CAPACITY - 1)];
+    }
+
+    // Returns the item offset places after the oldest one, or NULL if there are not that many.
+    RING_INLINE T* peek(uint32_t offset) {
+        if (offset >= available())
+            return NULL;
+        return &_buffer[(_tail.load(std::memory_order_relaxed) + offset) & (CAPACITY - 1)];
+    }
+
+    RING_INLINE void pop() { consume(1); }
+
+    RING_INLINE bool pop(T* item) {
+        T* oldest = front();
+        if (oldest == NULL)
+            return false;
+        *item = *oldest;
+        pop();
+        return true;
+    }
+
+    // Returns the longest run of items that does not wrap, with its length in *count. Release
+    // them with consume() when done.
+    RING_INLINE T* readSpan(uint32_t* count) {
+        uint32_t tail  = _tail.load(std::memory_order_relaxed);
+        uint32_t index = tail & (CAPACITY - 1);
+        uint32_t used  = available();
+        *count         = (used < CAPACITY - index) ? used : CAPACITY - index;
+        return &_buffer[index];
+    }
+
+    RING_INLINE void consume(uint32_t count) {
+        _tail.store(_tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+
+    // Copies up to count items out and returns how many that were.
+    uint32_t read(T* items, uint32_t count) {
+        uint32_t done = 0;
+        while (done < count) {
+            uint32_t span;
+            T* src = readSpan(&span);
+            if (span == 0)
+                break;
+            if (span > count - done)
+                span = count - done;
+            memcpy(items + done, src, span * sizeof(T));
+            consume(span);
+            done += span;
+        }
+        return done;
+    }
+
+    // Discards everything written so far. Reader side only.
+    RING_INLINE void clear() { _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release); }
+
+  private:
+    T _buffer[CAPACITY];
+    std::atomic<uint32_t> _head;  // Items ever written. Only changed by the writer.
+    std::atomic<uint32_t> _tail;  // Items ever read. Only changed by the reader.
+};
+
+#endif
@@ -47,8 +47,9 @@
   Realtime commands can be anywhere in the stream.
 
   To allow the realtime commands to be randomly mixed in the stream of data, we
-  read all clients as fast as possible. The realtime commands are acted upon and the other charcters are
-  placed into a client_buffer[client].
+  read all clients as fast as possible, in chunks of up to SERIAL_CHUNK_SIZE bytes. Each chunk is
+  scanned for realtime commands, which are acted upon, and the runs of other charcters in between
+  are copied into a client_buffer[client].
 
   The main protocol loop reads from client_buffer[]
 
@@ -58,8 +59,6 @@
 #include "grbl.h"
 #include "commands.h"
 
-portMUX_TYPE myMutex = portMUX_INITIALIZER_UNLOCKED;
-
 static TaskHandle_t serialCheckTaskHandle = 0;
 
 InputBuffer client_buffer[CLIENT_COUNT];  // create a buffer for each client
@@ -87,58 +86,100 @@ void serial_init() {
 }
 
 
-// this task runs and checks for data on all interfaces
-// REaltime stuff is acted upon, then characters are added to the appropriate buffer
-void serialCheckTask(void* pvParameters) {
-    uint8_t data = 0;
-    uint8_t client = CLIENT_ALL; // who sent the data
-    while (true) { // run continuously
-        while (any_client_has_data()) {
-            if (Serial.available()) {
-                client = CLIENT_SERIAL;
-                data = Serial.read();
-            } else if (inputBuffer.available()) {
-                client = CLIENT_INPUT;
-                data = inputBuffer.read();
-            } else {
-                //currently is wifi or BT but better to prepare both can be live
+// Reads up to size bytes of what one client has received, without waiting.
+static size_t serial_read_client(uint8_t client, uint8_t* buffer, size_t size) {
+    size_t len;
+    switch (client) {
+    case CLIENT_SERIAL:
+        len = Serial.available();
+        if (len == 0)
+            return 0;
+        // Only asks for what is already there, so readBytes() never waits for its timeout
+        return Serial.readBytes(buffer, (len < size) ? len : size);
+    case CLIENT_INPUT:
+        return inputBuffer.read(buffer, size);
 #ifdef ENABLE_BLUETOOTH
-                if (SerialBT.hasClient() && SerialBT.available()) {
-                    client = CLIENT_BT;
-                    data = SerialBT.read();
-                    //Serial.write(data);  // echo all data to serial
-                } else {
+    case CLIENT_BT:
+        if (!SerialBT.hasClient())
+            return 0;
+        len = SerialBT.available();
+        if (len == 0)
+            return 0;
+        return SerialBT.readBytes(buffer, (len < size) ? len : size);
 #endif
 #if defined (ENABLE_WIFI) && defined(ENABLE_HTTP)  && defined(ENABLE_SERIAL2SOCKET_IN)
-                    if (Serial2Socket.available()) {
-                        client = CLIENT_WEBUI;
-                        data = Serial2Socket.read();
-                    } else {
+    case CLIENT_WEBUI:
+        return Serial2Socket.read(buffer, size);
 #endif
 #if defined (ENABLE_WIFI) && defined(ENABLE_TELNET)
-                        if (telnet_server.available()) {
-                            client = CLIENT_TELNET;
-                            data = telnet_server.read();
-                        }
+    case CLIENT_TELNET:
+        return telnet_server.read(buffer, size);
 #endif
-#if defined (ENABLE_WIFI) && defined(ENABLE_HTTP)  && defined(ENABLE_SERIAL2SOCKET_IN)
-                    }
-#endif
-#ifdef ENABLE_BLUETOOTH
+    default:
+        return 0;
+    }
+}
+
+// Returns the offset of the first realtime command character, or len if there is none.
+// Plain g-code has none, so four bytes are checked at a time, the way memchr() does it.
+#define HAS_ZERO_BYTE(v) (((v) - 0x01010101UL) & ~(v) & 0x80808080UL)
+#define HAS_BYTE(v, b) HAS_ZERO_BYTE((v) ^ (0x01010101UL * (uint8_t)(b)))
+static size_t find_realtime_command(const uint8_t* data, size_t len) {
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        uint32_t v;
+        memcpy(&v, data + i, 4);
+        if ((v & 0x80808080UL) || HAS_BYTE(v, CMD_RESET) || HAS_BYTE(v, CMD_STATUS_REPORT) ||
+                HAS_BYTE(v, CMD_CYCLE_START) || HAS_BYTE(v, CMD_FEED_HOLD))
+            break;
+    }
+    for (; i < len; i++) {
+        if (is_realtime_command(data[i]))
+            return i;
+    }
+    return len;
+}
+
+// Acts upon the realtime commands in a chunk of received data and queues the rest for the
+// protocol loop. Realtime commands are not passed into the line buffer, but set system state
+// flag bits for realtime execution.
+void serial_ingest(uint8_t client, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        size_t run = find_realtime_command(data, len);
+        if (run > 0)
+            client_buffer[client].write(data, run); // Lock free. This task is the only writer.
+        if (run == len)
+            break;
+        execute_realtime_command(data[run], client);
+        data += run + 1;
+        len -= run + 1;
+    }
+}
+
+// Wakes up the serial task. Called by the client drivers that can tell when data arrives.
+void serial_notify() {
+    if (serialCheckTaskHandle)
+        xTaskNotifyGive(serialCheckTaskHandle);
+}
+
+// this task runs and checks for data on all interfaces
+// The data is read in chunks, realtime stuff is acted upon, then the rest is added to the appropriate buffer
+void serialCheckTask(void* pvParameters) {
+    uint8_t chunk[SERIAL_CHUNK_SIZE];
+    bool received;
+    while (true) { // run continuously
+        do {
+            received = false;
+            for (uint8_t client = 0; client < CLIENT_COUNT; client++) {
+                size_t len = serial_read_client(client, chunk, SERIAL_CHUNK_SIZE);
+                if (len > 0) {
+                    serial_ingest(client, chunk, len);
+                    received = true;
                 }
-#endif
             }
-            // Pick off realtime command characters directly from the serial stream. These characters are
-            // not passed into the main buffer, but these set system state flag bits for realtime execution.
-            if (is_realtime_command(data))
-                execute_realtime_command(data, client);
-            else {
-                vTaskEnterCritical(&myMutex);
-                client_buffer[client].write(data);
-                vTaskExitCritical(&myMutex);
-            }
-        }  // if something available
+        } while (received);
         COMMANDS::handle();
+        status_push_poll();
 #ifdef ENABLE_WIFI
         wifi_config.handle();
 #endif
@@ -148,14 +189,18 @@ void serialCheckTask(void* pvParameters) {
 #if defined (ENABLE_WIFI) && defined(ENABLE_HTTP) && defined(ENABLE_SERIAL2SOCKET_IN)
         Serial2Socket.handle_flush();
 #endif
-        vTaskDelay(1 / portTICK_RATE_MS);  // Yield to other tasks
+        // The handlers above may have received telnet or web socket data. Otherwise sleep until
+        // Bluetooth data arrives, or for a tick. The UART driver has no receive callback, so it
+        // and the network services are still polled every tick.
+        if (!any_client_has_data())
+            ulTaskNotifyTake(pdTRUE, 1 / portTICK_RATE_MS);
     }  // while(true)
 }
 
 void serial_reset_read_buffer(uint8_t client) {
     for (uint8_t client_num = 0; client_num < CLIENT_COUNT; client_num++) {
         if (client == client_num || client == CLIENT_ALL)
-            client_buffer[client].begin();
+            client_buffer[client_num].begin();
     }
 }
 
@@ -165,18 +210,22 @@ void serial_write(uint8_t data) {
 }
 
 // Fetches the first byte in the serial read buffer. Called by protocol loop.
+// Lock free, the protocol loop is the only reader.
 uint8_t serial_read(uint8_t client) {
-    uint8_t data;
-    vTaskEnterCritical(&myMutex);
-    if (client_buffer[client].available()) {
-        data = client_buffer[client].read();
-        vTaskExitCritical(&myMutex);
-        //Serial.write((char)data);
-        return data;
-    } else {
-        vTaskExitCritical(&myMutex);
+    int data = client_buffer[client].read();
+    if (data < 0)
         return SERIAL_NO_DATA;
-    }
+    return data;
+}
+
+// Returns the next contiguous run of bytes in a client buffer, or NULL if it is empty. Called by
+// the protocol loop, which releases what it used with serial_consume().
+const uint8_t* serial_read_span(uint8_t client, uint32_t* len) {
+    return client_buffer[client].readSpan(len);
+}
+
+void serial_consume(uint8_t client, uint32_t len) {
+    client_buffer[client].consume(len);
 }
 
 bool any_client_has_data() {
@@ -207,6 +256,9 @@ void execute_realtime_command(uint8_t command, uint8_t client) {
     case CMD_STATUS_REPORT:
         report_realtime_status(client); // direct call instead of setting flag
         break;
+    case CMD_STATUS_FRAME:
+        report_status_frame(client);
+        break;
     case CMD_CYCLE_START:
         system_set_exec_state_flag(EXEC_CYCLE_START); // Set as true
         break;
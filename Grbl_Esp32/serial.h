@@ -34,6 +34,11 @@
     #endif
 #endif
 
+// Bytes the serial task reads from a client at a time
+#ifndef SERIAL_CHUNK_SIZE
+    #define SERIAL_CHUNK_SIZE 128
+#endif
+
 #define SERIAL_NO_DATA 0xff
 
 // a task to read for incoming data from serial port
@@ -42,6 +47,9 @@ void serialCheckTask(void* pvParameters);
 void serial_write(uint8_t data);
 // Fetches the first byte in the serial read buffer. Called by main program.
 uint8_t serial_read(uint8_t client);
+// Looks at the bytes in the serial read buffer without copying them. Called by main program.
+const uint8_t* serial_read_span(uint8_t client, uint32_t* len);
+void serial_consume(uint8_t client, uint32_t len);
 
 // See if the character is an action command like feedhold or jogging. If so, do the action and return true
 uint8_t check_action_command(uint8_t data);
@@ -53,6 +61,8 @@ void serial_reset_read_buffer(uint8_t client);
 uint8_t serial_get_rx_buffer_available(uint8_t client);
 
 void execute_realtime_command(uint8_t command, uint8_t client);
+void serial_ingest(uint8_t client, const uint8_t* data, size_t len);
+void serial_notify();
 bool any_client_has_data();
 bool is_realtime_command(uint8_t data);
 
@@ -37,25 +37,21 @@ Serial_2_Socket Serial2Socket;
 Serial_2_Socket::Serial_2_Socket() {
     _web_socket = NULL;
     _TXbufferSize = 0;
-    _RXbufferSize = 0;
-    _RXbufferpos = 0;
+    _RXbuffer.clear();
 }
 Serial_2_Socket::~Serial_2_Socket() {
     if (_web_socket) detachWS();
     _TXbufferSize = 0;
-    _RXbufferSize = 0;
-    _RXbufferpos = 0;
+    _RXbuffer.clear();
 }
 void Serial_2_Socket::begin(long speed) {
     _TXbufferSize = 0;
-    _RXbufferSize = 0;
-    _RXbufferpos = 0;
+    _RXbuffer.clear();
 }
 
 void Serial_2_Socket::end() {
     _TXbufferSize = 0;
-    _RXbufferSize = 0;
-    _RXbufferpos = 0;
+    _RXbuffer.clear();
 }
 
 long Serial_2_Socket::baudRate() {
@@ -80,7 +76,7 @@ Serial_2_Socket::operator bool() const {
     return true;
 }
 int Serial_2_Socket::available() {
-    return _RXbufferSize;
+    return _RXbuffer.available();
 }
 
 
@@ -114,22 +110,16 @@ size_t Serial_2_Socket::write(const uint8_t* buffer, size_t size) {
 }
 
 int Serial_2_Socket::peek(void) {
-    if (_RXbufferSize > 0)return _RXbuffer[_RXbufferpos];
+    uint8_t* c = _RXbuffer.front();
+    if (c != NULL)return *c;
     else return -1;
 }
 
 bool Serial_2_Socket::push(const char* data) {
 #if defined(ENABLE_SERIAL2SOCKET_IN)
-    int data_size = strlen(data);
-    if ((data_size + _RXbufferSize) <= RXBUFFERSIZE) {
-        int current = _RXbufferpos + _RXbufferSize;
-        if (current > RXBUFFERSIZE) current = current - RXBUFFERSIZE;
-        for (int i = 0; i < data_size; i++) {
-            if (current > (RXBUFFERSIZE - 1)) current = 0;
-            _RXbuffer[current] = data[i];
-            current ++;
-        }
-        _RXbufferSize += strlen(data);
+    size_t data_size = strlen(data);
+    if (data_size <= _RXbuffer.availableForWrite()) {
+        _RXbuffer.write((const uint8_t*)data, data_size);
         return true;
     }
     return false;
@@ -139,13 +129,14 @@ bool Serial_2_Socket::push(const char* data) {
 }
 
 int Serial_2_Socket::read(void) {
-    if (_RXbufferSize > 0) {
-        int v = _RXbuffer[_RXbufferpos];
-        _RXbufferpos++;
-        if (_RXbufferpos > (RXBUFFERSIZE - 1))_RXbufferpos = 0;
-        _RXbufferSize--;
-        return v;
-    } else return -1;
+    uint8_t c;
+    if (_RXbuffer.pop(&c))return c;
+    else return -1;
+}
+
+// Copies out as much as is there, up to size bytes.
+size_t Serial_2_Socket::read(uint8_t* buffer, size_t size) {
+    return _RXbuffer.read(buffer, size);
 }
 
 void Serial_2_Socket::handle_flush() {
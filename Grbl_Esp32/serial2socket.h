@@ -23,6 +23,7 @@
 #define _SERIAL_2_SOCKET_H_
 
 #include "Print.h"
+#include "ringbuffer.h"
 #define TXBUFFERSIZE 1200
 #define RXBUFFERSIZE 128
 #define FLUSHTIMEOUT 500
@@ -54,6 +55,7 @@ class Serial_2_Socket: public Print {
     int available();
     int peek(void);
     int read(void);
+    size_t read(uint8_t* buffer, size_t size);
     bool push(const char* data);
     void flush(void);
     void handle_flush();
@@ -65,9 +67,8 @@ class Serial_2_Socket: public Print {
     void* _web_socket;
     uint8_t _TXbuffer[TXBUFFERSIZE];
     uint16_t _TXbufferSize;
-    uint8_t _RXbuffer[RXBUFFERSIZE];
-    uint16_t _RXbufferSize;
-    uint16_t _RXbufferpos;
+    // Filled by the web server and read by the serial task, without locks.
+    RingBuffer<uint8_t, RXBUFFERSIZE> _RXbuffer;
 };
 
 
@@ -239,6 +239,7 @@ void ServoAxis::set_location() {
     float min_pulse_cal, max_pulse_cal; // calibration values in percent 110% = 1.1
     uint32_t servo_pulse_len;
     float servo_pos, mpos, offset;
+    int32_t current_position[N_AXIS];
     // skip location if we are in alarm mode
     if (_disable_on_alarm && (sys.state == STATE_ALARM)) {
         disable();
@@ -252,7 +253,8 @@ void ServoAxis::set_location() {
     if ((_homing_type == SERVO_HOMING_TARGET) && (sys.state == STATE_HOMING)) {
         servo_pos = _homing_position; // go to servos home position
     } else {
-        mpos = system_convert_axis_steps_to_mpos(sys_position, _axis);  // get the axis machine position in mm
+        st_get_position(current_position);
+        mpos = system_convert_axis_steps_to_mpos(current_position, _axis);  // get the axis machine position in mm
         if (_use_mpos)
             servo_pos = mpos;
         else {
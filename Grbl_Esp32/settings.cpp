@@ -35,6 +35,13 @@ void settings_store_startup_line(uint8_t n, char* line) {
     memcpy_to_eeprom_with_checksum(addr, (char*)line, LINE_BUFFER_SIZE);
 }
 
+// The input shaper takes $38 and $190-$205 again, from the next motion on
+static void settings_shaper_changed() {
+#ifdef INPUT_SHAPING
+    shaper_settings_changed();
+#endif
+}
+
 void settings_init() {
     EEPROM.begin(EEPROM_SIZE);
     if (!read_global_settings()) {
@@ -68,6 +75,8 @@ void settings_restore(uint8_t restore_flag) {
         settings.spindle_pwm_off_value = DEFAULT_SPINDLE_OFF_VALUE; // $34 Percent (extended set)
         settings.spindle_pwm_min_value = DEFAULT_SPINDLE_MIN_VALUE; // $35 Percent (extended set)
         settings.spindle_pwm_max_value = DEFAULT_SPINDLE_MAX_VALUE; // $36 Percent (extended set)
+        settings.segment_buffer_time = DEFAULT_SEGMENT_BUFFER_TIME; // $37 msec (extended set)
+        settings.input_shaper = DEFAULT_INPUT_SHAPER; // $38 (extended set)
         settings.rpm_max = DEFAULT_SPINDLE_RPM_MAX;
         settings.rpm_min = DEFAULT_SPINDLE_RPM_MIN;
         settings.homing_dir_mask = DEFAULT_HOMING_DIR_MASK;
@@ -108,6 +117,15 @@ void settings_restore(uint8_t restore_flag) {
         settings.stallguard[X_AXIS] = DEFAULT_X_STALLGUARD;
         settings.stallguard[Y_AXIS] = DEFAULT_Y_STALLGUARD;
         settings.stallguard[Z_AXIS] = DEFAULT_Z_STALLGUARD;
+        settings.jerk[X_AXIS] = DEFAULT_X_JERK;
+        settings.jerk[Y_AXIS] = DEFAULT_Y_JERK;
+        settings.jerk[Z_AXIS] = DEFAULT_Z_JERK;
+        settings.shaper_frequency[X_AXIS] = DEFAULT_X_SHAPER_FREQUENCY;
+        settings.shaper_frequency[Y_AXIS] = DEFAULT_Y_SHAPER_FREQUENCY;
+        settings.shaper_frequency[Z_AXIS] = DEFAULT_Z_SHAPER_FREQUENCY;
+        settings.shaper_damping[X_AXIS] = DEFAULT_X_SHAPER_DAMPING;
+        settings.shaper_damping[Y_AXIS] = DEFAULT_Y_SHAPER_DAMPING;
+        settings.shaper_damping[Z_AXIS] = DEFAULT_Z_SHAPER_DAMPING;
 #if (N_AXIS > A_AXIS)
         settings.steps_per_mm[A_AXIS] = DEFAULT_A_STEPS_PER_MM;
         settings.max_rate[A_AXIS] = DEFAULT_A_MAX_RATE;
@@ -117,6 +135,9 @@ void settings_restore(uint8_t restore_flag) {
         settings.hold_current[A_AXIS] = DEFAULT_A_HOLD_CURRENT;
         settings.microsteps[A_AXIS] = DEFAULT_A_MICROSTEPS;
         settings.stallguard[A_AXIS] = DEFAULT_Z_STALLGUARD;
+        settings.jerk[A_AXIS] = DEFAULT_A_JERK;
+        settings.shaper_frequency[A_AXIS] = DEFAULT_A_SHAPER_FREQUENCY;
+        settings.shaper_damping[A_AXIS] = DEFAULT_A_SHAPER_DAMPING;
 #endif
 #if (N_AXIS > B_AXIS)
         settings.steps_per_mm[B_AXIS] = DEFAULT_B_STEPS_PER_MM;
@@ -127,6 +148,9 @@ void settings_restore(uint8_t restore_flag) {
         settings.hold_current[B_AXIS] = DEFAULT_B_HOLD_CURRENT;
         settings.microsteps[B_AXIS] = DEFAULT_B_MICROSTEPS;
         settings.stallguard[B_AXIS] = DEFAULT_Z_STALLGUARD;
+        settings.jerk[B_AXIS] = DEFAULT_B_JERK;
+        settings.shaper_frequency[B_AXIS] = DEFAULT_B_SHAPER_FREQUENCY;
+        settings.shaper_damping[B_AXIS] = DEFAULT_B_SHAPER_DAMPING;
 #endif
 #if (N_AXIS > C_AXIS)
         settings.steps_per_mm[C_AXIS] = DEFAULT_C_STEPS_PER_MM;
@@ -137,6 +161,9 @@ void settings_restore(uint8_t restore_flag) {
         settings.hold_current[C_AXIS] = DEFAULT_C_HOLD_CURRENT;
         settings.microsteps[C_AXIS] = DEFAULT_C_MICROSTEPS;
         settings.stallguard[C_AXIS] = DEFAULT_Z_STALLGUARD;
+        settings.jerk[C_AXIS] = DEFAULT_C_JERK;
+        settings.shaper_frequency[C_AXIS] = DEFAULT_C_SHAPER_FREQUENCY;
+        settings.shaper_damping[C_AXIS] = DEFAULT_C_SHAPER_DAMPING;
 #endif
         // TODO figure out a clean way to add actual default values
         for (uint8_t index = 0; index < USER_SETTING_COUNT; index++) {
@@ -156,6 +183,7 @@ void settings_restore(uint8_t restore_flag) {
         settings.machine_float[3] = DEFAULT_USER_FLOAT_93;
         settings.machine_float[4] = DEFAULT_USER_FLOAT_94;
         write_global_settings();
+        settings_shaper_changed();
     }
     if (restore_flag & SETTINGS_RESTORE_PARAMETERS) {
         uint8_t idx;
@@ -298,6 +326,9 @@ uint8_t settings_store_global_setting(uint8_t parameter, float value) {
                     settings.stallguard[parameter] = int_value;
                     settings_spi_driver_init();
                     break;
+                case 8: settings.jerk[parameter] = value * 60 * 60 * 60; break; // Convert to mm/min^3 for grbl internal use.
+                case 9: settings.shaper_frequency[parameter] = value; settings_shaper_changed(); break; // Applies from the next motion on.
+                case 10: settings.shaper_damping[parameter] = value; settings_shaper_changed(); break;
                 }
                 break; // Exit while-loop after setting has been configured and proceed to the EEPROM write call.
             } else {
@@ -380,6 +411,8 @@ uint8_t settings_store_global_setting(uint8_t parameter, float value) {
         case 34: settings.spindle_pwm_off_value = value; spindle_init(); break; // Re-initialize spindle pwm calibration
         case 35: settings.spindle_pwm_min_value = value; spindle_init(); break; // Re-initialize spindle pwm calibration
         case 36: settings.spindle_pwm_max_value = value; spindle_init(); break; // Re-initialize spindle pwm calibration
+        case 37: settings.segment_buffer_time = (uint16_t)value; break; // Applies as the buffer is refilled
+        case 38: settings.input_shaper = int_value; settings_shaper_changed(); break; // Applies from the next motion on.
         case 80:
         case 81:
         case 82:
@@ -30,7 +30,7 @@
 
 // Version of the EEPROM data. Will be used to migrate existing data from older versions of Grbl
 // when firmware is upgraded. Always stored in byte 0 of eeprom
-#define SETTINGS_VERSION 12  // NOTE: Check settings_reset() when moving to next version.
+#define SETTINGS_VERSION 15  // NOTE: Check settings_reset() when moving to next version.
 
 // Define bit flag masks for the boolean settings in settings.flag.
 #define BITFLAG_REPORT_INCHES      bit(0)
@@ -75,7 +75,7 @@
 // #define SETTING_INDEX_G92    N_COORDINATE_SYSTEM+2  // Coordinate offset (G92.2,G92.3 not supported)
 
 // Define Grbl axis settings numbering scheme. Starts at START_VAL, every INCREMENT, over N_SETTINGS.
-#define AXIS_N_SETTINGS          8 // includes extended settings
+#define AXIS_N_SETTINGS          11 // includes extended settings
 
 #define AXIS_SETTINGS_START_VAL  100 // NOTE: Reserving settings values >= 100 for axis settings. Up to 255.
 #define AXIS_SETTINGS_INCREMENT  10  // Must be greater than the number of axis settings
@@ -93,6 +93,9 @@ typedef struct {
     float hold_current[N_AXIS]; // $150 percent of run current (extended set)
     uint16_t microsteps[N_AXIS]; // $160... (extended set)
     uint8_t stallguard[N_AXIS]; // $170... (extended set)
+    float jerk[N_AXIS]; // $180... mm/min^3, 0 for trapezoidal acceleration (extended set)
+    float shaper_frequency[N_AXIS]; // $190... Hz of the ringing input shaping cancels, 0 for none (extended set)
+    float shaper_damping[N_AXIS]; // $200... damping ratio of the ringing (extended set)
 
     // Remaining Grbl settings
     uint8_t pulse_microseconds;
@@ -108,6 +111,9 @@ typedef struct {
     float spindle_pwm_min_value; // $35 Percent (extended set)
     float spindle_pwm_max_value; // $36 Percent (extended set)
 
+    uint16_t segment_buffer_time; // $37 msec of motion in the step segment buffer (extended set)
+    uint8_t input_shaper; // $38 SHAPER_xxx type of input shaping (extended set)
+
     float rpm_max;
     float rpm_min;
 
@@ -70,7 +70,7 @@ void solenoidSyncTask(void* pvParameters) {
             solenoid_delay_counter++;
             solenoid_pen_enable = (solenoid_delay_counter > SOLENOID_TURNON_DELAY);
         } else {
-            memcpy(current_position, sys_position, sizeof(sys_position)); // get current position in step
+            st_get_position(current_position); // get current position in step
             system_convert_array_steps_to_mpos(m_pos, current_position); // convert to millimeters
             calc_solenoid(m_pos[Z_AXIS]); // calculate kinematics and move the servos
         }
@@ -171,8 +171,11 @@ void spindle_set_state(uint8_t state, float rpm) {
 
 
 void spindle_sync(uint8_t state, float rpm) {
-    if (sys.state == STATE_CHECK_MODE)
+    if (sys.state == STATE_CHECK_MODE) {
+        if (job_compiling)
+            job_compile_spindle(state, rpm);
         return;
+    }
     protocol_buffer_synchronize(); // Empty planner buffer to ensure spindle is set when programmed.
     spindle_set_state(state, rpm);
 }
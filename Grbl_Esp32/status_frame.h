@@ -0,0 +1,117 @@
+/*
+  status_frame.h - binary realtime status frame
+  Part of Grbl_ESP32
+
+  The CMD_STATUS_FRAME realtime command is answered with one frame that
+  holds the same data as the '?' text report, in a fixed layout that is
+  cheap to fill in and needs no parsing on the sender side. The frame is
+  sent in between the text lines on the same connection:
+
+      byte 0      STATUS_FRAME_START
+      byte 1      length of the whole frame, sizeof(status_frame_t)
+      byte 2      STATUS_FRAME_VERSION
+      ...         the fields of status_frame_t, little endian
+      last two    CRC-16/CCITT-FALSE of all bytes before it
+
+  STATUS_FRAME_START never appears in a text response, so a receiver can
+  tell frames from text by their first byte. Fields are only added at the
+  end, with a new version; a receiver should use the length to skip a
+  frame it does not understand. The frame is sent as it is on every
+  connection; over telnet, 0xFF bytes are not escaped, so the sender should
+  read the port as raw TCP. This file is also used by the host decoder
+  in tests/sim and must not depend on the rest of Grbl.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef status_frame_h
+#define status_frame_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define STATUS_FRAME_START 0xA5
+#define STATUS_FRAME_VERSION 1
+#define STATUS_FRAME_AXES 6 // Always sent, axes from n_axis on are 0
+
+// Machine state, the name of the text report
+#define STATUS_FRAME_IDLE 0
+#define STATUS_FRAME_RUN 1
+#define STATUS_FRAME_HOLD 2  // Substate 0 ready to resume, 1 holding
+#define STATUS_FRAME_JOG 3
+#define STATUS_FRAME_HOME 4
+#define STATUS_FRAME_ALARM 5
+#define STATUS_FRAME_CHECK 6
+#define STATUS_FRAME_DOOR 7  // Substate 0 closed, 1 ajar, 2 retracting, 3 restoring
+#define STATUS_FRAME_SLEEP 8
+
+// Flags, how the text report would show the data
+#define STATUS_FRAME_FLAG_MPOS 0x01   // $10 reports the machine position instead of WPos
+#define STATUS_FRAME_FLAG_INCHES 0x02 // $13 reports in inches
+
+// Accessories, the A: field
+#define STATUS_FRAME_SPINDLE_CW 0x01
+#define STATUS_FRAME_SPINDLE_CCW 0x02
+#define STATUS_FRAME_FLOOD 0x04
+#define STATUS_FRAME_MIST 0x08
+
+// Input pins, the Pn: field. Bits 0 to 5 are the limit switches of the axes.
+#define STATUS_FRAME_PIN_PROBE 0x0040
+#define STATUS_FRAME_PIN_DOOR 0x0080
+#define STATUS_FRAME_PIN_RESET 0x0100
+#define STATUS_FRAME_PIN_HOLD 0x0200
+#define STATUS_FRAME_PIN_START 0x0400
+
+#define STATUS_FRAME_NO_SD 0xFFFF // sd_progress when no SD card job is running
+
+typedef struct __attribute__((packed)) {
+    uint8_t start;              // STATUS_FRAME_START
+    uint8_t length;             // sizeof(status_frame_t)
+    uint8_t version;            // STATUS_FRAME_VERSION
+    uint8_t state;              // STATUS_FRAME_IDLE ...
+    uint8_t substate;           // Of hold and door
+    uint8_t n_axis;
+    uint8_t flags;              // STATUS_FRAME_FLAG_...
+    uint8_t accessories;        // STATUS_FRAME_SPINDLE_CW ...
+    uint8_t feed_override;      // %
+    uint8_t rapid_override;     // %
+    uint8_t spindle_override;   // %
+    uint8_t reserved;           // 0
+    uint16_t pins;              // STATUS_FRAME_PIN_... and the limit switches
+    uint16_t planner_available; // Free planner blocks
+    uint16_t rx_available;      // Free bytes in the receive buffer of the client
+    uint16_t sd_progress;       // Of an SD card job, in 0.01%, or STATUS_FRAME_NO_SD
+    int32_t line_number;        // Of the running block, 0 for none
+    uint32_t feed_rate;         // Current feed rate, mm/min * 1000
+    uint32_t spindle_speed;     // RPM
+    uint32_t time_ms;           // Time since start up when the frame was made
+    int32_t position[STATUS_FRAME_AXES]; // Machine position in steps
+    int32_t wco[STATUS_FRAME_AXES];      // Work coordinate offset, mm * 1000
+    uint16_t crc;
+} status_frame_t;
+
+static_assert(sizeof(status_frame_t) == 86, "status_frame_t layout changed");
+
+// CRC-16/CCITT-FALSE, polynomial 0x1021, initial value 0xFFFF
+inline uint16_t status_frame_crc(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    while (len--) {
+        crc ^= (uint16_t)(*data++) << 8;
+        for (uint8_t i = 0; i < 8; i++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+#endif
@@ -0,0 +1,130 @@
+/*
+  status_push.cpp - status reports pushed to the clients that subscribe to them
+  Part of Grbl_ESP32
+
+  Instead of polling with '?' or CMD_STATUS_FRAME, a client can subscribe
+  with $RI=<ms> to text reports and with $RB=<ms> to status frames, every
+  <ms> and whenever the state changes, or with =C only when it changes.
+  =0 unsubscribes. The serial task calls status_push_poll() on every pass,
+  at least once a tick, and each report that is due is formatted once and
+  sent to all the clients that get it at that time.
+
+  Subscriptions are changed by the main loop and read by the serial task.
+  Each field is written in one go, and a half made change at worst sends
+  one report more or less.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "grbl.h"
+
+typedef struct {
+    volatile uint16_t interval_ms; // 0 for no periodic reports
+    volatile bool on_change;
+    volatile bool pending;         // A report is due as soon as the minimum interval allows
+    uint32_t last_ms;              // When the last report was sent
+} status_push_subscription_t;
+
+// What on change subscribers are told about
+typedef struct {
+    uint8_t state;
+    uint8_t suspend;
+    uint8_t f_override;
+    uint8_t r_override;
+    uint8_t spindle_speed_ovr;
+    uint8_t spindle_state;
+    uint8_t coolant_state;
+    uint8_t limits;
+    uint8_t control;
+    uint8_t probe;
+    uint32_t spindle_speed;
+} status_push_signature_t;
+
+static status_push_subscription_t subscription[CLIENT_COUNT][STATUS_PUSH_FORMATS];
+static volatile uint8_t subscribed; // Mask of bit(client) with any subscription
+static status_push_signature_t last_signature;
+
+uint8_t status_push_subscribe(uint8_t client, uint8_t format, uint16_t interval_ms, bool on_change) {
+    if (client >= CLIENT_COUNT || client == CLIENT_INPUT || format >= STATUS_PUSH_FORMATS)
+        return (STATUS_INVALID_STATEMENT);
+    status_push_subscription_t* sub = &subscription[client][format];
+    if (interval_ms != 0 && interval_ms < STATUS_PUSH_INTERVAL_MIN)
+        interval_ms = STATUS_PUSH_INTERVAL_MIN;
+    sub->interval_ms = interval_ms;
+    sub->on_change = on_change;
+    sub->pending = (interval_ms != 0 || on_change);
+    uint8_t any = 0;
+    for (format = 0; format < STATUS_PUSH_FORMATS; format++) {
+        if (subscription[client][format].interval_ms || subscription[client][format].on_change)
+            any = 1;
+    }
+    if (any)
+        subscribed |= bit(client);
+    else
+        subscribed &= ~bit(client);
+    return (STATUS_OK);
+}
+
+void status_push_stop(uint8_t client) {
+    for (uint8_t format = 0; format < STATUS_PUSH_FORMATS; format++)
+        status_push_subscribe(client, format, 0, false);
+}
+
+static void status_push_read_signature(status_push_signature_t* signature) {
+    memset(signature, 0, sizeof(status_push_signature_t));
+    signature->state = sys.state;
+    signature->suspend = sys.suspend;
+    signature->f_override = sys.f_override;
+    signature->r_override = sys.r_override;
+    signature->spindle_speed_ovr = sys.spindle_speed_ovr;
+    signature->spindle_state = spindle->get_state();
+    signature->coolant_state = coolant_get_state();
+    signature->limits = limits_get_state();
+    signature->control = system_control_get_state();
+    signature->probe = probe_get_state();
+    signature->spindle_speed = sys.spindle_speed;
+}
+
+void status_push_poll() {
+    if (!subscribed)
+        return;
+    uint32_t now = millis();
+    status_push_signature_t signature;
+    status_push_read_signature(&signature);
+    bool changed = memcmp(&signature, &last_signature, sizeof(signature)) != 0;
+    if (changed)
+        last_signature = signature;
+    uint8_t due[STATUS_PUSH_FORMATS] = { 0 };
+    for (uint8_t client = 0; client < CLIENT_COUNT; client++) {
+        if (bit_isfalse(subscribed, bit(client)))
+            continue;
+        for (uint8_t format = 0; format < STATUS_PUSH_FORMATS; format++) {
+            status_push_subscription_t* sub = &subscription[client][format];
+            if (changed && sub->on_change)
+                sub->pending = true;
+            uint32_t elapsed = now - sub->last_ms;
+            if (!sub->pending && (sub->interval_ms == 0 || elapsed < sub->interval_ms))
+                continue;
+            if (elapsed < STATUS_PUSH_INTERVAL_MIN && sub->last_ms != 0)
+                continue;
+            sub->pending = false;
+            sub->last_ms = now;
+            due[format] |= bit(client);
+        }
+    }
+    if (due[STATUS_PUSH_TEXT])
+        report_realtime_status_clients(due[STATUS_PUSH_TEXT]);
+    if (due[STATUS_PUSH_FRAME])
+        report_status_frame_clients(due[STATUS_PUSH_FRAME]);
+}
@@ -0,0 +1,46 @@
+/*
+  status_push.h - status reports pushed to the clients that subscribe to them
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef status_push_h
+#define status_push_h
+
+#include "grbl.h"
+
+// Report formats a client can subscribe to, both at the same time if it likes
+#define STATUS_PUSH_TEXT 0  // '<...>' text reports, $RI
+#define STATUS_PUSH_FRAME 1 // Binary status frames (status_frame.h), $RB
+#define STATUS_PUSH_FORMATS 2
+
+// Shortest time between two reports to a client, also when the state changes faster, in ms
+#ifndef STATUS_PUSH_INTERVAL_MIN
+    #define STATUS_PUSH_INTERVAL_MIN 20
+#endif
+
+// Subscribes a client to reports every interval_ms, 0 for none, and also as soon as the state,
+// the overrides, the spindle and coolant or the input pins change with on_change. Both 0 and
+// false unsubscribe it. The first report is sent right away.
+uint8_t status_push_subscribe(uint8_t client, uint8_t format, uint16_t interval_ms, bool on_change);
+
+// Unsubscribes a client from all reports, e.g. when it disconnects
+void status_push_stop(uint8_t client);
+
+// Sends the reports that are due. Each report is formatted once for all the clients that get it.
+// Called by the serial task on every pass.
+void status_push_poll();
+
+#endif
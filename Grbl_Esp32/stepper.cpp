@@ -27,7 +27,7 @@
 
 // Stores the planner block Bresenham algorithm execution data for the segments in the segment
 // buffer. Normally, this buffer is partially in-use, but, for the worst case scenario, it will
-// never exceed the number of accessible stepper buffer segments (SEGMENT_BUFFER_SIZE-1).
+// never exceed the number of stepper buffer segments (SEGMENT_BUFFER_SIZE).
 // NOTE: This data is copied from the prepped planner blocks so that the planner blocks may be
 // discarded when entirely consumed and completed by the segment buffer. Also, AMASS alters this
 // data for its own use.
@@ -37,7 +37,13 @@ typedef struct {
     uint8_t direction_bits;
     uint8_t is_pwm_rate_adjusted; // Tracks motions that require constant laser power/rate
 } st_block_t;
-static st_block_t st_block_buffer[SEGMENT_BUFFER_SIZE - 1];
+#ifdef INPUT_SHAPING
+// The upper half holds the data of the pieces of shaped motion, one for each segment. The stepper
+// ISR never steps the planner blocks while they are shaped, only these.
+static st_block_t st_block_buffer[2 * SEGMENT_BUFFER_SIZE];
+#else
+static st_block_t st_block_buffer[SEGMENT_BUFFER_SIZE];
+#endif
 
 // Primary stepper segment ring buffer. Contains small, short line segments for the stepper
 // algorithm to execute, which are "checked-out" incrementally from the first block in the
@@ -53,25 +59,17 @@ typedef struct {
     uint8_t prescaler;      // Without AMASS, a prescaler is required to adjust for slow timing.
 #endif
     uint16_t spindle_rpm;  // TODO get rid of this.
+    uint32_t prep_usec;    // prep.prep_usec before this segment was prepped
 } segment_t;
-static segment_t segment_buffer[SEGMENT_BUFFER_SIZE];
+// Filled by st_prep_buffer() and emptied by the stepper ISR.
+static RingBuffer<segment_t, SEGMENT_BUFFER_SIZE> segment_buffer;
 
 // Stepper ISR data struct. Contains the running data for the main stepper ISR.
 typedef struct {
     // Used by the bresenham line algorithm
-    uint32_t counter_x,        // Counter variables for the bresenham line tracer
-             counter_y,
-             counter_z
-#if (N_AXIS > A_AXIS)
-             , counter_a
-#endif
-#if (N_AXIS > B_AXIS)
-             , counter_b
-#endif
-#if (N_AXIS > C_AXIS)
-             , counter_c
-#endif
-             ;
+    uint32_t counter[N_AXIS];       // Counter variables for the bresenham line tracer
+    int8_t position_step[N_AXIS];   // Change of sys_position by a step in the direction of the block
+    uint32_t counter_start[N_AXIS]; // Counters when the steps of the segment were last committed
 #ifdef STEP_PULSE_DELAY
     uint8_t step_bits;  // Stores out_bits output to complete the step pulse delay
 #endif
@@ -85,21 +83,48 @@ typedef struct {
 #endif
 
     uint16_t step_count;       // Steps remaining in line segment motion
+    uint16_t step_count_start; // step_count when the steps of the segment were last committed
     uint8_t exec_block_index; // Tracks the current st_block index. Change indicates new block.
     st_block_t* exec_block;   // Pointer to the block data for the segment being executed
     segment_t* exec_segment;  // Pointer to the segment being executed
 } stepper_t;
 static stepper_t st;
 
-// Step segment ring buffer indices
-static volatile uint8_t segment_buffer_tail;
-static uint8_t segment_buffer_head;
-static uint8_t segment_next_head;
+// Odd while the stepper ISR changes sys_position or the position of the segment being executed, so
+// st_get_position() can tell when its copy is torn and read again. It reads on the other core, so
+// the changes are fenced in by st_position_change_begin() and st_position_change_end().
+static std::atomic<uint32_t> st_position_seq;
 
 // Step and direction port invert masks.
 static uint8_t step_port_invert_mask;
 static uint8_t dir_port_invert_mask;
 
+// GPIO output register masks, for the pins 0-31 (GPIO.out) and 32-39 (GPIO.out1). Generated from
+// the pin definitions and invert settings by st_generate_step_dir_invert_masks(), so the ISR sets
+// all step or direction pins with one write to the set and one to the clear register.
+typedef struct {
+    uint32_t out;
+    uint32_t out1;
+} gpio_mask_t;
+
+#ifdef USE_GANGED_AXES
+    #define STEP_MASK_MODES 3 // One set of step masks per SQUARING_MODE_xxx
+#else
+    #define STEP_MASK_MODES 1
+#endif
+static gpio_mask_t step_pin_mask[STEP_MASK_MODES][N_AXIS]; // Step pins of each axis
+static gpio_mask_t step_pins[STEP_MASK_MODES];             // All step pins that are driven
+static gpio_mask_t step_invert_pins[STEP_MASK_MODES];      // Step pins that idle high
+static gpio_mask_t dir_pin_mask[N_AXIS];                   // Direction pins of each axis
+static gpio_mask_t dir_pins;                               // All direction pins
+#ifdef USE_I2S_STEPS
+// The same for the outputs on the I2S shift registers, as bits of an I2S sample. There are no
+// other outputs on them, so the samples only need the bits that are set.
+static uint32_t i2s_step_mask[STEP_MASK_MODES][N_AXIS];
+static uint32_t i2s_step_invert[STEP_MASK_MODES];
+static uint32_t i2s_dir_mask[N_AXIS];
+#endif
+
 // Used to avoid ISR nesting of the "Stepper Driver Interrupt". Should never occur though.
 static volatile uint8_t busy;
 
@@ -128,6 +153,17 @@ typedef struct {
     float last_steps_remaining;
     float last_step_per_mm;
     float last_dt_remainder;
+#ifdef INPUT_SHAPING
+    uint32_t last_counter[N_AXIS];
+#endif
+#endif
+
+#ifdef INPUT_SHAPING
+    bool shaping;               // The segments prepped go through the input shaper
+    uint8_t shaped_block_index; // Of the last piece of shaped motion, in the upper half of st_block_buffer
+    uint8_t shaped_direction_bits;
+    uint32_t shaped_ticks_remainder; // Ticks of shaped motion left over by the step rate of the last piece
+    uint32_t counter[N_AXIS];   // Bresenham counters of the block prepped, as the stepper ISR would have them
 #endif
 
     uint8_t ramp_type;      // Current segment ramp state
@@ -139,11 +175,18 @@ typedef struct {
     float accelerate_until; // Acceleration ramp end measured from end of block (mm)
     float decelerate_after; // Deceleration ramp start measured from end of block (mm)
 
+    // Jerk limited ramp being traced, see plan_ramp_time()
+    float ramp_start_speed; // Speed at the start of the ramp (mm/min)
+    float ramp_start_mm;    // Start of the ramp measured from end of block (mm)
+    float ramp_time;        // Time into the ramp (min)
+
 
     float inv_rate;    // Used by PWM laser mode to speed up segment calculations.
     //uint16_t current_spindle_pwm;  // todo remove
     float current_spindle_rpm;
 
+    uint32_t prep_usec; // Execution time of all segments prepped, wraps around
+
 } st_prep_t;
 static st_prep_t prep;
 
@@ -163,6 +206,111 @@ uint8_t B2_rmt_chan_num = 255;
 uint8_t C_rmt_chan_num = 255;
 uint8_t C2_rmt_chan_num = 255;
 
+#ifdef USE_RMT_STEP_TRAINS
+// RMT step trains. The RMT channel of each axis plays a train of step pulses out of its memory
+// block, wrapping around at its end, and asks for a refill each time it has sent half of it. The
+// trains are filled from the segment buffer by the Bresenham algorithm of the step ISR, walked
+// ahead of the pulses. An item of a train is the idle time up to a step followed by the step
+// pulse, or only idle time when the next step is further away than an item can last. All trains
+// start together and count the same ticks, so they stay in step with each other. The direction
+// pins can only change between trains: a block with other directions ends the trains of all axes
+// and the next ones start when they have all ended.
+#define RMT_TRAIN_ITEMS 64                             // Items in the memory block of a channel
+#define RMT_TRAIN_HALF (RMT_TRAIN_ITEMS / 2)           // Items refilled at a time
+#define RMT_TRAIN_CLK_DIV (F_TIMERS / F_STEPPER_TIMER) // One RMT tick per step timer tick
+#define RMT_TRAIN_DURATION_MAX 0x7fff                  // Longest level of an item, in ticks
+#define RMT_TRAIN_NO_END 0xff
+#define RMT_TX_END_BIT(channel) bit((channel) * 3)
+#define RMT_TX_THR_BIT(channel) bit((channel) + 24)
+
+enum { TRAIN_RUNNING, TRAIN_ENDING, TRAIN_DONE };
+enum { TRAIN_LOADED, TRAIN_WAIT, TRAIN_END };
+
+typedef struct {
+    uint8_t channel;           // RMT channel of the axis
+    uint8_t channel2;          // Channel of the ganged motor, 255 for none. Plays the same train.
+    uint8_t idle_level;
+    uint8_t state;
+    uint8_t mem_pos;           // Next item to fill in the memory block
+    uint8_t segment;           // Segment to load next, counted from the oldest one in the buffer
+    uint8_t block_index;       // Tracks the st_block index. Change indicates new block.
+    bool starved;              // The last half was filled before the segments for it were there
+    bool step;                 // A step is due at the end of pending
+    bool negative;             // Direction of the block being stepped
+    uint16_t ticks;            // Step ISR ticks left in the loaded segment
+    uint16_t cycles_per_tick;
+    uint32_t steps;            // Bresenham increment of the axis, with AMASS applied
+    uint32_t step_event_count;
+    uint32_t counter;
+    int32_t pending;           // Ticks after the end of the last item that have not been filled
+} rmt_train_t;
+
+static struct {
+    rmt_train_t axis[N_AXIS];
+    bool usable;               // Every axis has a channel
+    bool trains;               // The channels are set up for trains, not for single pulses
+    volatile bool running;
+    volatile uint8_t channels; // Axes whose train has not ended yet
+    uint8_t end_segment;       // The trains end before this segment
+    uint8_t direction_bits;    // Of the blocks the trains step
+    bool pwm_rate_adjusted;    // Of the last block loaded
+    uint32_t pulse_ticks;
+} rmt_trains;
+#endif
+
+#ifdef USE_I2S_STEPS
+// I2S steps. The step and direction outputs are bits of the samples the I2S peripheral shifts
+// into the shift registers (see grbl_i2s_out.h). The samples are filled from the segment buffer
+// each time a DMA buffer has been sent, by running the ticks of the step ISR at their time within
+// them. A step comes out at the start of the sample its tick falls in, I2S_STEPS_DELAY samples
+// after the direction bits for it. The position is counted as the steps are filled, ahead of the
+// motion by up to the buffers queued. Homing and probing fill shorter buffers, to stop closer
+// behind the switches.
+#ifdef STEP_PULSE_DELAY
+#define I2S_STEPS_DELAY ((STEP_PULSE_DELAY + I2S_OUT_SAMPLE_USEC - 1) / I2S_OUT_SAMPLE_USEC)
+#else
+#define I2S_STEPS_DELAY 1
+#endif
+#define I2S_STEPS_SHORT_FILL 25 // Samples filled at a time during homing and probing, 100usec
+
+static struct {
+    volatile bool running;
+    bool empty;              // The segment buffer was empty at the last tick
+    uint8_t stopping;        // Fills left until the cycle stops, after the segment buffer ran empty
+    uint8_t delayed_steps;   // Axes to step once the direction bits are set for them
+    uint32_t delay_left;     // Samples up to the step pulse
+    uint32_t pulse_left;     // Samples left of the step pulse
+    uint32_t pulse_samples;
+    int32_t tick_wait;       // Step timer ticks from the sample being filled to the next ISR tick
+    uint32_t dir_sample;     // Direction bits of the samples
+    uint32_t step_sample;    // Step bits of the samples between the pulses
+    uint32_t pulse_sample;   // Step bits of the samples of the pulse
+} i2s_steps;
+
+static uint32_t IRAM_ATTR i2s_step_sample(uint8_t onMask) {
+#ifdef USE_GANGED_AXES
+    uint8_t mode = ganged_mode;
+#else
+    uint8_t mode = 0;
+#endif
+    uint32_t sample = 0;
+    for (uint8_t idx = 0; idx < N_AXIS; idx++) {
+        if (onMask & bit(idx))
+            sample |= i2s_step_mask[mode][idx];
+    }
+    return sample ^ i2s_step_invert[mode];
+}
+
+static uint32_t IRAM_ATTR i2s_dir_sample(uint8_t onMask) {
+    uint32_t sample = 0;
+    for (uint8_t idx = 0; idx < N_AXIS; idx++) {
+        if (onMask & bit(idx))
+            sample |= i2s_dir_mask[idx];
+    }
+    return sample;
+}
+#endif
+
 /* "The Stepper Driver Interrupt" - This timer interrupt is the workhorse of Grbl. Grbl employs
    the venerable Bresenham line algorithm to manage and exactly synchronize multi-axis moves.
    Unlike the popular DDA algorithm, the Bresenham algorithm is not susceptible to numerical
@@ -221,13 +369,140 @@ uint8_t C2_rmt_chan_num = 255;
 #ifdef USE_RMT_STEPS
     inline IRAM_ATTR static void stepperRMT_Outputs();
 #endif
-// TODO: Replace direct updating of the int32 position counters in the ISR somehow. Perhaps use smaller
-// int8 variables and update position counters only when a segment completes. This can get complicated
-// with probing and homing cycles that require true real-time positions.
-void IRAM_ATTR onStepperDriverTimer(void* para) { // ISR It is time to take a step =======================================================================================
-#ifndef USE_RMT_STEPS
-    uint64_t step_pulse_off_time;
+static void IRAM_ATTR st_stop_cycle(bool pwm_rate_adjusted);
+
+// The release fence keeps the changes that follow behind the odd sequence number, the release
+// store keeps them ahead of the even one. volatile would order neither for the other core.
+inline IRAM_ATTR static void st_position_change_begin() {
+    st_position_seq.store(st_position_seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+inline IRAM_ATTR static void st_position_change_end() {
+    st_position_seq.store(st_position_seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+// Loads the oldest segment of the segment buffer for execution. Returns false if the buffer is empty.
+inline IRAM_ATTR static bool st_load_segment() {
+    // Anything in the buffer? If so, load and initialize next step segment.
+    st.exec_segment = segment_buffer.front();
+    if (st.exec_segment == NULL)
+        return false;
+    st_position_change_begin();
+    // Load number of steps to execute.
+    st.step_count = st.exec_segment->n_step; // NOTE: Can sometimes be zero when moving slow.
+    st.step_count_start = st.step_count;
+    // If the new segment starts a new planner block, initialize stepper variables and counters.
+    // NOTE: When the segment data index changes, this indicates a new planner block.
+    if (st.exec_block_index != st.exec_segment->st_block_index) {
+        st.exec_block_index = st.exec_segment->st_block_index;
+        st.exec_block = &st_block_buffer[st.exec_block_index];
+        // Initialize Bresenham line and distance counters of all axes
+        for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+            st.counter[axis] = st.exec_block->step_event_count >> 1;
+            st.position_step[axis] = bit_istrue(st.exec_block->direction_bits, bit(axis)) ? -1 : 1;
+        }
+    }
+    st.dir_outbits = st.exec_block->direction_bits ^ settings.dir_invert_mask;
+    for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+        // With AMASS enabled, adjust Bresenham axis increment counters according to AMASS level.
+        st.steps[axis] = st.exec_block->steps[axis] >> st.exec_segment->amass_level;
+#endif
+        st.counter_start[axis] = st.counter[axis];
+    }
+    st_position_change_end();
+    // Set real-time spindle output as segment is loaded, just prior to the first step.
+    spindle->set_rpm(st.exec_segment->spindle_rpm);
+    return true;
+}
+
+// Adds the steps of the segment being executed since they were last committed to position. Each
+// step took step_event_count back from the Bresenham counter of its axis, which has taken in the
+// increment of the axis on every ISR tick since, so the steps follow from the counter. Also called
+// outside the ISR by st_get_position(), which throws the result away when torn, so nothing read here
+// may be dereferenced or divided by unchecked.
+inline IRAM_ATTR static void st_add_segment_steps(int32_t* position) {
+    segment_t* segment = st.exec_segment;
+    st_block_t* block = st.exec_block;
+    if (segment == NULL || block == NULL || block->step_event_count == 0)
+        return;
+    uint32_t ticks = (uint16_t)(st.step_count_start - st.step_count);
+    for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+        uint32_t increment = st.steps[axis];
+#else
+        uint32_t increment = block->steps[axis];
+#endif
+        if (increment == 0)
+            continue;
+        uint64_t taken = st.counter_start[axis] + (uint64_t)ticks * increment - st.counter[axis];
+        position[axis] += st.position_step[axis] * (int32_t)(taken / block->step_event_count);
+    }
+}
+
+// Commits the steps made so far in the segment being executed to sys_position, for when the
+// segment is cut short.
+static void IRAM_ATTR st_commit_position() {
+    st_position_change_begin();
+    st_add_segment_steps(sys_position);
+    for (uint8_t axis = 0; axis < N_AXIS; axis++)
+        st.counter_start[axis] = st.counter[axis];
+    st.step_count_start = st.step_count;
+    st_position_change_end();
+}
+
+// The Bresenham update of the axes below n for one ISR tick, unrolled at compile time. steps are the
+// increments of the axes, with AMASS applied when enabled. Returns the axes that step.
+template <uint8_t n>
+struct st_bresenham {
+    inline IRAM_ATTR static uint8_t tick(const uint32_t* steps, uint32_t step_event_count) {
+        uint8_t step_outbits = st_bresenham<n - 1>::tick(steps, step_event_count);
+        const uint8_t axis = n - 1;
+        st.counter[axis] += steps[axis];
+        if (st.counter[axis] > step_event_count) {
+            st.counter[axis] -= step_event_count;
+            step_outbits |= bit(axis);
+        }
+        return step_outbits;
+    }
+};
+
+template <>
+struct st_bresenham<0> {
+    inline IRAM_ATTR static uint8_t tick(const uint32_t* steps, uint32_t step_event_count) {
+        return 0;
+    }
+};
+
+// Executes one step ISR tick of the loaded segment: advances the Bresenham counters of all axes and
+// leaves the axes to step in st.step_outbits. Commits the steps of the segment to sys_position and
+// discards it when it is complete. The position of axes locked out by homing counts all the same.
+inline IRAM_ATTR static void st_step_tick() {
+    // Check probing state.
+    if (sys_probe_state == PROBE_ACTIVE)
+        probe_state_monitor();
+    st_position_change_begin();
+    // Execute step displacement profile by Bresenham line algorithm
+#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+    st.step_outbits = st_bresenham<N_AXIS>::tick(st.steps, st.exec_block->step_event_count);
+#else
+    st.step_outbits = st_bresenham<N_AXIS>::tick(st.exec_block->steps, st.exec_block->step_event_count);
 #endif
+    // During a homing cycle, lock out and prevent desired axes from moving.
+    if (sys.state == STATE_HOMING)
+        st.step_outbits &= sys.homing_axis_lock;
+    st.step_count--; // Decrement step events count
+    if (st.step_count == 0) {
+        // Segment is complete. Discard current segment and advance segment indexing.
+        st_add_segment_steps(sys_position);
+        st.exec_segment = NULL;
+        segment_buffer.pop();
+    }
+    st_position_change_end();
+}
+
+void IRAM_ATTR onStepperDriverTimer(void* para) { // ISR It is time to take a step =======================================================================================
     //const int timer_idx = (int)para;  // get the timer index
     TIMERG0.int_clr_timers.t0 = 1;
     if (busy) {
@@ -237,8 +512,16 @@ void IRAM_ATTR onStepperDriverTimer(void* para) { // ISR It is time to take a st
 #ifdef USE_RMT_STEPS
     stepperRMT_Outputs();
 #else
-    set_stepper_pins_on(st.step_outbits);
-    step_pulse_off_time = esp_timer_get_time() + (settings.pulse_microseconds); // determine when to turn off pulse
+    // The step pulse timer ends the pulse while the next step is computed below.
+    if (st.step_outbits) {
+#ifdef STEP_PULSE_DELAY
+        st.step_bits = st.step_outbits; // Set by the step pulse timer after the delay
+        Stepper_Pulse_Timer_Start(STEP_PULSE_DELAY);
+#else
+        set_stepper_pins_on(st.step_outbits);
+        Stepper_Pulse_Timer_Start(settings.pulse_microseconds);
+#endif
+    }
 #endif
 #ifdef USE_UNIPOLAR
     unipolar_step(st.step_outbits, st.dir_outbits);
@@ -246,159 +529,111 @@ void IRAM_ATTR onStepperDriverTimer(void* para) { // ISR It is time to take a st
     busy = true;
     // If there is no step segment, attempt to pop one from the stepper buffer
     if (st.exec_segment == NULL) {
-        // Anything in the buffer? If so, load and initialize next step segment.
-        if (segment_buffer_head != segment_buffer_tail) {
-            // Initialize new step segment and load number of steps to execute
-            st.exec_segment = &segment_buffer[segment_buffer_tail];
-            // Initialize step segment timing per step and load number of steps to execute.
-            Stepper_Timer_WritePeriod(st.exec_segment->cycles_per_tick);
-            st.step_count = st.exec_segment->n_step; // NOTE: Can sometimes be zero when moving slow.
-            // If the new segment starts a new planner block, initialize stepper variables and counters.
-            // NOTE: When the segment data index changes, this indicates a new planner block.
-            if (st.exec_block_index != st.exec_segment->st_block_index) {
-                st.exec_block_index = st.exec_segment->st_block_index;
-                st.exec_block = &st_block_buffer[st.exec_block_index];
-                // Initialize Bresenham line and distance counters
-                st.counter_x = st.counter_y = st.counter_z = (st.exec_block->step_event_count >> 1);
-                // TODO ABC
-            }
-            st.dir_outbits = st.exec_block->direction_bits ^ settings.dir_invert_mask;
-#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-            // With AMASS enabled, adjust Bresenham axis increment counters according to AMASS level.
-            st.steps[X_AXIS] = st.exec_block->steps[X_AXIS] >> st.exec_segment->amass_level;
-            st.steps[Y_AXIS] = st.exec_block->steps[Y_AXIS] >> st.exec_segment->amass_level;
-            st.steps[Z_AXIS] = st.exec_block->steps[Z_AXIS] >> st.exec_segment->amass_level;
-#if (N_AXIS > A_AXIS)
-            st.steps[A_AXIS] = st.exec_block->steps[A_AXIS] >> st.exec_segment->amass_level;
-#endif
-#if (N_AXIS > B_AXIS)
-            st.steps[B_AXIS] = st.exec_block->steps[B_AXIS] >> st.exec_segment->amass_level;
-#endif
-#if (N_AXIS > C_AXIS)
-            st.steps[C_AXIS] = st.exec_block->steps[C_AXIS] >> st.exec_segment->amass_level;
-#endif
-#endif
-            // Set real-time spindle output as segment is loaded, just prior to the first step.
-            spindle->set_rpm(st.exec_segment->spindle_rpm);
-        } else {
+        if (!st_load_segment()) {
             // Segment buffer empty. Shutdown.
-            st_go_idle();
-            if (!(sys.state & STATE_JOG)) {  // added to prevent ... jog after probing crash
-                // Ensure pwm is set properly upon completion of rate-controlled motion.
-                if (st.exec_block->is_pwm_rate_adjusted) {
-                    spindle->set_rpm(0);
-                }
-            }
-
-            system_set_exec_state_flag(EXEC_CYCLE_STOP); // Flag main program for cycle end
+            st_stop_cycle(st.exec_block != NULL && st.exec_block->is_pwm_rate_adjusted);
             return; // Nothing to do but exit.
         }
+        // Initialize step segment timing per step
+        Stepper_Timer_WritePeriod(st.exec_segment->cycles_per_tick);
     }
-    // Check probing state.
-    if (sys_probe_state == PROBE_ACTIVE)
-        probe_state_monitor();
-    // Reset step out bits.
-    st.step_outbits = 0;
-    // Execute step displacement profile by Bresenham line algorithm
-#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-    st.counter_x += st.steps[X_AXIS];
-#else
-    st.counter_x += st.exec_block->steps[X_AXIS];
-#endif
-    if (st.counter_x > st.exec_block->step_event_count) {
-        st.step_outbits |= (1 << X_STEP_BIT);
-        st.counter_x -= st.exec_block->step_event_count;
-        if (st.exec_block->direction_bits & (1 << X_DIRECTION_BIT))
-            sys_position[X_AXIS]--;
-        else
-            sys_position[X_AXIS]++;
-    }
-#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-    st.counter_y += st.steps[Y_AXIS];
-#else
-    st.counter_y += st.exec_block->steps[Y_AXIS];
-#endif
-    if (st.counter_y > st.exec_block->step_event_count) {
-        st.step_outbits |= (1 << Y_STEP_BIT);
-        st.counter_y -= st.exec_block->step_event_count;
-        if (st.exec_block->direction_bits & (1 << Y_DIRECTION_BIT))
-            sys_position[Y_AXIS]--;
-        else
-            sys_position[Y_AXIS]++;
+    st_step_tick();
+    TIMERG0.hw_timer[STEP_TIMER_INDEX].config.alarm_en = TIMER_ALARM_EN;
+    busy = false;
+}
+
+#ifndef USE_RMT_STEPS
+// Step pulse timer ISR. Ends the step pulse started by onStepperDriverTimer(). With STEP_PULSE_DELAY
+// it starts the pulse first, once the delay after setting the direction pins has passed.
+// NOTE: The step period must be longer than the pulse time, plus the delay, or steps are lost.
+void IRAM_ATTR onStepperOffTimer(void* para) {
+    TIMERG0.int_clr_timers.t1 = 1;
+#ifdef STEP_PULSE_DELAY
+    if (st.step_bits) {
+        set_stepper_pins_on(st.step_bits);
+        st.step_bits = 0;
+        Stepper_Pulse_Timer_Start(settings.pulse_microseconds);
+        return;
     }
-#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-    st.counter_z += st.steps[Z_AXIS];
-#else
-    st.counter_z += st.exec_block->steps[Z_AXIS];
 #endif
-    if (st.counter_z > st.exec_block->step_event_count) {
-        st.step_outbits |= (1 << Z_STEP_BIT);
-        st.counter_z -= st.exec_block->step_event_count;
-        if (st.exec_block->direction_bits & (1 << Z_DIRECTION_BIT))
-            sys_position[Z_AXIS]--;
-        else
-            sys_position[Z_AXIS]++;
-    }
-#if (N_AXIS > A_AXIS)
-#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-    st.counter_a += st.steps[A_AXIS];
-#else
-    st.counter_a += st.exec_block->steps[A_AXIS];
+    timer_pause(STEP_TIMER_GROUP, STEP_PULSE_TIMER_INDEX);
+    set_stepper_pins_on(0); // turn all off
+}
 #endif
-    if (st.counter_a > st.exec_block->step_event_count) {
-        st.step_outbits |= (1 << A_STEP_BIT);
-        st.counter_a -= st.exec_block->step_event_count;
-        if (st.exec_block->direction_bits & (1 << A_DIRECTION_BIT))  sys_position[A_AXIS]--;
-        else  sys_position[A_AXIS]++;
+
+// Called by the step ISR, or by the RMT step trains, when the segment buffer has run empty.
+static void IRAM_ATTR st_stop_cycle(bool pwm_rate_adjusted) {
+    st_go_idle();
+    if (!(sys.state & STATE_JOG)) {  // added to prevent ... jog after probing crash
+        // Ensure pwm is set properly upon completion of rate-controlled motion.
+        if (pwm_rate_adjusted)
+            spindle->set_rpm(0);
     }
-#endif
-#if (N_AXIS > B_AXIS)
-#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-    st.counter_b += st.steps[B_AXIS];
-#else
-    st.counter_b += st.exec_block->steps[B_AXIS];
-#endif
-    if (st.counter_b > st.exec_block->step_event_count) {
-        st.step_outbits |= (1 << B_STEP_BIT);
-        st.counter_b -= st.exec_block->step_event_count;
-        if (st.exec_block->direction_bits & (1 << B_DIRECTION_BIT))  sys_position[B_AXIS]--;
-        else  sys_position[B_AXIS]++;
+    system_set_exec_state_flag(EXEC_CYCLE_STOP); // Flag main program for cycle end
+}
+
+#ifdef USE_I2S_STEPS
+// Runs one tick of the step ISR at the sample being filled.
+static void IRAM_ATTR i2s_steps_tick() {
+    // The direction and step bits computed by the tick before come out now.
+    i2s_steps.dir_sample = i2s_dir_sample(st.dir_outbits);
+    if (st.step_outbits) {
+        i2s_steps.delayed_steps |= st.step_outbits;
+        i2s_steps.delay_left = I2S_STEPS_DELAY;
+        st.step_outbits = 0;
     }
-#endif
-#if (N_AXIS > C_AXIS)
-#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-    st.counter_c += st.steps[C_AXIS];
-#else
-    st.counter_c += st.exec_block->steps[C_AXIS];
-#endif
-    if (st.counter_c > st.exec_block->step_event_count) {
-        st.step_outbits |= (1 << C_STEP_BIT);
-        st.counter_c -= st.exec_block->step_event_count;
-        if (st.exec_block->direction_bits & (1 << C_DIRECTION_BIT))  sys_position[C_AXIS]--;
-        else  sys_position[C_AXIS]++;
+    if (st.exec_segment == NULL && !st_load_segment()) {
+        i2s_steps.empty = true;
+        return;
     }
-#endif
-    // During a homing cycle, lock out and prevent desired axes from moving.
-    if (sys.state == STATE_HOMING)
-        st.step_outbits &= sys.homing_axis_lock;
-    st.step_count--; // Decrement step events count
-    if (st.step_count == 0) {
-        // Segment is complete. Discard current segment and advance segment indexing.
-        st.exec_segment = NULL;
-        if (++segment_buffer_tail == SEGMENT_BUFFER_SIZE)
-            segment_buffer_tail = 0;
+    i2s_steps.stopping = 0;
+    i2s_steps.tick_wait += st.exec_segment->cycles_per_tick;
+    st_step_tick();
+}
+
+// Fills I2S samples from the segment buffer. Called from the I2S interrupt.
+// NOTE: A step pulse that starts before the one of the axis before has ended merges with it, so
+// the step period must be longer than the pulse time, plus the delay, plus a sample.
+static uint32_t IRAM_ATTR i2s_steps_fill(uint32_t* samples, uint32_t count) {
+    if (i2s_steps.stopping != 0 && --i2s_steps.stopping == 0) {
+        // Everything filled before the segment buffer ran empty has been sent.
+        st_stop_cycle(st.exec_block != NULL && st.exec_block->is_pwm_rate_adjusted);
+        samples[0] = i2s_steps.dir_sample | i2s_steps.step_sample;
+        return 1;
     }
-#ifndef USE_RMT_STEPS
-    st.step_outbits ^= step_port_invert_mask;  // Apply step port invert mask
-    // wait for step pulse time to complete...some of it should have expired during code above
-    while (esp_timer_get_time() < step_pulse_off_time) {
-        NOP(); // spin here until time to turn off step
+    if ((sys.state == STATE_HOMING || sys_probe_state == PROBE_ACTIVE) && count > I2S_STEPS_SHORT_FILL)
+        count = I2S_STEPS_SHORT_FILL;
+    i2s_steps.empty = false; // Look for new segments
+    uint32_t filled = 0;
+    while (filled < count) {
+        while (!i2s_steps.empty && i2s_steps.tick_wait < I2S_OUT_SAMPLE_TICKS)
+            i2s_steps_tick();
+        if (i2s_steps.empty && i2s_steps.stopping == 0)
+            i2s_steps.stopping = I2S_OUT_DMABUF_COUNT;
+        // Samples up to the next tick, or to the start or the end of a step pulse
+        uint32_t run = count - filled;
+        if (!i2s_steps.empty && (uint32_t)i2s_steps.tick_wait / I2S_OUT_SAMPLE_TICKS < run)
+            run = i2s_steps.tick_wait / I2S_OUT_SAMPLE_TICKS;
+        if (i2s_steps.delay_left != 0 && i2s_steps.delay_left < run)
+            run = i2s_steps.delay_left;
+        if (i2s_steps.pulse_left != 0 && i2s_steps.pulse_left < run)
+            run = i2s_steps.pulse_left;
+        uint32_t sample = i2s_steps.dir_sample | (i2s_steps.pulse_left != 0 ? i2s_steps.pulse_sample : i2s_steps.step_sample);
+        for (uint32_t i = 0; i < run; i++)
+            samples[filled++] = sample;
+        if (!i2s_steps.empty)
+            i2s_steps.tick_wait -= run * I2S_OUT_SAMPLE_TICKS;
+        if (i2s_steps.pulse_left != 0)
+            i2s_steps.pulse_left -= run;
+        if (i2s_steps.delay_left != 0 && (i2s_steps.delay_left -= run) == 0) {
+            i2s_steps.pulse_sample = i2s_step_sample(i2s_steps.delayed_steps);
+            i2s_steps.delayed_steps = 0;
+            i2s_steps.pulse_left = i2s_steps.pulse_samples;
+        }
     }
-    set_stepper_pins_on(0); // turn all off
-#endif
-    TIMERG0.hw_timer[STEP_TIMER_INDEX].config.alarm_en = TIMER_ALARM_EN;
-    busy = false;
+    return filled;
 }
+#endif
 
 
 void stepper_init() {
@@ -417,6 +652,9 @@ void stepper_init() {
 #ifdef USE_RMT_STEPS
     grbl_msg_sendf(CLIENT_SERIAL, MSG_LEVEL_INFO, "RMT Steps");
     initRMT();
+#elif defined(USE_I2S_STEPS)
+    grbl_msg_sendf(CLIENT_SERIAL, MSG_LEVEL_INFO, "I2S Steps");
+    i2s_out_init(0);
 #else
     grbl_msg_sendf(CLIENT_SERIAL, MSG_LEVEL_INFO, "Timed Steps");
     // make the step pins outputs
@@ -485,6 +723,7 @@ void stepper_init() {
 #ifdef C2_DIRECTION_PIN
     pinMode(C2_DIRECTION_PIN, OUTPUT);
 #endif
+    st_generate_step_dir_invert_masks(); // Register masks of the pins above
     // setup stepper timer interrupt
     /*
     stepperDriverTimer = timerBegin(	0, 													// timer number
@@ -505,7 +744,356 @@ void stepper_init() {
     timer_set_counter_value(STEP_TIMER_GROUP, STEP_TIMER_INDEX, 0x00000000ULL);
     timer_enable_intr(STEP_TIMER_GROUP, STEP_TIMER_INDEX);
     timer_isr_register(STEP_TIMER_GROUP, STEP_TIMER_INDEX, onStepperDriverTimer, NULL, 0, NULL);
+#ifndef USE_RMT_STEPS
+    // The step pulse timer is a one shot, started for each step pulse
+    config.auto_reload = false;
+    timer_init(STEP_TIMER_GROUP, STEP_PULSE_TIMER_INDEX, &config);
+    timer_set_counter_value(STEP_TIMER_GROUP, STEP_PULSE_TIMER_INDEX, 0x00000000ULL);
+    timer_enable_intr(STEP_TIMER_GROUP, STEP_PULSE_TIMER_INDEX);
+    timer_isr_register(STEP_TIMER_GROUP, STEP_PULSE_TIMER_INDEX, onStepperOffTimer, NULL, 0, NULL);
+#endif
+}
+
+#ifdef USE_RMT_STEP_TRAINS
+static void IRAM_ATTR rmt_train_put(rmt_train_t* train, uint32_t duration0, uint8_t level0, uint32_t duration1, uint8_t level1) {
+    rmt_item32_t item;
+    item.duration0 = duration0;
+    item.level0 = level0;
+    item.duration1 = duration1;
+    item.level1 = level1;
+    RMTMEM.chan[train->channel].data32[train->mem_pos].val = item.val;
+    if (train->channel2 != 255)
+        RMTMEM.chan[train->channel2].data32[train->mem_pos].val = item.val;
+    train->mem_pos = (train->mem_pos + 1) & (RMT_TRAIN_ITEMS - 1);
+}
+
+// Fills one item of idle time, at least 2 ticks.
+static void IRAM_ATTR rmt_train_wait(rmt_train_t* train, int32_t ticks) {
+    rmt_train_put(train, ticks - ticks / 2, train->idle_level, ticks / 2, train->idle_level);
+    train->pending -= ticks;
+}
+
+// Loads the next segment into the train of an axis.
+static uint8_t IRAM_ATTR rmt_train_load(uint8_t axis, rmt_train_t* train) {
+    if (train->segment >= rmt_trains.end_segment)
+        return TRAIN_END;
+    segment_t* segment = segment_buffer.peek(train->segment);
+    if (segment == NULL)
+        return TRAIN_WAIT;
+    st_block_t* block = &st_block_buffer[segment->st_block_index];
+    if (block->direction_bits != rmt_trains.direction_bits) {
+        rmt_trains.end_segment = train->segment;
+        return TRAIN_END;
+    }
+    train->segment++;
+    if (train->block_index != segment->st_block_index) {
+        // Initialize the Bresenham counter for the new planner block.
+        train->block_index = segment->st_block_index;
+        train->counter = block->step_event_count >> 1;
+    }
+    train->step_event_count = block->step_event_count;
+    train->negative = bit_istrue(block->direction_bits, bit(axis));
+#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+    train->steps = block->steps[axis] >> segment->amass_level;
+#else
+    train->steps = block->steps[axis];
+#endif
+    train->ticks = segment->n_step;
+    train->cycles_per_tick = segment->cycles_per_tick;
+    if (block->steps[axis] == block->step_event_count) {
+        // The dominant axis is filled the least ahead of its pulses, so it sets the spindle.
+        spindle->set_rpm(segment->spindle_rpm);
+        rmt_trains.pwm_rate_adjusted = block->is_pwm_rate_adjusted;
+    }
+    return TRAIN_LOADED;
+}
+
+// Fills the next items of the train of an axis. The Bresenham counter is advanced one step ISR tick
+// at a time, as in the step ISR, but only up to the next step, and the position is updated as the
+// step is filled in.
+static void IRAM_ATTR rmt_train_fill(uint8_t axis, uint8_t items) {
+    rmt_train_t* train = &rmt_trains.axis[axis];
+    bool starved = train->starved;
+    train->starved = false;
+    while (items > 0 && train->state != TRAIN_DONE) {
+        if (train->step) {
+            if (train->pending > RMT_TRAIN_DURATION_MAX) {
+                // Idle until the step is within reach of one item
+                int32_t ticks = train->pending - RMT_TRAIN_DURATION_MAX;
+                if (ticks < 2)
+                    ticks = 2;
+                else if (ticks > 2 * RMT_TRAIN_DURATION_MAX)
+                    ticks = 2 * RMT_TRAIN_DURATION_MAX;
+                rmt_train_wait(train, ticks);
+            } else {
+                // A step filled late, after the pulse of the one before, still gets its idle time.
+                int32_t ticks = (train->pending > 0) ? train->pending : 1;
+                rmt_train_put(train, ticks, train->idle_level, rmt_trains.pulse_ticks, !train->idle_level);
+                train->pending -= ticks + rmt_trains.pulse_ticks;
+                train->step = false;
+            }
+            items--;
+            continue;
+        }
+        if (train->pending > 2 * RMT_TRAIN_DURATION_MAX) {
+            rmt_train_wait(train, 2 * RMT_TRAIN_DURATION_MAX);
+            items--;
+            continue;
+        }
+        if (train->state == TRAIN_ENDING) {
+            if (train->pending >= 2)
+                rmt_train_wait(train, train->pending);
+            else {
+                rmt_train_put(train, 0, train->idle_level, 0, train->idle_level); // End marker
+                train->state = TRAIN_DONE;
+            }
+            items--;
+            continue;
+        }
+        if (train->ticks == 0) {
+            uint8_t loaded = rmt_train_load(axis, train);
+            if (loaded == TRAIN_END)
+                train->state = TRAIN_ENDING;
+            else if (loaded == TRAIN_WAIT) {
+                if (train->pending >= 2 * items) {
+                    // Spread the time up to the end of the segment buffer over the rest of the items.
+                    while (items > 0) {
+                        rmt_train_wait(train, train->pending / items);
+                        items--;
+                    }
+                } else if (!starved) {
+                    // Run ahead of the segments by the shortest items. The time is made up by
+                    // the idle time of the next step.
+                    train->starved = true;
+                    while (items > 0) {
+                        rmt_train_wait(train, 2);
+                        items--;
+                    }
+                } else {
+                    // The segment buffer has run empty. The trains of all axes end here.
+                    if (train->segment < rmt_trains.end_segment)
+                        rmt_trains.end_segment = train->segment;
+                    train->state = TRAIN_ENDING;
+                }
+            }
+            continue;
+        }
+        if (train->steps == 0) {
+            train->pending += (int32_t)((uint32_t)train->ticks * train->cycles_per_tick);
+            train->ticks = 0;
+            continue;
+        }
+        // ISR ticks up to the next step of the axis
+        uint32_t ticks = (train->step_event_count - train->counter) / train->steps + 1;
+        if (ticks > train->ticks) {
+            train->counter += train->ticks * train->steps;
+            train->pending += (int32_t)((uint32_t)train->ticks * train->cycles_per_tick);
+            train->ticks = 0;
+            continue;
+        }
+        train->counter += ticks * train->steps - train->step_event_count;
+        train->pending += (int32_t)(ticks * train->cycles_per_tick);
+        train->ticks -= ticks;
+        train->step = true;
+        if (train->negative)
+            sys_position[axis]--;
+        else
+            sys_position[axis]++;
+    }
+}
+
+// Pops the segments the trains of all axes have loaded.
+static void IRAM_ATTR rmt_trains_release() {
+    uint8_t loaded = RMT_TRAIN_NO_END;
+    for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+        if (rmt_trains.axis[axis].segment < loaded)
+            loaded = rmt_trains.axis[axis].segment;
+    }
+    if (loaded == 0)
+        return;
+    segment_buffer.consume(loaded);
+    for (uint8_t axis = 0; axis < N_AXIS; axis++)
+        rmt_trains.axis[axis].segment -= loaded;
+    if (rmt_trains.end_segment != RMT_TRAIN_NO_END)
+        rmt_trains.end_segment -= loaded;
+}
+
+// Starts the trains of all axes from the oldest segment, with the direction pins set for its block.
+static void IRAM_ATTR rmt_trains_start() {
+    segment_t* segment = segment_buffer.front();
+    if (segment == NULL) {
+        st_stop_cycle(rmt_trains.pwm_rate_adjusted);
+        return;
+    }
+    rmt_trains.direction_bits = st_block_buffer[segment->st_block_index].direction_bits;
+    st.dir_outbits = rmt_trains.direction_bits ^ settings.dir_invert_mask;
+    set_direction_pins_on(st.dir_outbits);
+    rmt_trains.end_segment = RMT_TRAIN_NO_END;
+    rmt_trains.channels = 0;
+    rmt_trains.running = true;
+    for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+        rmt_train_t* train = &rmt_trains.axis[axis];
+        train->state = TRAIN_RUNNING;
+        train->mem_pos = 0;
+        train->segment = 0;
+        train->starved = false;
+        train->step = false;
+#ifdef STEP_PULSE_DELAY
+        train->pending = STEP_PULSE_DELAY * TICKS_PER_MICROSECOND; // After setting the direction pins
+#else
+        train->pending = 0;
+#endif
+        rmt_train_fill(axis, RMT_TRAIN_ITEMS);
+        rmt_trains.channels |= bit(axis);
+        RMT.conf_ch[train->channel].conf1.mem_rd_rst = 1;
+        RMT.conf_ch[train->channel].conf1.mem_rd_rst = 0;
+        if (train->channel2 != 255) {
+            RMT.conf_ch[train->channel2].conf1.mem_rd_rst = 1;
+            RMT.conf_ch[train->channel2].conf1.mem_rd_rst = 0;
+        }
+    }
+    rmt_trains_release();
+    for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+        RMT.conf_ch[rmt_trains.axis[axis].channel].conf1.tx_start = 1;
+        if (rmt_trains.axis[axis].channel2 != 255)
+            RMT.conf_ch[rmt_trains.axis[axis].channel2].conf1.tx_start = 1;
+    }
+}
+
+// RMT interrupt. Refills the trains that have sent half of their memory block and starts the next
+// trains when all have ended.
+static void IRAM_ATTR rmt_trains_isr(void* arg) {
+    uint32_t status = RMT.int_st.val;
+    RMT.int_clr.val = status;
+    if (!rmt_trains.running)
+        return;
+    st_position_change_begin(); // The trains update sys_position as they are filled
+    for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+        uint8_t channel = rmt_trains.axis[axis].channel;
+        if (status & RMT_TX_THR_BIT(channel))
+            rmt_train_fill(axis, RMT_TRAIN_HALF);
+        if (status & RMT_TX_END_BIT(channel))
+            rmt_trains.channels &= ~bit(axis);
+    }
+    rmt_trains_release();
+    if (rmt_trains.channels == 0) {
+        rmt_trains.running = false;
+        rmt_trains_start();
+    }
+    st_position_change_end();
+}
+
+static void rmt_trains_stop_channel(uint8_t channel) {
+    RMTMEM.chan[channel].data32[0].val = 0;
+    RMT.conf_ch[channel].conf1.tx_start = 0;
+    RMT.conf_ch[channel].conf1.mem_rd_rst = 1;
+    RMT.conf_ch[channel].conf1.mem_rd_rst = 0;
+}
+
+// Stops the trains where they are. The position has been counted up to the end of what they were
+// filled with.
+static void rmt_trains_stop() {
+    if (!rmt_trains.running)
+        return;
+    rmt_trains.running = false;
+    rmt_trains.channels = 0;
+    for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+        rmt_trains_stop_channel(rmt_trains.axis[axis].channel);
+        if (rmt_trains.axis[axis].channel2 != 255)
+            rmt_trains_stop_channel(rmt_trains.axis[axis].channel2);
+    }
+}
+
+static void rmt_trains_reset() {
+    for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+        rmt_train_t* train = &rmt_trains.axis[axis];
+        train->block_index = 0;
+        train->ticks = 0;
+        train->step = false;
+        train->segment = 0;
+    }
+}
+
+static void rmt_trains_setup_channel(uint8_t channel, uint8_t idle_level, bool trains) {
+    RMT.conf_ch[channel].conf1.idle_out_lv = idle_level;
+    if (trains) {
+        RMT.conf_ch[channel].conf0.div_cnt = RMT_TRAIN_CLK_DIV;
+        RMT.conf_ch[channel].conf0.mem_size = 1;
+        RMT.tx_lim_ch[channel].limit = RMT_TRAIN_HALF;
+        return;
+    }
+    // The single step pulse of initRMT(), which a train has overwritten
+    rmt_item32_t item;
+    RMT.conf_ch[channel].conf0.div_cnt = 20;
+#ifdef STEP_PULSE_DELAY
+    item.duration0 = STEP_PULSE_DELAY * 4;
+#else
+    item.duration0 = 1;
+#endif
+    item.duration1 = 4 * settings.pulse_microseconds;
+    item.level0 = idle_level;
+    item.level1 = !idle_level;
+    RMTMEM.chan[channel].data32[0].val = item.val;
+    RMTMEM.chan[channel].data32[1].val = 0;
+}
+
+// Sets the channels up for the trains, or for the single pulses of the step ISR. Also takes on
+// changed step pulse and invert settings.
+static void rmt_trains_setup(bool trains) {
+    uint32_t interrupts = 0;
+    rmt_trains.pulse_ticks = settings.pulse_microseconds * TICKS_PER_MICROSECOND;
+    for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+        rmt_train_t* train = &rmt_trains.axis[axis];
+        train->idle_level = bit_istrue(settings.step_invert_mask, bit(axis)) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
+        rmt_trains_setup_channel(train->channel, train->idle_level, trains);
+        if (train->channel2 != 255)
+            rmt_trains_setup_channel(train->channel2, train->idle_level, trains);
+        interrupts |= RMT_TX_END_BIT(train->channel) | RMT_TX_THR_BIT(train->channel);
+    }
+    RMT.apb_conf.mem_tx_wrap_en = trains;
+    RMT.int_clr.val = interrupts;
+    if (trains)
+        RMT.int_ena.val |= interrupts;
+    else
+        RMT.int_ena.val &= ~interrupts;
+    rmt_trains.trains = trains;
+}
+
+static void rmt_trains_init() {
+    memset(&rmt_trains, 0, sizeof(rmt_trains));
+    rmt_trains.axis[X_AXIS].channel = X_rmt_chan_num;
+    rmt_trains.axis[X_AXIS].channel2 = X2_rmt_chan_num;
+    rmt_trains.axis[Y_AXIS].channel = Y_rmt_chan_num;
+    rmt_trains.axis[Y_AXIS].channel2 = Y2_rmt_chan_num;
+    rmt_trains.axis[Z_AXIS].channel = Z_rmt_chan_num;
+    rmt_trains.axis[Z_AXIS].channel2 = Z2_rmt_chan_num;
+#if (N_AXIS > A_AXIS)
+    rmt_trains.axis[A_AXIS].channel = A_rmt_chan_num;
+    rmt_trains.axis[A_AXIS].channel2 = A2_rmt_chan_num;
+#endif
+#if (N_AXIS > B_AXIS)
+    rmt_trains.axis[B_AXIS].channel = B_rmt_chan_num;
+    rmt_trains.axis[B_AXIS].channel2 = B2_rmt_chan_num;
+#endif
+#if (N_AXIS > C_AXIS)
+    rmt_trains.axis[C_AXIS].channel = C_rmt_chan_num;
+    rmt_trains.axis[C_AXIS].channel2 = C2_rmt_chan_num;
+#endif
+    rmt_trains.usable = true;
+    for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+        if (rmt_trains.axis[axis].channel >= RMT_CHANNEL_MAX)
+            rmt_trains.usable = false;
+    }
+    if (!rmt_trains.usable) {
+        grbl_msg_sendf(CLIENT_SERIAL, MSG_LEVEL_INFO, "RMT step trains need a channel per axis");
+        return;
+    }
+    // Not ESP_INTR_FLAG_IRAM, as the step timer: a refill can reach the spindle and st_go_idle(),
+    // which run from flash
+    rmt_isr_register(rmt_trains_isr, NULL, 0, NULL);
+    grbl_msg_sendf(CLIENT_SERIAL, MSG_LEVEL_INFO, "RMT Step Trains");
 }
+#endif
 
 #ifdef USE_RMT_STEPS
 void initRMT() {
@@ -532,7 +1120,7 @@ void initRMT() {
     X_rmt_chan_num = sys_get_next_RMT_chan_num();
     rmt_set_source_clk((rmt_channel_t)X_rmt_chan_num, RMT_BASECLK_APB);
     rmtConfig.channel = (rmt_channel_t)X_rmt_chan_num;
-    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, X_AXIS) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
+    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, bit(X_AXIS)) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
     rmtConfig.gpio_num = X_STEP_PIN;
     rmtItem[0].level0 = rmtConfig.tx_config.idle_level;
     rmtItem[0].level1 = !rmtConfig.tx_config.idle_level;
@@ -543,7 +1131,7 @@ void initRMT() {
     X2_rmt_chan_num = sys_get_next_RMT_chan_num();
     rmt_set_source_clk((rmt_channel_t)X2_rmt_chan_num, RMT_BASECLK_APB);
     rmtConfig.channel = (rmt_channel_t)X2_rmt_chan_num;
-    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, X_AXIS) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
+    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, bit(X_AXIS)) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
     rmtConfig.gpio_num = X2_STEP_PIN;
     rmtItem[0].level0 = rmtConfig.tx_config.idle_level;
     rmtItem[0].level1 = !rmtConfig.tx_config.idle_level;
@@ -554,7 +1142,7 @@ void initRMT() {
     Y_rmt_chan_num = sys_get_next_RMT_chan_num();
     rmt_set_source_clk((rmt_channel_t)Y_rmt_chan_num, RMT_BASECLK_APB);
     rmtConfig.channel = (rmt_channel_t)Y_rmt_chan_num;
-    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, Y_AXIS) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
+    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, bit(Y_AXIS)) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
     rmtConfig.gpio_num = Y_STEP_PIN;
     rmtItem[0].level0 = rmtConfig.tx_config.idle_level;
     rmtItem[0].level1 = !rmtConfig.tx_config.idle_level;
@@ -565,7 +1153,7 @@ void initRMT() {
     Y2_rmt_chan_num = sys_get_next_RMT_chan_num();
     rmt_set_source_clk((rmt_channel_t)Y2_rmt_chan_num, RMT_BASECLK_APB);
     rmtConfig.channel = (rmt_channel_t)Y2_rmt_chan_num;
-    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, Y_AXIS) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
+    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, bit(Y_AXIS)) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
     rmtConfig.gpio_num = Y2_STEP_PIN;
     rmtItem[0].level0 = rmtConfig.tx_config.idle_level;
     rmtItem[0].level1 = !rmtConfig.tx_config.idle_level;
@@ -576,7 +1164,7 @@ void initRMT() {
     Z_rmt_chan_num = sys_get_next_RMT_chan_num();
     rmt_set_source_clk((rmt_channel_t)Z_rmt_chan_num, RMT_BASECLK_APB);
     rmtConfig.channel = (rmt_channel_t)Z_rmt_chan_num;
-    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, Z_AXIS) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
+    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, bit(Z_AXIS)) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
     rmtConfig.gpio_num = Z_STEP_PIN;
     rmtItem[0].level0 = rmtConfig.tx_config.idle_level;
     rmtItem[0].level1 = !rmtConfig.tx_config.idle_level;
@@ -587,7 +1175,7 @@ void initRMT() {
     Z2_rmt_chan_num = sys_get_next_RMT_chan_num();
     rmt_set_source_clk((rmt_channel_t)Z2_rmt_chan_num, RMT_BASECLK_APB);
     rmtConfig.channel = (rmt_channel_t)Z2_rmt_chan_num;
-    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, Z_AXIS) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
+    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, bit(Z_AXIS)) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
     rmtConfig.gpio_num = Z2_STEP_PIN;
     rmtItem[0].level0 = rmtConfig.tx_config.idle_level;
     rmtItem[0].level1 = !rmtConfig.tx_config.idle_level;
@@ -598,7 +1186,7 @@ void initRMT() {
     A_rmt_chan_num = sys_get_next_RMT_chan_num();
     rmt_set_source_clk((rmt_channel_t)A_rmt_chan_num, RMT_BASECLK_APB);
     rmtConfig.channel = (rmt_channel_t)A_rmt_chan_num;
-    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, A_AXIS) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
+    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, bit(A_AXIS)) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
     rmtConfig.gpio_num = A_STEP_PIN;  // TODO
     rmtItem[0].level0 = rmtConfig.tx_config.idle_level;
     rmtItem[0].level1 = !rmtConfig.tx_config.idle_level;
@@ -609,7 +1197,7 @@ void initRMT() {
     B_rmt_chan_num = sys_get_next_RMT_chan_num();
     rmt_set_source_clk((rmt_channel_t)B_rmt_chan_num, RMT_BASECLK_APB);
     rmtConfig.channel = (rmt_channel_t)B_rmt_chan_num;
-    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, B_AXIS) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
+    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, bit(B_AXIS)) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
     rmtConfig.gpio_num = B_STEP_PIN;  // TODO
     rmtItem[0].level0 = rmtConfig.tx_config.idle_level;
     rmtItem[0].level1 = !rmtConfig.tx_config.idle_level;
@@ -620,13 +1208,16 @@ void initRMT() {
     C_rmt_chan_num = sys_get_next_RMT_chan_num();
     rmt_set_source_clk((rmt_channel_t)C_rmt_chan_num, RMT_BASECLK_APB);
     rmtConfig.channel = (rmt_channel_t)C_rmt_chan_num;
-    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, C_AXIS) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
+    rmtConfig.tx_config.idle_level = bit_istrue(settings.step_invert_mask, bit(C_AXIS)) ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
     rmtConfig.gpio_num = C_STEP_PIN;  // TODO
     rmtItem[0].level0 = rmtConfig.tx_config.idle_level;
     rmtItem[0].level1 = !rmtConfig.tx_config.idle_level;
     rmt_config(&rmtConfig);
     rmt_fill_tx_items(rmtConfig.channel, &rmtItem[0], rmtConfig.mem_block_num, 0);
 #endif
+#ifdef USE_RMT_STEP_TRAINS
+    rmt_trains_init();
+#endif
 }
 #endif
 
@@ -638,14 +1229,45 @@ void st_wake_up() {
     // Enable stepper drivers.
     set_stepper_disable(false);
     stepper_idle = false;
+#ifdef USE_I2S_STEPS
+    if (i2s_steps.running)
+        return; // The stream picks up the new segments
+    st.step_outbits = 0;
+    i2s_steps.pulse_samples = (settings.pulse_microseconds + I2S_OUT_SAMPLE_USEC - 1) / I2S_OUT_SAMPLE_USEC;
+    if (i2s_steps.pulse_samples == 0)
+        i2s_steps.pulse_samples = 1;
+    i2s_steps.tick_wait = 0;
+    i2s_steps.delay_left = 0;
+    i2s_steps.pulse_left = 0;
+    i2s_steps.delayed_steps = 0;
+    i2s_steps.stopping = 0;
+    i2s_steps.running = true;
+    i2s_out_start(i2s_steps_fill);
+    return;
+#endif
     // Initialize stepper output bits to ensure first ISR call does not step.
-    st.step_outbits = step_port_invert_mask;
+    st.step_outbits = 0;
     // Initialize step pulse timing from settings. Here to ensure updating after re-writing.
 #ifdef STEP_PULSE_DELAY
-    // Step pulse delay handling is not require with ESP32...the RMT function does it.
+    // The step pulse delay is timed by the RMT or the step pulse timer.
+    st.step_bits = 0;
 #else // Normal operation
     // Set step pulse time. Ad hoc computation from oscilloscope. Uses two's complement.
     st.step_pulse_time = -(((settings.pulse_microseconds - 2) * TICKS_PER_MICROSECOND) >> 3);
+#endif
+#ifdef USE_RMT_STEP_TRAINS
+    if (rmt_trains.running)
+        return; // The trains pick up the new segments
+    // Homing and probing check every step in the step ISR, so they step with single pulses.
+    bool trains = rmt_trains.usable && sys.state != STATE_HOMING && sys_probe_state != PROBE_ACTIVE;
+#ifdef USE_GANGED_AXES
+    trains = trains && ganged_mode == SQUARING_MODE_DUAL;
+#endif
+    rmt_trains_setup(trains);
+    if (trains) {
+        rmt_trains_start();
+        return;
+    }
 #endif
     // Enable Stepper Driver Interrupt
     Stepper_Timer_Start();
@@ -663,10 +1285,14 @@ void st_reset() {
     memset(&st, 0, sizeof(stepper_t));
     st.exec_segment = NULL;
     pl_block = NULL;  // Planner block pointer used by segment buffer
-    segment_buffer_tail = 0;
-    segment_buffer_head = 0; // empty = tail
-    segment_next_head = 1;
+    segment_buffer.clear();
+#ifdef INPUT_SHAPING
+    shaper_reset();
+#endif
     busy = false;
+#ifdef USE_RMT_STEP_TRAINS
+    rmt_trains_reset();
+#endif
     st_generate_step_dir_invert_masks();
     st.dir_outbits = dir_port_invert_mask; // Initialize direction bits to default.
     // TODO do we need to turn step pins off?
@@ -678,96 +1304,60 @@ void st_reset() {
 
 void set_direction_pins_on(uint8_t onMask) {
     // inverts are applied in step generation
-#ifdef X_DIRECTION_PIN
-    digitalWrite(X_DIRECTION_PIN, (onMask & (1 << X_AXIS)));
-#endif
-#ifdef X2_DIRECTION_PIN // optional ganged axis
-    digitalWrite(X2_DIRECTION_PIN, (onMask & (1 << X_AXIS)));
-#endif
-#ifdef Y_DIRECTION_PIN
-    digitalWrite(Y_DIRECTION_PIN, (onMask & (1 << Y_AXIS)));
-#endif
-#ifdef Y2_DIRECTION_PIN // optional ganged axis
-    digitalWrite(Y2_DIRECTION_PIN, (onMask & (1 << Y_AXIS)));
-#endif
-#ifdef Z_DIRECTION_PIN
-    digitalWrite(Z_DIRECTION_PIN, (onMask & (1 << Z_AXIS)));
-#endif
-#ifdef Z2_DIRECTION_PIN // optional ganged axis
-    digitalWrite(Z2_DIRECTION_PIN, (onMask & (1 << Z_AXIS)));
-#endif
-#ifdef A_DIRECTION_PIN
-    digitalWrite(A_DIRECTION_PIN, (onMask & (1 << A_AXIS)));
-#endif
-#ifdef A2_DIRECTION_PIN // optional ganged axis
-    digitalWrite(A2_DIRECTION_PIN, (onMask & (1 << A_AXIS)));
-#endif
-#ifdef B_DIRECTION_PIN
-    digitalWrite(B_DIRECTION_PIN, (onMask & (1 << B_AXIS)));
-#endif
-#ifdef B2_DIRECTION_PIN // optional ganged axis
-    digitalWrite(B2_DIRECTION_PIN, (onMask & (1 << B_AXIS)));
-#endif
-#ifdef C_DIRECTION_PIN
-    digitalWrite(C_DIRECTION_PIN, (onMask & (1 << C_AXIS)));
-#endif
-#ifdef C2_DIRECTION_PIN // optional ganged axis
-    digitalWrite(C2_DIRECTION_PIN, (onMask & (1 << C_AXIS)));
-#endif
+#ifdef USE_I2S_STEPS
+    i2s_steps.dir_sample = i2s_dir_sample(onMask);
+    if (!i2s_steps.running)
+        i2s_out_write(i2s_steps.dir_sample | i2s_steps.step_sample);
+    return;
+#endif
+    uint32_t out = 0;
+    uint32_t out1 = 0;
+    for (uint8_t idx = 0; idx < N_AXIS; idx++) {
+        if (onMask & bit(idx)) {
+            out |= dir_pin_mask[idx].out;
+            out1 |= dir_pin_mask[idx].out1;
+        }
+    }
+    GPIO.out_w1ts = out;
+    GPIO.out_w1tc = dir_pins.out & ~out;
+    if (dir_pins.out1) {
+        GPIO.out1_w1ts.val = out1;
+        GPIO.out1_w1tc.val = dir_pins.out1 & ~out1;
+    }
 }
 
-#ifndef USE_GANGED_AXES
-// basic one motor per axis
+// Sets the step pins of the axes in onMask to their step level and all other step pins to their
+// idle level. With ganged axes only the motors of the current ganged_mode are driven.
 void set_stepper_pins_on(uint8_t onMask) {
-    onMask ^= settings.step_invert_mask; // invert pins as required by invert mask
-#ifdef X_STEP_PIN
-    digitalWrite(X_STEP_PIN, (onMask & (1 << X_AXIS)));
-#endif
-#ifdef Y_STEP_PIN
-    digitalWrite(Y_STEP_PIN, (onMask & (1 << Y_AXIS)));
-#endif
-#ifdef Z_STEP_PIN
-    digitalWrite(Z_STEP_PIN, (onMask & (1 << Z_AXIS)));
-#endif
-#ifdef A_STEP_PIN
-    digitalWrite(A_STEP_PIN, (onMask & (1 << A_AXIS)));
-#endif
-}
-#else // we use ganged axes
-void set_stepper_pins_on(uint8_t onMask) {
-    onMask ^= settings.step_invert_mask; // invert pins as required by invert mask
-#ifdef X_STEP_PIN
-#ifndef X2_STEP_PIN // if not a ganged axis
-    digitalWrite(X_STEP_PIN, (onMask & (1 << X_AXIS)));
-#else // is a ganged axis
-    if ((ganged_mode == SQUARING_MODE_DUAL) || (ganged_mode == SQUARING_MODE_A))
-        digitalWrite(X_STEP_PIN, (onMask & (1 << X_AXIS)));
-    if ((ganged_mode == SQUARING_MODE_DUAL) || (ganged_mode == SQUARING_MODE_B))
-        digitalWrite(X2_STEP_PIN, (onMask & (1 << X_AXIS)));
-#endif
-#endif
-#ifdef Y_STEP_PIN
-#ifndef Y2_STEP_PIN // if not a ganged axis
-    digitalWrite(Y_STEP_PIN, (onMask & (1 << Y_AXIS)));
-#else // is a ganged axis
-    if ((ganged_mode == SQUARING_MODE_DUAL) || (ganged_mode == SQUARING_MODE_A))
-        digitalWrite(Y_STEP_PIN, (onMask & (1 << Y_AXIS)));
-    if ((ganged_mode == SQUARING_MODE_DUAL) || (ganged_mode == SQUARING_MODE_B))
-        digitalWrite(Y2_STEP_PIN, (onMask & (1 << Y_AXIS)));
-#endif
-#endif
-#ifdef Z_STEP_PIN
-#ifndef Z2_STEP_PIN // if not a ganged axis
-    digitalWrite(Z_STEP_PIN, (onMask & (1 << Z_AXIS)));
-#else // is a ganged axis
-    if ((ganged_mode == SQUARING_MODE_DUAL) || (ganged_mode == SQUARING_MODE_A))
-        digitalWrite(Z_STEP_PIN, (onMask & (1 << Z_AXIS)));
-    if ((ganged_mode == SQUARING_MODE_DUAL) || (ganged_mode == SQUARING_MODE_B))
-        digitalWrite(Z2_STEP_PIN, (onMask & (1 << Z_AXIS)));
-#endif
-#endif
+#ifdef USE_I2S_STEPS
+    i2s_steps.step_sample = i2s_step_sample(onMask);
+    if (!i2s_steps.running)
+        i2s_out_write(i2s_steps.dir_sample | i2s_steps.step_sample);
+    return;
+#endif
+#ifdef USE_GANGED_AXES
+    uint8_t mode = ganged_mode;
+#else
+    uint8_t mode = 0;
+#endif
+    uint32_t out = 0;
+    uint32_t out1 = 0;
+    for (uint8_t idx = 0; idx < N_AXIS; idx++) {
+        if (onMask & bit(idx)) {
+            out |= step_pin_mask[mode][idx].out;
+            out1 |= step_pin_mask[mode][idx].out1;
+        }
+    }
+    // invert pins as required by invert mask
+    out ^= step_invert_pins[mode].out;
+    out1 ^= step_invert_pins[mode].out1;
+    GPIO.out_w1ts = out;
+    GPIO.out_w1tc = step_pins[mode].out & ~out;
+    if (step_pins[mode].out1) {
+        GPIO.out1_w1ts.val = out1;
+        GPIO.out1_w1tc.val = step_pins[mode].out1 & ~out1;
+    }
 }
-#endif
 
 #ifdef USE_RMT_STEPS
 // Set stepper pulse output pins
@@ -850,7 +1440,18 @@ inline IRAM_ATTR static void stepperRMT_Outputs() {
 void st_go_idle() {
     // Disable Stepper Driver Interrupt. Allow Stepper Port Reset Interrupt to finish, if active.
     Stepper_Timer_Stop();
+#ifdef USE_RMT_STEP_TRAINS
+    rmt_trains_stop();
+#endif
+#ifdef USE_I2S_STEPS
+    if (i2s_steps.running) {
+        i2s_steps.running = false;
+        i2s_out_stop(i2s_steps.dir_sample | i2s_steps.step_sample);
+    }
+#endif
     busy = false;
+    // The steps of a segment cut short have been made.
+    st_commit_position();
     bool pin_state = false;
     // Set stepper driver idle state, disabled or enabled, depending on settings and circumstances.
     if (((settings.stepper_idle_lock_time != 0xff) || sys_rt_exec_alarm || sys.state == STATE_SLEEP) && sys.state != STATE_HOMING) {
@@ -865,13 +1466,28 @@ void st_go_idle() {
     set_stepper_pins_on(0);
 }
 
+// Copies sys_position, with the steps made in the segment being executed, as they were at one
+// moment. Retries when the stepper ISR changed them while they were being read. Must not be called
+// from the stepper ISR, but for probe_state_monitor(), which runs before it changes anything.
+void st_get_position(int32_t* position) {
+    uint32_t seq;
+    do {
+        seq = st_position_seq.load(std::memory_order_acquire);
+        memcpy(position, sys_position, sizeof(sys_position));
+        st_add_segment_steps(position);
+        std::atomic_thread_fence(std::memory_order_acquire); // The copy is complete before seq is read again
+    } while ((seq & 1) || seq != st_position_seq.load(std::memory_order_relaxed));
+}
+
 // Called by planner_recalculate() when the executing block is updated by the new plan.
 void st_update_plan_block_parameters() {
+    plan_lock();
     if (pl_block != NULL) { // Ignore if at start of a new block.
         prep.recalculate_flag |= PREP_FLAG_RECALCULATE;
         pl_block->entry_speed_sqr = prep.current_speed * prep.current_speed; // Update entry speed.
         pl_block = NULL; // Flag st_prep_segment() to load and check active velocity profile.
     }
+    plan_unlock();
 }
 
 #ifdef PARKING_ENABLE
@@ -883,6 +1499,9 @@ void st_parking_setup_buffer() {
         prep.last_steps_remaining = prep.steps_remaining;
         prep.last_dt_remainder = prep.dt_remainder;
         prep.last_step_per_mm = prep.step_per_mm;
+#ifdef INPUT_SHAPING
+        memcpy(prep.last_counter, prep.counter, sizeof(prep.counter));
+#endif
     }
     // Set flags to execute a parking motion
     prep.recalculate_flag |= PREP_FLAG_PARKING;
@@ -900,6 +1519,9 @@ void st_parking_restore_buffer() {
         prep.steps_remaining = prep.last_steps_remaining;
         prep.dt_remainder = prep.last_dt_remainder;
         prep.step_per_mm = prep.last_step_per_mm;
+#ifdef INPUT_SHAPING
+        memcpy(prep.counter, prep.last_counter, sizeof(prep.counter));
+#endif
         prep.recalculate_flag = (PREP_FLAG_HOLD_PARTIAL_BLOCK | PREP_FLAG_RECALCULATE);
         prep.req_mm_increment = REQ_MM_INCREMENT_SCALAR / prep.step_per_mm; // Recompute this value.
     } else
@@ -908,6 +1530,60 @@ void st_parking_restore_buffer() {
 }
 #endif
 
+static void gpio_mask_add(gpio_mask_t* mask, uint8_t pin) {
+    if (pin < 32)
+        mask->out |= bit(pin);
+    else
+        mask->out1 |= bit(pin - 32);
+}
+
+// Adds a step pin to the masks of the modes it is driven in. The second motor of a ganged axis
+// runs in SQUARING_MODE_DUAL and SQUARING_MODE_B, the first one in SQUARING_MODE_DUAL and _A.
+inline static void st_add_step_pin(uint8_t axis, uint8_t pin, bool ganged_motor) {
+    if (axis >= N_AXIS)
+        return;
+    for (uint8_t mode = 0; mode < STEP_MASK_MODES; mode++) {
+#ifdef USE_GANGED_AXES
+        if (mode == (ganged_motor ? SQUARING_MODE_A : SQUARING_MODE_B))
+            continue;
+#endif
+        gpio_mask_add(&step_pin_mask[mode][axis], pin);
+        gpio_mask_add(&step_pins[mode], pin);
+        if (bit_istrue(settings.step_invert_mask, bit(axis)))
+            gpio_mask_add(&step_invert_pins[mode], pin);
+    }
+}
+
+inline static void st_add_direction_pin(uint8_t axis, uint8_t pin) {
+    if (axis >= N_AXIS)
+        return;
+    gpio_mask_add(&dir_pin_mask[axis], pin);
+    gpio_mask_add(&dir_pins, pin);
+}
+
+#ifdef USE_I2S_STEPS
+// The same for the outputs on the I2S shift registers
+static void st_add_step_i2so(uint8_t axis, uint8_t i2so, bool ganged_motor) {
+    if (axis >= N_AXIS)
+        return;
+    for (uint8_t mode = 0; mode < STEP_MASK_MODES; mode++) {
+#ifdef USE_GANGED_AXES
+        if (mode == (ganged_motor ? SQUARING_MODE_A : SQUARING_MODE_B))
+            continue;
+#endif
+        i2s_step_mask[mode][axis] |= bit(i2so);
+        if (bit_istrue(settings.step_invert_mask, bit(axis)))
+            i2s_step_invert[mode] |= bit(i2so);
+    }
+}
+
+static void st_add_direction_i2so(uint8_t axis, uint8_t i2so) {
+    if (axis >= N_AXIS)
+        return;
+    i2s_dir_mask[axis] |= bit(i2so);
+}
+#endif
+
 // Generates the step and direction port invert masks used in the Stepper Interrupt Driver.
 void st_generate_step_dir_invert_masks() {
     /*
@@ -922,12 +1598,160 @@ void st_generate_step_dir_invert_masks() {
     // simpler with ESP32, but let's do it here for easier change management
     step_port_invert_mask = settings.step_invert_mask;
     dir_port_invert_mask = settings.dir_invert_mask;
+    // The GPIO register masks of the step and direction pins. Only the step levels are inverted
+    // here, the direction bits come with dir_invert_mask applied.
+    memset(step_pin_mask, 0, sizeof(step_pin_mask));
+    memset(step_pins, 0, sizeof(step_pins));
+    memset(step_invert_pins, 0, sizeof(step_invert_pins));
+    memset(dir_pin_mask, 0, sizeof(dir_pin_mask));
+    memset(&dir_pins, 0, sizeof(dir_pins));
+#ifdef X_STEP_PIN
+    st_add_step_pin(X_AXIS, X_STEP_PIN, false);
+#endif
+#ifdef X2_STEP_PIN // optional ganged axis
+    st_add_step_pin(X_AXIS, X2_STEP_PIN, true);
+#endif
+#ifdef Y_STEP_PIN
+    st_add_step_pin(Y_AXIS, Y_STEP_PIN, false);
+#endif
+#ifdef Y2_STEP_PIN // optional ganged axis
+    st_add_step_pin(Y_AXIS, Y2_STEP_PIN, true);
+#endif
+#ifdef Z_STEP_PIN
+    st_add_step_pin(Z_AXIS, Z_STEP_PIN, false);
+#endif
+#ifdef Z2_STEP_PIN // optional ganged axis
+    st_add_step_pin(Z_AXIS, Z2_STEP_PIN, true);
+#endif
+#ifdef A_STEP_PIN
+    st_add_step_pin(A_AXIS, A_STEP_PIN, false);
+#endif
+#ifdef B_STEP_PIN
+    st_add_step_pin(B_AXIS, B_STEP_PIN, false);
+#endif
+#ifdef C_STEP_PIN
+    st_add_step_pin(C_AXIS, C_STEP_PIN, false);
+#endif
+#ifdef X_DIRECTION_PIN
+    st_add_direction_pin(X_AXIS, X_DIRECTION_PIN);
+#endif
+#ifdef X2_DIRECTION_PIN // optional ganged axis
+    st_add_direction_pin(X_AXIS, X2_DIRECTION_PIN);
+#endif
+#ifdef Y_DIRECTION_PIN
+    st_add_direction_pin(Y_AXIS, Y_DIRECTION_PIN);
+#endif
+#ifdef Y2_DIRECTION_PIN // optional ganged axis
+    st_add_direction_pin(Y_AXIS, Y2_DIRECTION_PIN);
+#endif
+#ifdef Z_DIRECTION_PIN
+    st_add_direction_pin(Z_AXIS, Z_DIRECTION_PIN);
+#endif
+#ifdef Z2_DIRECTION_PIN // optional ganged axis
+    st_add_direction_pin(Z_AXIS, Z2_DIRECTION_PIN);
+#endif
+#ifdef A_DIRECTION_PIN
+    st_add_direction_pin(A_AXIS, A_DIRECTION_PIN);
+#endif
+#ifdef A2_DIRECTION_PIN // optional ganged axis
+    st_add_direction_pin(A_AXIS, A2_DIRECTION_PIN);
+#endif
+#ifdef B_DIRECTION_PIN
+    st_add_direction_pin(B_AXIS, B_DIRECTION_PIN);
+#endif
+#ifdef B2_DIRECTION_PIN // optional ganged axis
+    st_add_direction_pin(B_AXIS, B2_DIRECTION_PIN);
+#endif
+#ifdef C_DIRECTION_PIN
+    st_add_direction_pin(C_AXIS, C_DIRECTION_PIN);
+#endif
+#ifdef C2_DIRECTION_PIN // optional ganged axis
+    st_add_direction_pin(C_AXIS, C2_DIRECTION_PIN);
+#endif
+#ifdef USE_I2S_STEPS
+    memset(i2s_step_mask, 0, sizeof(i2s_step_mask));
+    memset(i2s_step_invert, 0, sizeof(i2s_step_invert));
+    memset(i2s_dir_mask, 0, sizeof(i2s_dir_mask));
+#ifdef X_STEP_I2SO
+    st_add_step_i2so(X_AXIS, X_STEP_I2SO, false);
+#endif
+#ifdef X2_STEP_I2SO // optional ganged axis
+    st_add_step_i2so(X_AXIS, X2_STEP_I2SO, true);
+#endif
+#ifdef Y_STEP_I2SO
+    st_add_step_i2so(Y_AXIS, Y_STEP_I2SO, false);
+#endif
+#ifdef Y2_STEP_I2SO // optional ganged axis
+    st_add_step_i2so(Y_AXIS, Y2_STEP_I2SO, true);
+#endif
+#ifdef Z_STEP_I2SO
+    st_add_step_i2so(Z_AXIS, Z_STEP_I2SO, false);
+#endif
+#ifdef Z2_STEP_I2SO // optional ganged axis
+    st_add_step_i2so(Z_AXIS, Z2_STEP_I2SO, true);
+#endif
+#ifdef A_STEP_I2SO
+    st_add_step_i2so(A_AXIS, A_STEP_I2SO, false);
+#endif
+#ifdef A2_STEP_I2SO // optional ganged axis
+    st_add_step_i2so(A_AXIS, A2_STEP_I2SO, true);
+#endif
+#ifdef B_STEP_I2SO
+    st_add_step_i2so(B_AXIS, B_STEP_I2SO, false);
+#endif
+#ifdef B2_STEP_I2SO // optional ganged axis
+    st_add_step_i2so(B_AXIS, B2_STEP_I2SO, true);
+#endif
+#ifdef C_STEP_I2SO
+    st_add_step_i2so(C_AXIS, C_STEP_I2SO, false);
+#endif
+#ifdef C2_STEP_I2SO // optional ganged axis
+    st_add_step_i2so(C_AXIS, C2_STEP_I2SO, true);
+#endif
+#ifdef X_DIRECTION_I2SO
+    st_add_direction_i2so(X_AXIS, X_DIRECTION_I2SO);
+#endif
+#ifdef X2_DIRECTION_I2SO // optional ganged axis
+    st_add_direction_i2so(X_AXIS, X2_DIRECTION_I2SO);
+#endif
+#ifdef Y_DIRECTION_I2SO
+    st_add_direction_i2so(Y_AXIS, Y_DIRECTION_I2SO);
+#endif
+#ifdef Y2_DIRECTION_I2SO // optional ganged axis
+    st_add_direction_i2so(Y_AXIS, Y2_DIRECTION_I2SO);
+#endif
+#ifdef Z_DIRECTION_I2SO
+    st_add_direction_i2so(Z_AXIS, Z_DIRECTION_I2SO);
+#endif
+#ifdef Z2_DIRECTION_I2SO // optional ganged axis
+    st_add_direction_i2so(Z_AXIS, Z2_DIRECTION_I2SO);
+#endif
+#ifdef A_DIRECTION_I2SO
+    st_add_direction_i2so(A_AXIS, A_DIRECTION_I2SO);
+#endif
+#ifdef A2_DIRECTION_I2SO // optional ganged axis
+    st_add_direction_i2so(A_AXIS, A2_DIRECTION_I2SO);
+#endif
+#ifdef B_DIRECTION_I2SO
+    st_add_direction_i2so(B_AXIS, B_DIRECTION_I2SO);
+#endif
+#ifdef B2_DIRECTION_I2SO // optional ganged axis
+    st_add_direction_i2so(B_AXIS, B2_DIRECTION_I2SO);
+#endif
+#ifdef C_DIRECTION_I2SO
+    st_add_direction_i2so(C_AXIS, C_DIRECTION_I2SO);
+#endif
+#ifdef C2_DIRECTION_I2SO // optional ganged axis
+    st_add_direction_i2so(C_AXIS, C2_DIRECTION_I2SO);
+#endif
+#endif
+    set_stepper_pins_on(0); // Step pins to their new idle level, or the first step is lost
 }
 
 // Increments the step segment buffer block data ring buffer.
 static uint8_t st_next_block_index(uint8_t block_index) {
     block_index++;
-    if (block_index == (SEGMENT_BUFFER_SIZE - 1))
+    if (block_index == SEGMENT_BUFFER_SIZE)
         return (0);
     return (block_index);
 }
@@ -942,14 +1766,241 @@ static uint8_t st_next_block_index(uint8_t block_index) {
    The number of steps "checked-out" from the planner buffer and the number of segments in
    the segment buffer is sized and computed such that no operation in the main program takes
    longer than the time it takes the stepper algorithm to empty it before refilling it.
-   Currently, the segment buffer conservatively holds roughly up to 40-50 msec of steps.
+   The segment buffer is filled with up to $37 (settings.segment_buffer_time) msec of steps.
+   Segments of a ramp last DT_SEGMENT, so the speed profile is traced closely, but cruising
+   segments last up to DT_SEGMENT_CRUISE, so the same number of segments holds more motion.
    NOTE: Computation units are in steps, millimeters, and minutes.
 */
+static void st_prep_segments();
+#ifdef INPUT_SHAPING
+static void st_shaper_fill(bool end_of_motion);
+#endif
+
+// Returns true when the segment buffer holds enough motion. At least two segments are kept, so
+// the next one is ready when the executing one completes, whatever the setting.
+static bool st_segment_buffer_filled() {
+    if (segment_buffer.full())
+        return true;
+    if (segment_buffer.available() < 2)
+        return false;
+    uint32_t buffered_usec = prep.prep_usec - segment_buffer.front()->prep_usec;
+    return buffered_usec >= (uint32_t)settings.segment_buffer_time * 1000;
+}
+
 void st_prep_buffer() {
+    st_prep_segments();
+#ifdef INPUT_SHAPING
+    // Out of motion to prep, which always ends at a stop: hand out the rest of its shaped motion.
+    if (prep.shaping && !st_segment_buffer_filled())
+        st_shaper_fill(true);
+#endif
+}
+
+// Starts a ramp of the block being prepped at the current speed, mm_remaining from the end of the block.
+static void st_ramp_start(float mm_remaining) {
+    prep.ramp_start_speed = prep.current_speed;
+    prep.ramp_start_mm = mm_remaining;
+    prep.ramp_time = 0.0;
+}
+
+// Returns the distance a jerk limited ramp of pl_block from speed to end_speed covers in its first
+// time, and the speed it has reached then in *reached.
+static float st_ramp_position(float speed, float end_speed, float time, float* reached) {
+    float sign = (end_speed < speed) ? -1.0 : 1.0;
+    float delta_speed = fabs(end_speed - speed);
+    float accel = pl_block->acceleration;
+    float jerk_time = accel / pl_block->jerk; // Time the acceleration rises and falls
+    if (delta_speed < accel * jerk_time) {    // Not reaching the full acceleration
+        jerk_time = sqrt(delta_speed / pl_block->jerk);
+        accel = pl_block->jerk * jerk_time;
+    }
+    float ramp_time = jerk_time + delta_speed / accel;
+    float jerk = sign * pl_block->jerk;
+    if (time <= jerk_time) { // Rising acceleration
+        *reached = speed + 0.5 * jerk * time * time;
+        return (time * (speed + jerk * time * time * (1.0 / 6.0)));
+    }
+    if (time <= ramp_time - jerk_time) { // Full acceleration
+        float rise_speed = speed + 0.5 * jerk * jerk_time * jerk_time;
+        float rise_mm = jerk_time * (speed + jerk * jerk_time * jerk_time * (1.0 / 6.0));
+        time -= jerk_time;
+        *reached = rise_speed + sign * accel * time;
+        return (rise_mm + time * (rise_speed + 0.5 * sign * accel * time));
+    }
+    // Falling acceleration, mirrors the rise from the end of the ramp.
+    float left = ramp_time - time;
+    *reached = end_speed - 0.5 * jerk * left * left;
+    return (0.5 * (speed + end_speed) * ramp_time - left * (end_speed - jerk * left * left * (1.0 / 6.0)));
+}
+
+// Advances the jerk limited ramp being traced to end_speed by time_var. Returns true when the ramp is
+// over, with time_var cut to what was left of it and mm_remaining set to end_mm.
+static bool st_ramp_advance(float end_speed, float end_mm, float* time_var, float* mm_remaining) {
+    float ramp_time = plan_ramp_time(pl_block, fabs(end_speed - prep.ramp_start_speed));
+    if (prep.ramp_time + *time_var < ramp_time) {
+        float speed;
+        float mm = prep.ramp_start_mm - st_ramp_position(prep.ramp_start_speed, end_speed, prep.ramp_time + *time_var, &speed);
+        if (mm > end_mm) { // Round-off can reach the end early.
+            prep.ramp_time += *time_var;
+            prep.current_speed = speed;
+            *mm_remaining = mm;
+            return false;
+        }
+    }
+    *time_var = MAX(ramp_time - prep.ramp_time, 0.0);
+    prep.current_speed = end_speed;
+    *mm_remaining = end_mm;
+    return true;
+}
+
+// Returns the speed a jerk limited deceleration from speed reaches over distance, for when it
+// cannot get down to target speed within it. Ramps down to lower speeds can be shorter, so this is
+// found by bisection rather than solved for.
+static float st_ramp_decel_speed(float speed, float target_speed, float distance) {
+    float low = target_speed, high = speed; // Too far at low, not far enough at high
+    for (uint8_t iteration = 0; iteration < 24; iteration++) {
+        float mid = 0.5 * (low + high);
+        if (plan_ramp_distance(pl_block, mid, speed) > distance)
+            low = mid;
+        else
+            high = mid;
+    }
+    return (high);
+}
+
+// Returns the peak speed of a jerk limited triangle profile, accelerating from entry_speed and
+// decelerating to exit_speed over distance, below nominal_speed.
+static float st_ramp_peak_speed(float entry_speed, float exit_speed, float nominal_speed, float distance) {
+    float low = MAX(entry_speed, exit_speed), high = nominal_speed;
+    for (uint8_t iteration = 0; iteration < 24; iteration++) {
+        float mid = 0.5 * (low + high);
+        if (plan_ramp_distance(pl_block, entry_speed, mid) + plan_ramp_distance(pl_block, exit_speed, mid) > distance)
+            high = mid;
+        else
+            low = mid;
+    }
+    return (low);
+}
+
+// Sets the step timing of a segment of n_step steps, cycles step timer ticks apart.
+static void st_segment_rate(segment_t* segment, uint32_t cycles) {
+#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+    // Compute step timing and multi-axis smoothing level.
+    // NOTE: AMASS overdrives the timer with each level, so only one prescalar is required.
+    if (cycles < AMASS_LEVEL1)
+        segment->amass_level = 0;
+    else {
+        if (cycles < AMASS_LEVEL2)
+            segment->amass_level = 1;
+        else if (cycles < AMASS_LEVEL3)
+            segment->amass_level = 2;
+        else
+            segment->amass_level = 3;
+        cycles >>= segment->amass_level;
+        segment->n_step <<= segment->amass_level;
+    }
+    if (cycles < (1UL << 16)) {
+        segment->cycles_per_tick = cycles;    // < 65536 (4.1ms @ 16MHz)
+    } else {
+        segment->cycles_per_tick = 0xffff;    // Just set the slowest speed possible.
+    }
+#else
+    // Compute step timing and timer prescalar for normal step generation.
+    if (cycles < (1UL << 16)) { // < 65536  (4.1ms @ 16MHz)
+        segment->prescaler = 1; // prescaler: 0
+        segment->cycles_per_tick = cycles;
+    } else if (cycles < (1UL << 19)) { // < 524288 (32.8ms@16MHz)
+        segment->prescaler = 2; // prescaler: 8
+        segment->cycles_per_tick = cycles >> 3;
+    } else {
+        segment->prescaler = 3; // prescaler: 64
+        if (cycles < (1UL << 22))   // < 4194304 (262ms@16MHz)
+            segment->cycles_per_tick =  cycles >> 6;
+        else   // Just set the slowest speed possible. (Around 4 step/sec.)
+            segment->cycles_per_tick = 0xffff;
+    }
+#endif
+}
+
+#ifdef INPUT_SHAPING
+// Returns the steps of each axis in a prepped segment of the block being prepped, signed by
+// direction, as the Bresenham algorithm of the stepper ISR would take them.
+static void st_segment_steps(segment_t* segment, int32_t* steps) {
+    for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+        uint32_t increment = st_prep_block->steps[axis] >> segment->amass_level;
+#else
+        uint32_t increment = st_prep_block->steps[axis];
+#endif
+        // The counter steps each time it goes over step_event_count.
+        uint64_t counter = prep.counter[axis] + (uint64_t)segment->n_step * increment;
+        uint32_t taken = (counter == 0) ? 0 : (counter - 1) / st_prep_block->step_event_count;
+        prep.counter[axis] = counter - (uint64_t)taken * st_prep_block->step_event_count;
+        steps[axis] = bit_istrue(st_prep_block->direction_bits, bit(axis)) ? -(int32_t)taken : taken;
+    }
+}
+
+// Puts the pieces of shaped motion that are ready into the segment buffer, while there is room. Each
+// gets a Bresenham block of its own, stepping its steps at a constant rate over its time.
+static void st_shaper_fill(bool end_of_motion) {
+#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
+    const uint32_t max_cycles = 0xffffUL << MAX_AMASS_LEVEL;
+#else
+    const uint32_t max_cycles = 0xffff;
+#endif
+    uint32_t ticks;
+    int32_t steps[N_AXIS];
+    while (!segment_buffer.full() && shaper_next_piece(end_of_motion, &ticks, steps)) {
+        prep.shaped_block_index = (prep.shaped_block_index + 1) & (SEGMENT_BUFFER_SIZE - 1);
+        st_block_t* block = &st_block_buffer[SEGMENT_BUFFER_SIZE + prep.shaped_block_index];
+        uint32_t n_step = 1;
+        for (uint8_t axis = 0; axis < N_AXIS; axis++) {
+            // Axes that do not step keep their direction, so the direction pins only change on reversals.
+            if (steps[axis] < 0) {
+                prep.shaped_direction_bits |= bit(axis);
+                steps[axis] = -steps[axis];
+            } else if (steps[axis] > 0)
+                prep.shaped_direction_bits &= ~bit(axis);
+            // Scaled like the planner blocks, so AMASS never divides off a step.
+            block->steps[axis] = (uint32_t)steps[axis] << MAX_AMASS_LEVEL;
+            n_step = MAX(n_step, (uint32_t)steps[axis]);
+        }
+        ticks += prep.shaped_ticks_remainder;
+        n_step = MAX(n_step, ticks / max_cycles + 1); // Slow pieces step idle ticks in between.
+        block->step_event_count = n_step << MAX_AMASS_LEVEL;
+        block->direction_bits = prep.shaped_direction_bits;
+        block->is_pwm_rate_adjusted = st_prep_block->is_pwm_rate_adjusted;
+        segment_t* segment = segment_buffer.reserve();
+        segment->st_block_index = SEGMENT_BUFFER_SIZE + prep.shaped_block_index;
+        segment->n_step = n_step;
+        st_segment_rate(segment, ticks / n_step);
+        uint32_t stepped = (uint32_t)segment->n_step * segment->cycles_per_tick;
+        prep.shaped_ticks_remainder = ticks - stepped;
+        segment->spindle_rpm = prep.current_spindle_rpm;
+        segment->prep_usec = prep.prep_usec;
+        prep.prep_usec += stepped / TICKS_PER_MICROSECOND;
+        segment_buffer.commit();
+    }
+}
+
+// Hands a prepped segment to the input shaper, and puts the shaped motion that is ready into the
+// segment buffer.
+static void st_prep_shape(segment_t* segment) {
+    int32_t steps[N_AXIS];
+    st_segment_steps(segment, steps);
+    shaper_add_motion((uint32_t)segment->n_step * segment->cycles_per_tick, steps);
+    st_shaper_fill(false);
+}
+#endif
+
+static void st_prep_segments() {
     // Block step prep buffer, while in a suspend state and there is no suspend motion to execute.
     if (bit_istrue(sys.step_control, STEP_CONTROL_END_MOTION))
         return;
-    while (segment_buffer_tail != segment_next_head) { // Check if we need to fill the buffer.
+    while (!st_segment_buffer_filled()) { // Check if we need to fill the buffer.
+        // The planner task may be adding a block on the other core. It is kept out for one segment
+        // at a time, so it can plan between segments and is never held up for a whole refill.
+        plan_lock();
         // Determine if we need to load a new planner block or if the block needs to be recomputed.
         if (pl_block == NULL) {
             // Query planner for a queued block
@@ -958,6 +2009,7 @@ void st_prep_buffer() {
             else
                 pl_block = plan_get_current_block();
             if (pl_block == NULL) {
+                plan_unlock();
                 return;    // No planner blocks. Exit.
             }
             // Check if we need to only recompute the velocity profile or load a new block.
@@ -990,6 +2042,15 @@ void st_prep_buffer() {
                 for (idx = 0; idx < N_AXIS; idx++)
                     st_prep_block->steps[idx] = pl_block->steps[idx] << MAX_AMASS_LEVEL;
                 st_prep_block->step_event_count = pl_block->step_event_count << MAX_AMASS_LEVEL;
+#endif
+#ifdef INPUT_SHAPING
+                // Shaping is switched on and off between motions, when the shaper has handed out all.
+                if (shaper_idle())
+                    prep.shaping = (sys.state != STATE_HOMING) && shaper_setup();
+                if (prep.shaping) {
+                    for (idx = 0; idx < N_AXIS; idx++)
+                        prep.counter[idx] = st_prep_block->step_event_count >> 1;
+                }
 #endif
                 // Initialize segment buffer data for generating the segments.
                 prep.steps_remaining = (float)pl_block->step_event_count;
@@ -1027,10 +2088,17 @@ void st_prep_buffer() {
                 // the planner block profile, enforcing a deceleration to zero speed.
                 prep.ramp_type = RAMP_DECEL;
                 // Compute decelerate distance relative to end of block.
-                float decel_dist = pl_block->millimeters - inv_2_accel * pl_block->entry_speed_sqr;
+                float decel_dist;
+                if (pl_block->jerk > 0.0)
+                    decel_dist = pl_block->millimeters - plan_ramp_distance(pl_block, 0.0, prep.current_speed);
+                else
+                    decel_dist = pl_block->millimeters - inv_2_accel * pl_block->entry_speed_sqr;
                 if (decel_dist < 0.0) {
                     // Deceleration through entire planner block. End of feed hold is not in this block.
-                    prep.exit_speed = sqrt(pl_block->entry_speed_sqr - 2 * pl_block->acceleration * pl_block->millimeters);
+                    if (pl_block->jerk > 0.0)
+                        prep.exit_speed = st_ramp_decel_speed(prep.current_speed, 0.0, pl_block->millimeters);
+                    else
+                        prep.exit_speed = sqrt(pl_block->entry_speed_sqr - 2 * pl_block->acceleration * pl_block->millimeters);
                 } else {
                     prep.mm_complete = decel_dist; // End of feed hold.
                     prep.exit_speed = 0.0;
@@ -1051,7 +2119,57 @@ void st_prep_buffer() {
                 float nominal_speed_sqr = nominal_speed * nominal_speed;
                 float intersect_distance =
                     0.5 * (pl_block->millimeters + inv_2_accel * (pl_block->entry_speed_sqr - exit_speed_sqr));
-                if (pl_block->entry_speed_sqr > nominal_speed_sqr) { // Only occurs during override reductions.
+                if (pl_block->jerk > 0.0) {
+                    // The same profile types, with jerk limited ramps.
+                    float entry_speed = prep.current_speed;
+                    // NOTE: A ramp must cover the distance between its ends exactly. Where the plan cannot
+                    // be kept, the exit speed is raised instead and the next block loaded as a deceleration
+                    // override.
+                    if (entry_speed > nominal_speed) { // Only occurs during override reductions.
+                        float override_mm = plan_ramp_distance(pl_block, nominal_speed, entry_speed);
+                        prep.decelerate_after = plan_ramp_distance(pl_block, prep.exit_speed, nominal_speed);
+                        if (override_mm + prep.decelerate_after < pl_block->millimeters) {
+                            // Decelerate to cruise or cruise-decelerate types.
+                            prep.accelerate_until = pl_block->millimeters - override_mm;
+                            prep.maximum_speed = nominal_speed;
+                            prep.ramp_type = RAMP_DECEL_OVERRIDE;
+                        } else if (plan_ramp_distance(pl_block, prep.exit_speed, entry_speed) < pl_block->millimeters) {
+                            // No room to slow down to the nominal speed first. Cruise-deceleration type.
+                            prep.decelerate_after = plan_ramp_distance(pl_block, prep.exit_speed, entry_speed);
+                            prep.maximum_speed = entry_speed;
+                            prep.ramp_type = RAMP_CRUISE;
+                        } else { // Deceleration-only.
+                            prep.ramp_type = RAMP_DECEL;
+                            prep.exit_speed = st_ramp_decel_speed(entry_speed, prep.exit_speed, pl_block->millimeters);
+                            prep.recalculate_flag |= PREP_FLAG_DECEL_OVERRIDE; // Flag to load next block as deceleration override.
+                        }
+                    } else {
+                        float accel_mm = plan_ramp_distance(pl_block, entry_speed, nominal_speed);
+                        prep.decelerate_after = plan_ramp_distance(pl_block, prep.exit_speed, nominal_speed);
+                        if (accel_mm + prep.decelerate_after < pl_block->millimeters) { // Trapezoid type
+                            prep.maximum_speed = nominal_speed;
+                            prep.accelerate_until -= accel_mm;
+                            if (entry_speed == nominal_speed)
+                                prep.ramp_type = RAMP_CRUISE;
+                        } else if (entry_speed >= prep.exit_speed &&
+                                   plan_ramp_distance(pl_block, prep.exit_speed, entry_speed) >= pl_block->millimeters) {
+                            prep.ramp_type = RAMP_DECEL; // Deceleration-only type
+                            float exit_speed = st_ramp_decel_speed(entry_speed, prep.exit_speed, pl_block->millimeters);
+                            if (exit_speed > prep.exit_speed) {
+                                prep.exit_speed = exit_speed;
+                                prep.recalculate_flag |= PREP_FLAG_DECEL_OVERRIDE;
+                            }
+                        } else if (entry_speed < prep.exit_speed &&
+                                   plan_ramp_distance(pl_block, entry_speed, prep.exit_speed) >= pl_block->millimeters) {
+                            prep.accelerate_until = 0.0; // Acceleration-only type
+                            prep.maximum_speed = prep.exit_speed;
+                        } else { // Triangle type
+                            prep.maximum_speed = st_ramp_peak_speed(entry_speed, prep.exit_speed, nominal_speed, pl_block->millimeters);
+                            prep.decelerate_after = plan_ramp_distance(pl_block, prep.exit_speed, prep.maximum_speed);
+                            prep.accelerate_until = prep.decelerate_after;
+                        }
+                    }
+                } else if (pl_block->entry_speed_sqr > nominal_speed_sqr) { // Only occurs during override reductions.
                     prep.accelerate_until = pl_block->millimeters - inv_2_accel * (pl_block->entry_speed_sqr - nominal_speed_sqr);
                     if (prep.accelerate_until <= 0.0) { // Deceleration-only.
                         prep.ramp_type = RAMP_DECEL;
@@ -1099,11 +2217,17 @@ void st_prep_buffer() {
                 }
             }
 
+            st_ramp_start(pl_block->millimeters);
             bit_true(sys.step_control, STEP_CONTROL_UPDATE_SPINDLE_RPM); // Force update whenever updating block.
 
         }
         // Initialize new segment
-        segment_t* prep_segment = &segment_buffer[segment_buffer_head];
+#ifdef INPUT_SHAPING
+        static segment_t shaper_segment; // Prepped aside and handed to the input shaper
+        segment_t* prep_segment = prep.shaping ? &shaper_segment : segment_buffer.reserve();
+#else
+        segment_t* prep_segment = segment_buffer.reserve();
+#endif
         // Set new segment to point to the current segment data block.
         prep_segment->st_block_index = prep.st_block_index;
         /*------------------------------------------------------------------------------------
@@ -1120,7 +2244,9 @@ void st_prep_buffer() {
           the end of planner block (typical) or mid-block at the end of a forced deceleration,
           such as from a feed hold.
         */
-        float dt_max = DT_SEGMENT; // Maximum segment time
+        // Cruising segments can be long, ramps are traced with short ones.
+        bool long_segment = (prep.ramp_type == RAMP_CRUISE) && (DT_SEGMENT_CRUISE > DT_SEGMENT);
+        float dt_max = long_segment ? DT_SEGMENT_CRUISE : DT_SEGMENT; // Maximum segment time
         float dt = 0.0; // Initialize segment time
         float time_var = dt_max; // Time worker variable
         float mm_var; // mm-Distance worker variable
@@ -1132,6 +2258,11 @@ void st_prep_buffer() {
         do {
             switch (prep.ramp_type) {
             case RAMP_DECEL_OVERRIDE:
+                if (pl_block->jerk > 0.0) {
+                    if (st_ramp_advance(prep.maximum_speed, prep.accelerate_until, &time_var, &mm_remaining))
+                        prep.ramp_type = RAMP_CRUISE;
+                    break;
+                }
                 speed_var = pl_block->acceleration * time_var;
                 mm_var = time_var * (prep.current_speed - 0.5 * speed_var);
                 mm_remaining -= mm_var;
@@ -1145,6 +2276,16 @@ void st_prep_buffer() {
                     prep.current_speed -= speed_var;
                 break;
             case RAMP_ACCEL:
+                if (pl_block->jerk > 0.0) {
+                    if (st_ramp_advance(prep.maximum_speed, prep.accelerate_until, &time_var, &mm_remaining)) {
+                        if (mm_remaining == prep.decelerate_after) {
+                            prep.ramp_type = RAMP_DECEL;
+                            st_ramp_start(mm_remaining);
+                        } else
+                            prep.ramp_type = RAMP_CRUISE;
+                    }
+                    break;
+                }
                 // NOTE: Acceleration ramp only computes during first do-while loop.
                 speed_var = pl_block->acceleration * time_var;
                 mm_remaining -= time_var * (prep.current_speed + 0.5 * speed_var);
@@ -1170,10 +2311,15 @@ void st_prep_buffer() {
                     time_var = (mm_remaining - prep.decelerate_after) / prep.maximum_speed;
                     mm_remaining = prep.decelerate_after; // NOTE: 0.0 at EOB
                     prep.ramp_type = RAMP_DECEL;
+                    st_ramp_start(mm_remaining);
                 } else   // Cruising only.
                     mm_remaining = mm_var;
                 break;
             default: // case RAMP_DECEL:
+                if (pl_block->jerk > 0.0) {
+                    st_ramp_advance(prep.exit_speed, prep.mm_complete, &time_var, &mm_remaining);
+                    break;
+                }
                 // NOTE: mm_var used as a misc worker variable to prevent errors when near zero speed.
                 speed_var = pl_block->acceleration * time_var; // Used as delta speed (mm/min)
                 if (prep.current_speed > speed_var) { // Check if at or below zero speed.
@@ -1191,6 +2337,11 @@ void st_prep_buffer() {
                 prep.current_speed = prep.exit_speed;
             }
             dt += time_var; // Add computed ramp time to total segment time.
+            if (long_segment && prep.ramp_type != RAMP_CRUISE) {
+                // The cruise ended within a long segment. Trace the ramp that follows with short ones.
+                long_segment = false;
+                dt_max = (dt < DT_SEGMENT) ? DT_SEGMENT : dt;
+            }
             if (dt < dt_max) {
                 time_var = dt_max - dt;    // **Incomplete** At ramp junction.
             } else {
@@ -1254,6 +2405,7 @@ void st_prep_buffer() {
                 if (!(prep.recalculate_flag & PREP_FLAG_PARKING))
                     prep.recalculate_flag |= PREP_FLAG_HOLD_PARTIAL_BLOCK;
 #endif
+                plan_unlock();
                 return; // Segment not generated, but current step data still retained.
             }
         }
@@ -1269,46 +2421,18 @@ void st_prep_buffer() {
         float inv_rate = dt / (last_n_steps_remaining - step_dist_remaining); // Compute adjusted step rate inverse
         // Compute CPU cycles per step for the prepped segment.
         uint32_t cycles = ceil((TICKS_PER_MICROSECOND * 1000000 * 60) * inv_rate); // (cycles/step)
-#ifdef ADAPTIVE_MULTI_AXIS_STEP_SMOOTHING
-        // Compute step timing and multi-axis smoothing level.
-        // NOTE: AMASS overdrives the timer with each level, so only one prescalar is required.
-        if (cycles < AMASS_LEVEL1)
-            prep_segment->amass_level = 0;
-        else {
-            if (cycles < AMASS_LEVEL2)
-                prep_segment->amass_level = 1;
-            else if (cycles < AMASS_LEVEL3)
-                prep_segment->amass_level = 2;
-            else
-                prep_segment->amass_level = 3;
-            cycles >>= prep_segment->amass_level;
-            prep_segment->n_step <<= prep_segment->amass_level;
-        }
-        if (cycles < (1UL << 16)) {
-            prep_segment->cycles_per_tick = cycles;    // < 65536 (4.1ms @ 16MHz)
-        } else {
-            prep_segment->cycles_per_tick = 0xffff;    // Just set the slowest speed possible.
-        }
-#else
-        // Compute step timing and timer prescalar for normal step generation.
-        if (cycles < (1UL << 16)) { // < 65536  (4.1ms @ 16MHz)
-            prep_segment->prescaler = 1; // prescaler: 0
-            prep_segment->cycles_per_tick = cycles;
-        } else if (cycles < (1UL << 19)) { // < 524288 (32.8ms@16MHz)
-            prep_segment->prescaler = 2; // prescaler: 8
-            prep_segment->cycles_per_tick = cycles >> 3;
-        } else {
-            prep_segment->prescaler = 3; // prescaler: 64
-            if (cycles < (1UL << 22))   // < 4194304 (262ms@16MHz)
-                prep_segment->cycles_per_tick =  cycles >> 6;
-            else   // Just set the slowest speed possible. (Around 4 step/sec.)
-                prep_segment->cycles_per_tick = 0xffff;
-        }
+        st_segment_rate(prep_segment, cycles);
+#ifdef INPUT_SHAPING
+        if (prep.shaping)
+            st_prep_shape(prep_segment);
+        else
 #endif
-        // Segment complete! Increment segment buffer indices, so stepper ISR can immediately execute it.
-        segment_buffer_head = segment_next_head;
-        if (++segment_next_head == SEGMENT_BUFFER_SIZE)
-            segment_next_head = 0;
+        {
+            prep_segment->prep_usec = prep.prep_usec;
+            prep.prep_usec += (uint32_t)(dt * (60.0 * 1000000.0));
+            // Segment complete! Increment segment buffer indices, so stepper ISR can immediately execute it.
+            segment_buffer.commit();
+        }
         // Update the appropriate planner and segment data.
         pl_block->millimeters = mm_remaining;
         prep.steps_remaining = n_steps_remaining;
@@ -1325,17 +2449,20 @@ void st_prep_buffer() {
                 if (!(prep.recalculate_flag & PREP_FLAG_PARKING))
                     prep.recalculate_flag |= PREP_FLAG_HOLD_PARTIAL_BLOCK;
 #endif
+                plan_unlock();
                 return; // Bail!
             } else { // End of planner block
                 // The planner block is complete. All steps are set to be executed in the segment buffer.
                 if (sys.step_control & STEP_CONTROL_EXECUTE_SYS_MOTION) {
                     bit_true(sys.step_control, STEP_CONTROL_END_MOTION);
+                    plan_unlock();
                     return;
                 }
                 pl_block = NULL; // Set pointer to indicate check and load next planner block.
                 plan_discard_current_block();
             }
         }
+        plan_unlock();
     }
 }
 
@@ -1343,8 +2470,8 @@ void st_prep_buffer() {
 
 // Called by realtime status reporting to fetch the current speed being executed. This value
 // however is not exactly the current speed, but the speed computed in the last step segment
-// in the segment buffer. It will always be behind by up to the number of segment blocks (-1)
-// divided by the ACCELERATION TICKS PER SECOND in seconds.
+// in the segment buffer. It will always be ahead by up to the motion in the segment buffer,
+// $37 msec.
 float st_get_realtime_rate() {
     if (sys.state & (STATE_CYCLE | STATE_HOMING | STATE_HOLD | STATE_JOG | STATE_SAFETY_DOOR))
         return prep.current_speed;
@@ -1369,8 +2496,21 @@ void IRAM_ATTR Stepper_Timer_Stop() {
     //Serial.println("ST Stop");
 #endif
     timer_pause(STEP_TIMER_GROUP, STEP_TIMER_INDEX);
+#ifndef USE_RMT_STEPS
+    timer_pause(STEP_TIMER_GROUP, STEP_PULSE_TIMER_INDEX); // st_go_idle() ends a running pulse
+#endif
 }
 
+#ifndef USE_RMT_STEPS
+// Starts the step pulse timer, which fires once after the given time.
+void IRAM_ATTR Stepper_Pulse_Timer_Start(uint32_t microseconds) {
+    timer_set_counter_value(STEP_TIMER_GROUP, STEP_PULSE_TIMER_INDEX, 0x00000000ULL);
+    timer_set_alarm_value(STEP_TIMER_GROUP, STEP_PULSE_TIMER_INDEX, (uint64_t)microseconds * TICKS_PER_MICROSECOND);
+    timer_start(STEP_TIMER_GROUP, STEP_PULSE_TIMER_INDEX);
+    TIMERG0.hw_timer[STEP_PULSE_TIMER_INDEX].config.alarm_en = TIMER_ALARM_EN;
+}
+#endif
+
 
 void set_stepper_disable(uint8_t isOn) { // isOn = true // to disable
 #ifdef USE_TRINAMIC_ENABLE
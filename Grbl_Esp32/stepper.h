@@ -26,7 +26,10 @@
 #define stepper_h
 
 #ifndef SEGMENT_BUFFER_SIZE
-    #define SEGMENT_BUFFER_SIZE 6
+    #define SEGMENT_BUFFER_SIZE 64
+#endif
+#if defined(INPUT_SHAPING) && SEGMENT_BUFFER_SIZE > 128
+    #error "INPUT_SHAPING needs twice SEGMENT_BUFFER_SIZE stepper blocks, which must be indexed by a byte"
 #endif
 
 
@@ -36,6 +39,11 @@
 
 // Some useful constants.
 #define DT_SEGMENT (1.0/(ACCELERATION_TICKS_PER_SECOND*60.0)) // min/segment
+#ifdef CRUISE_TICKS_PER_SECOND
+    #define DT_SEGMENT_CRUISE (1.0/(CRUISE_TICKS_PER_SECOND*60.0)) // min/segment
+#else
+    #define DT_SEGMENT_CRUISE DT_SEGMENT
+#endif
 #define REQ_MM_INCREMENT_SCALAR 1.25
 #define RAMP_ACCEL 0
 #define RAMP_CRUISE 1
@@ -71,6 +79,7 @@
 
 #define STEP_TIMER_GROUP TIMER_GROUP_0
 #define STEP_TIMER_INDEX TIMER_0
+#define STEP_PULSE_TIMER_INDEX TIMER_1 // Ends the step pulses, in the group of the step timer
 
 // esp32 work around for diable in main loop
 extern uint64_t stepper_idle_counter;
@@ -80,11 +89,17 @@ extern uint8_t ganged_mode;
 
 // -- Task handles for use in the notifications
 void IRAM_ATTR onSteppertimer();
-void IRAM_ATTR onStepperOffTimer();
+void IRAM_ATTR onStepperOffTimer(void* para);
 
 #ifdef USE_RMT_STEPS
     void initRMT();
 #endif
+#if defined(USE_RMT_STEP_TRAINS) && !defined(USE_RMT_STEPS)
+    #error "USE_RMT_STEP_TRAINS requires USE_RMT_STEPS"
+#endif
+#if defined(USE_I2S_STEPS) && defined(USE_RMT_STEPS)
+    #error "USE_I2S_STEPS replaces USE_RMT_STEPS, #undef USE_RMT_STEPS in the machine file"
+#endif
 
 void stepper_init();
 
@@ -100,6 +115,11 @@ void st_generate_step_dir_invert_masks();
 // Reset the stepper subsystem variables
 void st_reset();
 
+// Copies the machine position in steps, including the steps made in the segment being executed. The
+// stepper ISR only commits steps to sys_position when a segment completes or is cut short, so read it
+// through here while the steppers may be moving.
+void st_get_position(int32_t* position);
+
 // Changes the run state of the step segment buffer to execute the special parking motion.
 void st_parking_setup_buffer();
 
@@ -127,5 +147,6 @@ void set_direction_pins_on(uint8_t onMask);
 void Stepper_Timer_WritePeriod(uint64_t alarm_val);
 void Stepper_Timer_Start();
 void Stepper_Timer_Stop();
+void Stepper_Pulse_Timer_Start(uint32_t microseconds);
 
 #endif
\ No newline at end of file
@@ -202,6 +202,19 @@ uint8_t system_execute_line(char* line, uint8_t client) {
             break;
         }
         break;
+    case 'R' : // Status report push [any state] $RI= text reports, $RB= status frames, =ms, =C on change only or =0 off
+        if (line[2] == 'I' || line[2] == 'B') {
+            if (line[3] != '=')  return (STATUS_INVALID_STATEMENT);
+            helper_var = (line[2] == 'I') ? STATUS_PUSH_TEXT : STATUS_PUSH_FRAME;
+            if ((line[4] == 'C') && (line[5] == 0))
+                return (status_push_subscribe(client, helper_var, 0, true));
+            char_counter = 4;
+            if (!read_float(line, &char_counter, &value))  return (STATUS_BAD_NUMBER_FORMAT);
+            if ((line[char_counter] != 0) || (value > 0xFFFF))  return (STATUS_INVALID_STATEMENT);
+            if (value < 0.0)  return (STATUS_NEGATIVE_VALUE);
+            return (status_push_subscribe(client, helper_var, (uint16_t)value, value > 0.0));
+        }
+    // Falls through - $RST= continues into default:, it requires IDLE/ALARM.
     default :
         // Block any system command that requires the state as IDLE/ALARM. (i.e. EEPROM, homing)
         if (!(sys.state == STATE_IDLE || sys.state == STATE_ALARM))  return (STATUS_IDLE_ERROR);
@@ -293,8 +306,7 @@ uint8_t system_execute_line(char* line, uint8_t client) {
             } else { // Store startup line [IDLE Only] Prevents motion during ALARM.
                 if (sys.state != STATE_IDLE)  return (STATUS_IDLE_ERROR);  // Store only when idle.
                 helper_var = true;  // Set helper_var to flag storing method.
-                // No break. Continues into default: to read remaining command characters.
-            }
+            } // Falls through - continues into default: to read remaining command characters.
         default :  // Storing setting methods [IDLE/ALARM]
             if (!read_float(line, &char_counter, &parameter))  return (STATUS_BAD_NUMBER_FORMAT);
             if (line[char_counter++] != '=')  return (STATUS_INVALID_STATEMENT);
@@ -46,8 +46,6 @@ WiFiClient Telnet_Server::_telnetClients[MAX_TLNT_CLIENTS];
 #endif
 
 Telnet_Server::Telnet_Server() {
-    _RXbufferSize = 0;
-    _RXbufferpos = 0;
 }
 Telnet_Server::~Telnet_Server() {
     end();
@@ -58,8 +56,7 @@ bool Telnet_Server::begin() {
     bool no_error = true;
     end();
     Preferences prefs;
-    _RXbufferSize = 0;
-    _RXbufferpos = 0;;
+    _RXbuffer.clear();
     prefs.begin(NAMESPACE, true);
     int8_t penabled = prefs.getChar(TELNET_ENABLE_ENTRY, DEFAULT_TELNET_STATE);
     //Get telnet port
@@ -79,14 +76,27 @@ bool Telnet_Server::begin() {
 
 void Telnet_Server::end() {
     _setupdone = false;
-    _RXbufferSize = 0;
-    _RXbufferpos = 0;
+    _RXbuffer.clear();
     if (_telnetserver) {
         delete _telnetserver;
         _telnetserver = NULL;
     }
 }
 
+// The reports pushed to CLIENT_TELNET are for all telnet clients, so they stop with the last one
+static bool telnet_was_connected = false;
+
+static void telnet_status_push_check(WiFiClient* clients) {
+    bool connected = false;
+    for (uint8_t i = 0; i < MAX_TLNT_CLIENTS; i++) {
+        if (clients[i].connected())
+            connected = true;
+    }
+    if (telnet_was_connected && !connected)
+        status_push_stop(CLIENT_TELNET);
+    telnet_was_connected = connected;
+}
+
 void Telnet_Server::clearClients() {
     //check if there are any new clients
     if (_telnetserver->hasClient()) {
@@ -98,6 +108,7 @@ void Telnet_Server::clearClients() {
                 _telnetClientsIP[i] = IPAddress(0, 0, 0, 0);
 #endif
                 if (_telnetClients[i]) _telnetClients[i].stop();
+                telnet_status_push_check(_telnetClients); // before a new client takes the slot
                 _telnetClients[i] = _telnetserver->available();
                 break;
             }
@@ -134,6 +145,7 @@ void Telnet_Server::handle() {
     if (!_setupdone || _telnetserver == NULL)
         return;
     clearClients();
+    telnet_status_push_check(_telnetClients);
     //check clients for data
     //uint8_t c;
     for (uint8_t i = 0; i < MAX_TLNT_CLIENTS; i++) {
@@ -170,62 +182,48 @@ void Telnet_Server::handle() {
 }
 
 int Telnet_Server::peek(void) {
-    if (_RXbufferSize > 0)return _RXbuffer[_RXbufferpos];
+    uint8_t* c = _RXbuffer.front();
+    if (c != NULL)return *c;
     else return -1;
 }
 
 int Telnet_Server::available() {
-    return _RXbufferSize;
+    return _RXbuffer.available();
 }
 
 int Telnet_Server::get_rx_buffer_available() {
-    return TELNETRXBUFFERSIZE - _RXbufferSize;
+    return _RXbuffer.availableForWrite();
 }
 
 bool Telnet_Server::push(uint8_t data) {
     log_i("[TELNET]push %c", data);
-    if ((1 + _RXbufferSize) <= TELNETRXBUFFERSIZE) {
-        int current = _RXbufferpos + _RXbufferSize;
-        if (current > TELNETRXBUFFERSIZE) current = current - TELNETRXBUFFERSIZE;
-        if (current > (TELNETRXBUFFERSIZE - 1)) current = 0;
-        _RXbuffer[current] = data;
-        _RXbufferSize++;
-        log_i("[TELNET]buffer size %d", _RXbufferSize);
-        return true;
-    }
-    return false;
+    return _RXbuffer.push(data);
 }
 
+// Queues the data without the '\r' characters, all of it or nothing.
 bool Telnet_Server::push(const uint8_t* data, int data_size) {
-    if ((data_size + _RXbufferSize) <= TELNETRXBUFFERSIZE) {
-        int data_processed = 0;
-        int current = _RXbufferpos + _RXbufferSize;
-        if (current > TELNETRXBUFFERSIZE) current = current - TELNETRXBUFFERSIZE;
-        for (int i = 0; i < data_size; i++) {
-            if (current > (TELNETRXBUFFERSIZE - 1)) current = 0;
-            if (char(data[i]) != '\r') {
-                _RXbuffer[current] = data[i];
-                current ++;
-                data_processed++;
-            }
-            COMMANDS::wait(0);
-            //vTaskDelay(1 / portTICK_RATE_MS);  // Yield to other tasks
-        }
-        _RXbufferSize += data_processed;
-        return true;
+    if (data_size > (int)_RXbuffer.availableForWrite())
+        return false;
+    const uint8_t* end = data + data_size;
+    while (data < end) {
+        const uint8_t* cr = (const uint8_t*)memchr(data, '\r', end - data);
+        if (cr == NULL)
+            cr = end;
+        _RXbuffer.write(data, cr - data);
+        data = cr + 1;
     }
-    return false;
+    return true;
 }
 
 int Telnet_Server::read(void) {
-    if (_RXbufferSize > 0) {
-        int v = _RXbuffer[_RXbufferpos];
-        //log_d("[TELNET]read %c",char(v));
-        _RXbufferpos++;
-        if (_RXbufferpos > (TELNETRXBUFFERSIZE - 1))_RXbufferpos = 0;
-        _RXbufferSize--;
-        return v;
-    } else return -1;
+    uint8_t c;
+    if (_RXbuffer.pop(&c))return c;
+    else return -1;
+}
+
+// Copies out as much as is there, up to size bytes.
+size_t Telnet_Server::read(uint8_t* buffer, size_t size) {
+    return _RXbuffer.read(buffer, size);
 }
 
 #endif // Enable TELNET && ENABLE_WIFI
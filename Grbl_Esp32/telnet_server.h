@@ -26,10 +26,11 @@
 
 
 #include "config.h"
+#include "ringbuffer.h"
 class WiFiServer;
 class WiFiClient;
 
-#define TELNETRXBUFFERSIZE 1200
+#define TELNETRXBUFFERSIZE 1024 // Must be a power of two
 #define FLUSHTIMEOUT 500
 
 class Telnet_Server {
@@ -41,6 +42,7 @@ class Telnet_Server {
     void handle();
     size_t write(const uint8_t* buffer, size_t size);
     int read(void);
+    size_t read(uint8_t* buffer, size_t size);
     int peek(void);
     int available();
     int get_rx_buffer_available();
@@ -57,9 +59,7 @@ class Telnet_Server {
     static uint16_t _port;
     void clearClients();
     uint32_t _lastflush;
-    uint8_t _RXbuffer[TELNETRXBUFFERSIZE];
-    uint16_t _RXbufferSize;
-    uint16_t _RXbufferpos;
+    RingBuffer<uint8_t, TELNETRXBUFFERSIZE> _RXbuffer;
 };
 
 extern Telnet_Server telnet_server;
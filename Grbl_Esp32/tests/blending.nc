@@ -0,0 +1,445 @@
+; Zig-zag and square paths of short lines with sharp corners, to compare
+; G61 exact path with G64 blending of the corners (tests/sim, make blending).
+; The path mode is set by the file run before this one.
+G21 G90 G94 G1 F3000
+X0.5 Y3.0
+X1.0 Y0.0
+X1.5 Y3.0
+X2.0 Y0.0
+X2.5 Y3.0
+X3.0 Y0.0
+X3.5 Y3.0
+X4.0 Y0.0
+X4.5 Y3.0
+X5.0 Y0.0
+X5.5 Y3.0
+X6.0 Y0.0
+X6.5 Y3.0
+X7.0 Y0.0
+X7.5 Y3.0
+X8.0 Y0.0
+X8.5 Y3.0
+X9.0 Y0.0
+X9.5 Y3.0
+X10.0 Y0.0
+X10.5 Y3.0
+X11.0 Y0.0
+X11.5 Y3.0
+X12.0 Y0.0
+X12.5 Y3.0
+X13.0 Y0.0
+X13.5 Y3.0
+X14.0 Y0.0
+X14.5 Y3.0
+X15.0 Y0.0
+X15.5 Y3.0
+X16.0 Y0.0
+X16.5 Y3.0
+X17.0 Y0.0
+X17.5 Y3.0
+X18.0 Y0.0
+X18.5 Y3.0
+X19.0 Y0.0
+X19.5 Y3.0
+X20.0 Y0.0
+X20.5 Y3.0
+X21.0 Y0.0
+X21.5 Y3.0
+X22.0 Y0.0
+X22.5 Y3.0
+X23.0 Y0.0
+X23.5 Y3.0
+X24.0 Y0.0
+X24.5 Y3.0
+X25.0 Y0.0
+X25.5 Y3.0
+X26.0 Y0.0
+X26.5 Y3.0
+X27.0 Y0.0
+X27.5 Y3.0
+X28.0 Y0.0
+X28.5 Y3.0
+X29.0 Y0.0
+X29.5 Y3.0
+X30.0 Y0.0
+X30.5 Y3.0
+X31.0 Y0.0
+X31.5 Y3.0
+X32.0 Y0.0
+X32.5 Y3.0
+X33.0 Y0.0
+X33.5 Y3.0
+X34.0 Y0.0
+X34.5 Y3.0
+X35.0 Y0.0
+X35.5 Y3.0
+X36.0 Y0.0
+X36.5 Y3.0
+X37.0 Y0.0
+X37.5 Y3.0
+X38.0 Y0.0
+X38.5 Y3.0
+X39.0 Y0.0
+X39.5 Y3.0
+X40.0 Y0.0
+X40.5 Y3.0
+X41.0 Y0.0
+X41.5 Y3.0
+X42.0 Y0.0
+X42.5 Y3.0
+X43.0 Y0.0
+X43.5 Y3.0
+X44.0 Y0.0
+X44.5 Y3.0
+X45.0 Y0.0
+X45.5 Y3.0
+X46.0 Y0.0
+X46.5 Y3.0
+X47.0 Y0.0
+X47.5 Y3.0
+X48.0 Y0.0
+X48.5 Y3.0
+X49.0 Y0.0
+X49.5 Y3.0
+X50.0 Y0.0
+X50.5 Y3.0
+X51.0 Y0.0
+X51.5 Y3.0
+X52.0 Y0.0
+X52.5 Y3.0
+X53.0 Y0.0
+X53.5 Y3.0
+X54.0 Y0.0
+X54.5 Y3.0
+X55.0 Y0.0
+X55.5 Y3.0
+X56.0 Y0.0
+X56.5 Y3.0
+X57.0 Y0.0
+X57.5 Y3.0
+X58.0 Y0.0
+X58.5 Y3.0
+X59.0 Y0.0
+X59.5 Y3.0
+X60.0 Y0.0
+X60.5 Y3.0
+X61.0 Y0.0
+X61.5 Y3.0
+X62.0 Y0.0
+X62.5 Y3.0
+X63.0 Y0.0
+X63.5 Y3.0
+X64.0 Y0.0
+X64.5 Y3.0
+X65.0 Y0.0
+X65.5 Y3.0
+X66.0 Y0.0
+X66.5 Y3.0
+X67.0 Y0.0
+X67.5 Y3.0
+X68.0 Y0.0
+X68.5 Y3.0
+X69.0 Y0.0
+X69.5 Y3.0
+X70.0 Y0.0
+X70.5 Y3.0
+X71.0 Y0.0
+X71.5 Y3.0
+X72.0 Y0.0
+X72.5 Y3.0
+X73.0 Y0.0
+X73.5 Y3.0
+X74.0 Y0.0
+X74.5 Y3.0
+X75.0 Y0.0
+X75.5 Y3.0
+X76.0 Y0.0
+X76.5 Y3.0
+X77.0 Y0.0
+X77.5 Y3.0
+X78.0 Y0.0
+X78.5 Y3.0
+X79.0 Y0.0
+X79.5 Y3.0
+X80.0 Y0.0
+X80.5 Y3.0
+X81.0 Y0.0
+X81.5 Y3.0
+X82.0 Y0.0
+X82.5 Y3.0
+X83.0 Y0.0
+X83.5 Y3.0
+X84.0 Y0.0
+X84.5 Y3.0
+X85.0 Y0.0
+X85.5 Y3.0
+X86.0 Y0.0
+X86.5 Y3.0
+X87.0 Y0.0
+X87.5 Y3.0
+X88.0 Y0.0
+X88.5 Y3.0
+X89.0 Y0.0
+X89.5 Y3.0
+X90.0 Y0.0
+X90.5 Y3.0
+X91.0 Y0.0
+X91.5 Y3.0
+X92.0 Y0.0
+X92.5 Y3.0
+X93.0 Y0.0
+X93.5 Y3.0
+X94.0 Y0.0
+X94.5 Y3.0
+X95.0 Y0.0
+X95.5 Y3.0
+X96.0 Y0.0
+X96.5 Y3.0
+X97.0 Y0.0
+X97.5 Y3.0
+X98.0 Y0.0
+X98.5 Y3.0
+X99.0 Y0.0
+X99.5 Y3.0
+X100.0 Y0.0
+X109.0 Y4.0
+X121.00 Y4.00
+X121.00 Y16.00
+X109.00 Y16.00
+X109.00 Y4.00
+X120.92 Y4.08
+X120.92 Y15.92
+X109.08 Y15.92
+X109.08 Y4.08
+X120.84 Y4.16
+X120.84 Y15.84
+X109.16 Y15.84
+X109.16 Y4.16
+X120.76 Y4.24
+X120.76 Y15.76
+X109.24 Y15.76
+X109.24 Y4.24
+X120.68 Y4.32
+X120.68 Y15.68
+X109.32 Y15.68
+X109.32 Y4.32
+X120.60 Y4.40
+X120.60 Y15.60
+X109.40 Y15.60
+X109.40 Y4.40
+X120.52 Y4.48
+X120.52 Y15.52
+X109.48 Y15.52
+X109.48 Y4.48
+X120.44 Y4.56
+X120.44 Y15.44
+X109.56 Y15.44
+X109.56 Y4.56
+X120.36 Y4.64
+X120.36 Y15.36
+X109.64 Y15.36
+X109.64 Y4.64
+X120.28 Y4.72
+X120.28 Y15.28
+X109.72 Y15.28
+X109.72 Y4.72
+X120.20 Y4.80
+X120.20 Y15.20
+X109.80 Y15.20
+X109.80 Y4.80
+X120.12 Y4.88
+X120.12 Y15.12
+X109.88 Y15.12
+X109.88 Y4.88
+X120.04 Y4.96
+X120.04 Y15.04
+X109.96 Y15.04
+X109.96 Y4.96
+X119.96 Y5.04
+X119.96 Y14.96
+X110.04 Y14.96
+X110.04 Y5.04
+X119.88 Y5.12
+X119.88 Y14.88
+X110.12 Y14.88
+X110.12 Y5.12
+X119.80 Y5.20
+X119.80 Y14.80
+X110.20 Y14.80
+X110.20 Y5.20
+X119.72 Y5.28
+X119.72 Y14.72
+X110.28 Y14.72
+X110.28 Y5.28
+X119.64 Y5.36
+X119.64 Y14.64
+X110.36 Y14.64
+X110.36 Y5.36
+X119.56 Y5.44
+X119.56 Y14.56
+X110.44 Y14.56
+X110.44 Y5.44
+X119.48 Y5.52
+X119.48 Y14.48
+X110.52 Y14.48
+X110.52 Y5.52
+X119.40 Y5.60
+X119.40 Y14.40
+X110.60 Y14.40
+X110.60 Y5.60
+X119.32 Y5.68
+X119.32 Y14.32
+X110.68 Y14.32
+X110.68 Y5.68
+X119.24 Y5.76
+X119.24 Y14.24
+X110.76 Y14.24
+X110.76 Y5.76
+X119.16 Y5.84
+X119.16 Y14.16
+X110.84 Y14.16
+X110.84 Y5.84
+X119.08 Y5.92
+X119.08 Y14.08
+X110.92 Y14.08
+X110.92 Y5.92
+X119.00 Y6.00
+X119.00 Y14.00
+X111.00 Y14.00
+X111.00 Y6.00
+X118.92 Y6.08
+X118.92 Y13.92
+X111.08 Y13.92
+X111.08 Y6.08
+X118.84 Y6.16
+X118.84 Y13.84
+X111.16 Y13.84
+X111.16 Y6.16
+X118.76 Y6.24
+X118.76 Y13.76
+X111.24 Y13.76
+X111.24 Y6.24
+X118.68 Y6.32
+X118.68 Y13.68
+X111.32 Y13.68
+X111.32 Y6.32
+X118.60 Y6.40
+X118.60 Y13.60
+X111.40 Y13.60
+X111.40 Y6.40
+X118.52 Y6.48
+X118.52 Y13.52
+X111.48 Y13.52
+X111.48 Y6.48
+X118.44 Y6.56
+X118.44 Y13.44
+X111.56 Y13.44
+X111.56 Y6.56
+X118.36 Y6.64
+X118.36 Y13.36
+X111.64 Y13.36
+X111.64 Y6.64
+X118.28 Y6.72
+X118.28 Y13.28
+X111.72 Y13.28
+X111.72 Y6.72
+X118.20 Y6.80
+X118.20 Y13.20
+X111.80 Y13.20
+X111.80 Y6.80
+X118.12 Y6.88
+X118.12 Y13.12
+X111.88 Y13.12
+X111.88 Y6.88
+X118.04 Y6.96
+X118.04 Y13.04
+X111.96 Y13.04
+X111.96 Y6.96
+X117.96 Y7.04
+X117.96 Y12.96
+X112.04 Y12.96
+X112.04 Y7.04
+X117.88 Y7.12
+X117.88 Y12.88
+X112.12 Y12.88
+X112.12 Y7.12
+X117.80 Y7.20
+X117.80 Y12.80
+X112.20 Y12.80
+X112.20 Y7.20
+X117.72 Y7.28
+X117.72 Y12.72
+X112.28 Y12.72
+X112.28 Y7.28
+X117.64 Y7.36
+X117.64 Y12.64
+X112.36 Y12.64
+X112.36 Y7.36
+X117.56 Y7.44
+X117.56 Y12.56
+X112.44 Y12.56
+X112.44 Y7.44
+X117.48 Y7.52
+X117.48 Y12.48
+X112.52 Y12.48
+X112.52 Y7.52
+X117.40 Y7.60
+X117.40 Y12.40
+X112.60 Y12.40
+X112.60 Y7.60
+X117.32 Y7.68
+X117.32 Y12.32
+X112.68 Y12.32
+X112.68 Y7.68
+X117.24 Y7.76
+X117.24 Y12.24
+X112.76 Y12.24
+X112.76 Y7.76
+X117.16 Y7.84
+X117.16 Y12.16
+X112.84 Y12.16
+X112.84 Y7.84
+X117.08 Y7.92
+X117.08 Y12.08
+X112.92 Y12.08
+X112.92 Y7.92
+X117.00 Y8.00
+X117.00 Y12.00
+X113.00 Y12.00
+X113.00 Y8.00
+X116.92 Y8.08
+X116.92 Y11.92
+X113.08 Y11.92
+X113.08 Y8.08
+X116.84 Y8.16
+X116.84 Y11.84
+X113.16 Y11.84
+X113.16 Y8.16
+X116.76 Y8.24
+X116.76 Y11.76
+X113.24 Y11.76
+X113.24 Y8.24
+X116.68 Y8.32
+X116.68 Y11.68
+X113.32 Y11.68
+X113.32 Y8.32
+X116.60 Y8.40
+X116.60 Y11.60
+X113.40 Y11.60
+X113.40 Y8.40
+X116.52 Y8.48
+X116.52 Y11.52
+X113.48 Y11.52
+X113.48 Y8.48
+X116.44 Y8.56
+X116.44 Y11.44
+X113.56 Y11.44
+X113.56 Y8.56
+X116.36 Y8.64
+X116.36 Y11.36
+X113.64 Y11.36
+X113.64 Y8.64
+X116.28 Y8.72
+X116.28 Y11.28
+X113.72 Y11.28
+X113.72 Y8.72
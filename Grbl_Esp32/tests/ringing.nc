@@ -0,0 +1,35 @@
+; Moves of X and Y of different lengths with full stops in between, to
+; compare the ringing with and without input shaping (tests/sim, make ringing)
+G21 G90 G94 G1 F6000
+X40
+G4 P0.3
+X0
+G4 P0.3
+Y40
+G4 P0.3
+Y0
+G4 P0.3
+X10
+G4 P0.3
+X0
+G4 P0.3
+Y10
+G4 P0.3
+Y0
+G4 P0.3
+X3
+G4 P0.3
+X0
+G4 P0.3
+Y3
+G4 P0.3
+Y0
+G4 P0.3
+X30 Y20
+G4 P0.3
+X0 Y0
+G4 P0.3
+X20 Y30
+X0 Y30
+X0 Y0
+G4 P0.3
@@ -0,0 +1,44 @@
+/*
+    host_sim.h
+    Part of Grbl_ESP32
+
+    Machine definition for the host simulator in tests/sim.
+
+    A plain 3 axis machine with step and direction pins only. The pin
+    numbers are arbitrary; the simulator watches them to build the step
+    timeline. Timed (GPIO register) steps are used instead of RMT so every
+    step edge passes through the simulated GPIO layer.
+
+    Axis settings come from defaults.h and can be changed at run time
+    with $ lines in the simulated G-code file, e.g. $110=3000.
+
+    Grbl_ESP32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Grbl is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Grbl_ESP32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define MACHINE_NAME "Host Simulator"
+
+#define X_STEP_PIN              GPIO_NUM_12
+#define X_DIRECTION_PIN         GPIO_NUM_14
+#define Y_STEP_PIN              GPIO_NUM_26
+#define Y_DIRECTION_PIN         GPIO_NUM_15
+#define Z_STEP_PIN              GPIO_NUM_27
+#define Z_DIRECTION_PIN         GPIO_NUM_33
+
+#define LIMIT_MASK 0  // no limit pins
+
+#define SPINDLE_TYPE    SPINDLE_TYPE_NONE
+
+#ifdef USE_RMT_STEPS
+    #undef USE_RMT_STEPS
+#endif
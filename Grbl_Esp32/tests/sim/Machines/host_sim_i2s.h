@@ -0,0 +1,49 @@
+/*
+    host_sim_i2s.h
+    Part of Grbl_ESP32
+
+    Machine definition for the host simulator in tests/sim.
+
+    The machine of host_sim.h with its step and direction outputs on I2S
+    shift registers, see USE_I2S_STEPS in config.h. The simulated I2S sends
+    the DMA buffers against the virtual clock and drives the outputs as
+    virtual pins, so the timeline can be compared with the one of the timed
+    steps. Build it with
+
+        make MACHINE=host_sim_i2s.h
+
+    Grbl_ESP32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Grbl is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Grbl_ESP32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define MACHINE_NAME "Host Simulator, I2S steps"
+
+#ifdef USE_RMT_STEPS
+    #undef USE_RMT_STEPS
+#endif
+#define USE_I2S_STEPS
+
+#define I2S_OUT_BCK             GPIO_NUM_22
+#define I2S_OUT_WS              GPIO_NUM_17
+#define I2S_OUT_DATA            GPIO_NUM_21
+
+#define X_DIRECTION_I2SO        0
+#define X_STEP_I2SO             1
+#define Y_DIRECTION_I2SO        2
+#define Y_STEP_I2SO             3
+#define Z_DIRECTION_I2SO        4
+#define Z_STEP_I2SO             5
+
+#define LIMIT_MASK 0  // no limit pins
+
+#define SPINDLE_TYPE    SPINDLE_TYPE_NONE
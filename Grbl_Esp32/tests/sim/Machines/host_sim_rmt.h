@@ -0,0 +1,44 @@
+/*
+    host_sim_rmt.h
+    Part of Grbl_ESP32
+
+    Machine definition for the host simulator in tests/sim.
+
+    The machine of host_sim.h with its steps sent as RMT step trains, see
+    USE_RMT_STEP_TRAINS in config.h. The simulated RMT plays the trains
+    against the virtual clock and drives the step pins, so the timeline can
+    be compared with the one of the timed steps. Build it with
+
+        make MACHINE=host_sim_rmt.h
+
+    Grbl_ESP32 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Grbl is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Grbl_ESP32.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define MACHINE_NAME "Host Simulator, RMT step trains"
+
+#define X_STEP_PIN              GPIO_NUM_12
+#define X_DIRECTION_PIN         GPIO_NUM_14
+#define Y_STEP_PIN              GPIO_NUM_26
+#define Y_DIRECTION_PIN         GPIO_NUM_15
+#define Z_STEP_PIN              GPIO_NUM_27
+#define Z_DIRECTION_PIN         GPIO_NUM_33
+
+#define LIMIT_MASK 0  // no limit pins
+
+#define SPINDLE_TYPE    SPINDLE_TYPE_NONE
+
+#ifndef USE_RMT_STEPS
+    #define USE_RMT_STEPS
+#endif
+#define USE_RMT_STEP_TRAINS
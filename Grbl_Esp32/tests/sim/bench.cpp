@@ -0,0 +1,268 @@
+/*
+  bench.cpp - planner and segment preparation benchmark
+  Part of Grbl_ESP32 host simulator
+
+  Replays g-code files through the host simulator and reports the host
+  time per line spent in the g-code parser, per block in the planner and
+  in segment preparation, and per stepper ISR. Each file is run several
+  times and the fastest run counts. Files shorter than BENCH_MIN_LINES
+  lines are repeated to make up a longer job.
+
+  The results can be stored as a baseline (-u) and later checked against
+  it (-c). A check fails when any figure is more than the threshold (-t,
+  in percent) slower than its baseline.
+
+  Usage: grbl_bench [-r runs] [-t percent] [-c baseline | -u baseline] file.nc [file.nc ...]
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "simulator.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+
+#define BENCH_MAX_FILES 32
+#define BENCH_NAME_LEN 64
+#define BENCH_MIN_LINES 2000
+
+enum {
+    BENCH_PARSE = 0, // ns per g-code line
+    BENCH_PLAN,      // ns per planner block
+    BENCH_PREP,      // ns of segment preparation per planner block
+    BENCH_STEP,      // ns per stepper ISR
+    BENCH_COUNT
+};
+
+static const char* bench_labels[BENCH_COUNT] = {"parse/line", "plan/block", "prep/block", "step/isr"};
+
+typedef struct {
+    char name[BENCH_NAME_LEN];
+    double ns[BENCH_COUNT];
+} bench_entry_t;
+
+static bench_entry_t baseline[BENCH_MAX_FILES];
+static int baseline_count;
+static double baseline_calibration;
+
+static void usage() {
+    fprintf(stderr, "usage: grbl_bench [-r runs] [-t percent] [-c baseline | -u baseline] file.nc [file.nc ...]\n"
+                    "  -r runs     runs per file, the fastest counts (default 3)\n"
+                    "  -t percent  allowed slowdown against the baseline (default 25)\n"
+                    "  -c file     check the results against a baseline file\n"
+                    "  -u file     write the results as the new baseline file\n");
+}
+
+static const char* base_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static uint64_t host_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Times a fixed floating point workload, in ns. Figures are scaled by the
+// ratio of calibrations so that changes in host CPU speed, during the
+// bench or between the baseline and this machine, cancel out.
+static double calibrate() {
+    double best = 0.0;
+    for (int rep = 0; rep < 5; rep++) {
+        volatile float sink;
+        float x = 1.0f;
+        uint64_t start = host_ns();
+        for (int i = 0; i < 20000; i++)
+            x = sqrtf(x * 1.0001f + i) / (1.0f + x * 0.5f);
+        sink = x;
+        (void)sink;
+        double ns = host_ns() - start;
+        if (rep == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+static double calibration; // at the start of the bench, in ns
+
+static double per(uint64_t ns, uint32_t count) {
+    return count ? (double)ns / count : 0.0;
+}
+
+static bool bench_run(double ns[BENCH_COUNT], uint32_t* lines) {
+    sim_result_t r;
+    double scale = calibration / calibrate();
+    sim_run(&r);
+    if (!r.done)
+        return false;
+    const sim_profile_t* p = &r.profile;
+    uint32_t blocks = p->calls[SIM_PROFILE_PLAN];
+    ns[BENCH_PARSE] = scale * per(p->ns[SIM_PROFILE_PARSE], p->calls[SIM_PROFILE_PARSE]);
+    ns[BENCH_PLAN] = scale * per(p->ns[SIM_PROFILE_PLAN], blocks);
+    ns[BENCH_PREP] = scale * per(p->ns[SIM_PROFILE_PREP], blocks);
+    ns[BENCH_STEP] = scale * per(p->ns[SIM_PROFILE_STEP], r.step_isrs);
+    *lines = r.lines;
+    return true;
+}
+
+static bool bench_file(const char* path, int runs, bench_entry_t* entry) {
+    strncpy(entry->name, base_name(path), BENCH_NAME_LEN - 1);
+    entry->name[BENCH_NAME_LEN - 1] = 0;
+    sim_clear_input();
+    if (!sim_load_file(path))
+        return false;
+    for (int run = 0; run < runs; run++) {
+        double ns[BENCH_COUNT];
+        uint32_t lines;
+        if (!bench_run(ns, &lines) || lines == 0)
+            return false;
+        if (run == 0 && lines < BENCH_MIN_LINES) {
+            // Too short to time reliably. Repeat the file and start over.
+            for (uint32_t copies = lines; copies < BENCH_MIN_LINES; copies += lines) {
+                if (!sim_load_file(path))
+                    return false;
+            }
+            run--;
+            continue;
+        }
+        for (int i = 0; i < BENCH_COUNT; i++) {
+            if (run == 0 || ns[i] < entry->ns[i])
+                entry->ns[i] = ns[i];
+        }
+    }
+    return true;
+}
+
+// Baseline files hold the calibration of the machine they were made on and
+// one line per g-code file: name and the figures in the order of
+// bench_labels. Lines starting with # are comments.
+static bool read_baseline(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f) != NULL && baseline_count < BENCH_MAX_FILES) {
+        bench_entry_t* e = &baseline[baseline_count];
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+        if (sscanf(line, "calibration %lf", &baseline_calibration) == 1)
+            continue;
+        if (sscanf(line, "%63s %lf %lf %lf %lf", e->name, &e->ns[BENCH_PARSE], &e->ns[BENCH_PLAN], &e->ns[BENCH_PREP],
+                   &e->ns[BENCH_STEP]) == 1 + BENCH_COUNT)
+            baseline_count++;
+    }
+    fclose(f);
+    return true;
+}
+
+static bool write_baseline(const char* path, const bench_entry_t* entries, int count) {
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    fprintf(f, "# grbl_bench baseline, host ns per:");
+    for (int i = 0; i < BENCH_COUNT; i++)
+        fprintf(f, " %s", bench_labels[i]);
+    fprintf(f, "\n");
+    fprintf(f, "calibration %.1f\n", calibration);
+    for (int n = 0; n < count; n++) {
+        fprintf(f, "%s", entries[n].name);
+        for (int i = 0; i < BENCH_COUNT; i++)
+            fprintf(f, " %.1f", entries[n].ns[i]);
+        fprintf(f, "\n");
+    }
+    fclose(f);
+    return true;
+}
+
+static const bench_entry_t* find_baseline(const char* name) {
+    for (int n = 0; n < baseline_count; n++) {
+        if (strcmp(baseline[n].name, name) == 0)
+            return &baseline[n];
+    }
+    return NULL;
+}
+
+// Prints the figures of one file and returns the number of regressions.
+// The baseline is scaled to the speed of this machine.
+static int report_entry(const bench_entry_t* e, const bench_entry_t* base, double threshold) {
+    int regressions = 0;
+    double scale = (baseline_calibration > 0.0) ? calibration / baseline_calibration : 1.0;
+    for (int i = 0; i < BENCH_COUNT; i++) {
+        printf("%-20s %-11s %10.1f ns", e->name, bench_labels[i], e->ns[i]);
+        if (base != NULL && base->ns[i] > 0.0) {
+            double base_ns = base->ns[i] * scale;
+            double change = (e->ns[i] - base_ns) * 100.0 / base_ns;
+            bool slow = change > threshold;
+            printf("  baseline %10.1f ns  %+6.1f%%%s", base_ns, change, slow ? "  REGRESSION" : "");
+            if (slow)
+                regressions++;
+        }
+        printf("\n");
+    }
+    return regressions;
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    int runs = 3;
+    double threshold = 25.0;
+    const char* check_path = NULL;
+    const char* update_path = NULL;
+    while ((opt = getopt(argc, argv, "r:t:c:u:")) != -1) {
+        switch (opt) {
+        case 'r': runs = atoi(optarg); break;
+        case 't': threshold = atof(optarg); break;
+        case 'c': check_path = optarg; break;
+        case 'u': update_path = optarg; break;
+        default: usage(); return 1;
+        }
+    }
+    int count = argc - optind;
+    if (count <= 0 || count > BENCH_MAX_FILES || runs < 1 || (check_path && update_path)) {
+        usage();
+        return 1;
+    }
+    if (check_path != NULL && !read_baseline(check_path))
+        return 1;
+    calibration = calibrate();
+    sim_options.timeline = NULL;
+    bench_entry_t entries[BENCH_MAX_FILES];
+    int regressions = 0;
+    for (int n = 0; n < count; n++) {
+        const char* path = argv[optind + n];
+        if (!bench_file(path, runs, &entries[n])) {
+            fprintf(stderr, "%s did not run to completion\n", path);
+            return 1;
+        }
+        const bench_entry_t* base = NULL;
+        if (check_path != NULL) {
+            base = find_baseline(entries[n].name);
+            if (base == NULL)
+                fprintf(stderr, "no baseline for %s\n", entries[n].name);
+        }
+        regressions += report_entry(&entries[n], base, threshold);
+    }
+    if (update_path != NULL && !write_baseline(update_path, entries, count))
+        return 1;
+    if (regressions) {
+        printf("%d figure(s) more than %.0f%% slower than the baseline\n", regressions, threshold);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,5 @@
+$110=6000
+$111=6000
+$120=1000
+$121=1000
+G64 P0.05
@@ -0,0 +1,205 @@
+/*
+  format_check.cpp - checks the decimal formatter of print.cpp against printf
+  Part of Grbl_ESP32 host simulator
+
+  Usage: grbl_format [-n count]
+
+  format_decimal() and format_integer() replace sprintf() in the reports,
+  which must not change a byte of them. Formats count random values of
+  each kind with both, for all numbers of decimal places, and counts the
+  strings that differ: floats as the reports pass them, positions made of
+  steps, inch values computed in double, exact ties that printf rounds to
+  even, and values on the edges of the 64 bit range. Then times both on
+  positions. The exit status is 2 when any string differs.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "grbl.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FORMAT_MAX_DECIMALS 9
+#define FORMAT_SHOW_DIFFERENT 10 // Printed at most
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+// xorshift64*, the same values on every run
+static uint64_t random64() {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+// Uniform in [0, 1)
+static double random_unit() {
+    return (random64() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint32_t checked;
+static uint32_t different;
+
+static void check_decimal(double n, uint8_t decimal_places) {
+    char expected[400];
+    char got[FORMAT_DECIMAL_SIZE + 8];
+    int expected_len = snprintf(expected, sizeof(expected), "%.*f", decimal_places, n);
+    if (expected_len >= FORMAT_DECIMAL_SIZE) { // Only fits truncated, as the reports never have it
+        expected_len = FORMAT_DECIMAL_SIZE - 1;
+        expected[expected_len] = '\0';
+    }
+    memset(got, 'x', sizeof(got));
+    uint8_t len = format_decimal(got, n, decimal_places);
+    checked++;
+    bool overflow = got[FORMAT_DECIMAL_SIZE] != 'x';
+    if (len != expected_len || strcmp(got, expected) != 0 || overflow) {
+        if (different++ < FORMAT_SHOW_DIFFERENT)
+            printf("%.17g with %u decimals: \"%s\" instead of \"%s\"\n", n, decimal_places, got, expected);
+    }
+}
+
+static void check_all_decimals(double n) {
+    for (uint8_t decimal_places = 0; decimal_places <= FORMAT_MAX_DECIMALS; decimal_places++)
+        check_decimal(n, decimal_places);
+}
+
+static void check_integer(int32_t n) {
+    char expected[16];
+    char got[16];
+    int expected_len = snprintf(expected, sizeof(expected), "%d", n);
+    uint8_t len = format_integer(got, n);
+    checked++;
+    if (len != expected_len || strcmp(got, expected) != 0) {
+        if (different++ < FORMAT_SHOW_DIFFERENT)
+            printf("%d: \"%s\"\n", n, got);
+    }
+}
+
+static void report(const char* kind) {
+    static uint32_t last_checked, last_different;
+    printf("%-28s %9u checked, %u different\n", kind, checked - last_checked, different - last_different);
+    last_checked = checked;
+    last_different = different;
+}
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// ns per value of both on positions in mm, as in a status report
+static void time_positions() {
+    const int count = 200000;
+    float* values = new float[count];
+    for (int idx = 0; idx < count; idx++)
+        values[idx] = (float)((random_unit() - 0.5) * 2000.0);
+    char s[FORMAT_DECIMAL_SIZE];
+    uint32_t total = 0;
+    double start = now_ns();
+    for (int idx = 0; idx < count; idx++)
+        total += format_decimal(s, values[idx], 3);
+    double formatter = (now_ns() - start) / count;
+    start = now_ns();
+    for (int idx = 0; idx < count; idx++)
+        total += sprintf(s, "%4.3f", values[idx]);
+    double printf_ns = (now_ns() - start) / count;
+    delete[] values;
+    printf("positions: format_decimal %.1f ns, sprintf %.1f ns, %.1f times faster (%u chars)\n",
+           formatter, printf_ns, printf_ns / formatter, total);
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t count = 200000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+        case 'n': count = strtoul(optarg, NULL, 10); break;
+        default: fprintf(stderr, "usage: grbl_format [-n count]\n"); return 1;
+        }
+    }
+    // Random bit patterns of floats, as settings and positions are passed
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t bits = random64();
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        check_all_decimals(f);
+    }
+    report("float bits");
+    // Steps divided by steps per mm, in mm and inches, as report_util_axis_values() has them
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t steps = (int32_t)(random64() % 20000001) - 10000000;
+        float steps_per_mm = (float)(1.0 + random_unit() * 999.0);
+        float mm = steps / steps_per_mm;
+        check_decimal(mm, 3);
+        check_decimal(mm * (float)(1.0 / MM_PER_INCH), 4);
+        check_decimal(mm / MM_PER_INCH, 1);
+        check_decimal(mm * INCH_PER_MM, 3);
+        check_decimal(roundf(mm), 0);
+    }
+    report("positions and rates");
+    // Doubles of any magnitude up to 10^9
+    for (uint32_t i = 0; i < count; i++) {
+        double n = (random_unit() - 0.5) * pow(10.0, (int)(random64() % 16) - 6);
+        check_all_decimals(n);
+    }
+    report("doubles");
+    // k / 2^n, ties for some decimal places, which printf rounds to even
+    for (uint32_t i = 0; i < count; i++) {
+        int64_t k = (int64_t)(random64() % 2000001) - 1000000;
+        check_all_decimals(ldexp((double)k, -(int)(random64() % 24)));
+    }
+    report("binary fractions and ties");
+    const double edges[] = { 0.0, -0.0, 0.5, -0.5, 1.5, 2.5, 0.0005, -0.0005, 0.00049999, 1e-300, -4.9e-324,
+                             DBL_MIN, FLT_MIN, FLT_MAX, 4294967295.5, 4294967296.5, 9007199254740993.0,
+                             18446744073709551615.0, 18446744073709551616.0, 1e19, 1e20, 1e25, -1e25,
+                             INFINITY, -INFINITY, NAN };
+    for (double edge : edges) {
+        check_all_decimals(edge);
+        check_all_decimals(nextafter(edge, INFINITY));
+        check_all_decimals(nextafter(edge, -INFINITY));
+    }
+    for (int shift = 0; shift < 64; shift++) {
+        check_all_decimals(ldexp(1.0, shift));
+        check_all_decimals(ldexp(1.0, -shift));
+        check_all_decimals(ldexp(3.0, -shift - 1));
+    }
+    report("edges");
+    // More than 9 decimals and numbers beyond 64 bits, left to snprintf() and cut to size
+    const double huge[] = { 1.5, -0.001, 123456.789, 1e19, 1e25, -1e25, 1e300, -1e300, DBL_MAX, -DBL_MAX,
+                            INFINITY, NAN };
+    const uint8_t places[] = { 0, 3, 9, 10, 12, 20, 28, 29, 30, 31, 40, 255 };
+    for (double n : huge) {
+        for (uint8_t decimal_places : places)
+            check_decimal(n, decimal_places);
+    }
+    for (uint32_t i = 0; i < count / 100; i++) {
+        double n = (random_unit() - 0.5) * pow(10.0, (int)(random64() % 600) - 300);
+        check_decimal(n, random64() % 64);
+    }
+    report("long and truncated");
+    const int32_t integer_edges[] = { 0, 1, -1, 9, 10, -10, 99, 100, 65535, 2147483647, -2147483647 - 1 };
+    for (int32_t edge : integer_edges)
+        check_integer(edge);
+    for (uint32_t i = 0; i < count; i++) {
+        check_integer((int32_t)random64());
+        check_integer((int32_t)(random64() % 2001) - 1000);
+    }
+    report("integers");
+    time_positions();
+    printf("%u values, %u different\n", checked, different);
+    return different ? 2 : 0;
+}
@@ -0,0 +1,71 @@
+/*
+  grbl_compile.cpp - compiles g-code files into jobs on the host
+  Part of Grbl_ESP32 host simulator
+
+  Usage: grbl_compile [-o job.gjb] file.nc
+
+  Does what [ESP230] does on the SD card, for the machine the simulator is
+  built for. The job is only valid for a machine with the same number of
+  axes, and is played with [ESP220] or by grbl_sim.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "grbl.h"
+#include "simulator.h"
+#include <unistd.h>
+#include <string>
+
+static void usage() {
+    fprintf(stderr, "usage: grbl_compile [-o job.gjb] file.nc\n"
+                    "  -o file  write the job to file instead of file" JOB_FILE_EXTENSION "\n");
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    std::string job_path;
+    while ((opt = getopt(argc, argv, "o:")) != -1) {
+        switch (opt) {
+        case 'o': job_path = optarg; break;
+        default: usage(); return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        usage();
+        return 1;
+    }
+    const char* path = argv[optind];
+    if (job_path.empty()) {
+        // The name of the g-code file with the job extension, as [ESP230] does it
+        job_path = path;
+        size_t dot = job_path.rfind('.');
+        if (dot != std::string::npos && (job_path.rfind('/') == std::string::npos || dot > job_path.rfind('/')))
+            job_path.erase(dot);
+        job_path += JOB_FILE_EXTENSION;
+    }
+    FILE* out = fopen(job_path.c_str(), "wb");
+    if (out == NULL) {
+        fprintf(stderr, "cannot open %s\n", job_path.c_str());
+        return 1;
+    }
+    uint32_t line_number;
+    uint8_t status = sim_compile(path, out, &line_number);
+    if (fclose(out) != 0 && status == STATUS_OK)
+        status = STATUS_JOB_WRITE_FAILED;
+    if (status != STATUS_OK) {
+        fprintf(stderr, "%s:%u: error:%d\n", path, line_number, status);
+        remove(job_path.c_str());
+        return 2;
+    }
+    fprintf(stderr, "%s: %u lines compiled into %s\n", path, line_number, job_path.c_str());
+    return 0;
+}
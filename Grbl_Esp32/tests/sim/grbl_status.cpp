@@ -0,0 +1,110 @@
+/*
+  grbl_status.cpp - decodes the status frames in what Grbl sent
+  Part of Grbl_ESP32 host simulator
+
+  Usage: grbl_status [-u steps_per_mm[,steps_per_mm...]] [-c] [capture]
+
+  Reads everything Grbl sent on a connection, e.g. as written by
+  `grbl_sim -r`, from a file or stdin. Prints the text lines as they are
+  and each status frame rendered like a text report, after its time. With
+  -c each frame is checked against the text report right before it, which
+  is how a sender can be moved from '?' to CMD_STATUS_FRAME safely.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "status_decoder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void usage() {
+    fprintf(stderr, "usage: grbl_status [-u steps_per_mm[,steps_per_mm...]] [-c] [capture]\n"
+                    "  -u list  steps per mm of the axes, the last one is used for the rest, 100 by default\n"
+                    "  -c       check each frame against the text status report before it\n");
+}
+
+int main(int argc, char* argv[]) {
+    float steps_per_mm[STATUS_FRAME_AXES];
+    for (int idx = 0; idx < STATUS_FRAME_AXES; idx++)
+        steps_per_mm[idx] = 100.0;
+    bool check = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "u:c")) != -1) {
+        switch (opt) {
+        case 'u': {
+            char* p = optarg;
+            for (int idx = 0; idx < STATUS_FRAME_AXES; idx++) {
+                steps_per_mm[idx] = strtod(p, &p);
+                if (*p == ',')
+                    p++;
+                else {
+                    while (++idx < STATUS_FRAME_AXES)
+                        steps_per_mm[idx] = steps_per_mm[idx - 1];
+                }
+            }
+            break;
+        }
+        case 'c': check = true; break;
+        default: usage(); return 1;
+        }
+    }
+    for (int idx = 0; idx < STATUS_FRAME_AXES; idx++) {
+        if (steps_per_mm[idx] <= 0.0) {
+            usage();
+            return 1;
+        }
+    }
+    FILE* in = stdin;
+    if (optind < argc) {
+        in = fopen(argv[optind], "rb");
+        if (in == NULL) {
+            fprintf(stderr, "cannot open %s\n", argv[optind]);
+            return 1;
+        }
+    }
+    status_decoder_t decoder;
+    status_decoder_init(&decoder);
+    char status_line[sizeof(decoder.line)] = "";
+    uint32_t mismatches = 0;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        const uint8_t* data = buf;
+        int found;
+        while ((found = status_decoder_next(&decoder, &data, &n)) != STATUS_DECODER_NONE) {
+            if (found == STATUS_DECODER_LINE) {
+                printf("%s\n", decoder.line);
+                if (decoder.line[0] == '<')
+                    strcpy(status_line, decoder.line);
+                continue;
+            }
+            char text[256];
+            status_frame_format(&decoder.frame, steps_per_mm, text, sizeof(text));
+            printf("%u ms %s\n", decoder.frame.time_ms, text);
+            char why[300];
+            if (check && status_line[0] && !status_frame_matches(&decoder.frame, steps_per_mm, status_line, why, sizeof(why))) {
+                printf("  %s\n", why);
+                mismatches++;
+            }
+            status_line[0] = 0;
+        }
+    }
+    if (in != stdin)
+        fclose(in);
+    fprintf(stderr, "%u status frames, %u bad", decoder.frames, decoder.bad_frames);
+    if (check)
+        fprintf(stderr, ", %u not matching the text report", mismatches);
+    fprintf(stderr, "\n");
+    return (decoder.bad_frames == 0 && mismatches == 0) ? 0 : 2;
+}
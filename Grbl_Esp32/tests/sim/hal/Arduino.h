@@ -0,0 +1,116 @@
+/*
+  Arduino.h - host stand-in for the ESP32 Arduino core
+  Part of Grbl_ESP32 host simulator
+
+  Only the parts of the Arduino and ESP-IDF API that the motion core
+  touches are provided. Pins, timers and delays are routed to the
+  simulator's virtual clock (see sim_hal.cpp).
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+
+#include "binary.h"
+#include "WString.h"
+#include "freertos/FreeRTOS.h"
+#include "esp32-hal-gpio.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT          0x01
+#define OUTPUT         0x02
+#define PULLUP         0x04
+#define INPUT_PULLUP   0x05
+#define PULLDOWN       0x08
+#define INPUT_PULLDOWN 0x09
+
+#define bit(b) (1UL << (b))
+
+#define IRAM_ATTR
+#define NOP() sim_nop()
+
+void sim_nop();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+double ledcSetup(uint8_t chan, double freq, uint8_t bit_num);
+void ledcWrite(uint8_t chan, uint32_t duty);
+uint32_t ledcRead(uint8_t chan);
+void dacWrite(uint8_t pin, uint8_t value);
+void ledcAttachPin(uint8_t pin, uint8_t chan);
+
+int64_t esp_timer_get_time();
+
+// Everything Grbl prints ends up in sim_serial_out(), which filters the
+// "ok" responses so the simulator output stays readable.
+void sim_serial_out(const char* text, size_t len);
+
+class HardwareSerial {
+  public:
+    void begin(unsigned long baud) {}
+    int available() { return 0; }
+    int read() { return -1; }
+    void flush() {}
+    size_t write(uint8_t c) {
+        sim_serial_out((const char*)&c, 1);
+        return 1;
+    }
+    size_t write(const uint8_t* buf, size_t len) {
+        sim_serial_out((const char*)buf, len);
+        return len;
+    }
+    size_t print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int n) { return printf_out("%d", n); }
+    size_t print(unsigned int n) { return printf_out("%u", n); }
+    size_t print(long n) { return printf_out("%ld", n); }
+    size_t print(unsigned long n) { return printf_out("%lu", n); }
+    size_t print(double n, int digits = 2) { return printf_out("%.*f", digits, n); }
+    size_t println(const char* s = "") { return print(s) + print("\r\n"); }
+
+  private:
+    size_t printf_out(const char* format, ...) {
+        char buf[64];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        return print(buf);
+    }
+};
+
+extern HardwareSerial Serial;
+
+#endif
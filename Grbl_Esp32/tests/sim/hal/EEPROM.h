@@ -0,0 +1,32 @@
+/*
+  EEPROM.h - RAM backed EEPROM for the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  Starts erased on every run, so settings_init() restores the defaults
+  compiled in from defaults.h and the machine file.
+*/
+
+#ifndef sim_EEPROM_h
+#define sim_EEPROM_h
+
+#include <stdint.h>
+#include <string.h>
+
+class EEPROMClass {
+  public:
+    bool begin(size_t size) {
+        if (size > sizeof(_data))
+            return false;
+        return true;
+    }
+    uint8_t read(int address) { return _data[address]; }
+    void write(int address, uint8_t val) { _data[address] = val; }
+    bool commit() { return true; }
+
+  private:
+    uint8_t _data[4096];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
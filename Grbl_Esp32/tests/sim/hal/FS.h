@@ -0,0 +1,35 @@
+/*
+  FS.h - file system stand-in for the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  SD card jobs are not simulated; the simulator reads its G-code file
+  from the host file system instead.
+*/
+
+#ifndef sim_FS_h
+#define sim_FS_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace fs {
+    class File {
+      public:
+        operator bool() const { return false; }
+        int available() { return 0; }
+        int read() { return -1; }
+        size_t size() { return 0; }
+        size_t position() { return 0; }
+        const char* name() { return ""; }
+        void close() {}
+    };
+
+    class FS {
+      public:
+        File open(const char* path) { return File(); }
+    };
+}
+
+using fs::File;
+
+#endif
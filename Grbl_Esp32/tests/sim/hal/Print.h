@@ -0,0 +1,24 @@
+/*
+  Print.h - Arduino Print base class for the host simulator
+  Part of Grbl_ESP32 host simulator
+*/
+
+#ifndef sim_Print_h
+#define sim_Print_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--)
+            n += write(*buffer++);
+        return n;
+    }
+};
+
+#endif
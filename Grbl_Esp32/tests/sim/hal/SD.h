@@ -0,0 +1,6 @@
+/*
+  SD.h - SD card stand-in for the host simulator
+  Part of Grbl_ESP32 host simulator
+*/
+
+#include "FS.h"
@@ -0,0 +1,4 @@
+/*
+  SPI.h - SPI stand-in for the host simulator
+  Part of Grbl_ESP32 host simulator
+*/
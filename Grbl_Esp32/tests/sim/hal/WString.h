@@ -0,0 +1,21 @@
+/*
+  WString.h - Arduino String stand-in for the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  Only used to declare the [ESP...] command interfaces, which the
+  simulator does not execute.
+*/
+
+#ifndef sim_WString_h
+#define sim_WString_h
+
+#include <string>
+
+class String : public std::string {
+  public:
+    String() {}
+    String(const char* s) : std::string(s) {}
+    const char* c_str() const { return std::string::c_str(); }
+};
+
+#endif
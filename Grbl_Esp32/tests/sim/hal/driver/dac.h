@@ -0,0 +1,9 @@
+/*
+  driver/dac.h - DAC stand-in for the host simulator
+  Part of Grbl_ESP32 host simulator
+*/
+
+#ifndef sim_driver_dac_h
+#define sim_driver_dac_h
+
+#endif
@@ -0,0 +1,13 @@
+/*
+  driver/periph_ctrl.h - peripheral clock stand-in for the host simulator
+  Part of Grbl_ESP32 host simulator
+*/
+
+#ifndef sim_driver_periph_ctrl_h
+#define sim_driver_periph_ctrl_h
+
+typedef enum { PERIPH_I2S0_MODULE = 0 } periph_module_t;
+
+static inline void periph_module_enable(periph_module_t periph) {}
+
+#endif
@@ -0,0 +1,51 @@
+/*
+  driver/rmt.h - RMT stand-in for the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  The default simulator machine uses timed (GPIO register) steps. With
+  USE_RMT_STEPS the channels are played by sim_hal.cpp, see
+  soc/rmt_struct.h. Carrier and receive settings are ignored.
+*/
+
+#ifndef sim_driver_rmt_h
+#define sim_driver_rmt_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driver/timer.h"
+#include "soc/rmt_struct.h"
+#include "esp_intr_alloc.h"
+
+typedef enum { RMT_CHANNEL_0 = 0, RMT_CHANNEL_MAX = 8 } rmt_channel_t;
+typedef enum { RMT_MODE_TX = 0, RMT_MODE_RX } rmt_mode_t;
+typedef enum { RMT_BASECLK_REF = 0, RMT_BASECLK_APB } rmt_source_clk_t;
+typedef enum { RMT_CARRIER_LEVEL_LOW = 0, RMT_CARRIER_LEVEL_HIGH } rmt_carrier_level_t;
+typedef enum { RMT_IDLE_LEVEL_LOW = 0, RMT_IDLE_LEVEL_HIGH } rmt_idle_level_t;
+
+typedef struct {
+    bool loop_en;
+    uint32_t carrier_freq_hz;
+    uint8_t carrier_duty_percent;
+    rmt_carrier_level_t carrier_level;
+    bool carrier_en;
+    rmt_idle_level_t idle_level;
+    bool idle_output_en;
+} rmt_tx_config_t;
+
+typedef struct {
+    rmt_mode_t rmt_mode;
+    rmt_channel_t channel;
+    uint8_t clk_div;
+    int gpio_num;
+    uint8_t mem_block_num;
+    rmt_tx_config_t tx_config;
+} rmt_config_t;
+
+typedef void* rmt_isr_handle_t;
+
+esp_err_t rmt_config(const rmt_config_t* config);
+esp_err_t rmt_set_source_clk(rmt_channel_t channel, rmt_source_clk_t base_clk);
+esp_err_t rmt_fill_tx_items(rmt_channel_t channel, const rmt_item32_t* item, uint16_t item_num, uint16_t mem_offset);
+esp_err_t rmt_isr_register(void (*fn)(void*), void* arg, int intr_alloc_flags, rmt_isr_handle_t* handle);
+
+#endif
@@ -0,0 +1,61 @@
+/*
+  driver/timer.h - general purpose timer stand-in for the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  All four timers are modelled as alarms, auto reloading or one shot as
+  configured. Alarm values are counted in ticks of the divided timer clock
+  and drive the virtual clock in sim_hal.cpp.
+*/
+
+#ifndef sim_driver_timer_h
+#define sim_driver_timer_h
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum { TIMER_GROUP_0 = 0, TIMER_GROUP_1, TIMER_GROUP_MAX } timer_group_t;
+typedef enum { TIMER_0 = 0, TIMER_1, TIMER_MAX } timer_idx_t;
+typedef enum { TIMER_COUNT_DOWN = 0, TIMER_COUNT_UP } timer_count_dir_t;
+typedef enum { TIMER_PAUSE = 0, TIMER_START } timer_start_t;
+typedef enum { TIMER_ALARM_DIS = 0, TIMER_ALARM_EN } timer_alarm_t;
+typedef enum { TIMER_INTR_LEVEL = 0, TIMER_INTR_MAX } timer_intr_mode_t;
+typedef enum { TIMER_AUTORELOAD_DIS = 0, TIMER_AUTORELOAD_EN } timer_autoreload_t;
+
+typedef struct {
+    timer_alarm_t alarm_en;
+    timer_start_t counter_en;
+    timer_intr_mode_t intr_type;
+    timer_count_dir_t counter_dir;
+    bool auto_reload;
+    uint32_t divider;
+} timer_config_t;
+
+typedef int esp_err_t;
+typedef void* timer_isr_handle_t;
+
+esp_err_t timer_init(timer_group_t group, timer_idx_t idx, const timer_config_t* config);
+esp_err_t timer_set_counter_value(timer_group_t group, timer_idx_t idx, uint64_t value);
+esp_err_t timer_set_alarm_value(timer_group_t group, timer_idx_t idx, uint64_t value);
+esp_err_t timer_enable_intr(timer_group_t group, timer_idx_t idx);
+esp_err_t timer_isr_register(timer_group_t group, timer_idx_t idx, void (*fn)(void*), void* arg,
+                             int intr_alloc_flags, timer_isr_handle_t* handle);
+esp_err_t timer_start(timer_group_t group, timer_idx_t idx);
+esp_err_t timer_pause(timer_group_t group, timer_idx_t idx);
+
+// Register view used directly by the stepper ISR.
+typedef struct {
+    struct {
+        uint32_t t0;
+        uint32_t t1;
+    } int_clr_timers;
+    struct {
+        struct {
+            uint32_t alarm_en;
+        } config;
+    } hw_timer[TIMER_MAX];
+} timg_dev_t;
+
+extern timg_dev_t TIMERG0;
+extern timg_dev_t TIMERG1;
+
+#endif
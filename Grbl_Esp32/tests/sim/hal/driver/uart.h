@@ -0,0 +1,43 @@
+/*
+  driver/uart.h - UART stand-in for the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  Lets the RS485 spindle code compile; no bytes are ever exchanged.
+*/
+
+#ifndef sim_driver_uart_h
+#define sim_driver_uart_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+
+typedef int esp_err_t;
+typedef enum { UART_NUM_0 = 0, UART_NUM_1, UART_NUM_2, UART_NUM_MAX } uart_port_t;
+typedef enum { UART_DATA_5_BITS = 0, UART_DATA_6_BITS, UART_DATA_7_BITS, UART_DATA_8_BITS } uart_word_length_t;
+typedef enum { UART_PARITY_DISABLE = 0, UART_PARITY_EVEN = 2, UART_PARITY_ODD = 3 } uart_parity_t;
+typedef enum { UART_STOP_BITS_1 = 1, UART_STOP_BITS_1_5, UART_STOP_BITS_2 } uart_stop_bits_t;
+typedef enum { UART_HW_FLOWCTRL_DISABLE = 0 } uart_hw_flowcontrol_t;
+typedef enum { UART_MODE_UART = 0, UART_MODE_RS485_HALF_DUPLEX = 1 } uart_mode_t;
+
+#define UART_PIN_NO_CHANGE (-1)
+
+typedef struct {
+    int baud_rate;
+    uart_word_length_t data_bits;
+    uart_parity_t parity;
+    uart_stop_bits_t stop_bits;
+    uart_hw_flowcontrol_t flow_ctrl;
+    uint8_t rx_flow_ctrl_thresh;
+} uart_config_t;
+
+static inline esp_err_t uart_driver_delete(uart_port_t port) { return 0; }
+static inline esp_err_t uart_param_config(uart_port_t port, const uart_config_t* config) { return 0; }
+static inline esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts) { return 0; }
+static inline esp_err_t uart_driver_install(uart_port_t port, int rx_size, int tx_size, int queue_size,
+                                            QueueHandle_t* queue, int flags) { return 0; }
+static inline esp_err_t uart_set_mode(uart_port_t port, uart_mode_t mode) { return 0; }
+static inline int uart_write_bytes(uart_port_t port, const char* src, size_t size) { return size; }
+static inline int uart_read_bytes(uart_port_t port, uint8_t* buf, uint32_t length, TickType_t wait) { return 0; }
+
+#endif
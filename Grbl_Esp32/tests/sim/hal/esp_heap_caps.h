@@ -0,0 +1,21 @@
+/*
+  esp_heap_caps.h - heap allocation stand-in for the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  PSRAM allocations only succeed when the simulated board has PSRAM
+  (sim_options.psram).
+*/
+
+#ifndef sim_esp_heap_caps_h
+#define sim_esp_heap_caps_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT   (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+
+void* heap_caps_malloc(size_t size, uint32_t caps);
+void heap_caps_free(void* ptr);
+
+#endif
@@ -0,0 +1,23 @@
+/*
+  esp_intr_alloc.h - interrupt allocation stand-in for the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  Only the I2S interrupt can be allocated, see soc/i2s_struct.h.
+*/
+
+#ifndef sim_esp_intr_alloc_h
+#define sim_esp_intr_alloc_h
+
+#include <stdint.h>
+#include "driver/timer.h"
+
+#define ESP_INTR_FLAG_IRAM (1 << 10)
+
+#define ETS_I2S0_INTR_SOURCE 32 // from soc/soc.h
+
+typedef void (*intr_handler_t)(void* arg);
+typedef void* intr_handle_t;
+
+esp_err_t esp_intr_alloc(int source, int flags, intr_handler_t handler, void* arg, intr_handle_t* ret_handle);
+
+#endif
@@ -0,0 +1,11 @@
+/*
+  esp_task_wdt.h - task watchdog stand-in for the host simulator
+  Part of Grbl_ESP32 host simulator
+*/
+
+#ifndef sim_esp_task_wdt_h
+#define sim_esp_task_wdt_h
+
+static inline int esp_task_wdt_reset() { return 0; }
+
+#endif
@@ -0,0 +1,81 @@
+/*
+  FreeRTOS.h - single threaded FreeRTOS stand-in for the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  The simulator runs Grbl's main program and the stepper ISR on one
+  host thread, so tasks are never started, queues are always empty and
+  critical sections are no-ops. vTaskDelay() advances the virtual clock.
+*/
+
+#ifndef sim_FreeRTOS_h
+#define sim_FreeRTOS_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void* QueueHandle_t;
+typedef void* xQueueHandle;
+typedef void* SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define portTICK_RATE_MS portTICK_PERIOD_MS
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+#define portENTER_CRITICAL(mux) vTaskEnterCritical(mux)
+#define portEXIT_CRITICAL(mux) vTaskExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux) vTaskEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux) vTaskExitCritical(mux)
+
+static inline void vTaskEnterCritical(portMUX_TYPE* mux) { mux->count++; }
+static inline void vTaskExitCritical(portMUX_TYPE* mux) { mux->count--; }
+
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previous_wake, TickType_t increment);
+TickType_t xTaskGetTickCount();
+
+static inline BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* param,
+                                     UBaseType_t priority, TaskHandle_t* handle) {
+    if (handle != NULL)
+        *handle = NULL;
+    return pdPASS;
+}
+
+static inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* param,
+                                                 UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    return xTaskCreate(fn, name, stack, param, priority, handle);
+}
+
+static inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) { return 0; }
+static inline BaseType_t xTaskNotifyGive(TaskHandle_t task) { return pdPASS; }
+static inline TaskHandle_t xTaskGetCurrentTaskHandle() { return NULL; }
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex() { return NULL; }
+static inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait) { return pdTRUE; }
+static inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) { return pdTRUE; }
+static inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return NULL; }
+static inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t wait) { return pdTRUE; }
+static inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem) { return pdTRUE; }
+
+static inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) { return NULL; }
+static inline BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t wait) { return pdFAIL; }
+static inline BaseType_t xQueueSendFromISR(QueueHandle_t q, const void* item, BaseType_t* woken) { return pdFAIL; }
+static inline BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t wait) { return pdFALSE; }
+
+#endif
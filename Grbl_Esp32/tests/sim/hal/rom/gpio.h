@@ -0,0 +1,16 @@
+/*
+  rom/gpio.h - GPIO matrix stand-in for the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  The outputs of the I2S shift registers are virtual pins of their own
+  (SIM_I2S_PIN), so the I2S signals themselves are not routed anywhere.
+*/
+
+#ifndef sim_rom_gpio_h
+#define sim_rom_gpio_h
+
+#include <stdint.h>
+
+static inline void gpio_matrix_out(uint32_t gpio, uint32_t signal_idx, bool out_inv, bool oen_inv) {}
+
+#endif
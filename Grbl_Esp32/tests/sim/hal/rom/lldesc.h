@@ -0,0 +1,25 @@
+/*
+  rom/lldesc.h - DMA descriptors for the host simulator
+  Part of Grbl_ESP32 host simulator
+*/
+
+#ifndef sim_rom_lldesc_h
+#define sim_rom_lldesc_h
+
+#include <stdint.h>
+
+typedef struct lldesc_s {
+    volatile uint32_t size : 12,
+             length : 12,
+             offset : 5,
+             sosf : 1,
+             eof : 1,
+             owner : 1;
+    volatile uint8_t* buf;
+    union {
+        volatile uint32_t empty;
+        struct lldesc_s* stqe_next;
+    } qe;
+} lldesc_t;
+
+#endif
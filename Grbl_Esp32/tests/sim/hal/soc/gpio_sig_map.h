@@ -0,0 +1,13 @@
+/*
+  soc/gpio_sig_map.h - GPIO matrix signals for the host simulator
+  Part of Grbl_ESP32 host simulator
+*/
+
+#ifndef sim_soc_gpio_sig_map_h
+#define sim_soc_gpio_sig_map_h
+
+#define I2S0O_BCK_OUT_IDX 12
+#define I2S0O_WS_OUT_IDX 13
+#define I2S0O_DATA_OUT23_IDX 163
+
+#endif
@@ -0,0 +1,36 @@
+/*
+  soc/gpio_struct.h - GPIO output registers for the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  Only the write-one-to-set and write-one-to-clear output registers are
+  provided. A write drives every pin whose bit is set through the same
+  path as digitalWrite, so the simulator sees each pin change.
+*/
+
+#ifndef sim_soc_gpio_struct_h
+#define sim_soc_gpio_struct_h
+
+#include <stdint.h>
+
+void sim_gpio_write_mask(uint8_t first_pin, uint32_t mask, uint8_t level);
+
+// A write-only register driving the pins first_pin..first_pin + 31 to level
+template <uint8_t first_pin, uint8_t level>
+struct sim_gpio_reg_t {
+    void operator=(uint32_t mask) { sim_gpio_write_mask(first_pin, mask, level); }
+};
+
+typedef struct {
+    sim_gpio_reg_t<0, 1> out_w1ts;
+    sim_gpio_reg_t<0, 0> out_w1tc;
+    struct {
+        sim_gpio_reg_t<32, 1> val;
+    } out1_w1ts;
+    struct {
+        sim_gpio_reg_t<32, 0> val;
+    } out1_w1tc;
+} gpio_dev_t;
+
+extern gpio_dev_t GPIO;
+
+#endif
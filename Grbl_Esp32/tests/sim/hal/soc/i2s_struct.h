@@ -0,0 +1,95 @@
+/*
+  soc/i2s_struct.h - I2S registers for the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  Only the registers Grbl uses are provided. sim_hal.cpp sends the DMA
+  buffers of out_link from when it is started until it is stopped, one
+  32 bit sample every 64 BCK cycles, and raises the EOF interrupt after
+  each buffer. When not sending buffers, conf_single_data is sent. Each
+  bit of the samples drives a virtual pin, SIM_I2S_PIN(bit), as a chain
+  of shift registers would. The channel modes, resets and the other
+  settings are not modelled.
+*/
+
+#ifndef sim_soc_i2s_struct_h
+#define sim_soc_i2s_struct_h
+
+#include <stdint.h>
+
+void sim_i2s_write(uint8_t field, uint32_t value);
+
+enum { SIM_I2S_OUT_START = 0, SIM_I2S_OUT_STOP, SIM_I2S_SINGLE_DATA, SIM_I2S_INT_CLR };
+
+// A write-only register, or bit of one
+template <uint8_t field>
+struct sim_i2s_reg_t {
+    void operator=(uint32_t value) { sim_i2s_write(field, value); }
+};
+
+typedef union {
+    struct {
+        uint32_t reserved0 : 12;
+        uint32_t out_eof : 1;
+    };
+    uint32_t val;
+} sim_i2s_int_t;
+
+typedef struct {
+    struct {
+        uint32_t tx_reset : 1;
+        uint32_t tx_fifo_reset : 1;
+        uint32_t tx_start : 1;
+        uint32_t tx_slave_mod : 1;
+        uint32_t tx_right_first : 1;
+        uint32_t tx_msb_shift : 1;
+        uint32_t tx_short_sync : 1;
+        uint32_t tx_mono : 1;
+        uint32_t tx_msb_right : 1;
+    } conf;
+    struct {
+        uint32_t val;
+    } conf2;
+    sim_i2s_int_t int_raw, int_st, int_ena;
+    struct {
+        sim_i2s_reg_t<SIM_I2S_INT_CLR> val;
+    } int_clr;
+    struct {
+        uintptr_t addr;
+        sim_i2s_reg_t<SIM_I2S_OUT_STOP> stop;
+        sim_i2s_reg_t<SIM_I2S_OUT_START> start;
+    } out_link;
+    uintptr_t out_eof_des_addr;
+    struct {
+        uint32_t out_rst : 1;
+        uint32_t ahbm_fifo_rst : 1;
+        uint32_t out_auto_wrback : 1;
+        uint32_t out_eof_mode : 1;
+        uint32_t outdscr_burst_en : 1;
+        uint32_t out_data_burst_en : 1;
+        uint32_t check_owner : 1;
+    } lc_conf;
+    struct {
+        uint32_t tx_fifo_mod : 3;
+        uint32_t dscr_en : 1;
+        uint32_t tx_fifo_mod_force_en : 1;
+    } fifo_conf;
+    struct {
+        uint32_t tx_chan_mod : 3;
+    } conf_chan;
+    sim_i2s_reg_t<SIM_I2S_SINGLE_DATA> conf_single_data;
+    struct {
+        uint32_t clkm_div_num : 8;
+        uint32_t clkm_div_b : 6;
+        uint32_t clkm_div_a : 6;
+        uint32_t clk_en : 1;
+        uint32_t clka_en : 1;
+    } clkm_conf;
+    struct {
+        uint32_t tx_bck_div_num : 6;
+        uint32_t tx_bits_mod : 6;
+    } sample_rate_conf;
+} i2s_dev_t;
+
+extern i2s_dev_t I2S0;
+
+#endif
@@ -0,0 +1,81 @@
+/*
+  soc/rmt_struct.h - RMT registers and memory for the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  Only the registers Grbl uses are provided. Writes to tx_start and
+  mem_rd_rst start, stop and rewind a channel in sim_hal.cpp, which plays
+  the items in RMTMEM against the virtual clock, drives the pin of the
+  channel and raises the end and threshold interrupts.
+*/
+
+#ifndef sim_soc_rmt_struct_h
+#define sim_soc_rmt_struct_h
+
+#include <stdint.h>
+
+void sim_rmt_write(const void* reg, uint8_t field, uint32_t value);
+void sim_rmt_clear_interrupts(uint32_t mask);
+
+enum { SIM_RMT_TX_START = 0, SIM_RMT_MEM_RD_RST };
+
+// A write-only bit of the conf1 register of a channel
+template <uint8_t field>
+struct sim_rmt_bit_t {
+    void operator=(uint32_t value) { sim_rmt_write(this, field, value); }
+};
+
+struct sim_rmt_int_clr_t {
+    void operator=(uint32_t mask) { sim_rmt_clear_interrupts(mask); }
+};
+
+typedef struct {
+    struct {
+        struct {
+            uint32_t div_cnt : 8;
+            uint32_t mem_size : 4;
+        } conf0;
+        struct {
+            sim_rmt_bit_t<SIM_RMT_TX_START> tx_start;
+            sim_rmt_bit_t<SIM_RMT_MEM_RD_RST> mem_rd_rst;
+            uint32_t idle_out_lv : 1;
+            uint32_t idle_out_en : 1;
+        } conf1;
+    } conf_ch[8];
+    struct {
+        uint32_t val;
+    } int_raw, int_st, int_ena;
+    struct {
+        sim_rmt_int_clr_t val;
+    } int_clr;
+    struct {
+        uint32_t limit : 9;
+    } tx_lim_ch[8];
+    struct {
+        uint32_t fifo_mask : 1;
+        uint32_t mem_tx_wrap_en : 1;
+    } apb_conf;
+} rmt_dev_t;
+
+extern rmt_dev_t RMT;
+
+typedef struct {
+    union {
+        struct {
+            uint32_t duration0 : 15;
+            uint32_t level0 : 1;
+            uint32_t duration1 : 15;
+            uint32_t level1 : 1;
+        };
+        uint32_t val;
+    };
+} rmt_item32_t;
+
+typedef struct {
+    struct {
+        rmt_item32_t data32[64];
+    } chan[8];
+} rmt_mem_t;
+
+extern rmt_mem_t RMTMEM;
+
+#endif
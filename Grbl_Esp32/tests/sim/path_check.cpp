@@ -0,0 +1,215 @@
+/*
+  path_check.cpp - checks a step timeline against the path programmed in g-code
+  Part of Grbl_ESP32 host simulator
+
+  Usage: grbl_path [-t tolerance] [-u steps_per_mm] job.nc timeline.csv
+
+  Follows the position of the steps of the timeline along the lines of
+  the job and reports how far it got from them at most, and where it
+  ended against the end of the job. G64 rounds off the corners by up to
+  its P tolerance, G61 not at all, and either way the position is off by
+  up to a step of each axis between steps. The exit status is 2 when the
+  path deviates more than that, or the job ends more than half a step
+  from its programmed end, e.g. with `make blending`.
+
+  Only straight G0/G1 moves in absolute mm are understood, as in
+  tests/blending.nc.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+static const char AXIS_NAMES[] = "XYZ";
+#define PATH_AXES 3
+#define PATH_LOOKAHEAD 3 // Lines after the current one a step may have got to, past a rounded corner
+
+struct point_t {
+    double axis[PATH_AXES]; // mm
+    int line;               // Of the job, that ends here
+};
+
+static void usage() {
+    fprintf(stderr, "usage: grbl_path [-t tolerance] [-u steps_per_mm] job.nc timeline.csv\n"
+                    "  -t tolerance     how far corners may be rounded off, in mm, 0 by default\n"
+                    "  -u steps_per_mm  of all axes, 100 by default\n");
+}
+
+// Reads the end points of the moves of the job, starting at 0
+static bool read_job(const char* path, std::vector<point_t>* points) {
+    FILE* in = fopen(path, "r");
+    if (in == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    point_t point = { { 0.0, 0.0, 0.0 }, 0 };
+    points->push_back(point);
+    char line[256];
+    int number = 0;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        number++;
+        char* comment = strpbrk(line, ";(");
+        if (comment != NULL)
+            *comment = '\0';
+        if (line[0] == '$')
+            continue;
+        bool moved = false;
+        char* p = line;
+        while (*p != '\0') {
+            char letter = toupper(*p++);
+            if (!isalpha(letter))
+                continue;
+            char* end;
+            double value = strtod(p, &end);
+            if (end == p) {
+                fprintf(stderr, "%s:%d: %c without a value\n", path, number, letter);
+                fclose(in);
+                return false;
+            }
+            p = end;
+            const char* name = strchr(AXIS_NAMES, letter);
+            if (name != NULL) {
+                point.axis[name - AXIS_NAMES] = value;
+                moved = true;
+            } else if (letter == 'G' && value != 0 && value != 1 && value != 21 && value != 90 && value != 94 &&
+                       value != 61 && value != 64) {
+                fprintf(stderr, "%s:%d: G%g is not supported\n", path, number, value);
+                fclose(in);
+                return false;
+            }
+        }
+        const point_t& last = points->back();
+        if (moved && memcmp(point.axis, last.axis, sizeof(point.axis)) != 0) {
+            point.line = number;
+            points->push_back(point);
+        }
+    }
+    fclose(in);
+    return true;
+}
+
+// Distance of p from the line from a to b
+static double line_distance(const double* p, const double* a, const double* b) {
+    double ab[PATH_AXES], ap[PATH_AXES];
+    double length2 = 0.0, along = 0.0;
+    for (int idx = 0; idx < PATH_AXES; idx++) {
+        ab[idx] = b[idx] - a[idx];
+        ap[idx] = p[idx] - a[idx];
+        length2 += ab[idx] * ab[idx];
+        along += ab[idx] * ap[idx];
+    }
+    double fraction = (length2 > 0.0) ? fmin(fmax(along / length2, 0.0), 1.0) : 0.0;
+    double distance2 = 0.0;
+    for (int idx = 0; idx < PATH_AXES; idx++) {
+        double off = ap[idx] - fraction * ab[idx];
+        distance2 += off * off;
+    }
+    return sqrt(distance2);
+}
+
+int main(int argc, char* argv[]) {
+    double tolerance = 0.0, steps_per_mm = 100.0;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:u:")) != -1) {
+        switch (opt) {
+        case 't': tolerance = atof(optarg); break;
+        case 'u': steps_per_mm = atof(optarg); break;
+        default: usage(); return 1;
+        }
+    }
+    if (argc - optind != 2 || tolerance < 0.0 || steps_per_mm <= 0.0) {
+        usage();
+        return 1;
+    }
+    std::vector<point_t> points;
+    if (!read_job(argv[optind], &points))
+        return 1;
+    if (points.size() < 2) {
+        fprintf(stderr, "%s has no moves\n", argv[optind]);
+        return 1;
+    }
+    FILE* in = fopen(argv[optind + 1], "r");
+    if (in == NULL) {
+        fprintf(stderr, "cannot open %s\n", argv[optind + 1]);
+        return 1;
+    }
+    int position[PATH_AXES] = { 0 };
+    size_t current = 1; // Line of the path the steps are on, ending at points[current]
+    double deviation = 0.0, end_usec = 0.0;
+    int deviation_line = 0;
+    unsigned long steps = 0;
+    char line[100];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        double usec;
+        char axis;
+        int direction;
+        if (sscanf(line, "%lf,%c,%d", &usec, &axis, &direction) != 3)
+            continue; // Header
+        const char* name = strchr(AXIS_NAMES, axis);
+        if (name == NULL || axis == '\0')
+            continue;
+        position[name - AXIS_NAMES] += (direction < 0) ? -1 : 1;
+        end_usec = usec;
+        steps++;
+        double p[PATH_AXES];
+        for (int idx = 0; idx < PATH_AXES; idx++)
+            p[idx] = position[idx] / steps_per_mm;
+        // The nearest of the lines from the current one on, which the steps never go back from
+        double nearest = INFINITY;
+        size_t last = (current + PATH_LOOKAHEAD < points.size()) ? current + PATH_LOOKAHEAD : points.size() - 1;
+        for (size_t idx = current; idx <= last; idx++) {
+            double distance = line_distance(p, points[idx - 1].axis, points[idx].axis);
+            if (distance < nearest) {
+                nearest = distance;
+                current = idx;
+            }
+        }
+        if (nearest > deviation) {
+            deviation = nearest;
+            deviation_line = points[current].line;
+        }
+    }
+    fclose(in);
+    // Between steps, the position lags by up to a step of each axis.
+    double step_error = sqrt((double)PATH_AXES) / steps_per_mm;
+    double end_error = 0.0;
+    const point_t& end = points.back();
+    printf("%lu steps in %.3f s\n", steps, end_usec * 1e-6);
+    printf("Deviation from the path: %.4f mm at line %d, allowed %.4f mm\n", deviation, deviation_line,
+           tolerance + step_error);
+    printf("End:");
+    for (int idx = 0; idx < PATH_AXES; idx++) {
+        double at = position[idx] / steps_per_mm;
+        printf(" %c%.3f", AXIS_NAMES[idx], at);
+        end_error = fmax(end_error, fabs(at - end.axis[idx]));
+    }
+    printf(", programmed");
+    for (int idx = 0; idx < PATH_AXES; idx++)
+        printf(" %c%.3f", AXIS_NAMES[idx], end.axis[idx]);
+    printf("\n");
+    bool failed = false;
+    if (deviation > tolerance + step_error) {
+        printf("The path deviates more than allowed\n");
+        failed = true;
+    }
+    if (end_error > 0.5 / steps_per_mm) {
+        printf("The job does not end at its programmed end\n");
+        failed = true;
+    }
+    return failed ? 2 : 0;
+}
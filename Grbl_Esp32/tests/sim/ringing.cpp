@@ -0,0 +1,151 @@
+/*
+  ringing.cpp - compares the ringing step timelines excite in a resonance
+  Part of Grbl_ESP32 host simulator
+
+  Usage: grbl_ringing [-f hz] [-z damping] [-u steps_per_mm] timeline.csv [timeline.csv ...]
+
+  Each axis drives a mass on a spring, such as a belt, tuned to the
+  frequency and damping. The motor position moves from step to step at
+  the rate of the steps, or jumps to the next one after a stop. Reports
+  per axis how far the mass deflects from the motor position at most,
+  and how far it still rings when the axis comes to a stop. Compare the
+  timelines of a job with and without input shaping, e.g. with
+  `make ringing`.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+static const char AXIS_NAMES[] = "XYZABC";
+static const double SAMPLE_SEC = 10e-6; // Integration step
+static const double STOP_SEC = 0.02;    // An axis without steps for this long has stopped
+
+struct step_t {
+    double time; // sec
+    int position;
+};
+
+static void usage() {
+    fprintf(stderr, "usage: grbl_ringing [-f hz] [-z damping] [-u steps_per_mm] timeline.csv [timeline.csv ...]\n"
+                    "  -f hz            resonance frequency, 40 by default\n"
+                    "  -z damping       damping ratio of the resonance, 0.1 by default\n"
+                    "  -u steps_per_mm  to report in mm, 100 by default\n");
+}
+
+static bool read_timeline(const char* path, std::vector<step_t>* axes) {
+    FILE* in = fopen(path, "r");
+    if (in == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    char line[100];
+    int position[sizeof(AXIS_NAMES)] = { 0 };
+    while (fgets(line, sizeof(line), in) != NULL) {
+        double usec;
+        char axis;
+        int direction;
+        if (sscanf(line, "%lf,%c,%d", &usec, &axis, &direction) != 3)
+            continue; // Header
+        const char* name = strchr(AXIS_NAMES, axis);
+        if (name == NULL || axis == '\0')
+            continue;
+        int index = name - AXIS_NAMES;
+        position[index] += (direction < 0) ? -1 : 1;
+        axes[index].push_back({ usec * 1e-6, position[index] });
+    }
+    fclose(in);
+    return true;
+}
+
+// Runs the resonance of one axis over its steps. Returns the largest deflection and the largest
+// amplitude of the ringing at a stop, in steps, and counts the stops.
+static void ring(const std::vector<step_t>& steps, double frequency, double damping, double* peak, double* residual, int* stops) {
+    double omega = 2.0 * M_PI * frequency;
+    double damped_omega = omega * sqrt(1.0 - damping * damping);
+    double mass = 0.0, speed = 0.0; // Position and speed of the mass, the motor is at 0 at the start
+    *peak = 0.0;
+    *residual = 0.0;
+    *stops = 0;
+    double end = steps.back().time + 10.0 * STOP_SEC;
+    size_t next = 0; // Next step
+    double time = 0.0;
+    while (time < end) {
+        time += SAMPLE_SEC;
+        while (next < steps.size() && steps[next].time <= time)
+            next++;
+        // Motor position and speed, moving from step to step when they are close.
+        double motor = 0.0, motor_speed = 0.0;
+        if (next > 0)
+            motor = steps[next - 1].position;
+        if (next > 0 && next < steps.size()) {
+            double gap = steps[next].time - steps[next - 1].time;
+            if (gap < STOP_SEC) {
+                motor_speed = (steps[next].position - steps[next - 1].position) / gap;
+                motor += motor_speed * (time - steps[next - 1].time);
+            }
+        }
+        // Semi-implicit Euler of the spring and damper between motor and mass
+        double accel = omega * omega * (motor - mass) + 2.0 * damping * omega * (motor_speed - speed);
+        speed += accel * SAMPLE_SEC;
+        mass += speed * SAMPLE_SEC;
+        double deflection = mass - motor;
+        *peak = fmax(*peak, fabs(deflection));
+        // At the start of a stop the mass rings freely, with this amplitude.
+        bool stopped = next > 0 && time - steps[next - 1].time < SAMPLE_SEC &&
+                       (next == steps.size() || steps[next].time - steps[next - 1].time >= STOP_SEC);
+        if (stopped) {
+            double velocity = speed - motor_speed;
+            double amplitude = hypot(deflection, (velocity + damping * omega * deflection) / damped_omega);
+            *residual = fmax(*residual, amplitude);
+            (*stops)++;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    double frequency = 40.0, damping = 0.1, steps_per_mm = 100.0;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:z:u:")) != -1) {
+        switch (opt) {
+        case 'f': frequency = atof(optarg); break;
+        case 'z': damping = atof(optarg); break;
+        case 'u': steps_per_mm = atof(optarg); break;
+        default: usage(); return 1;
+        }
+    }
+    if (optind == argc || frequency <= 0.0 || damping < 0.0 || damping >= 1.0 || steps_per_mm <= 0.0) {
+        usage();
+        return 1;
+    }
+    printf("Resonance %.1f Hz, damping %.3f\n", frequency, damping);
+    printf("%-32s %4s %12s %14s %6s\n", "Timeline", "Axis", "Deflection", "Ringing stop", "Stops");
+    for (int arg = optind; arg < argc; arg++) {
+        std::vector<step_t> axes[sizeof(AXIS_NAMES)];
+        if (!read_timeline(argv[arg], axes))
+            return 1;
+        for (size_t axis = 0; axis < sizeof(AXIS_NAMES) - 1; axis++) {
+            if (axes[axis].empty())
+                continue;
+            double peak, residual;
+            int stops;
+            ring(axes[axis], frequency, damping, &peak, &residual, &stops);
+            printf("%-32s %4c %9.4f mm %11.4f mm %6d\n", argv[arg], AXIS_NAMES[axis], peak / steps_per_mm, residual / steps_per_mm, stops);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,9 @@
+$110=6000
+$111=6000
+$120=2000
+$121=2000
+$38=2
+$190=40
+$191=40
+$200=0.1
+$201=0.1
@@ -0,0 +1,593 @@
+/*
+  sim_hal.cpp - virtual clock, timers and pins for the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  The ESP32 general purpose timers are replaced by a virtual clock. Time
+  only moves when the simulator asks for it (sim_advance_to) or when Grbl
+  itself waits (delay, vTaskDelay, NOP() busy-waits). Each timer alarm
+  runs its ISR at the exact virtual time it would fire on the hardware.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "driver/timer.h"
+#include "driver/rmt.h"
+#include "esp_intr_alloc.h"
+#include "rom/lldesc.h"
+#include "soc/i2s_struct.h"
+#include "soc/gpio_struct.h"
+#include "esp_heap_caps.h"
+#include "simulator.h"
+
+#define SIM_TIMER_COUNT (TIMER_GROUP_MAX * TIMER_MAX)
+#define SIM_STEP_TIMER  0 // group 0, timer 0
+#define SIM_I2S_EVENT   (SIM_TIMER_COUNT + RMT_CHANNEL_MAX)
+#define SIM_EVENT_COUNT (SIM_I2S_EVENT + 1) // the timers, the RMT channels, then the I2S
+#define SIM_RMT_ITEMS   64 // items per RMT memory block
+
+typedef struct {
+    bool running;
+    bool auto_reload;
+    uint64_t ps_per_tick;   // one tick of the divided timer clock
+    uint64_t alarm;         // alarm value in timer ticks
+    uint64_t counter_start; // virtual time at which the counter was zero
+    void (*isr)(void*);
+    void* isr_arg;
+} sim_timer_t;
+
+typedef struct {
+    bool running;
+    uint8_t pin;            // set by rmt_config(), GPIO_NUM_MAX if none
+    uint16_t pos;           // item being sent
+    uint8_t half;           // 0 while sending level0/duration0 of the item, 1 for the second half
+    uint32_t sent;          // items sent since the start, for the threshold interrupt
+    uint64_t half_end;      // virtual time at which the half being sent ends
+} sim_rmt_chan_t;
+
+typedef struct {
+    bool streaming;         // sending the DMA buffers of out_link
+    const lldesc_t* desc;   // buffer being sent
+    uint32_t change;        // next sample of it that differs from the latched one, its length if none
+    uint64_t desc_start;    // virtual time at which its first sample is latched
+    uint32_t latched;       // sample on the outputs
+} sim_i2s_t;
+
+static sim_timer_t timers[SIM_TIMER_COUNT];
+static sim_rmt_chan_t rmt_chan[RMT_CHANNEL_MAX];
+static void (*rmt_isr)(void*);
+static void* rmt_isr_arg;
+static uint64_t now;      // virtual time in picoseconds
+static bool in_isr;       // time cannot be advanced from inside an ISR
+static uint32_t segment_loads; // alarm changes made by the stepper ISR, and RMT interrupts
+static sim_i2s_t i2s;
+static intr_handler_t i2s_isr;
+static void* i2s_isr_arg;
+static uint8_t pin_level[SIM_PIN_COUNT];
+static bool pin_rmt[GPIO_NUM_MAX]; // driven by an RMT channel instead of the GPIO registers
+static uint32_t ledc_duty[16];
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+timg_dev_t TIMERG0;
+timg_dev_t TIMERG1;
+gpio_dev_t GPIO;
+rmt_dev_t RMT;
+i2s_dev_t I2S0;
+rmt_mem_t RMTMEM;
+
+static sim_timer_t* get_timer(timer_group_t group, timer_idx_t idx) {
+    return &timers[group * TIMER_MAX + idx];
+}
+
+// Time of the next alarm of a running timer. An alarm of 0 ticks would
+// fire continuously on the hardware; treat it as one tick.
+static uint64_t timer_next_alarm(const sim_timer_t* t) {
+    uint64_t ticks = t->alarm ? t->alarm : 1;
+    return t->counter_start + ticks * t->ps_per_tick;
+}
+
+static void fire_timer(int index) {
+    sim_timer_t* t = &timers[index];
+    uint64_t isr_time = timer_next_alarm(t);
+    if (isr_time > now)
+        now = isr_time;
+    // The counter restarts at the alarm. A one shot timer stops until it is started again.
+    t->counter_start = isr_time;
+    if (!t->auto_reload)
+        t->running = false;
+    in_isr = true;
+    t->isr(t->isr_arg);
+    in_isr = false;
+    if (index == SIM_STEP_TIMER)
+        sim_step_interrupt_done(isr_time);
+}
+
+// ---- RMT channels ----
+
+static void rmt_set_pin(uint8_t channel, uint8_t level) {
+    uint8_t pin = rmt_chan[channel].pin;
+    if (pin < GPIO_NUM_MAX && pin_level[pin] != level) {
+        pin_level[pin] = level;
+        sim_gpio_write(pin, level);
+    }
+}
+
+static void rmt_raise(uint32_t mask) {
+    RMT.int_raw.val |= mask;
+    RMT.int_st.val = RMT.int_raw.val & RMT.int_ena.val;
+}
+
+// A channel with its interrupts enabled is refilled by its ISR, as the
+// RMT step trains do. Channels that send a single pulse are not.
+static bool rmt_interrupts_enabled(uint8_t channel) {
+    return (RMT.int_ena.val & (bit(channel * 3) | bit(channel + 24))) != 0;
+}
+
+static void rmt_stop(uint8_t channel) {
+    rmt_chan[channel].running = false;
+    rmt_set_pin(channel, RMT.conf_ch[channel].conf1.idle_out_lv);
+    rmt_raise(bit(channel * 3)); // end interrupt
+}
+
+// Starts sending the current half of the current item. The memory blocks
+// of the channels follow each other, so a channel with more than one block
+// continues into the next. A duration of 0 ends the transmission.
+static void rmt_begin_half(uint8_t channel, uint64_t time) {
+    sim_rmt_chan_t* c = &rmt_chan[channel];
+    const rmt_item32_t* item = &RMTMEM.chan[0].data32[(channel * SIM_RMT_ITEMS + c->pos) % (RMT_CHANNEL_MAX * SIM_RMT_ITEMS)];
+    uint32_t duration = c->half ? item->duration1 : item->duration0;
+    if (duration == 0) {
+        rmt_stop(channel);
+        return;
+    }
+    uint32_t div = RMT.conf_ch[channel].conf0.div_cnt;
+    rmt_set_pin(channel, c->half ? item->level1 : item->level0);
+    c->half_end = time + duration * (div ? div : 256) * SIM_PS_PER_APB_TICK;
+}
+
+// Moves on to the next half at the end of the current one, raising the
+// threshold interrupt every tx_lim items. Runs the RMT ISR for anything
+// raised.
+static void fire_rmt(uint8_t channel) {
+    sim_rmt_chan_t* c = &rmt_chan[channel];
+    uint64_t time = c->half_end;
+    if (time > now)
+        now = time;
+    if (c->half == 0) {
+        c->half = 1;
+        rmt_begin_half(channel, time);
+    } else {
+        c->half = 0;
+        c->sent++;
+        uint32_t mem_size = RMT.conf_ch[channel].conf0.mem_size ? RMT.conf_ch[channel].conf0.mem_size : 1;
+        if (++c->pos == mem_size * SIM_RMT_ITEMS) {
+            c->pos = 0;
+            if (!RMT.apb_conf.mem_tx_wrap_en) {
+                rmt_stop(channel);
+                c->sent = 0;
+            }
+        }
+        uint32_t limit = RMT.tx_lim_ch[channel].limit;
+        if (limit != 0 && c->sent % limit == 0 && c->sent != 0)
+            rmt_raise(bit(channel + 24)); // threshold interrupt
+        if (c->running)
+            rmt_begin_half(channel, time);
+    }
+    if (RMT.int_st.val != 0 && rmt_isr != NULL) {
+        segment_loads++;
+        in_isr = true;
+        rmt_isr(rmt_isr_arg);
+        in_isr = false;
+        sim_step_interrupt_done(time);
+    }
+}
+
+// ---- I2S shift register outputs ----
+
+static uint64_t i2s_ps_per_sample() {
+    uint32_t div = I2S0.clkm_conf.clkm_div_num ? I2S0.clkm_conf.clkm_div_num : 256;
+    uint32_t bck_div = I2S0.sample_rate_conf.tx_bck_div_num ? I2S0.sample_rate_conf.tx_bck_div_num : 64;
+    return 64 * div * bck_div * SIM_PS_PER_PLL_D2_TICK;
+}
+
+// All outputs change together, so their levels are set before the
+// simulator sees any of them change.
+static void i2s_latch(uint32_t sample) {
+    uint32_t changed = sample ^ i2s.latched;
+    i2s.latched = sample;
+    for (uint32_t mask = changed; mask != 0; mask &= mask - 1) {
+        uint8_t bit = __builtin_ctz(mask);
+        pin_level[SIM_I2S_PIN(bit)] = (sample >> bit) & 1;
+    }
+    for (uint32_t mask = changed; mask != 0; mask &= mask - 1) {
+        uint8_t bit = __builtin_ctz(mask);
+        sim_gpio_write(SIM_I2S_PIN(bit), (sample >> bit) & 1);
+    }
+}
+
+static void i2s_find_change(uint32_t from) {
+    const uint32_t* samples = (const uint32_t*)i2s.desc->buf;
+    uint32_t count = i2s.desc->length / sizeof(uint32_t);
+    while (from < count && samples[from] == i2s.latched)
+        from++;
+    i2s.change = from;
+}
+
+static uint64_t i2s_event_time() {
+    return i2s.desc_start + i2s.change * i2s_ps_per_sample();
+}
+
+// Latches the next sample that changes the outputs, or raises the EOF
+// interrupt at the end of the buffer and goes on with the next one.
+static void fire_i2s() {
+    uint64_t time = i2s_event_time();
+    if (time > now)
+        now = time;
+    if (i2s.change < i2s.desc->length / sizeof(uint32_t)) {
+        i2s_latch(((const uint32_t*)i2s.desc->buf)[i2s.change]);
+        i2s_find_change(i2s.change + 1);
+        return;
+    }
+    I2S0.out_eof_des_addr = (uintptr_t)i2s.desc;
+    i2s.desc = i2s.desc->qe.stqe_next;
+    i2s.desc_start = time;
+    if (i2s.desc == NULL)
+        i2s.streaming = false;
+    else
+        i2s_find_change(0);
+    I2S0.int_raw.out_eof = 1;
+    I2S0.int_st.val = I2S0.int_raw.val & I2S0.int_ena.val;
+    if (I2S0.int_st.val != 0 && i2s_isr != NULL) {
+        segment_loads++;
+        in_isr = true;
+        i2s_isr(i2s_isr_arg);
+        in_isr = false;
+        sim_step_interrupt_done(time);
+    }
+}
+
+// ---- Events: timer alarms, the ends of RMT item halves and I2S samples ----
+
+static bool event_pending(int index) {
+    if (index < SIM_TIMER_COUNT)
+        return timers[index].running && timers[index].isr != NULL;
+    if (index == SIM_I2S_EVENT)
+        return i2s.streaming;
+    return rmt_chan[index - SIM_TIMER_COUNT].running;
+}
+
+static uint64_t event_time(int index) {
+    if (index < SIM_TIMER_COUNT)
+        return timer_next_alarm(&timers[index]);
+    if (index == SIM_I2S_EVENT)
+        return i2s_event_time();
+    return rmt_chan[index - SIM_TIMER_COUNT].half_end;
+}
+
+// Events of the stepper: the step timer, the RMT step trains and the I2S
+// buffers filled by the stepper
+static bool stepper_event(int index) {
+    if (index < SIM_TIMER_COUNT)
+        return index == SIM_STEP_TIMER;
+    if (index == SIM_I2S_EVENT)
+        return I2S0.int_ena.out_eof;
+    return rmt_interrupts_enabled(index - SIM_TIMER_COUNT);
+}
+
+// Returns the pending event that comes first, of the stepper only or of
+// anything, or -1 if there is none.
+static int next_event(bool stepper_only) {
+    int found = -1;
+    for (int i = 0; i < SIM_EVENT_COUNT; i++) {
+        if (!event_pending(i) || (stepper_only && !stepper_event(i)))
+            continue;
+        if (found < 0 || event_time(i) < event_time(found))
+            found = i;
+    }
+    return found;
+}
+
+static void fire_event(int index) {
+    if (index < SIM_TIMER_COUNT)
+        fire_timer(index);
+    else if (index == SIM_I2S_EVENT)
+        fire_i2s();
+    else
+        fire_rmt(index - SIM_TIMER_COUNT);
+}
+
+uint64_t sim_get_time() {
+    return now;
+}
+
+bool sim_stepper_running() {
+    return next_event(true) >= 0;
+}
+
+void sim_advance_to(uint64_t time) {
+    if (in_isr)
+        return;
+    int index;
+    while ((index = next_event(false)) >= 0 && event_time(index) <= time)
+        fire_event(index);
+    if (now < time)
+        now = time;
+}
+
+bool sim_run_step_interrupts(uint64_t limit) {
+    if (in_isr)
+        return false;
+    // The stepper ISR sets a new alarm period each time it loads a segment,
+    // which frees a slot in the segment buffer. The RMT ISR may free some
+    // each time it refills a step train.
+    uint32_t loads = segment_loads;
+    bool ran = false;
+    int index;
+    while ((index = next_event(true)) >= 0 && event_time(index) <= limit && segment_loads == loads) {
+        // Any other event that is due first runs before the stepper.
+        int next = next_event(false);
+        fire_event(next);
+        if (next == index)
+            ran = true;
+    }
+    return ran;
+}
+
+void sim_nop() {
+    now += SIM_NOP_PS;
+}
+
+// ---- ESP-IDF timer driver ----
+
+esp_err_t timer_init(timer_group_t group, timer_idx_t idx, const timer_config_t* config) {
+    sim_timer_t* t = get_timer(group, idx);
+    t->ps_per_tick = config->divider * SIM_PS_PER_APB_TICK;
+    t->running = (config->counter_en == TIMER_START);
+    t->auto_reload = config->auto_reload;
+    t->counter_start = now;
+    return 0;
+}
+
+esp_err_t timer_set_counter_value(timer_group_t group, timer_idx_t idx, uint64_t value) {
+    sim_timer_t* t = get_timer(group, idx);
+    t->counter_start = now - value * t->ps_per_tick;
+    return 0;
+}
+
+esp_err_t timer_set_alarm_value(timer_group_t group, timer_idx_t idx, uint64_t value) {
+    sim_timer_t* t = get_timer(group, idx);
+    if (in_isr && t == &timers[SIM_STEP_TIMER])
+        segment_loads++;
+    t->alarm = value;
+    return 0;
+}
+
+esp_err_t timer_enable_intr(timer_group_t group, timer_idx_t idx) {
+    return 0;
+}
+
+esp_err_t timer_isr_register(timer_group_t group, timer_idx_t idx, void (*fn)(void*), void* arg,
+                             int intr_alloc_flags, timer_isr_handle_t* handle) {
+    sim_timer_t* t = get_timer(group, idx);
+    t->isr = fn;
+    t->isr_arg = arg;
+    return 0;
+}
+
+esp_err_t timer_start(timer_group_t group, timer_idx_t idx) {
+    get_timer(group, idx)->running = true;
+    return 0;
+}
+
+esp_err_t timer_pause(timer_group_t group, timer_idx_t idx) {
+    get_timer(group, idx)->running = false;
+    return 0;
+}
+
+// ---- ESP-IDF RMT driver and registers ----
+
+esp_err_t rmt_config(const rmt_config_t* config) {
+    uint8_t channel = config->channel;
+    if (channel >= RMT_CHANNEL_MAX)
+        return 1;
+    bool has_pin = config->gpio_num >= 0 && config->gpio_num < GPIO_NUM_MAX;
+    rmt_chan[channel].pin = has_pin ? config->gpio_num : GPIO_NUM_MAX;
+    RMT.conf_ch[channel].conf0.div_cnt = config->clk_div;
+    RMT.conf_ch[channel].conf0.mem_size = config->mem_block_num;
+    RMT.conf_ch[channel].conf1.idle_out_lv = config->tx_config.idle_level;
+    RMT.conf_ch[channel].conf1.idle_out_en = config->tx_config.idle_output_en;
+    if (has_pin) {
+        pin_rmt[config->gpio_num] = true;
+        rmt_set_pin(channel, config->tx_config.idle_level);
+    }
+    return 0;
+}
+
+esp_err_t rmt_set_source_clk(rmt_channel_t channel, rmt_source_clk_t base_clk) {
+    return 0; // always the APB clock
+}
+
+esp_err_t rmt_fill_tx_items(rmt_channel_t channel, const rmt_item32_t* item, uint16_t item_num, uint16_t mem_offset) {
+    for (uint16_t i = 0; i < item_num; i++)
+        RMTMEM.chan[0].data32[(channel * SIM_RMT_ITEMS + mem_offset + i) % (RMT_CHANNEL_MAX * SIM_RMT_ITEMS)] = item[i];
+    return 0;
+}
+
+esp_err_t rmt_isr_register(void (*fn)(void*), void* arg, int intr_alloc_flags, rmt_isr_handle_t* handle) {
+    rmt_isr = fn;
+    rmt_isr_arg = arg;
+    return 0;
+}
+
+void sim_rmt_write(const void* reg, uint8_t field, uint32_t value) {
+    uint8_t channel = ((const uint8_t*)reg - (const uint8_t*)&RMT.conf_ch[0]) / sizeof(RMT.conf_ch[0]);
+    if (channel >= RMT_CHANNEL_MAX)
+        return;
+    sim_rmt_chan_t* c = &rmt_chan[channel];
+    if (field == SIM_RMT_MEM_RD_RST) {
+        if (value) {
+            c->pos = 0;
+            c->half = 0;
+        }
+    } else if (value) {
+        c->running = true;
+        c->half = 0;
+        c->sent = 0;
+        rmt_begin_half(channel, now);
+    } else {
+        c->running = false;
+        rmt_set_pin(channel, RMT.conf_ch[channel].conf1.idle_out_lv);
+    }
+}
+
+void sim_rmt_clear_interrupts(uint32_t mask) {
+    RMT.int_raw.val &= ~mask;
+    RMT.int_st.val = RMT.int_raw.val & RMT.int_ena.val;
+}
+
+// ---- I2S registers and interrupt ----
+
+esp_err_t esp_intr_alloc(int source, int flags, intr_handler_t handler, void* arg, intr_handle_t* ret_handle) {
+    if (source != ETS_I2S0_INTR_SOURCE)
+        return 1;
+    i2s_isr = handler;
+    i2s_isr_arg = arg;
+    return 0;
+}
+
+void sim_i2s_write(uint8_t field, uint32_t value) {
+    switch (field) {
+    case SIM_I2S_OUT_START:
+        if (value) {
+            i2s.streaming = true;
+            i2s.desc = (const lldesc_t*)I2S0.out_link.addr;
+            i2s.desc_start = now;
+            i2s_find_change(0);
+        }
+        break;
+    case SIM_I2S_OUT_STOP:
+        if (value)
+            i2s.streaming = false;
+        break;
+    case SIM_I2S_SINGLE_DATA:
+        if (!i2s.streaming)
+            i2s_latch(value);
+        break;
+    case SIM_I2S_INT_CLR:
+        I2S0.int_raw.val &= ~value;
+        I2S0.int_st.val = I2S0.int_raw.val & I2S0.int_ena.val;
+        break;
+    }
+}
+
+// ---- Heap ----
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    if ((caps & MALLOC_CAP_SPIRAM) && !sim_options.psram)
+        return NULL;
+    return malloc(size);
+}
+
+void heap_caps_free(void* ptr) {
+    free(ptr);
+}
+
+// ---- Time ----
+
+int64_t esp_timer_get_time() {
+    return now / SIM_PS_PER_US;
+}
+
+unsigned long millis() {
+    return now / SIM_PS_PER_MS;
+}
+
+unsigned long micros() {
+    return now / SIM_PS_PER_US;
+}
+
+void delay(uint32_t ms) {
+    sim_advance_to(now + ms * SIM_PS_PER_MS);
+}
+
+void delayMicroseconds(uint32_t us) {
+    sim_advance_to(now + us * SIM_PS_PER_US);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    delay(ticks * portTICK_PERIOD_MS);
+}
+
+void vTaskDelayUntil(TickType_t* previous_wake, TickType_t increment) {
+    *previous_wake += increment;
+    sim_advance_to((uint64_t)*previous_wake * portTICK_PERIOD_MS * SIM_PS_PER_MS);
+}
+
+TickType_t xTaskGetTickCount() {
+    return millis() / portTICK_PERIOD_MS;
+}
+
+// ---- Pins ----
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin >= GPIO_NUM_MAX || pin_rmt[pin])
+        return;
+    pin_level[pin] = val ? HIGH : LOW;
+    sim_gpio_write(pin, pin_level[pin]);
+}
+
+void sim_gpio_write_mask(uint8_t first_pin, uint32_t mask, uint8_t level) {
+    // Only pins that change level are passed on, as the clear registers are written with every
+    // pin that is low already.
+    while (mask != 0) {
+        uint8_t pin = first_pin + __builtin_ctz(mask);
+        mask &= mask - 1;
+        if (pin < GPIO_NUM_MAX && !pin_rmt[pin] && pin_level[pin] != level) {
+            pin_level[pin] = level;
+            sim_gpio_write(pin, level);
+        }
+    }
+}
+
+int digitalRead(uint8_t pin) {
+    return (pin < SIM_PIN_COUNT) ? pin_level[pin] : LOW;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+}
+
+void detachInterrupt(uint8_t pin) {
+}
+
+double ledcSetup(uint8_t chan, double freq, uint8_t bit_num) {
+    return freq;
+}
+
+void ledcWrite(uint8_t chan, uint32_t duty) {
+    if (chan < 16)
+        ledc_duty[chan] = duty;
+}
+
+uint32_t ledcRead(uint8_t chan) {
+    return (chan < 16) ? ledc_duty[chan] : 0;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t chan) {
+}
+
+void dacWrite(uint8_t pin, uint8_t value) {
+}
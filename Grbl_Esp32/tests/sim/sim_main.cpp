@@ -0,0 +1,99 @@
+/*
+  sim_main.cpp - command line front end of the host simulator
+  Part of Grbl_ESP32 host simulator
+
+  Usage: grbl_sim [-o timeline.csv] [-n] [-b baud] [-p] [-m] [-s ms] [-r capture] [-v] file.nc [file.nc ...]
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "simulator.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+static void usage() {
+    fprintf(stderr, "usage: grbl_sim [-o timeline.csv] [-n] [-b baud] [-p] [-m] [-s ms] [-r capture] [-v] file.nc [file.nc ...]\n"
+                    "  -o file  write the step timeline to file instead of stdout\n"
+                    "  -n       no step timeline, summary only\n"
+                    "  -b baud  limit the g-code stream to a serial link of this speed\n"
+                    "  -p       also show the host time spent in each part of Grbl\n"
+                    "  -m       simulate a board with PSRAM (deep planner buffer)\n"
+                    "  -s ms    ask for a text and a binary status report every ms and compare them\n"
+                    "  -r file  write everything Grbl sends to file\n"
+                    "  -v       verbose, also show ok responses and underrun times\n");
+}
+
+static void report_profile(FILE* f, const sim_profile_t* p) {
+    static const char* names[SIM_PROFILE_COUNT] = {"Parse", "Plan", "Prep", "Step ISR", "Wait"};
+    for (int i = 0; i < SIM_PROFILE_COUNT; i++) {
+        fprintf(f, "%-14s %10.3f ms %10u calls %8.1f ns/call\n", names[i], p->ns[i] / 1e6, p->calls[i],
+                p->calls[i] ? (double)p->ns[i] / p->calls[i] : 0.0);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int opt;
+    bool no_timeline = false;
+    bool profile = false;
+    const char* timeline_path = NULL;
+    const char* capture_path = NULL;
+    sim_options.timeline = stdout;
+    while ((opt = getopt(argc, argv, "o:nb:pms:r:v")) != -1) {
+        switch (opt) {
+        case 'o': timeline_path = optarg; break;
+        case 'n': no_timeline = true; break;
+        case 'b': sim_options.baud = strtoul(optarg, NULL, 10); break;
+        case 'p': profile = true; break;
+        case 'm': sim_options.psram = true; break;
+        case 's': sim_options.status_ms = strtoul(optarg, NULL, 10); break;
+        case 'r': capture_path = optarg; break;
+        case 'v': sim_options.verbose = true; break;
+        default: usage(); return 1;
+        }
+    }
+    if (optind >= argc) {
+        usage();
+        return 1;
+    }
+    for (int i = optind; i < argc; i++) {
+        if (!sim_load_file(argv[i]))
+            return 1;
+    }
+    if (no_timeline)
+        sim_options.timeline = NULL;
+    else if (timeline_path != NULL) {
+        sim_options.timeline = fopen(timeline_path, "w");
+        if (sim_options.timeline == NULL) {
+            fprintf(stderr, "cannot open %s\n", timeline_path);
+            return 1;
+        }
+    }
+    if (capture_path != NULL) {
+        sim_options.capture = fopen(capture_path, "wb");
+        if (sim_options.capture == NULL) {
+            fprintf(stderr, "cannot open %s\n", capture_path);
+            return 1;
+        }
+    }
+    if (sim_options.timeline != NULL)
+        fprintf(sim_options.timeline, "time_us,axis,direction\n");
+    sim_result_t result;
+    sim_run(&result);
+    if (sim_options.timeline != NULL && sim_options.timeline != stdout)
+        fclose(sim_options.timeline);
+    if (sim_options.capture != NULL)
+        fclose(sim_options.capture);
+    sim_report(stderr, &result);
+    if (profile)
+        report_profile(stderr, &result.profile);
+    return (result.done && result.errors == 0 && result.status_mismatches == 0) ? 0 : 2;
+}
@@ -0,0 +1,52 @@
+/*
+  sim_stubs.cpp - stand-ins for the parts of Grbl_ESP32 the simulator does not run
+  Part of Grbl_ESP32 host simulator
+
+  The [ESP...] command set and the serial transmit path are not part of the
+  motion core. They are replaced by the minimum needed to link protocol.cpp
+  and report.cpp. The SD card is in simulator.cpp, where it plays compiled
+  jobs.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "grbl.h"
+#include "commands.h"
+#include "espresponse.h"
+
+// ---- [ESP...] commands: none are recognized ----
+
+bool COMMANDS::check_command(const char* cmd_line, int* cmd, String& cmd_params) {
+    return false;
+}
+
+bool COMMANDS::execute_internal_command(int cmd, String cmd_params, level_authenticate_type auth_level,
+                                        ESPResponseStream* espresponse) {
+    return false;
+}
+
+ESPResponseStream::ESPResponseStream(uint8_t client, bool byid) {
+    _client = client;
+}
+
+// ---- Serial transmit and buffer bookkeeping ----
+
+void serial_write(uint8_t data) {
+    Serial.write(data);
+}
+
+void serial_reset_read_buffer(uint8_t client) {
+}
+
+uint8_t serial_get_rx_buffer_available(uint8_t client) {
+    return RX_BUFFER_SIZE;
+}
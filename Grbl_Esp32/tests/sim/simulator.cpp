@@ -0,0 +1,752 @@
+/*
+  simulator.cpp - host simulator for the Grbl_ESP32 motion core
+  Part of Grbl_ESP32 host simulator
+
+  Runs the real g-code parser, planner, segment generator and stepper ISR
+  on the host against a virtual clock. G-code is fed through the normal
+  protocol_main_loop() as if it arrived on the serial port, and every step
+  pulse is written to a timeline as
+
+      time_us,axis,direction
+
+  A job ends when the input is exhausted and all motion has finished. Its
+  result holds the job time, achieved feed rates, segment buffer underruns
+  and the host time spent parsing, planning and preparing segments.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "grbl.h"
+#include "simulator.h"
+#include "status_decoder.h"
+#include <time.h>
+
+// Declare system global variable structure (see Grbl_Esp32.ino)
+system_t sys;
+int32_t sys_position[N_AXIS];
+int32_t sys_probe_position[N_AXIS];
+volatile uint8_t sys_probe_state;
+volatile uint8_t sys_rt_exec_state;
+volatile uint8_t sys_rt_exec_alarm;
+volatile uint8_t sys_rt_exec_motion_override;
+volatile uint8_t sys_rt_exec_accessory_override;
+#ifdef DEBUG
+    volatile uint8_t sys_rt_exec_debug;
+#endif
+
+// The original definitions are renamed at compile time, see the Makefile.
+uint8_t sim_real_gc_execute_line(char* line, uint8_t client);
+uint8_t sim_real_plan_buffer_line(float* target, plan_line_data_t* pl_data);
+void sim_real_st_prep_buffer();
+void sim_real_protocol_buffer_synchronize();
+void sim_real_protocol_execute_realtime();
+void sim_real_plan_queue_line(float* target, plan_line_data_t* pl_data);
+void sim_real_plan_queue_synchronize();
+
+#define SIM_SAMPLE_PS (1 * SIM_PS_PER_MS)  // position sampling period for path length
+#define SIM_FEED_WINDOW_PS (10 * SIM_PS_PER_MS) // window for the peak feed rate
+#define SIM_PROFILE_DEPTH 8
+
+sim_options_t sim_options;
+
+static const char axis_letters[] = "XYZABC";
+
+// G-code input, all files concatenated
+static struct {
+    char* data;
+    size_t len;
+    size_t pos;
+    uint64_t byte_ps;                   // time on the wire per byte, 0 for an infinitely fast link
+    uint64_t last_arrival;
+    uint64_t read_time[RX_BUFFER_SIZE]; // when each of the last RX_BUFFER_SIZE bytes was read
+} input;
+
+// Compiled job (see gcode_job.h), played as if from the SD card once the
+// g-code input is consumed
+static struct {
+    uint8_t* data;
+    size_t len;
+    size_t pos;
+    bool started;
+    uint8_t sd_state;
+    uint32_t source_line;
+} job;
+
+// State of the job being run
+static struct {
+    sim_result_t* result;
+    bool running; // false during start up
+    uint8_t synchronizing;
+    uint64_t start;
+
+    uint8_t step_pin[N_AXIS];
+    uint8_t dir_pin[N_AXIS];
+    uint8_t step_level[N_AXIS];
+    int32_t position[N_AXIS];
+
+    bool moving;
+    uint64_t motion_start;
+    uint64_t sample_time;
+    int32_t sample_position[N_AXIS];
+    uint64_t window_start;
+    double window_mm;
+
+    // Profiling: sections currently entered and the host time each started
+    uint8_t depth;
+    uint8_t section[SIM_PROFILE_DEPTH];
+    uint64_t section_start[SIM_PROFILE_DEPTH];
+
+    status_decoder_t output;
+    char status_line[256]; // last text status report
+    uint64_t next_status;
+    uint64_t next_push;
+} sim;
+
+static void poll_status(uint64_t time);
+
+static void map_axis_pins() {
+    memset(sim.step_pin, 0xff, sizeof(sim.step_pin));
+    memset(sim.dir_pin, 0xff, sizeof(sim.dir_pin));
+#ifdef USE_I2S_STEPS
+    sim.step_pin[X_AXIS] = SIM_I2S_PIN(X_STEP_I2SO);
+    sim.dir_pin[X_AXIS] = SIM_I2S_PIN(X_DIRECTION_I2SO);
+    sim.step_pin[Y_AXIS] = SIM_I2S_PIN(Y_STEP_I2SO);
+    sim.dir_pin[Y_AXIS] = SIM_I2S_PIN(Y_DIRECTION_I2SO);
+    sim.step_pin[Z_AXIS] = SIM_I2S_PIN(Z_STEP_I2SO);
+    sim.dir_pin[Z_AXIS] = SIM_I2S_PIN(Z_DIRECTION_I2SO);
+#if (N_AXIS > A_AXIS) && defined(A_STEP_I2SO)
+    sim.step_pin[A_AXIS] = SIM_I2S_PIN(A_STEP_I2SO);
+    sim.dir_pin[A_AXIS] = SIM_I2S_PIN(A_DIRECTION_I2SO);
+#endif
+#if (N_AXIS > B_AXIS) && defined(B_STEP_I2SO)
+    sim.step_pin[B_AXIS] = SIM_I2S_PIN(B_STEP_I2SO);
+    sim.dir_pin[B_AXIS] = SIM_I2S_PIN(B_DIRECTION_I2SO);
+#endif
+#if (N_AXIS > C_AXIS) && defined(C_STEP_I2SO)
+    sim.step_pin[C_AXIS] = SIM_I2S_PIN(C_STEP_I2SO);
+    sim.dir_pin[C_AXIS] = SIM_I2S_PIN(C_DIRECTION_I2SO);
+#endif
+#endif
+#ifdef X_STEP_PIN
+    sim.step_pin[X_AXIS] = X_STEP_PIN;
+    sim.dir_pin[X_AXIS] = X_DIRECTION_PIN;
+#endif
+#ifdef Y_STEP_PIN
+    sim.step_pin[Y_AXIS] = Y_STEP_PIN;
+    sim.dir_pin[Y_AXIS] = Y_DIRECTION_PIN;
+#endif
+#ifdef Z_STEP_PIN
+    sim.step_pin[Z_AXIS] = Z_STEP_PIN;
+    sim.dir_pin[Z_AXIS] = Z_DIRECTION_PIN;
+#endif
+#if (N_AXIS > A_AXIS) && defined(A_STEP_PIN)
+    sim.step_pin[A_AXIS] = A_STEP_PIN;
+    sim.dir_pin[A_AXIS] = A_DIRECTION_PIN;
+#endif
+#if (N_AXIS > B_AXIS) && defined(B_STEP_PIN)
+    sim.step_pin[B_AXIS] = B_STEP_PIN;
+    sim.dir_pin[B_AXIS] = B_DIRECTION_PIN;
+#endif
+#if (N_AXIS > C_AXIS) && defined(C_STEP_PIN)
+    sim.step_pin[C_AXIS] = C_STEP_PIN;
+    sim.dir_pin[C_AXIS] = C_DIRECTION_PIN;
+#endif
+    for (uint8_t idx = 0; idx < N_AXIS; idx++)
+        sim.step_level[idx] = digitalRead(sim.step_pin[idx]);
+}
+
+static void print_time(FILE* f, uint64_t time) {
+    fprintf(f, "%llu.%03llu", (unsigned long long)(time / SIM_PS_PER_US),
+            (unsigned long long)((time % SIM_PS_PER_US) / 1000));
+}
+
+// ---- Profiling ----
+
+static uint64_t host_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Time is charged to the innermost section only, so the time of a nested
+// section is taken out of the one it was entered from.
+static void profile_enter(uint8_t section) {
+    uint64_t t = host_ns();
+    if (sim.depth > 0)
+        sim.result->profile.ns[sim.section[sim.depth - 1]] += t - sim.section_start[sim.depth - 1];
+    if (sim.depth < SIM_PROFILE_DEPTH) {
+        sim.section[sim.depth] = section;
+        sim.section_start[sim.depth] = t;
+    }
+    sim.depth++;
+    sim.result->profile.calls[section]++;
+}
+
+static void profile_exit() {
+    uint64_t t = host_ns();
+    sim.depth--;
+    if (sim.depth < SIM_PROFILE_DEPTH)
+        sim.result->profile.ns[sim.section[sim.depth]] += t - sim.section_start[sim.depth];
+    if (sim.depth > 0)
+        sim.section_start[sim.depth - 1] = t;
+}
+
+// Runs the stepper until the ISR frees a segment buffer slot or until limit
+static bool run_step_interrupts(uint64_t limit) {
+    if (!sim_stepper_running())
+        return false;
+    profile_enter(SIM_PROFILE_STEP);
+    bool ran = sim_run_step_interrupts(limit);
+    profile_exit();
+    return ran;
+}
+
+// ---- Statistics ----
+
+static double sample_distance() {
+    double sum = 0.0;
+    for (uint8_t idx = 0; idx < N_AXIS; idx++) {
+        double delta = (sim.position[idx] - sim.sample_position[idx]) / settings.steps_per_mm[idx];
+        sum += delta * delta;
+    }
+    return sqrt(sum);
+}
+
+static void take_sample(uint64_t time) {
+    sim_result_t* r = sim.result;
+    double distance = sample_distance();
+    r->path_mm += distance;
+    sim.window_mm += distance;
+    memcpy(sim.sample_position, sim.position, sizeof(sim.position));
+    sim.sample_time = time;
+    if (time - sim.window_start >= SIM_FEED_WINDOW_PS) {
+        double feed = sim.window_mm * 60.0 * SIM_PS_PER_SEC / (time - sim.window_start);
+        if (feed > r->peak_feed)
+            r->peak_feed = feed;
+        sim.window_start = time;
+        sim.window_mm = 0.0;
+    }
+}
+
+static bool input_remaining() {
+    return input.pos < input.len;
+}
+
+void sim_step_interrupt_done(uint64_t isr_time) {
+    sim_result_t* r = sim.result;
+    r->step_isrs++;
+    poll_status(isr_time);
+    if (!sim.moving) {
+        sim.moving = true;
+        sim.motion_start = isr_time;
+        sim.sample_time = isr_time;
+        sim.window_start = isr_time;
+        sim.window_mm = 0.0;
+        memcpy(sim.sample_position, sim.position, sizeof(sim.position));
+    } else if (isr_time - sim.sample_time >= SIM_SAMPLE_PS)
+        take_sample(isr_time);
+    if (!sim_stepper_running()) {
+        // The ISR found the segment buffer empty and stopped the stepper.
+        sim.moving = false;
+        r->motion_ps += isr_time - sim.motion_start;
+        take_sample(isr_time);
+        if (!sim.synchronizing && (input_remaining() || job.sd_state == SDCARD_BUSY_PRINTING || plan_get_current_block() != NULL)) {
+            r->underruns++;
+            if (sim_options.verbose) {
+                fprintf(stderr, "underrun at ");
+                print_time(stderr, isr_time - sim.start);
+                fprintf(stderr, " us, line %u\n", r->lines + 1);
+            }
+        }
+    }
+}
+
+void sim_gpio_write(uint8_t pin, uint8_t level) {
+    if (sim.result == NULL)
+        return;
+    for (uint8_t idx = 0; idx < N_AXIS; idx++) {
+        if (pin != sim.step_pin[idx])
+            continue;
+        uint8_t idle_level = bit_istrue(settings.step_invert_mask, bit(idx)) ? HIGH : LOW;
+        bool step = (sim.step_level[idx] == idle_level) && (level != idle_level);
+        sim.step_level[idx] = level;
+        if (!step)
+            continue;
+        bool negative = (digitalRead(sim.dir_pin[idx]) == HIGH) != bit_istrue(settings.dir_invert_mask, bit(idx));
+        sim.position[idx] += negative ? -1 : 1;
+        sim.result->steps[idx]++;
+        if (sim_options.timeline != NULL) {
+            print_time(sim_options.timeline, sim_get_time() - sim.start);
+            fprintf(sim_options.timeline, ",%c,%d\n", axis_letters[idx], negative ? -1 : 1);
+        }
+    }
+}
+
+// ---- Serial ----
+
+// Grbl's responses. "ok" is only counted unless running verbose; errors are
+// reported with the line number of the g-code that caused them. The start up
+// chatter (settings restored into the blank EEPROM) is only shown when verbose.
+static void output_line(const char* line) {
+    if (!sim.running) {
+        if (sim_options.verbose)
+            fprintf(stderr, "%s\n", line);
+        return;
+    }
+    if (strcmp(line, "ok") == 0) {
+        sim.result->oks++;
+        if (!sim_options.verbose)
+            return;
+    } else if (strncmp(line, "error:", 6) == 0) {
+        sim.result->errors++;
+        fprintf(stderr, "line %u: ", sim.result->lines);
+    } else if (line[0] == '<') {
+        // Status reports asked for by -s are only checked against the frame that follows
+        snprintf(sim.status_line, sizeof(sim.status_line), "%s", line);
+        if (!sim_options.verbose)
+            return;
+    }
+    fprintf(stderr, "%s\n", line);
+}
+
+// Each status frame must tell the same as the text report asked for right before it.
+static void output_frame(const status_frame_t* frame) {
+    if (!sim.running)
+        return;
+    sim.result->status_frames++;
+    char why[300];
+    if (sim.status_line[0] && !status_frame_matches(frame, settings.steps_per_mm, sim.status_line, why, sizeof(why))) {
+        sim.result->status_mismatches++;
+        fprintf(stderr, "status frame at %u ms, %s\n  text report %s\n", frame->time_ms, why, sim.status_line);
+    }
+    sim.status_line[0] = 0;
+}
+
+void sim_serial_out(const char* text, size_t len) {
+    if (sim_options.capture != NULL)
+        fwrite(text, 1, len, sim_options.capture);
+    const uint8_t* data = (const uint8_t*)text;
+    int found;
+    while ((found = status_decoder_next(&sim.output, &data, &len)) != STATUS_DECODER_NONE) {
+        if (found == STATUS_DECODER_LINE)
+            output_line(sim.output.line);
+        else
+            output_frame(&sim.output.frame);
+    }
+}
+
+// The serial task pushes the status reports subscribed to with $RI and $RB
+// once a tick, and a sender may poll the status, as with -s. On the ESP32
+// the serial task does either at once, whatever the main program is doing.
+static void poll_status(uint64_t time) {
+    if (!sim.running)
+        return;
+    if (time >= sim.next_push) {
+        sim.next_push = time + SIM_PS_PER_MS;
+        status_push_poll();
+    }
+    if (sim_options.status_ms == 0 || time < sim.next_status)
+        return;
+    sim.next_status = time + sim_options.status_ms * SIM_PS_PER_MS;
+    report_realtime_status(CLIENT_SERIAL);
+    report_status_frame(CLIENT_SERIAL);
+}
+
+static bool sim_is_realtime_command(uint8_t data) {
+    return (data == CMD_RESET || data == CMD_STATUS_REPORT || data == CMD_CYCLE_START || data == CMD_FEED_HOLD || data > 0x7F);
+}
+
+// The job is finished when all input is consumed and the machine is at rest.
+// A compiled job is started once the g-code in front of it has been read.
+static void check_job_done() {
+    if (job.data != NULL && !job.started) {
+        job.started = true;
+        job.pos = sizeof(job_header_t);
+        job.source_line = 0;
+        uint8_t status = job_play_begin((job_header_t*)job.data);
+        if (status != STATUS_OK) {
+            report_status_message(status, CLIENT_SERIAL);
+            return;
+        }
+        job.sd_state = SDCARD_BUSY_PRINTING;
+        SD_ready_next = true;
+        return;
+    }
+    if (job.sd_state == SDCARD_BUSY_PRINTING)
+        return;
+    if (sys.state & (STATE_CYCLE | STATE_HOLD | STATE_HOMING | STATE_JOG | STATE_SAFETY_DOOR))
+        return;
+    if (sys_rt_exec_state || sim_stepper_running() || plan_get_current_block() != NULL)
+        return;
+    sim.result->done = true;
+    sys.abort = true; // makes protocol_main_loop() return
+}
+
+// Time at which the next input byte is on the serial port. With a baud rate
+// set, the sender is limited by the wire speed and by free space in Grbl's
+// RX buffer, as with a character counting streamer.
+static uint64_t next_arrival() {
+    if (input.byte_ps == 0)
+        return 0;
+    uint64_t arrival = input.last_arrival + input.byte_ps;
+    if (input.pos >= RX_BUFFER_SIZE) {
+        uint64_t room = input.read_time[input.pos % RX_BUFFER_SIZE];
+        if (room > arrival)
+            arrival = room;
+    }
+    return arrival;
+}
+
+// Hands the protocol loop the input that has arrived, straight out of the
+// input file. Without a baud rate that is the rest of the line up to the
+// next realtime command, otherwise one byte at a time.
+const uint8_t* serial_read_span(uint8_t client, uint32_t* len) {
+    *len = 0;
+    if (client != CLIENT_SERIAL || sim.result == NULL || sim.result->done)
+        return NULL;
+    poll_status(sim_get_time());
+    while (input_remaining()) {
+        uint64_t arrival = next_arrival();
+        if (arrival > sim_get_time()) {
+            // Keep stepping while waiting for the byte, returning to the main
+            // loop each time a segment buffer slot frees up.
+            if (!run_step_interrupts(arrival))
+                sim_advance_to(arrival);
+            return NULL;
+        }
+        if (sim_is_realtime_command(input.data[input.pos])) {
+            // Realtime commands are handled by the serial task on the ESP32,
+            // which is not part of the simulation.
+            serial_consume(client, 1);
+            sim.result->realtime_chars++;
+            continue;
+        }
+        size_t end = input.pos + 1;
+        if (input.byte_ps == 0) {
+            while (end < input.len && input.data[end - 1] != '\n' && !sim_is_realtime_command(input.data[end]))
+                end++;
+        }
+        *len = end - input.pos;
+        return (const uint8_t*)input.data + input.pos;
+    }
+    check_job_done();
+    return NULL;
+}
+
+void serial_consume(uint8_t client, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++) {
+        if (input.byte_ps != 0)
+            input.last_arrival = next_arrival();
+        input.read_time[input.pos % RX_BUFFER_SIZE] = sim_get_time();
+        if (input.data[input.pos++] == '\n')
+            sim.result->lines++;
+    }
+}
+
+// ---- Hooks into the motion core ----
+
+uint8_t gc_execute_line(char* line, uint8_t client) {
+    profile_enter(SIM_PROFILE_PARSE);
+    uint8_t status = sim_real_gc_execute_line(line, client);
+    profile_exit();
+    return status;
+}
+
+uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
+    profile_enter(SIM_PROFILE_PLAN);
+    uint8_t status = sim_real_plan_buffer_line(target, pl_data);
+    profile_exit();
+    return status;
+}
+
+// The planner task runs on the other core of the ESP32. Here it runs
+// whenever it would be woken up, as if planning took no time: when a line
+// is queued, when a planner block is freed and when the main program waits
+// for it.
+void plan_queue_line(float* target, plan_line_data_t* pl_data) {
+    sim_real_plan_queue_line(target, pl_data);
+    plan_execute_queue();
+}
+
+void plan_queue_synchronize() {
+    plan_execute_queue();
+    sim_real_plan_queue_synchronize();
+}
+
+// The stepper runs whenever the main program prepares segments, so the
+// simulated machine moves while Grbl parses and plans. It runs until a slot
+// in the segment buffer is free again, which is when the main program would
+// next find something to do. While the planner (or the queue of the planner
+// task) is full the main program can only wait, so that is repeated until
+// there is room again.
+void st_prep_buffer() {
+    do {
+        profile_enter(SIM_PROFILE_PREP);
+        sim_real_st_prep_buffer();
+        profile_exit();
+        plan_execute_queue();
+        if (!run_step_interrupts(UINT64_MAX))
+            break;
+    } while (plan_check_full_queue() && !sys_rt_exec_state && !sys_rt_exec_alarm);
+}
+
+// Realtime checks made by the parser and motion control while they wait
+void protocol_execute_realtime() {
+    plan_execute_queue();
+    profile_enter(SIM_PROFILE_WAIT);
+    sim_real_protocol_execute_realtime();
+    profile_exit();
+}
+
+// Stops from a buffer synchronize are requested by the program and are not
+// counted as underruns.
+void protocol_buffer_synchronize() {
+    sim.synchronizing++;
+    profile_enter(SIM_PROFILE_WAIT);
+    sim_real_protocol_buffer_synchronize();
+    profile_exit();
+    sim.synchronizing--;
+}
+
+// ---- SD card: plays the compiled job ----
+
+bool SD_ready_next = false;
+uint8_t SD_client = CLIENT_SERIAL;
+
+uint8_t get_sd_state(bool refresh) {
+    return job.sd_state;
+}
+
+boolean closeFile() {
+    job.sd_state = SDCARD_IDLE;
+    SD_ready_next = false;
+    return true;
+}
+
+boolean readFileLine(char* line) {
+    return false;
+}
+
+bool sd_job_is_compiled() {
+    return true;
+}
+
+boolean readJobRecord(job_record_t* record) {
+    if (job.len - job.pos < sizeof(job_record_t))
+        return false;
+    memcpy(record, job.data + job.pos, sizeof(job_record_t));
+    job.pos += sizeof(job_record_t);
+    if (record->source_line != job.source_line) {
+        job.source_line = record->source_line;
+        sim.result->lines++;
+    }
+    return record->type != JOB_RECORD_END;
+}
+
+float sd_report_perc_complete() {
+    return job.len ? 100.0 * job.pos / job.len : 0.0;
+}
+
+uint32_t sd_get_current_line_number() {
+    return job.source_line;
+}
+
+void sd_get_current_filename(char* name) {
+    name[0] = 0;
+}
+
+// Jobs are compiled by the simulator itself, see sim_compile()
+void sd_compile_poll() {
+}
+
+// ---- Jobs ----
+
+bool sim_load_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    char buf[4096];
+    size_t n;
+    job_header_t header;
+    if (fread(&header, 1, sizeof(job_header_t), f) == sizeof(job_header_t) &&
+            memcmp(header.magic, JOB_MAGIC, sizeof(header.magic)) == 0) {
+        if (job.data != NULL) {
+            fprintf(stderr, "%s: only one compiled job can be played\n", path);
+            fclose(f);
+            return false;
+        }
+        rewind(f);
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+            job.data = (uint8_t*)realloc(job.data, job.len + n);
+            memcpy(job.data + job.len, buf, n);
+            job.len += n;
+        }
+        fclose(f);
+        return true;
+    }
+    rewind(f);
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        input.data = (char*)realloc(input.data, input.len + n + 1);
+        memcpy(input.data + input.len, buf, n);
+        input.len += n;
+    }
+    fclose(f);
+    // Make sure the last line of every file is terminated
+    if (input.len > 0 && input.data[input.len - 1] != '\n') {
+        input.data = (char*)realloc(input.data, input.len + 1);
+        input.data[input.len++] = '\n';
+    }
+    return true;
+}
+
+void sim_clear_input() {
+    free(input.data);
+    input.data = NULL;
+    input.len = 0;
+    free(job.data);
+    job.data = NULL;
+    job.len = 0;
+}
+
+// setup() and the start of loop(), without the radios and the serial task
+static void grbl_init() {
+    report_init();
+    output_queue_init();
+    grbl_msg_sendf(CLIENT_SERIAL, MSG_LEVEL_INFO, "Grbl_ESP32 Ver %s Date %s", GRBL_VERSION, GRBL_VERSION_BUILD);
+    grbl_msg_sendf(CLIENT_SERIAL, MSG_LEVEL_INFO, "Using machine:%s", MACHINE_NAME);
+    settings_init();
+    stepper_init();
+    plan_init();
+    system_ini();
+    memset(sys_position, 0, sizeof(sys_position));
+    // loop(), up to protocol_main_loop()
+    memset(&sys, 0, sizeof(system_t));
+    sys.state = STATE_IDLE;
+    sys.f_override = DEFAULT_FEED_OVERRIDE;
+    sys.r_override = DEFAULT_RAPID_OVERRIDE;
+    sys.spindle_speed_ovr = DEFAULT_SPINDLE_SPEED_OVERRIDE;
+    memset(sys_probe_position, 0, sizeof(sys_probe_position));
+    sys_probe_state = 0;
+    sys_rt_exec_state = 0;
+    sys_rt_exec_alarm = 0;
+    sys_rt_exec_motion_override = 0;
+    sys_rt_exec_accessory_override = 0;
+    serial_reset_read_buffer(CLIENT_ALL);
+    gc_init();
+    spindle_select(SPINDLE_TYPE);
+    spindle_init();
+    coolant_init();
+    limits_init();
+    probe_init();
+    plan_reset();
+    st_reset();
+    plan_sync_position();
+    gc_sync_position();
+}
+
+void sim_run(sim_result_t* result) {
+    memset(result, 0, sizeof(sim_result_t));
+    memset(&sim, 0, sizeof(sim));
+    sim.result = result;
+    sim.start = sim_get_time();
+    input.pos = 0;
+    input.byte_ps = sim_options.baud ? 10 * SIM_PS_PER_SEC / sim_options.baud : 0; // 8N1
+    input.last_arrival = sim.start;
+    job.started = false;
+    job.sd_state = SDCARD_IDLE;
+    SD_ready_next = false;
+    grbl_init();
+    report_init_message(CLIENT_ALL);
+    map_axis_pins();
+    sim.running = true;
+    protocol_main_loop();
+    sim.running = false;
+    result->job_ps = sim_get_time() - sim.start;
+    if (!result->done)
+        fprintf(stderr, "simulation aborted before the end of the input\n");
+    sim.result = NULL;
+}
+
+// Nothing is written to the timeline, the machine stays in check mode while
+// compiling.
+static FILE* compile_out;
+
+static bool write_compiled(const void* data, size_t size) {
+    return fwrite(data, 1, size, compile_out) == size;
+}
+
+uint8_t sim_compile(const char* path, FILE* out, uint32_t* line_number) {
+    *line_number = 0;
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+        return STATUS_SD_FAILED_READ;
+    sim_result_t result;
+    memset(&result, 0, sizeof(sim_result_t));
+    memset(&sim, 0, sizeof(sim));
+    sim.result = &result;
+    compile_out = out;
+    grbl_init();
+    char line[SD_LINE_BUFFER_SIZE];
+    line_tokenizer_t tokenizer;
+    uint8_t status = job_compile_begin(write_compiled, CLIENT_SERIAL);
+    if (status == STATUS_OK) {
+        // Lines are split like the SD card reader does it
+        for (;;) {
+            line_tokenizer_init(&tokenizer, line, sizeof(line));
+            bool complete = false;
+            int c;
+            while (!complete && (c = fgetc(f)) != EOF) {
+                uint8_t data = c;
+                if (data != '\r')
+                    line_tokenizer_feed(&tokenizer, &data, 1, &complete);
+            }
+            if (!complete && !line_tokenizer_finish(&tokenizer))
+                break;
+            (*line_number)++;
+            if (tokenizer.flags & LINE_FLAG_OVERFLOW)
+                status = STATUS_OVERFLOW;
+            else
+                status = job_compile_line(line, *line_number);
+            if (status != STATUS_OK)
+                break;
+        }
+        if (status == STATUS_OK)
+            status = job_compile_end(true);
+        else
+            job_compile_end(false);
+    }
+    fclose(f);
+    sim.result = NULL;
+    return status;
+}
+
+void sim_report(FILE* f, const sim_result_t* r) {
+    double motion_s = (double)r->motion_ps / SIM_PS_PER_SEC;
+    fprintf(f, "Job time:      %.6f s\n", (double)r->job_ps / SIM_PS_PER_SEC);
+    fprintf(f, "Motion time:   %.6f s\n", motion_s);
+    fprintf(f, "Path length:   %.3f mm\n", r->path_mm);
+    fprintf(f, "Average feed:  %.1f mm/min\n", motion_s > 0.0 ? r->path_mm * 60.0 / motion_s : 0.0);
+    fprintf(f, "Peak feed:     %.1f mm/min\n", r->peak_feed);
+    fprintf(f, "Steps:        ");
+    for (uint8_t idx = 0; idx < N_AXIS; idx++)
+        fprintf(f, " %c:%u", axis_letters[idx], r->steps[idx]);
+    fprintf(f, "\n");
+    fprintf(f, "Step ISRs:     %u\n", r->step_isrs);
+    fprintf(f, "Lines:         %u (%u ok, %u errors)\n", r->lines, r->oks, r->errors);
+    fprintf(f, "Underruns:     %u\n", r->underruns);
+    if (r->status_frames)
+        fprintf(f, "Status frames: %u (%u not matching the text report)\n", r->status_frames, r->status_mismatches);
+    if (r->realtime_chars)
+        fprintf(f, "Ignored %u realtime command characters\n", r->realtime_chars);
+}
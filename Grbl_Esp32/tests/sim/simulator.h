@@ -0,0 +1,131 @@
+/*
+  simulator.h - host simulator for the Grbl_ESP32 motion core
+  Part of Grbl_ESP32 host simulator
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef simulator_h
+#define simulator_h
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+// Virtual time is kept in picoseconds so that one tick of the 80MHz APB
+// clock that feeds the ESP32 timers (12.5ns) is a whole number.
+#define SIM_PS_PER_APB_TICK 12500ULL
+#define SIM_PS_PER_PLL_D2_TICK 6250ULL // 160MHz, the I2S clock
+#define SIM_PS_PER_US 1000000ULL
+#define SIM_PS_PER_MS 1000000000ULL
+#define SIM_PS_PER_SEC 1000000000000ULL
+
+// Time spent per NOP() in a busy-wait.
+#define SIM_NOP_PS (2 * SIM_PS_PER_APB_TICK)
+
+// ---- Virtual clock, timers and RMT (sim_hal.cpp) ----
+
+// Current virtual time
+uint64_t sim_get_time();
+
+// True while the step timer, an RMT step train or the I2S stream of the
+// stepper is running
+bool sim_stepper_running();
+
+// Advances the virtual clock to time, firing every timer alarm and RMT
+// item that falls inside the interval.
+void sim_advance_to(uint64_t time);
+
+// Runs the stepper until its ISR loads or frees a segment, it stops or the
+// next stepper event would come after limit. Returns false if none was due.
+bool sim_run_step_interrupts(uint64_t limit);
+
+// ---- Hooks called by the HAL into the simulator (simulator.cpp) ----
+
+// Every digitalWrite() ends up here, and each output of the I2S shift
+// registers, as virtual pins after the GPIOs
+#define SIM_I2S_PIN(bit) (GPIO_NUM_MAX + (bit))
+#define SIM_PIN_COUNT SIM_I2S_PIN(32)
+void sim_gpio_write(uint8_t pin, uint8_t level);
+
+// Called after each stepper ISR, of the step timer, the RMT or the I2S
+void sim_step_interrupt_done(uint64_t isr_time);
+
+// ---- Running jobs (simulator.cpp) ----
+
+#define SIM_MAX_AXIS 6
+
+typedef struct {
+    FILE* timeline; // step timeline output, NULL for none
+    uint32_t baud;  // serial link speed, 0 for an infinitely fast link
+    bool verbose;   // show ok responses, start up messages and underruns
+    bool psram;     // the board has PSRAM, so the planner gets its deep buffer
+    uint32_t status_ms; // ask for a text and a binary status report this often, 0 for never
+    FILE* capture;  // everything Grbl sends is written here, NULL for nowhere
+} sim_options_t;
+
+extern sim_options_t sim_options;
+
+// Host time spent in each part of Grbl, exclusive of the parts nested inside
+// (planning inside parsing, stepper ISRs inside segment preparation).
+enum {
+    SIM_PROFILE_PARSE = 0, // gc_execute_line()
+    SIM_PROFILE_PLAN,      // plan_buffer_line()
+    SIM_PROFILE_PREP,      // st_prep_buffer()
+    SIM_PROFILE_STEP,      // stepper ISR
+    SIM_PROFILE_WAIT,      // realtime checks while waiting for the planner or stepper
+    SIM_PROFILE_COUNT
+};
+
+typedef struct {
+    uint64_t ns[SIM_PROFILE_COUNT];
+    uint32_t calls[SIM_PROFILE_COUNT];
+} sim_profile_t;
+
+typedef struct {
+    bool done; // input consumed and all motion finished
+    uint64_t job_ps;
+    uint64_t motion_ps;
+    double path_mm;
+    double peak_feed;
+    uint32_t steps[SIM_MAX_AXIS];
+    uint32_t step_isrs;
+    uint32_t lines;
+    uint32_t oks;
+    uint32_t errors;
+    uint32_t underruns;
+    uint32_t realtime_chars;
+    uint32_t status_frames;
+    uint32_t status_mismatches; // frames that disagree with the text report before them
+    sim_profile_t profile;
+} sim_result_t;
+
+// Appends a g-code file to the input of the next job. A compiled job is
+// played after the g-code, as if from the SD card.
+bool sim_load_file(const char* path);
+
+// Empties the input
+void sim_clear_input();
+
+// Resets Grbl and runs it until the input is consumed and all motion has
+// finished. Can be called repeatedly; the virtual clock keeps running.
+void sim_run(sim_result_t* result);
+
+// Compiles a g-code file into a job (see gcode_job.h) written to out, for
+// the simulated machine. Returns the status of the line that failed, with
+// its number in *line_number.
+uint8_t sim_compile(const char* path, FILE* out, uint32_t* line_number);
+
+// Prints the summary of a job
+void sim_report(FILE* f, const sim_result_t* result);
+
+#endif
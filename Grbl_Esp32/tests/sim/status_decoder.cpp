@@ -0,0 +1,278 @@
+/*
+  status_decoder.cpp - host side decoder of the binary status frames
+  Part of Grbl_ESP32 host simulator
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "status_decoder.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#define MM_PER_INCH 25.40
+
+static const char axis_letters[] = "XYZABC";
+
+void status_decoder_init(status_decoder_t* decoder) {
+    memset(decoder, 0, sizeof(status_decoder_t));
+}
+
+static int take_text(status_decoder_t* d, uint8_t c) {
+    if (c == '\r')
+        return STATUS_DECODER_NONE;
+    if (c == '\n') {
+        d->line[d->line_len] = 0;
+        d->line_len = 0;
+        return STATUS_DECODER_LINE;
+    }
+    if (d->line_len < sizeof(d->line) - 1)
+        d->line[d->line_len++] = c;
+    return STATUS_DECODER_NONE;
+}
+
+// Not a frame after all: the start byte was text, and the bytes after it
+// are looked at again.
+static void reject_frame(status_decoder_t* d) {
+    uint8_t replay[sizeof(d->replay)];
+    size_t len = d->raw_len - 1;
+    memcpy(replay, d->raw + 1, len);
+    memcpy(replay + len, d->replay + d->replay_pos, d->replay_len - d->replay_pos);
+    len += d->replay_len - d->replay_pos;
+    memcpy(d->replay, replay, len);
+    d->replay_pos = 0;
+    d->replay_len = len;
+    d->raw_len = 0;
+    d->bad_frames++;
+    take_text(d, STATUS_FRAME_START);
+}
+
+static int take_byte(status_decoder_t* d, uint8_t c) {
+    if (d->raw_len == 0) {
+        if (c != STATUS_FRAME_START)
+            return take_text(d, c);
+        d->raw[d->raw_len++] = c;
+        return STATUS_DECODER_NONE;
+    }
+    d->raw[d->raw_len++] = c;
+    if (d->raw_len == 2 && c < sizeof(status_frame_t)) {
+        reject_frame(d);
+        return STATUS_DECODER_NONE;
+    }
+    if (d->raw_len < 2 || d->raw_len < d->raw[1])
+        return STATUS_DECODER_NONE;
+    size_t len = d->raw_len;
+    uint16_t crc = d->raw[len - 2] | (d->raw[len - 1] << 8);
+    if (crc != status_frame_crc(d->raw, len - 2) || !status_frame_decode(d->raw, len, &d->frame)) {
+        reject_frame(d);
+        return STATUS_DECODER_NONE;
+    }
+    d->raw_len = 0;
+    d->frames++;
+    return STATUS_DECODER_FRAME;
+}
+
+int status_decoder_next(status_decoder_t* decoder, const uint8_t** data, size_t* len) {
+    for (;;) {
+        uint8_t c;
+        if (decoder->replay_pos < decoder->replay_len)
+            c = decoder->replay[decoder->replay_pos++];
+        else if (*len > 0) {
+            c = *(*data)++;
+            (*len)--;
+        } else
+            return STATUS_DECODER_NONE;
+        int found = take_byte(decoder, c);
+        if (found != STATUS_DECODER_NONE)
+            return found;
+    }
+}
+
+static uint32_t get_le(const uint8_t* data, size_t size) {
+    uint32_t value = 0;
+    while (size--)
+        value = (value << 8) | data[size];
+    return value;
+}
+
+#define GET(field) get_le(data + offsetof(status_frame_t, field), sizeof(frame->field))
+
+bool status_frame_decode(const uint8_t* data, size_t length, status_frame_t* frame) {
+    if (length < sizeof(status_frame_t) || data[0] != STATUS_FRAME_START || data[1] != length ||
+            data[2] < STATUS_FRAME_VERSION)
+        return false;
+    frame->start = GET(start);
+    frame->length = GET(length);
+    frame->version = GET(version);
+    frame->state = GET(state);
+    frame->substate = GET(substate);
+    frame->n_axis = GET(n_axis);
+    frame->flags = GET(flags);
+    frame->accessories = GET(accessories);
+    frame->feed_override = GET(feed_override);
+    frame->rapid_override = GET(rapid_override);
+    frame->spindle_override = GET(spindle_override);
+    frame->reserved = GET(reserved);
+    frame->pins = GET(pins);
+    frame->planner_available = GET(planner_available);
+    frame->rx_available = GET(rx_available);
+    frame->sd_progress = GET(sd_progress);
+    frame->line_number = GET(line_number);
+    frame->feed_rate = GET(feed_rate);
+    frame->spindle_speed = GET(spindle_speed);
+    frame->time_ms = GET(time_ms);
+    for (int idx = 0; idx < STATUS_FRAME_AXES; idx++) {
+        frame->position[idx] = get_le(data + offsetof(status_frame_t, position) + 4 * idx, 4);
+        frame->wco[idx] = get_le(data + offsetof(status_frame_t, wco) + 4 * idx, 4);
+    }
+    frame->crc = get_le(data + length - 2, 2);
+    if (frame->n_axis > STATUS_FRAME_AXES)
+        frame->n_axis = STATUS_FRAME_AXES;
+    return true;
+}
+
+const char* status_frame_state_name(uint8_t state) {
+    static const char* names[] = {"Idle", "Run", "Hold", "Jog", "Home", "Alarm", "Check", "Door", "Sleep"};
+    return state < sizeof(names) / sizeof(names[0]) ? names[state] : "Unknown";
+}
+
+// snprintf() that appends to text
+static void append(char* text, size_t size, int* len, const char* format, ...) __attribute__((format(printf, 4, 5)));
+static void append(char* text, size_t size, int* len, const char* format, ...) {
+    va_list arg;
+    va_start(arg, format);
+    size_t used = (size_t)*len < size ? *len : size;
+    *len += vsnprintf(text + used, size - used, format, arg);
+    va_end(arg);
+}
+
+static void append_axes(char* text, size_t size, int* len, const status_frame_t* frame, const double* mm) {
+    bool inches = frame->flags & STATUS_FRAME_FLAG_INCHES;
+    for (int idx = 0; idx < frame->n_axis; idx++) {
+        if (inches)
+            append(text, size, len, "%s%.4f", idx ? "," : "", mm[idx] / MM_PER_INCH);
+        else
+            append(text, size, len, "%s%.3f", idx ? "," : "", mm[idx]);
+    }
+}
+
+int status_frame_format(const status_frame_t* frame, const float* steps_per_mm, char* text, size_t size) {
+    int len = 0;
+    if (size > 0)
+        text[0] = 0;
+    append(text, size, &len, "<%s", status_frame_state_name(frame->state));
+    if (frame->state == STATUS_FRAME_HOLD || frame->state == STATUS_FRAME_DOOR)
+        append(text, size, &len, ":%u", frame->substate);
+    double position[STATUS_FRAME_AXES], wco[STATUS_FRAME_AXES];
+    for (int idx = 0; idx < frame->n_axis; idx++) {
+        wco[idx] = frame->wco[idx] / 1000.0;
+        position[idx] = frame->position[idx] / steps_per_mm[idx];
+        if (!(frame->flags & STATUS_FRAME_FLAG_MPOS))
+            position[idx] -= wco[idx];
+    }
+    append(text, size, &len, (frame->flags & STATUS_FRAME_FLAG_MPOS) ? "|MPos:" : "|WPos:");
+    append_axes(text, size, &len, frame, position);
+    append(text, size, &len, "|Bf:%u,%u", frame->planner_available, frame->rx_available);
+    if (frame->line_number > 0)
+        append(text, size, &len, "|Ln:%d", frame->line_number);
+    if (frame->flags & STATUS_FRAME_FLAG_INCHES)
+        append(text, size, &len, "|FS:%.1f,%u", frame->feed_rate / 1000.0 / MM_PER_INCH, frame->spindle_speed);
+    else
+        append(text, size, &len, "|FS:%.0f,%u", frame->feed_rate / 1000.0, frame->spindle_speed);
+    if (frame->pins) {
+        append(text, size, &len, "|Pn:%s", (frame->pins & STATUS_FRAME_PIN_PROBE) ? "P" : "");
+        for (int idx = 0; idx < frame->n_axis; idx++) {
+            if (frame->pins & (1 << idx))
+                append(text, size, &len, "%c", axis_letters[idx]);
+        }
+        append(text, size, &len, "%s%s%s%s", (frame->pins & STATUS_FRAME_PIN_DOOR) ? "D" : "", (frame->pins & STATUS_FRAME_PIN_RESET) ? "R" : "",
+               (frame->pins & STATUS_FRAME_PIN_HOLD) ? "H" : "", (frame->pins & STATUS_FRAME_PIN_START) ? "S" : "");
+    }
+    append(text, size, &len, "|WCO:");
+    append_axes(text, size, &len, frame, wco);
+    append(text, size, &len, "|Ov:%u,%u,%u", frame->feed_override, frame->rapid_override, frame->spindle_override);
+    if (frame->accessories) {
+        append(text, size, &len, "|A:%s%s%s", (frame->accessories & STATUS_FRAME_SPINDLE_CW) ? "S" : (frame->accessories & STATUS_FRAME_SPINDLE_CCW) ? "C" : "",
+               (frame->accessories & STATUS_FRAME_FLOOD) ? "F" : "", (frame->accessories & STATUS_FRAME_MIST) ? "M" : "");
+    }
+    if (frame->sd_progress != STATUS_FRAME_NO_SD)
+        append(text, size, &len, "|SD:%.2f,", frame->sd_progress / 100.0);
+    append(text, size, &len, ">");
+    return len;
+}
+
+// Finds the field with key in a report, e.g. "Bf" in "<Idle|Bf:15,128>". Returns its values.
+static const char* find_field(const char* report, const char* key, size_t key_len, size_t* len) {
+    for (const char* p = strchr(report, '|'); p != NULL; p = strchr(p + 1, '|')) {
+        if (strncmp(p + 1, key, key_len) == 0 && p[1 + key_len] == ':') {
+            const char* values = p + 2 + key_len;
+            *len = strcspn(values, "|>");
+            return values;
+        }
+    }
+    return NULL;
+}
+
+// Compares two lists of values, such as "1.000,2.000,0.000". Numbers may differ by about one
+// unit in the last digit of the text report, other values must be the same.
+static bool values_match(const char* text, size_t text_len, const char* frame, size_t frame_len, size_t max_values) {
+    for (size_t n = 0; n < max_values; n++) {
+        size_t a = strcspn(text, ",|>"), b = strcspn(frame, ",|>");
+        if (a > text_len)
+            a = text_len;
+        if (b > frame_len)
+            b = frame_len;
+        std::string va(text, a), vb(frame, b);
+        char *end_a, *end_b;
+        double x = strtod(va.c_str(), &end_a), y = strtod(vb.c_str(), &end_b);
+        if (a > 0 && *end_a == 0 && b > 0 && *end_b == 0) {
+            const char* point = strchr(va.c_str(), '.');
+            double unit = point ? pow(10.0, -(double)strlen(point + 1)) : 1.0;
+            if (fabs(x - y) > 1.5 * unit)
+                return false;
+        } else if (va != vb)
+            return false;
+        if (a == text_len || b == frame_len)
+            return a == text_len && b == frame_len;
+        text += a + 1;
+        text_len -= a + 1;
+        frame += b + 1;
+        frame_len -= b + 1;
+    }
+    return true;
+}
+
+bool status_frame_matches(const status_frame_t* frame, const float* steps_per_mm, const char* text, char* why, size_t size) {
+    char rendered[256];
+    status_frame_format(frame, steps_per_mm, rendered, sizeof(rendered));
+    size_t state_len = strcspn(text, "|>");
+    if (strncmp(text, rendered, state_len) != 0 || strcspn(rendered, "|>") != state_len) {
+        snprintf(why, size, "state differs: %s", rendered);
+        return false;
+    }
+    for (const char* p = strchr(text, '|'); p != NULL; p = strchr(p + 1, '|')) {
+        size_t key_len = strcspn(p + 1, ":|>");
+        size_t text_len = strcspn(p + 2 + key_len, "|>");
+        size_t frame_len;
+        const char* values = find_field(rendered, p + 1, key_len, &frame_len);
+        // The file name of the SD card job is not in the frame
+        size_t max_values = strncmp(p + 1, "SD:", 3) == 0 ? 1 : STATUS_FRAME_AXES;
+        if (values == NULL || !values_match(p + 2 + key_len, text_len, values, frame_len, max_values)) {
+            snprintf(why, size, "%.*s differs: %s", (int)key_len, p + 1, rendered);
+            return false;
+        }
+    }
+    return true;
+}
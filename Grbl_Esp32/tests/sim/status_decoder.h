@@ -0,0 +1,75 @@
+/*
+  status_decoder.h - host side decoder of the binary status frames
+  Part of Grbl_ESP32 host simulator
+
+  Separates the status frames (see status_frame.h) from the text a sender
+  receives from Grbl, checks and decodes them, and renders them like the
+  '?' text report. Only needs status_frame.h, so it can be built into a
+  sender as it is.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef status_decoder_h
+#define status_decoder_h
+
+#include "status_frame.h"
+
+// What status_decoder_next() found
+enum {
+    STATUS_DECODER_NONE = 0, // Needs more data
+    STATUS_DECODER_LINE,     // A text line is complete, in line, without the line end
+    STATUS_DECODER_FRAME,    // A valid status frame is complete, in frame
+};
+
+typedef struct {
+    char line[256];
+    status_frame_t frame; // Fields in host byte order
+    uint32_t frames;      // Valid frames so far
+    uint32_t bad_frames;  // Frames with a bad length or CRC, passed on as text
+
+    // Private
+    size_t line_len;
+    uint8_t raw[256]; // Frame being received
+    size_t raw_len;
+    uint8_t replay[256]; // Bytes after the start of a bad frame, to be looked at again
+    size_t replay_pos;
+    size_t replay_len;
+} status_decoder_t;
+
+void status_decoder_init(status_decoder_t* decoder);
+
+// Takes bytes received from Grbl, from *data on, until a line or a frame is
+// complete. Advances *data and *len past the bytes taken. Call it again
+// until it returns STATUS_DECODER_NONE, even with *len at 0.
+int status_decoder_next(status_decoder_t* decoder, const uint8_t** data, size_t* len);
+
+// Decodes a complete frame of length bytes with a valid CRC. A longer
+// frame of a later version is decoded as far as this version knows it.
+// Returns false if the frame is not a status frame.
+bool status_frame_decode(const uint8_t* data, size_t length, status_frame_t* frame);
+
+// Name of a frame state, as in the text report
+const char* status_frame_state_name(uint8_t state);
+
+// Renders a frame like the '?' text report, with all fields, for a
+// machine with these steps per mm. The SD card file name is left out.
+// Returns the length, as snprintf().
+int status_frame_format(const status_frame_t* frame, const float* steps_per_mm, char* text, size_t size);
+
+// Checks that a frame and a text report taken at the same time agree: the
+// state and every field of the text report must be in the frame, numbers
+// within about one unit of their last digit. Describes the first
+// difference in why.
+bool status_frame_matches(const status_frame_t* frame, const float* steps_per_mm, const char* text, char* why, size_t size);
+
+#endif
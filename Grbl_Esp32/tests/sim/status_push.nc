@@ -0,0 +1,2 @@
+$RI=50
+$RB=50
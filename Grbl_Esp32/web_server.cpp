@@ -450,6 +450,7 @@ bool Web_Server::is_realtime_cmd(char c){
     if (c == CMD_SAFETY_DOOR) return true;
     if (c == CMD_JOG_CANCEL) return true;
     if (c == CMD_DEBUG_REPORT) return true;
+    if (c == CMD_STATUS_FRAME) return true;
     if (c == CMD_FEED_OVR_RESET) return true;
     if (c == CMD_FEED_OVR_COARSE_PLUS) return true;
     if (c == CMD_FEED_OVR_COARSE_MINUS) return true;
@@ -1653,6 +1654,9 @@ void Web_Server::handle_Websocket_Event(uint8_t num, uint8_t type, uint8_t * pay
     switch(type) {
         case WStype_DISCONNECTED:
             //USE_SERIAL.printf("[%u] Disconnected!\n", num);
+            // the reports pushed to CLIENT_WEBUI stop with the last socket
+            if (_socket_server->connectedClients() == 0)
+                status_push_stop(CLIENT_WEBUI);
             break;
         case WStype_CONNECTED:
             {